@@ -35,16 +35,13 @@
 #include "bnetprotocol.h"
 #include "bnet.h"
 #include "map.h"
+#include "mapindex.h"
 #include "packed.h"
 #include "savegame.h"
 #include "replay.h"
 #include "gameprotocol.h"
 #include "game_base.h"
 
-#include <boost/filesystem.hpp>
-
-using namespace boost :: filesystem;
-
 //
 // CBNET
 //
@@ -673,8 +670,8 @@ void CBNET :: ExtractPackets( )
 {
 	// extract as many packets as possible from the socket's receive buffer and put them in the m_Packets queue
 
-	string *RecvBuffer = m_Socket->GetBytes( );
-	BYTEARRAY Bytes = UTIL_CreateByteArray( (unsigned char *)RecvBuffer->c_str( ), RecvBuffer->size( ) );
+	CRecvBuffer *RecvBuffer = m_Socket->GetBytes( );
+	BYTEARRAY Bytes = UTIL_CreateByteArray( (unsigned char *)RecvBuffer->GetData( ), RecvBuffer->GetSize( ) );
 
 	// a packet is at least 4 bytes so loop as long as the buffer contains 4 bytes
 
@@ -693,7 +690,7 @@ void CBNET :: ExtractPackets( )
 				if( Bytes.size( ) >= Length )
 				{
 					m_Packets.push( new CCommandPacket( BNET_HEADER_CONSTANT, Bytes[1], BYTEARRAY( Bytes.begin( ), Bytes.begin( ) + Length ) ) );
-					*RecvBuffer = RecvBuffer->substr( Length );
+					RecvBuffer->Consume( Length );
 					Bytes = BYTEARRAY( Bytes.begin( ) + Length, Bytes.end( ) );
 				}
 				else
@@ -1081,6 +1078,7 @@ void CBNET :: ProcessChatEvent( CIncomingChatEvent *chatEvent )
 				boost::mutex::scoped_lock spoofLock( m_GHost->m_CurrentGame->m_SpoofAddMutex );
 				m_GHost->m_CurrentGame->m_DoSpoofAdd.push_back( SpoofAdd );
 				spoofLock.unlock( );
+				m_GHost->m_CurrentGame->Wake( );
 			}
 		}
 
@@ -1146,6 +1144,7 @@ void CBNET :: ProcessChatEvent( CIncomingChatEvent *chatEvent )
 				boost::mutex::scoped_lock sayLock( m_GHost->m_CurrentGame->m_SayGamesMutex );
 				m_GHost->m_CurrentGame->m_DoSayGames.push_back( FailMessage );
 				sayLock.unlock( );
+				m_GHost->m_CurrentGame->Wake( );
 			}
 
 			if( Message.find( "is using Warcraft III The Frozen Throne in game" ) != string :: npos || Message.find( "is using Warcraft III Frozen Throne and is currently in  game" ) != string :: npos || Message.find( "is using Warcraft III in game" ) != string :: npos || Message.find( "is using Warcraft III  in game" ) != string :: npos )
@@ -1166,6 +1165,7 @@ void CBNET :: ProcessChatEvent( CIncomingChatEvent *chatEvent )
 				boost::mutex::scoped_lock spoofLock( m_GHost->m_CurrentGame->m_SpoofAddMutex );
 				m_GHost->m_CurrentGame->m_DoSpoofAdd.push_back( SpoofAdd );
 				spoofLock.unlock( );
+				m_GHost->m_CurrentGame->Wake( );
 			}
 		}
 
@@ -1269,6 +1269,7 @@ void CBNET :: BotCommand( string Message, string User, bool Whisper, bool ForceR
 				boost::mutex::scoped_lock sayLock( m_GHost->m_CurrentGame->m_SayGamesMutex );
 				m_GHost->m_CurrentGame->m_DoSayGames.push_back( "/kick " + Victim );
 				sayLock.unlock( );
+				m_GHost->m_CurrentGame->Wake( );
 			}
 
 			for( vector<CBaseGame *> :: iterator i = m_GHost->m_Games.begin( ); i != m_GHost->m_Games.end( ); ++i )
@@ -1276,6 +1277,7 @@ void CBNET :: BotCommand( string Message, string User, bool Whisper, bool ForceR
 				boost::mutex::scoped_lock sayLock( (*i)->m_SayGamesMutex );
 				(*i)->m_DoSayGames.push_back( "/kick " + Victim );
 				sayLock.unlock( );
+				(*i)->Wake( );
 			}
 			
 			lock.unlock( );
@@ -1642,71 +1644,41 @@ void CBNET :: BotCommand( string Message, string User, bool Whisper, bool ForceR
 				QueueChatCommand( m_GHost->m_Language->CurrentlyLoadedMapCFGIs( m_GHost->m_Map->GetCFGFile( ) ), User, Whisper );
 			else
 			{
-				string FoundMapConfigs;
+				vector<string> Matches;
+				uint32_t NumMatches = m_GHost->m_MapCFGIndex->Find( Payload, Matches );
 
-				try
+				if( NumMatches == 1 )
 				{
-					path MapCFGPath( m_GHost->m_MapCFGPath );
-					string Pattern = Payload;
-					transform( Pattern.begin( ), Pattern.end( ), Pattern.begin( ), (int(*)(int))tolower );
-
-					if( !exists( MapCFGPath ) )
-					{
-						CONSOLE_Print( "[BNET: " + m_ServerAlias + "] error listing map configs - map config path doesn't exist" );
-						QueueChatCommand( m_GHost->m_Language->ErrorListingMapConfigs( ), User, Whisper );
-					}
-					else
-					{
-						directory_iterator EndIterator;
-						path LastMatch;
-						uint32_t Matches = 0;
-
-                                                        for( directory_iterator i( MapCFGPath ); i != EndIterator; ++i )
-						{
-							string FileName = i->path( ).filename( ).string( );
-							string Stem = i->path( ).stem( ).string( );
-							transform( FileName.begin( ), FileName.end( ), FileName.begin( ), (int(*)(int))tolower );
-							transform( Stem.begin( ), Stem.end( ), Stem.begin( ), (int(*)(int))tolower );
+					string File = Matches[0];
+					QueueChatCommand( m_GHost->m_Language->LoadingConfigFile( m_GHost->m_MapCFGPath + File ), User, Whisper );
+					CConfig MapCFG;
+					MapCFG.Read( m_GHost->m_MapCFGPath + File );
+					m_GHost->m_Map->Load( &MapCFG, m_GHost->m_MapCFGPath + File );
+				}
+				else if( !Matches.empty( ) )
+				{
+					// either several configs matched or nothing matched and these are the closest names (see CMapIndex :: Find)
 
-							if( !is_directory( i->status( ) ) && i->path( ).extension( ) == ".cfg" && FileName.find( Pattern ) != string :: npos )
-							{
-								LastMatch = i->path( );
-                                                                        ++Matches;
+					string FoundMapConfigs;
 
-								if( FoundMapConfigs.empty( ) )
-									FoundMapConfigs = i->path( ).filename( ).string( );
-								else
-									FoundMapConfigs += ", " + i->path( ).filename( ).string( );
+					for( vector<string> :: iterator i = Matches.begin( ); i != Matches.end( ); ++i )
+					{
+						if( !FoundMapConfigs.empty( ) )
+							FoundMapConfigs += ", ";
 
-								// if the pattern matches the filename exactly, with or without extension, stop any further matching
+						FoundMapConfigs += *i;
+					}
 
-								if( FileName == Pattern || Stem == Pattern )
-								{
-									Matches = 1;
-									break;
-								}
-							}
-						}
+					if( NumMatches > Matches.size( ) )
+						FoundMapConfigs += ", ... (" + UTIL_ToString( NumMatches ) + ")";
 
-						if( Matches == 0 )
-							QueueChatCommand( m_GHost->m_Language->NoMapConfigsFound( ), User, Whisper );
-						else if( Matches == 1 )
-						{
-							string File = LastMatch.filename( ).string( );
-							QueueChatCommand( m_GHost->m_Language->LoadingConfigFile( m_GHost->m_MapCFGPath + File ), User, Whisper );
-							CConfig MapCFG;
-							MapCFG.Read( LastMatch.string( ) );
-							m_GHost->m_Map->Load( &MapCFG, m_GHost->m_MapCFGPath + File );
-						}
-						else
-							QueueChatCommand( m_GHost->m_Language->FoundMapConfigs( FoundMapConfigs ), User, Whisper );
-					}
-				}
-				catch( const exception &ex )
-				{
-					CONSOLE_Print( "[BNET: " + m_ServerAlias + "] error listing map configs - caught exception [" + ex.what( ) + "]" );
-					QueueChatCommand( m_GHost->m_Language->ErrorListingMapConfigs( ), User, Whisper );
+					if( NumMatches > 0 )
+						QueueChatCommand( m_GHost->m_Language->FoundMapConfigs( FoundMapConfigs ), User, Whisper );
+					else
+						QueueChatCommand( m_GHost->m_Language->DidYouMeanMapConfigs( FoundMapConfigs ), User, Whisper );
 				}
+				else
+					QueueChatCommand( m_GHost->m_Language->NoMapConfigsFound( ), User, Whisper );
 			}
 		}
 
@@ -1753,75 +1725,45 @@ void CBNET :: BotCommand( string Message, string User, bool Whisper, bool ForceR
 				QueueChatCommand( m_GHost->m_Language->CurrentlyLoadedMapCFGIs( m_GHost->m_Map->GetCFGFile( ) ), User, Whisper );
 			else
 			{
-				string FoundMaps;
+				vector<string> Matches;
+				uint32_t NumMatches = m_GHost->m_MapIndex->Find( Payload, Matches );
 
-				try
+				if( NumMatches == 1 )
 				{
-					path MapPath( m_GHost->m_MapPath );
-					string Pattern = Payload;
-					transform( Pattern.begin( ), Pattern.end( ), Pattern.begin( ), (int(*)(int))tolower );
+					string File = Matches[0];
+					QueueChatCommand( m_GHost->m_Language->LoadingConfigFile( File ), User, Whisper );
 
-					if( !exists( MapPath ) )
-					{
-						CONSOLE_Print( "[BNET: " + m_ServerAlias + "] error listing maps - map path doesn't exist" );
-						QueueChatCommand( m_GHost->m_Language->ErrorListingMaps( ), User, Whisper );
-					}
-					else
-					{
-						directory_iterator EndIterator;
-						path LastMatch;
-						uint32_t Matches = 0;
-
-                                                        for( directory_iterator i( MapPath ); i != EndIterator; ++i )
-						{
-							string FileName = i->path( ).filename( ).string( );
-							string Stem = i->path( ).stem( ).string( );
-							transform( FileName.begin( ), FileName.end( ), FileName.begin( ), (int(*)(int))tolower );
-							transform( Stem.begin( ), Stem.end( ), Stem.begin( ), (int(*)(int))tolower );
+					// hackhack: create a config file in memory with the required information to load the map
 
-							if( !is_directory( i->status( ) ) && FileName.find( Pattern ) != string :: npos )
-							{
-								LastMatch = i->path( );
-                                                                        ++Matches;
-
-								if( FoundMaps.empty( ) )
-									FoundMaps = i->path( ).filename( ).string( );
-								else
-									FoundMaps += ", " + i->path( ).filename( ).string( );
+					CConfig MapCFG;
+					MapCFG.Set( "map_path", "Maps\\Download\\" + File );
+					MapCFG.Set( "map_localpath", File );
+					m_GHost->m_Map->Load( &MapCFG, File );
+				}
+				else if( !Matches.empty( ) )
+				{
+					// either several maps matched or nothing matched and these are the closest names (see CMapIndex :: Find)
 
-								// if the pattern matches the filename exactly, with or without extension, stop any further matching
+					string FoundMaps;
 
-								if( FileName == Pattern || Stem == Pattern )
-								{
-									Matches = 1;
-									break;
-								}
-							}
-						}
+					for( vector<string> :: iterator i = Matches.begin( ); i != Matches.end( ); ++i )
+					{
+						if( !FoundMaps.empty( ) )
+							FoundMaps += ", ";
 
-						if( Matches == 0 )
-							QueueChatCommand( m_GHost->m_Language->NoMapsFound( ), User, Whisper );
-						else if( Matches == 1 )
-						{
-							string File = LastMatch.filename( ).string( );
-							QueueChatCommand( m_GHost->m_Language->LoadingConfigFile( File ), User, Whisper );
+						FoundMaps += *i;
+					}
 
-							// hackhack: create a config file in memory with the required information to load the map
+					if( NumMatches > Matches.size( ) )
+						FoundMaps += ", ... (" + UTIL_ToString( NumMatches ) + ")";
 
-							CConfig MapCFG;
-							MapCFG.Set( "map_path", "Maps\\Download\\" + File );
-							MapCFG.Set( "map_localpath", File );
-							m_GHost->m_Map->Load( &MapCFG, File );
-						}
-						else
-							QueueChatCommand( m_GHost->m_Language->FoundMaps( FoundMaps ), User, Whisper );
-					}
-				}
-				catch( const exception &ex )
-				{
-					CONSOLE_Print( "[BNET: " + m_ServerAlias + "] error listing maps - caught exception [" + ex.what( ) + "]" );
-					QueueChatCommand( m_GHost->m_Language->ErrorListingMaps( ), User, Whisper );
+					if( NumMatches > 0 )
+						QueueChatCommand( m_GHost->m_Language->FoundMaps( FoundMaps ), User, Whisper );
+					else
+						QueueChatCommand( m_GHost->m_Language->DidYouMeanMaps( FoundMaps ), User, Whisper );
 				}
+				else
+					QueueChatCommand( m_GHost->m_Language->NoMapsFound( ), User, Whisper );
 			}
 		}
 
@@ -1977,6 +1919,7 @@ void CBNET :: BotCommand( string Message, string User, bool Whisper, bool ForceR
 					boost::mutex::scoped_lock sayLock( m_GHost->m_CurrentGame->m_SayGamesMutex );
 					m_GHost->m_CurrentGame->m_DoSayGames.push_back( Payload );
 					sayLock.unlock( );
+					m_GHost->m_CurrentGame->Wake( );
 				}
 
 				for( vector<CBaseGame *> :: iterator i = m_GHost->m_Games.begin( ); i != m_GHost->m_Games.end( ); ++i )
@@ -1984,6 +1927,7 @@ void CBNET :: BotCommand( string Message, string User, bool Whisper, bool ForceR
 					boost::mutex::scoped_lock sayLock( (*i)->m_SayGamesMutex );
 					(*i)->m_DoSayGames.push_back( Payload );
 					sayLock.unlock( );
+					(*i)->Wake( );
 				}
 
 				lock.unlock( );
@@ -133,8 +133,8 @@ bool CBNLSClient :: Update( void *fd, void *send_fd )
 
 void CBNLSClient :: ExtractPackets( )
 {
-	string *RecvBuffer = m_Socket->GetBytes( );
-	BYTEARRAY Bytes = UTIL_CreateByteArray( (unsigned char *)RecvBuffer->c_str( ), RecvBuffer->size( ) );
+	CRecvBuffer *RecvBuffer = m_Socket->GetBytes( );
+	BYTEARRAY Bytes = UTIL_CreateByteArray( (unsigned char *)RecvBuffer->GetData( ), RecvBuffer->GetSize( ) );
 
 	while( Bytes.size( ) >= 3 )
 	{
@@ -145,7 +145,7 @@ void CBNLSClient :: ExtractPackets( )
 			if( Bytes.size( ) >= Length )
 			{
 				m_Packets.push( new CCommandPacket( 0, Bytes[2], BYTEARRAY( Bytes.begin( ), Bytes.begin( ) + Length ) ) );
-				*RecvBuffer = RecvBuffer->substr( Length );
+				RecvBuffer->Consume( Length );
 				Bytes = BYTEARRAY( Bytes.begin( ) + Length, Bytes.end( ) );
 			}
 			else
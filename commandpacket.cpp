@@ -39,3 +39,34 @@ CCommandPacket :: ~CCommandPacket( )
 {
 
 }
+
+//
+// CPacketView
+//
+
+CPacketView :: FrameResult CPacketView :: Frame( const unsigned char *data, uint32_t size )
+{
+	// point this view at the packet at the front of data
+	// every W3GS, GPS and GCBI packet starts with a one byte header constant and a one byte ID followed by the two byte length of the whole packet
+	// the header constant isn't checked here since which ones are acceptable depends on who's reading
+
+	m_Data = NULL;
+	m_Length = 0;
+
+	// a packet is at least 4 bytes
+
+	if( size < 4 )
+		return FRAME_INCOMPLETE;
+
+	uint16_t Length = (uint16_t)( data[2] | ( data[3] << 8 ) );
+
+	if( Length < 4 )
+		return FRAME_BADLENGTH;
+
+	if( size < Length )
+		return FRAME_INCOMPLETE;
+
+	m_Data = data;
+	m_Length = Length;
+	return FRAME_OK;
+}
@@ -46,4 +46,43 @@ public:
 	BYTEARRAY GetData( )			{ return m_Data; }
 };
 
+//
+// CPacketView
+//
+
+// a non-owning view (pointer plus length) of one packet that's still sitting in a socket's receive buffer
+// this lets the hot packets (keepalives, actions, pongs) be parsed straight out of the receive buffer without allocating or copying anything
+// the view is only valid until the socket receives more data so a handler that wants to keep any part of the packet must copy it out (e.g. with GetData)
+
+class CPacketView
+{
+public:
+	enum FrameResult {
+		FRAME_OK			= 0,	// a complete packet was framed
+		FRAME_INCOMPLETE	= 1,	// the packet hasn't been fully received yet
+		FRAME_BADLENGTH		= 2		// the length field is invalid
+	};
+
+private:
+	const unsigned char *m_Data;
+	uint32_t m_Length;
+
+public:
+	CPacketView( ) : m_Data( NULL ), m_Length( 0 ) { }
+	CPacketView( const unsigned char *nData, uint32_t nLength ) : m_Data( nData ), m_Length( nLength ) { }
+
+	unsigned char GetPacketType( )		{ return m_Data[0]; }
+	int GetID( )						{ return m_Data[1]; }
+	const unsigned char *GetBytes( )	{ return m_Data; }
+	uint32_t GetLength( )				{ return m_Length; }
+	BYTEARRAY GetData( )				{ return BYTEARRAY( m_Data, m_Data + m_Length ); }
+
+	// little endian integers at the given offset, the caller must check the length first
+
+	uint16_t GetUInt16( uint32_t start )	{ return (uint16_t)( m_Data[start] | ( m_Data[start + 1] << 8 ) ); }
+	uint32_t GetUInt32( uint32_t start )	{ return (uint32_t)m_Data[start] | ( (uint32_t)m_Data[start + 1] << 8 ) | ( (uint32_t)m_Data[start + 2] << 16 ) | ( (uint32_t)m_Data[start + 3] << 24 ); }
+
+	FrameResult Frame( const unsigned char *data, uint32_t size );
+};
+
 #endif
@@ -120,3 +120,20 @@ void CConfig :: Set( string key, string x )
 {
 	m_CFG[key] = x;
 }
+
+bool CConfig :: Write( string file )
+{
+	// write every value in a format Read can load
+
+	ofstream out;
+	out.open( file.c_str( ) );
+
+	if( out.fail( ) )
+		return false;
+
+	for( map<string, string> :: iterator i = m_CFG.begin( ); i != m_CFG.end( ); ++i )
+		out << i->first << " = " << i->second << endl;
+
+	out.close( );
+	return !out.fail( );
+}
@@ -1,17 +1,158 @@
 #include "ghost.h"
 #include "crc32.h"
 
+#if defined( __GNUC__ ) && defined( __x86_64__ )
+ #define CRC32_CLMUL
+ #include <cpuid.h>
+ #include <emmintrin.h>
+ #include <smmintrin.h>
+ #include <wmmintrin.h>
+#endif
+
+// buffers shorter than this aren't worth setting up the carry-less multiplication for
+
+#define CRC32_CLMUL_MINIMUM		64
+
+#ifdef CRC32_CLMUL
+
+// fold 64 byte blocks with PCLMULQDQ and Barrett reduce the result to 32 bits
+// see "Fast CRC Computation for Generic Polynomials Using PCLMULQDQ Instruction" (Gopal et al, Intel 2009)
+// the constants are the bit reflected x^n mod P(x) values for the CRC32 polynomial given at the end of that paper
+// ulLength must be at least 64 and a multiple of 16, ulCRC is the raw (not inverted) CRC register
+
+__attribute__(( target( "pclmul,sse4.1" ) )) static uint32_t CLMULCRC( uint32_t ulCRC, unsigned char *sData, uint32_t ulLength )
+{
+	static const uint64_t K1K2[2] __attribute__(( aligned( 16 ) )) = { 0x0154442bd4ULL, 0x01c6e41596ULL };
+	static const uint64_t K3K4[2] __attribute__(( aligned( 16 ) )) = { 0x01751997d0ULL, 0x00ccaa009eULL };
+	static const uint64_t K5K0[2] __attribute__(( aligned( 16 ) )) = { 0x0163cd6124ULL, 0x0000000000ULL };
+	static const uint64_t Poly[2] __attribute__(( aligned( 16 ) )) = { 0x01db710641ULL, 0x01f7011641ULL };
+
+	__m128i x0, x1, x2, x3, x4, x5, x6, x7, x8, y5, y6, y7, y8;
+
+	x1 = _mm_loadu_si128( (__m128i *)( sData + 0x00 ) );
+	x2 = _mm_loadu_si128( (__m128i *)( sData + 0x10 ) );
+	x3 = _mm_loadu_si128( (__m128i *)( sData + 0x20 ) );
+	x4 = _mm_loadu_si128( (__m128i *)( sData + 0x30 ) );
+	x1 = _mm_xor_si128( x1, _mm_cvtsi32_si128( ulCRC ) );
+	x0 = _mm_load_si128( (__m128i *)K1K2 );
+	sData += 64;
+	ulLength -= 64;
+
+	// fold four 16 byte lanes in parallel
+
+	while( ulLength >= 64 )
+	{
+		x5 = _mm_clmulepi64_si128( x1, x0, 0x00 );
+		x6 = _mm_clmulepi64_si128( x2, x0, 0x00 );
+		x7 = _mm_clmulepi64_si128( x3, x0, 0x00 );
+		x8 = _mm_clmulepi64_si128( x4, x0, 0x00 );
+
+		x1 = _mm_clmulepi64_si128( x1, x0, 0x11 );
+		x2 = _mm_clmulepi64_si128( x2, x0, 0x11 );
+		x3 = _mm_clmulepi64_si128( x3, x0, 0x11 );
+		x4 = _mm_clmulepi64_si128( x4, x0, 0x11 );
+
+		y5 = _mm_loadu_si128( (__m128i *)( sData + 0x00 ) );
+		y6 = _mm_loadu_si128( (__m128i *)( sData + 0x10 ) );
+		y7 = _mm_loadu_si128( (__m128i *)( sData + 0x20 ) );
+		y8 = _mm_loadu_si128( (__m128i *)( sData + 0x30 ) );
+
+		x1 = _mm_xor_si128( _mm_xor_si128( x1, x5 ), y5 );
+		x2 = _mm_xor_si128( _mm_xor_si128( x2, x6 ), y6 );
+		x3 = _mm_xor_si128( _mm_xor_si128( x3, x7 ), y7 );
+		x4 = _mm_xor_si128( _mm_xor_si128( x4, x8 ), y8 );
+
+		sData += 64;
+		ulLength -= 64;
+	}
+
+	// fold the four lanes into one
+
+	x0 = _mm_load_si128( (__m128i *)K3K4 );
+
+	x5 = _mm_clmulepi64_si128( x1, x0, 0x00 );
+	x1 = _mm_clmulepi64_si128( x1, x0, 0x11 );
+	x1 = _mm_xor_si128( _mm_xor_si128( x1, x2 ), x5 );
+
+	x5 = _mm_clmulepi64_si128( x1, x0, 0x00 );
+	x1 = _mm_clmulepi64_si128( x1, x0, 0x11 );
+	x1 = _mm_xor_si128( _mm_xor_si128( x1, x3 ), x5 );
+
+	x5 = _mm_clmulepi64_si128( x1, x0, 0x00 );
+	x1 = _mm_clmulepi64_si128( x1, x0, 0x11 );
+	x1 = _mm_xor_si128( _mm_xor_si128( x1, x4 ), x5 );
+
+	// fold the remaining 16 byte blocks
+
+	while( ulLength >= 16 )
+	{
+		x2 = _mm_loadu_si128( (__m128i *)sData );
+
+		x5 = _mm_clmulepi64_si128( x1, x0, 0x00 );
+		x1 = _mm_clmulepi64_si128( x1, x0, 0x11 );
+		x1 = _mm_xor_si128( _mm_xor_si128( x1, x2 ), x5 );
+
+		sData += 16;
+		ulLength -= 16;
+	}
+
+	// fold 128 bits to 64 bits
+
+	x2 = _mm_clmulepi64_si128( x1, x0, 0x10 );
+	x3 = _mm_setr_epi32( ~0, 0, ~0, 0 );
+	x1 = _mm_srli_si128( x1, 8 );
+	x1 = _mm_xor_si128( x1, x2 );
+
+	x0 = _mm_loadl_epi64( (__m128i *)K5K0 );
+
+	x2 = _mm_srli_si128( x1, 4 );
+	x1 = _mm_and_si128( x1, x3 );
+	x1 = _mm_clmulepi64_si128( x1, x0, 0x00 );
+	x1 = _mm_xor_si128( x1, x2 );
+
+	// Barrett reduce to 32 bits
+
+	x0 = _mm_load_si128( (__m128i *)Poly );
+
+	x2 = _mm_and_si128( x1, x3 );
+	x2 = _mm_clmulepi64_si128( x2, x0, 0x10 );
+	x2 = _mm_and_si128( x2, x3 );
+	x2 = _mm_clmulepi64_si128( x2, x0, 0x00 );
+	x1 = _mm_xor_si128( x1, x2 );
+
+	return _mm_extract_epi32( x1, 1 );
+}
+
+#endif
+
 void CCRC32 :: Initialize( )
 {
         for( int iCodes = 0; iCodes <= 0xFF; ++iCodes )
 	{
-		ulTable[iCodes] = Reflect( iCodes, 8 ) << 24;
+		ulTable[0][iCodes] = Reflect( iCodes, 8 ) << 24;
 
 		for( int iPos = 0; iPos < 8; iPos++ )
-			ulTable[iCodes] = ( ulTable[iCodes] << 1 ) ^ ( ulTable[iCodes] & (1 << 31) ? CRC32_POLYNOMIAL : 0 );
+			ulTable[0][iCodes] = ( ulTable[0][iCodes] << 1 ) ^ ( ulTable[0][iCodes] & (1 << 31) ? CRC32_POLYNOMIAL : 0 );
 
-		ulTable[iCodes] = Reflect( ulTable[iCodes], 32 );
+		ulTable[0][iCodes] = Reflect( ulTable[0][iCodes], 32 );
 	}
+
+	// ulTable[n][i] is the CRC of byte i followed by n zero bytes, this lets SliceCRC process 8 bytes with 8 independent lookups
+
+	for( int iCodes = 0; iCodes <= 0xFF; ++iCodes )
+	{
+		for( int iSlice = 1; iSlice < 8; ++iSlice )
+			ulTable[iSlice][iCodes] = ( ulTable[iSlice - 1][iCodes] >> 8 ) ^ ulTable[0][ulTable[iSlice - 1][iCodes] & 0xFF];
+	}
+
+	bCLMUL = false;
+
+#ifdef CRC32_CLMUL
+	unsigned int eax, ebx, ecx, edx;
+
+	if( __get_cpuid( 1, &eax, &ebx, &ecx, &edx ) && ( ecx & bit_PCLMUL ) && ( ecx & bit_SSE4_1 ) )
+		bCLMUL = true;
+#endif
 }
 
 uint32_t CCRC32 :: Reflect( uint32_t ulReflect, char cChar )
@@ -38,6 +179,39 @@ uint32_t CCRC32 :: FullCRC( unsigned char *sData, uint32_t ulLength )
 
 void CCRC32 :: PartialCRC( uint32_t *ulInCRC, unsigned char *sData, uint32_t ulLength )
 {
+#ifdef CRC32_CLMUL
+	if( bCLMUL && ulLength >= CRC32_CLMUL_MINIMUM )
+	{
+		uint32_t ulBlocks = ulLength & ~15;
+		*ulInCRC = CLMULCRC( *ulInCRC, sData, ulBlocks );
+		sData += ulBlocks;
+		ulLength -= ulBlocks;
+	}
+#endif
+
+	SliceCRC( ulInCRC, sData, ulLength );
+}
+
+void CCRC32 :: SliceCRC( uint32_t *ulInCRC, unsigned char *sData, uint32_t ulLength )
+{
+	uint32_t ulCRC = *ulInCRC;
+
+	// the bytes are combined by hand rather than loaded as words so this works the same regardless of alignment and byte order
+
+	while( ulLength >= 8 )
+	{
+		uint32_t ulOne = ulCRC ^ ( sData[0] | ( sData[1] << 8 ) | ( sData[2] << 16 ) | ( (uint32_t)sData[3] << 24 ) );
+		uint32_t ulTwo = sData[4] | ( sData[5] << 8 ) | ( sData[6] << 16 ) | ( (uint32_t)sData[7] << 24 );
+
+		ulCRC = ulTable[7][ulOne & 0xFF] ^ ulTable[6][( ulOne >> 8 ) & 0xFF] ^ ulTable[5][( ulOne >> 16 ) & 0xFF] ^ ulTable[4][ulOne >> 24] ^
+				ulTable[3][ulTwo & 0xFF] ^ ulTable[2][( ulTwo >> 8 ) & 0xFF] ^ ulTable[1][( ulTwo >> 16 ) & 0xFF] ^ ulTable[0][ulTwo >> 24];
+
+		sData += 8;
+		ulLength -= 8;
+	}
+
 	while( ulLength-- )
-		*ulInCRC = ( *ulInCRC >> 8 ) ^ ulTable[( *ulInCRC & 0xFF ) ^ *sData++];
+		ulCRC = ( ulCRC >> 8 ) ^ ulTable[0][( ulCRC & 0xFF ) ^ *sData++];
+
+	*ulInCRC = ulCRC;
 }
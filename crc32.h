@@ -3,16 +3,25 @@
 
 #define CRC32_POLYNOMIAL 0x04c11db7
 
+// PartialCRC picks the fastest implementation the CPU supports when the object is initialized
+// all of them produce exactly the same result as the original byte at a time table lookup
+//  - on x86-64 CPUs with PCLMULQDQ (and SSE4.1) blocks of 64 bytes are folded with carry-less multiplication
+//  - otherwise (and for the head and tail of the buffer) 8 bytes are processed per iteration with eight lookup tables ("slicing-by-8")
+
 class CCRC32
 {
 public:
 	void Initialize( );
 	uint32_t FullCRC( unsigned char *sData, uint32_t ulLength );
 	void PartialCRC( uint32_t *ulInCRC, unsigned char *sData, uint32_t ulLength );
+	bool UsingCLMUL( )		{ return bCLMUL; }
+	void DisableCLMUL( )	{ bCLMUL = false; }		// only used to test and time the slicing-by-8 path on CPUs with PCLMULQDQ (see crc32bench)
 
 private:
 	uint32_t Reflect( uint32_t ulReflect, char cChar );
-	uint32_t ulTable[256];
+	void SliceCRC( uint32_t *ulInCRC, unsigned char *sData, uint32_t ulLength );
+	uint32_t ulTable[8][256];
+	bool bCLMUL;
 };
 
 #endif
@@ -0,0 +1,282 @@
+/*
+
+	ent-ghost
+	Copyright [2011-2013] [Jack Lu]
+
+	This file is part of the ent-ghost source code.
+
+	ent-ghost is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	ent-ghost source code is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with ent-ghost source code. If not, see <http://www.gnu.org/licenses/>.
+
+	ent-ghost is modified from GHost++ (http://ghostplusplus.googlecode.com/)
+	GHost++ is Copyright [2008] [Trevor Hogan]
+
+*/
+
+#include "ghost.h"
+#include "util.h"
+#include "crc32.h"
+#include "gameprotocol.h"
+
+#include <time.h>
+
+#ifndef WIN32
+ #include <sys/time.h>
+#endif
+
+#ifdef __APPLE__
+ #include <mach/mach_time.h>
+#endif
+
+// crc32bench is a separate program that checks every CCRC32 implementation against fixed vectors and a plain byte at a time CRC, then times them
+// the slicing-by-8 path is always checked, the PCLMULQDQ path only on CPUs that support it
+// map files can be given as arguments, optionally followed by "=" and the expected map CRC in hex (the CRC32 of the whole file)
+
+#define CRC32BENCH_MINTICKS 1000
+
+boost::mutex PrintMutex;
+uint32_t gResult = 0;		// the timed CRCs are combined into this so they can't be optimized away
+
+uint32_t GetTime( )
+{
+	return GetTicks( ) / 1000;
+}
+
+uint32_t GetTicks( )
+{
+#ifdef WIN32
+	return timeGetTime( );
+#elif __APPLE__
+	uint64_t current = mach_absolute_time( );
+	static mach_timebase_info_data_t info = { 0, 0 };
+
+	if( info.denom == 0 )
+		mach_timebase_info( &info );
+
+	uint64_t elapsednano = current * ( info.numer / info.denom );
+	return elapsednano / 1e6;
+#else
+	uint32_t ticks;
+	struct timespec t;
+	clock_gettime( CLOCK_MONOTONIC, &t );
+	ticks = t.tv_sec * 1000;
+	ticks += t.tv_nsec / 1000000;
+	return ticks;
+#endif
+}
+
+void CONSOLE_Print( string message )
+{
+	boost::mutex::scoped_lock printLock( PrintMutex );
+	cout << message << endl;
+}
+
+// the reference, one bit at a time with the reflected polynomial so it shares nothing with CCRC32
+
+uint32_t ReferenceCRC( const unsigned char *data, uint32_t length )
+{
+	uint32_t CRC = 0xFFFFFFFF;
+
+	for( uint32_t i = 0; i < length; ++i )
+	{
+		CRC ^= data[i];
+
+		for( int j = 0; j < 8; ++j )
+			CRC = ( CRC >> 1 ) ^ ( CRC & 1 ? 0xEDB88320 : 0 );
+	}
+
+	return CRC ^ 0xFFFFFFFF;
+}
+
+string GenerateData( uint32_t size )
+{
+	string Data( size, 0 );
+	uint32_t Seed = 12345;
+
+	for( uint32_t i = 0; i < size; ++i )
+	{
+		Seed = Seed * 1103515245 + 12345;
+		Data[i] = (char)( Seed >> 24 );
+	}
+
+	return Data;
+}
+
+string ToHex( uint32_t crc )
+{
+	char Buffer[9];
+	snprintf( Buffer, sizeof( Buffer ), "%08x", crc );
+	return Buffer;
+}
+
+//
+// the implementations
+//
+
+struct CRCPath {
+	string name;
+	CCRC32 *crc;
+};
+
+bool Check( vector<CRCPath> &paths, string name, const unsigned char *data, uint32_t length, uint32_t expected )
+{
+	bool Success = true;
+
+	for( vector<CRCPath> :: iterator i = paths.begin( ); i != paths.end( ); ++i )
+	{
+		uint32_t CRC = i->crc->FullCRC( (unsigned char *)data, length );
+
+		// the same data split into two partial CRCs at an odd position has to give the same result
+
+		uint32_t Split = length / 3 | 1;
+		uint32_t PartialCRC = 0xFFFFFFFF;
+
+		if( Split > length )
+			Split = length;
+
+		i->crc->PartialCRC( &PartialCRC, (unsigned char *)data, Split );
+		i->crc->PartialCRC( &PartialCRC, (unsigned char *)data + Split, length - Split );
+		PartialCRC ^= 0xFFFFFFFF;
+
+		if( CRC != expected || PartialCRC != expected )
+		{
+			CONSOLE_Print( "[CRC32BENCH] " + i->name + " failed on " + name + ", expected " + ToHex( expected ) + ", got " + ToHex( CRC ) + " (full) and " + ToHex( PartialCRC ) + " (partial)" );
+			Success = false;
+		}
+	}
+
+	return Success;
+}
+
+void Time( vector<CRCPath> &paths, string name, const string &data, uint32_t chunkSize )
+{
+	CONSOLE_Print( "[CRC32BENCH] " + name );
+
+	for( vector<CRCPath> :: iterator i = paths.begin( ); i != paths.end( ); ++i )
+	{
+		uint64_t Bytes = 0;
+		uint32_t StartTicks = GetTicks( );
+
+		do
+		{
+			for( uint32_t j = 0; j < data.size( ); j += chunkSize )
+				gResult ^= i->crc->FullCRC( (unsigned char *)data.data( ) + j, min( (uint32_t)data.size( ) - j, chunkSize ) );
+
+			Bytes += data.size( );
+		} while( GetTicks( ) - StartTicks < CRC32BENCH_MINTICKS );
+
+		uint32_t Ticks = GetTicks( ) - StartTicks;
+		CONSOLE_Print( "[CRC32BENCH]   " + i->name + ": " + UTIL_ToString( Bytes / 1048576.0 * 1000 / max( Ticks, (uint32_t)1 ), 1 ) + " MB/s" );
+	}
+}
+
+int main( int argc, char **argv )
+{
+	CCRC32 Slicing;
+	Slicing.Initialize( );
+	Slicing.DisableCLMUL( );
+	CCRC32 CLMUL;
+	CLMUL.Initialize( );
+
+	vector<CRCPath> Paths;
+	CRCPath Path;
+	Path.name = "slicing-by-8";
+	Path.crc = &Slicing;
+	Paths.push_back( Path );
+
+	if( CLMUL.UsingCLMUL( ) )
+	{
+		Path.name = "PCLMULQDQ";
+		Path.crc = &CLMUL;
+		Paths.push_back( Path );
+	}
+	else
+		CONSOLE_Print( "[CRC32BENCH] this CPU doesn't support PCLMULQDQ, only checking slicing-by-8" );
+
+	bool Success = true;
+
+	// the standard check values
+
+	string Check1 = "123456789";
+	string Check2 = "The quick brown fox jumps over the lazy dog";
+	string Zeros( 1048576, 0 );
+	string Bytes( 1048581, 0 );
+
+	for( uint32_t i = 0; i < Bytes.size( ); ++i )
+		Bytes[i] = (char)( i & 0xFF );
+
+	Success = Check( Paths, "the empty string", (const unsigned char *)"", 0, 0x00000000 ) && Success;
+	Success = Check( Paths, "\"" + Check1 + "\"", (const unsigned char *)Check1.data( ), Check1.size( ), 0xcbf43926 ) && Success;
+	Success = Check( Paths, "\"" + Check2 + "\"", (const unsigned char *)Check2.data( ), Check2.size( ), 0x414fa339 ) && Success;
+	Success = Check( Paths, "1 MB of zeros", (const unsigned char *)Zeros.data( ), Zeros.size( ), 0xa738ea1c ) && Success;
+	Success = Check( Paths, "1 MB + 5 of counting bytes", (const unsigned char *)Bytes.data( ), Bytes.size( ), 0x8863c261 ) && Success;
+
+	// every length around the 8, 16 and 64 byte boundaries the implementations switch at, starting at every alignment
+
+	string Data = GenerateData( 4 * 1024 * 1024 );
+
+	for( uint32_t Offset = 0; Offset < 16; ++Offset )
+	{
+		for( uint32_t Length = 0; Length <= 300; ++Length )
+			Success = Check( Paths, UTIL_ToString( Length ) + " bytes at offset " + UTIL_ToString( Offset ), (const unsigned char *)Data.data( ) + Offset, Length, ReferenceCRC( (const unsigned char *)Data.data( ) + Offset, Length ) ) && Success;
+
+		Success = Check( Paths, UTIL_ToString( MAPPART_SIZE ) + " bytes at offset " + UTIL_ToString( Offset ), (const unsigned char *)Data.data( ) + Offset, MAPPART_SIZE, ReferenceCRC( (const unsigned char *)Data.data( ) + Offset, MAPPART_SIZE ) ) && Success;
+	}
+
+	Success = Check( Paths, "4 MB of generated data", (const unsigned char *)Data.data( ), Data.size( ), ReferenceCRC( (const unsigned char *)Data.data( ), Data.size( ) ) ) && Success;
+
+	// map files
+
+	for( int i = 1; i < argc; ++i )
+	{
+		string Arg = argv[i];
+		string :: size_type Split = Arg.rfind( '=' );
+		string FileName = Split == string :: npos ? Arg : Arg.substr( 0, Split );
+		string File = UTIL_FileRead( FileName );
+
+		if( File.empty( ) )
+		{
+			CONSOLE_Print( "[CRC32BENCH] couldn't read [" + FileName + "]" );
+			Success = false;
+			continue;
+		}
+
+		uint32_t Expected = ReferenceCRC( (const unsigned char *)File.data( ), File.size( ) );
+
+		if( Split != string :: npos && Expected != (uint32_t)strtoul( Arg.substr( Split + 1 ).c_str( ), NULL, 16 ) )
+		{
+			CONSOLE_Print( "[CRC32BENCH] the CRC of [" + FileName + "] is " + ToHex( Expected ) + ", not " + Arg.substr( Split + 1 ) );
+			Success = false;
+			continue;
+		}
+
+		if( Check( Paths, "[" + FileName + "]", (const unsigned char *)File.data( ), File.size( ), Expected ) )
+			CONSOLE_Print( "[CRC32BENCH] [" + FileName + "] has CRC " + ToHex( Expected ) );
+		else
+			Success = false;
+	}
+
+	if( !Success )
+	{
+		CONSOLE_Print( "[CRC32BENCH] FAILED" );
+		return 1;
+	}
+
+	CONSOLE_Print( "[CRC32BENCH] every implementation matches" );
+
+	// the map CRC is calculated over the whole map and over every map part when a map is loaded (see CMap :: GetMapPartCRC)
+
+	Time( Paths, "4 MB map", Data, Data.size( ) );
+	Time( Paths, UTIL_ToString( MAPPART_SIZE ) + " byte map parts", Data, MAPPART_SIZE );
+	return 0;
+}
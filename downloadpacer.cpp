@@ -0,0 +1,125 @@
+/*
+
+	ent-ghost
+	Copyright [2011-2013] [Jack Lu]
+
+	This file is part of the ent-ghost source code.
+
+	ent-ghost is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	ent-ghost source code is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with ent-ghost source code. If not, see <http://www.gnu.org/licenses/>.
+
+	ent-ghost is modified from GHost++ (http://ghostplusplus.googlecode.com/)
+	GHost++ is Copyright [2008] [Trevor Hogan]
+
+*/
+
+#include "ghost.h"
+#include "gameprotocol.h"
+#include "downloadpacer.h"
+
+//
+// CDownloadPacer
+//
+
+CDownloadPacer :: CDownloadPacer( ) : m_Window( DOWNLOADPACER_INITIALWINDOW ), m_MinRTT( 0 ), m_Rate( 0 ), m_RateTicks( 0 ), m_RateAcked( 0 ), m_Acked( 0 ), m_Tokens( 0 )
+{
+
+}
+
+CDownloadPacer :: ~CDownloadPacer( )
+{
+
+}
+
+void CDownloadPacer :: AddTokens( uint32_t tokens, uint32_t maximum )
+{
+	// the bucket never holds more than maximum so a player that couldn't use its share doesn't get to burst later
+
+	if( m_Tokens >= maximum )
+		return;
+
+	m_Tokens = maximum - m_Tokens < tokens ? maximum : m_Tokens + tokens;
+}
+
+void CDownloadPacer :: AddPing( uint32_t ping )
+{
+	if( ping > 0 && ( m_MinRTT == 0 || ping < m_MinRTT ) )
+		m_MinRTT = ping;
+}
+
+void CDownloadPacer :: Sent( uint32_t end, uint32_t ticks )
+{
+	if( m_InFlight.empty( ) )
+	{
+		// nothing was in flight so the link was idle, don't count the idle time in the next rate sample
+
+		m_RateTicks = ticks;
+		m_RateAcked = m_Acked;
+	}
+
+	m_InFlight.push_back( make_pair( end, ticks ) );
+}
+
+void CDownloadPacer :: Acked( uint32_t acked, uint32_t ticks )
+{
+	if( acked <= m_Acked )
+		return;
+
+	uint32_t NewlyAcked = acked - m_Acked;
+	m_Acked = acked;
+
+	// the round trip time is measured from when the last part covered by this ack was sent
+
+	uint32_t SentTicks = 0;
+
+	while( !m_InFlight.empty( ) && m_InFlight.front( ).first <= acked )
+	{
+		SentTicks = m_InFlight.front( ).second;
+		m_InFlight.pop_front( );
+	}
+
+	if( SentTicks != 0 )
+	{
+		uint32_t RTT = ticks - SentTicks;
+
+		if( RTT > 0 && ( m_MinRTT == 0 || RTT < m_MinRTT ) )
+			m_MinRTT = RTT;
+	}
+
+	// take a rate sample about once per round trip (but not more often than every 100 ms so a few fast acks don't dominate)
+	// the rate decays slowly rather than following each sample so a single late burst of acks doesn't collapse the window
+
+	uint32_t Interval = ticks - m_RateTicks;
+
+	if( Interval >= max( m_MinRTT, (uint32_t)100 ) )
+	{
+		uint32_t Rate = (uint32_t)( (uint64_t)( acked - m_RateAcked ) * 1000 / Interval );
+		m_Rate = max( Rate, m_Rate - m_Rate / 8 );
+		m_RateTicks = ticks;
+		m_RateAcked = acked;
+	}
+
+	if( m_Rate == 0 || m_MinRTT == 0 )
+	{
+		// nothing measured yet, grow the window by what was just acked (doubling it every round trip)
+
+		m_Window += NewlyAcked;
+	}
+	else
+		m_Window = (uint32_t)( (uint64_t)m_Rate * m_MinRTT * DOWNLOADPACER_GAIN / 1000 );
+
+	if( m_Window < DOWNLOADPACER_MINWINDOW )
+		m_Window = DOWNLOADPACER_MINWINDOW;
+	else if( m_Window > DOWNLOADPACER_MAXWINDOW )
+		m_Window = DOWNLOADPACER_MAXWINDOW;
+}
@@ -0,0 +1,75 @@
+/*
+
+	ent-ghost
+	Copyright [2011-2013] [Jack Lu]
+
+	This file is part of the ent-ghost source code.
+
+	ent-ghost is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	ent-ghost source code is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with ent-ghost source code. If not, see <http://www.gnu.org/licenses/>.
+
+	ent-ghost is modified from GHost++ (http://ghostplusplus.googlecode.com/)
+	GHost++ is Copyright [2008] [Trevor Hogan]
+
+*/
+
+#ifndef DOWNLOADPACER_H
+#define DOWNLOADPACER_H
+
+#define DOWNLOADPACER_INITIALWINDOW		( MAPPART_SIZE * 16 )		// bytes in flight before anything was measured
+#define DOWNLOADPACER_MINWINDOW			( MAPPART_SIZE * 4 )
+#define DOWNLOADPACER_MAXWINDOW			( MAPPART_SIZE * 1024 )
+#define DOWNLOADPACER_GAIN				2							// the window is this many times the bandwidth delay product
+
+//
+// CDownloadPacer
+//
+
+// decides how much map data can be sent to one player before it has to wait for more MAPPARTOK acks
+// the old fixed window of 100 parts (140 KB) was far too much for slow connections, every lobby event queued up behind it
+// instead the window is sized from what the player actually manages: DOWNLOADPACER_GAIN * ack rate * minimum round trip time
+// while the link isn't the bottleneck the round trip time stays close to the minimum and the window doubles every round trip like TCP slow start
+// once the link is saturated the round trip time grows until there's about one bandwidth delay product of map data queued up and no more
+// the minimum round trip time comes from the acks and from the pings measured in the lobby before the download started
+// the pacer also holds the player's share of bot_maxdownloadspeed as a token bucket (see CBaseGame :: SendMapParts)
+
+class CDownloadPacer
+{
+private:
+	deque<pair<uint32_t, uint32_t> > m_InFlight;	// (offset after the part, GetTicks it was sent) for every part that wasn't acked yet
+	uint32_t m_Window;								// bytes of map data allowed in flight
+	uint32_t m_MinRTT;								// lowest round trip time seen in milliseconds, zero until the first sample
+	uint32_t m_Rate;								// recent ack rate in bytes/sec, zero until the first sample
+	uint32_t m_RateTicks;							// GetTicks when the current rate sample started
+	uint32_t m_RateAcked;							// acked offset when the current rate sample started
+	uint32_t m_Acked;								// highest acked offset
+	uint32_t m_Tokens;								// bytes the player may still be sent under bot_maxdownloadspeed
+
+public:
+	CDownloadPacer( );
+	~CDownloadPacer( );
+
+	uint32_t GetWindow( )						{ return m_Window; }
+	uint32_t GetMinRTT( )						{ return m_MinRTT; }
+	uint32_t GetRate( )							{ return m_Rate; }
+	uint32_t GetTokens( )						{ return m_Tokens; }
+
+	void AddTokens( uint32_t tokens, uint32_t maximum );
+	void TakeTokens( uint32_t tokens )			{ m_Tokens = tokens < m_Tokens ? m_Tokens - tokens : 0; }
+
+	void AddPing( uint32_t ping );
+	void Sent( uint32_t end, uint32_t ticks );
+	void Acked( uint32_t acked, uint32_t ticks );
+};
+
+#endif
@@ -196,11 +196,56 @@ CGame :: ~CGame( )
 
 bool CGame :: Update( void *fd, void *send_fd )
 {
-	// update callables
+	if( m_ForfeitTime != 0 && GetTime( ) - m_ForfeitTime >= 5 )
+	{
+		// kick everyone on forfeit team
+		
+		for( vector<CGamePlayer *> :: iterator i = m_Players.begin( ); i != m_Players.end( ); i++)
+		{
+			if( *i && !(*i)->GetLeftMessageSent( ) )
+			{
+				char sid = GetSIDFromPID( (*i)->GetPID( ) );
+				
+				if( sid != 255 && m_Slots[sid].GetTeam( ) == m_ForfeitTeam )
+				{
+					(*i)->SetDeleteMe( true );
+					(*i)->SetLeftReason( "forfeited" );
+					(*i)->SetLeftCode( PLAYERLEAVE_LOST );
+				}
+			}
+		}
+		
+		string ForfeitTeamString = "Sentinel";
+		if( m_ForfeitTeam == 1 ) ForfeitTeamString = "Scourge";
+		
+		SendAllChat( "The " + ForfeitTeamString + " players have been removed from the game." );
+		SendAllChat( "Please wait five or so seconds before leaving so that stats can be properly saved." );
+		
+		m_ForfeitTime = 0;
+		m_GameOverTime = GetTime( );
+	}
 
-	for( vector<PairedBanCheck> :: iterator i = m_PairedBanChecks.begin( ); i != m_PairedBanChecks.end( ); )
+	if( m_ForfeitTime != 0 )
+		ScheduleTime( m_ForfeitTime, 5 );
+	
+	// update gamelist every 12 seconds if in lobby, or every 60 seconds otherwise
+	if( !m_CallableGameUpdate && ( m_LastGameUpdateTime == 0 || GetTime( ) - m_LastGameUpdateTime >= 60 || ( !m_GameLoaded && !m_GameLoading && GetTime( ) - m_LastGameUpdateTime >= 12 ) ) )
+	{
+		m_CallableGameUpdate = m_CallableQueue->Attach( m_GHost->m_DB->ThreadedGameUpdate(m_GameUpdateID, GetMapName(), GetGameName(), GetOwnerName(), GetCreatorName(), GetNumHumanPlayers(), GetPlayerList( ), GetNumHumanPlayers() + GetSlotsOpen(), m_GameLoaded ? 1 : 0, 0, true) );
+		m_LastGameUpdateTime = GetTime();
+	}
+
+	if( !m_CallableGameUpdate )
+		ScheduleTime( m_LastGameUpdateTime, !m_GameLoaded && !m_GameLoading ? 12 : 60 );
+
+	return CBaseGame :: Update( fd, send_fd );
+}
+
+bool CGame :: EventCallableCompleted( CBaseCallable *callable )
+{
+	for( vector<PairedBanCheck> :: iterator i = m_PairedBanChecks.begin( ); i != m_PairedBanChecks.end( ); ++i )
 	{
-		if( i->second->GetReady( ) )
+		if( i->second == callable )
 		{
 			CDBBan *Ban = i->second->GetResult( );
 
@@ -211,15 +256,14 @@ bool CGame :: Update( void *fd, void *send_fd )
 
 			m_GHost->m_DB->RecoverCallable( i->second );
 			delete i->second;
-			i = m_PairedBanChecks.erase( i );
+			m_PairedBanChecks.erase( i );
+			return true;
 		}
-		else
-                        ++i;
 	}
 
-	for( vector<PairedBanAdd> :: iterator i = m_PairedBanAdds.begin( ); i != m_PairedBanAdds.end( ); )
+	for( vector<PairedBanAdd> :: iterator i = m_PairedBanAdds.begin( ); i != m_PairedBanAdds.end( ); ++i )
 	{
-		if( i->second->GetReady( ) )
+		if( i->second == callable )
 		{
 			if( i->second->GetResult( ) )
 			{
@@ -228,15 +272,14 @@ bool CGame :: Update( void *fd, void *send_fd )
 
 			m_GHost->m_DB->RecoverCallable( i->second );
 			delete i->second;
-			i = m_PairedBanAdds.erase( i );
+			m_PairedBanAdds.erase( i );
+			return true;
 		}
-		else
-                        ++i;
 	}
 
-	for( vector<PairedGPSCheck> :: iterator i = m_PairedGPSChecks.begin( ); i != m_PairedGPSChecks.end( ); )
+	for( vector<PairedGPSCheck> :: iterator i = m_PairedGPSChecks.begin( ); i != m_PairedGPSChecks.end( ); ++i )
 	{
-		if( i->second->GetReady( ) )
+		if( i->second == callable )
 		{
 			CDBGamePlayerSummary *GamePlayerSummary = i->second->GetResult( );
 			string StatsName = i->second->GetName( );
@@ -271,15 +314,14 @@ bool CGame :: Update( void *fd, void *send_fd )
 
 			m_GHost->m_DB->RecoverCallable( i->second );
 			delete i->second;
-			i = m_PairedGPSChecks.erase( i );
+			m_PairedGPSChecks.erase( i );
+			return true;
 		}
-		else
-                        ++i;
 	}
 
-	for( vector<PairedDPSCheck> :: iterator i = m_PairedDPSChecks.begin( ); i != m_PairedDPSChecks.end( ); )
+	for( vector<PairedDPSCheck> :: iterator i = m_PairedDPSChecks.begin( ); i != m_PairedDPSChecks.end( ); ++i )
 	{
-		if( i->second->GetReady( ) )
+		if( i->second == callable )
 		{
 			CDBDotAPlayerSummary *DotAPlayerSummary = i->second->GetResult( );
 			string StatsName = i->second->GetName( );
@@ -355,15 +397,14 @@ bool CGame :: Update( void *fd, void *send_fd )
 
 			m_GHost->m_DB->RecoverCallable( i->second );
 			delete i->second;
-			i = m_PairedDPSChecks.erase( i );
+			m_PairedDPSChecks.erase( i );
+			return true;
 		}
-		else
-                        ++i;
 	}
 
-	for( vector<PairedVPSCheck> :: iterator i = m_PairedVPSChecks.begin( ); i != m_PairedVPSChecks.end( ); )
+	for( vector<PairedVPSCheck> :: iterator i = m_PairedVPSChecks.begin( ); i != m_PairedVPSChecks.end( ); ++i )
 	{
-		if( i->second->GetReady( ) )
+		if( i->second == callable )
 		{
 			CDBVampPlayerSummary *VampPlayerSummary = i->second->GetResult( );
 
@@ -433,15 +474,14 @@ bool CGame :: Update( void *fd, void *send_fd )
 
 			m_GHost->m_DB->RecoverCallable( i->second );
 			delete i->second;
-			i = m_PairedVPSChecks.erase( i );
+			m_PairedVPSChecks.erase( i );
+			return true;
 		}
-		else
-			++i;
 	}
 
-	for( vector<PairedTPSCheck> :: iterator i = m_PairedTPSChecks.begin( ); i != m_PairedTPSChecks.end( ); )
+	for( vector<PairedTPSCheck> :: iterator i = m_PairedTPSChecks.begin( ); i != m_PairedTPSChecks.end( ); ++i )
 	{
-		if( i->second->GetReady( ) )
+		if( i->second == callable )
 		{
 			CDBTreePlayerSummary *TreePlayerSummary = i->second->GetResult( );
 			string StatsName = i->second->GetName( );
@@ -484,15 +524,14 @@ bool CGame :: Update( void *fd, void *send_fd )
 
 			m_GHost->m_DB->RecoverCallable( i->second );
 			delete i->second;
-			i = m_PairedTPSChecks.erase( i );
+			m_PairedTPSChecks.erase( i );
+			return true;
 		}
-		else
-                        ++i;
 	}
 
-	for( vector<PairedSPSCheck> :: iterator i = m_PairedSPSChecks.begin( ); i != m_PairedSPSChecks.end( ); )
+	for( vector<PairedSPSCheck> :: iterator i = m_PairedSPSChecks.begin( ); i != m_PairedSPSChecks.end( ); ++i )
 	{
-		if( i->second->GetReady( ) )
+		if( i->second == callable )
 		{
 			CDBSnipePlayerSummary *SnipePlayerSummary = i->second->GetResult( );
 			string StatsName = i->second->GetName( );
@@ -535,15 +574,14 @@ bool CGame :: Update( void *fd, void *send_fd )
 
 			m_GHost->m_DB->RecoverCallable( i->second );
 			delete i->second;
-			i = m_PairedSPSChecks.erase( i );
+			m_PairedSPSChecks.erase( i );
+			return true;
 		}
-		else
-                        ++i;
 	}
 
-	for( vector<PairedBPSCheck> :: iterator i = m_PairedBPSChecks.begin( ); i != m_PairedBPSChecks.end( ); )
+	for( vector<PairedBPSCheck> :: iterator i = m_PairedBPSChecks.begin( ); i != m_PairedBPSChecks.end( ); ++i )
 	{
-		if( i->second->GetReady( ) )
+		if( i->second == callable )
 		{
 			CDBShipsPlayerSummary *ShipsPlayerSummary = i->second->GetResult( );
 			string StatsName = i->second->GetName( );
@@ -586,15 +624,14 @@ bool CGame :: Update( void *fd, void *send_fd )
 
 			m_GHost->m_DB->RecoverCallable( i->second );
 			delete i->second;
-			i = m_PairedBPSChecks.erase( i );
+			m_PairedBPSChecks.erase( i );
+			return true;
 		}
-		else
-                        ++i;
 	}
 
-	for( vector<PairedWPSCheck> :: iterator i = m_PairedWPSChecks.begin( ); i != m_PairedWPSChecks.end( ); )
+	for( vector<PairedWPSCheck> :: iterator i = m_PairedWPSChecks.begin( ); i != m_PairedWPSChecks.end( ); ++i )
 	{
-		if( i->second->GetReady( ) )
+		if( i->second == callable )
 		{
 			CDBW3MMDPlayerSummary *W3MMDPlayerSummary = i->second->GetResult( );
 			string StatsName = i->second->GetName( );
@@ -647,42 +684,12 @@ bool CGame :: Update( void *fd, void *send_fd )
 
 			m_GHost->m_DB->RecoverCallable( i->second );
 			delete i->second;
-			i = m_PairedWPSChecks.erase( i );
-		}
-		else
-                        ++i;
-	}
-	
-	if( m_ForfeitTime != 0 && GetTime( ) - m_ForfeitTime >= 5 )
-	{
-		// kick everyone on forfeit team
-		
-		for( vector<CGamePlayer *> :: iterator i = m_Players.begin( ); i != m_Players.end( ); i++)
-		{
-			if( *i && !(*i)->GetLeftMessageSent( ) )
-			{
-				char sid = GetSIDFromPID( (*i)->GetPID( ) );
-				
-				if( sid != 255 && m_Slots[sid].GetTeam( ) == m_ForfeitTeam )
-				{
-					(*i)->SetDeleteMe( true );
-					(*i)->SetLeftReason( "forfeited" );
-					(*i)->SetLeftCode( PLAYERLEAVE_LOST );
-				}
-			}
+			m_PairedWPSChecks.erase( i );
+			return true;
 		}
-		
-		string ForfeitTeamString = "Sentinel";
-		if( m_ForfeitTeam == 1 ) ForfeitTeamString = "Scourge";
-		
-		SendAllChat( "The " + ForfeitTeamString + " players have been removed from the game." );
-		SendAllChat( "Please wait five or so seconds before leaving so that stats can be properly saved." );
-		
-		m_ForfeitTime = 0;
-		m_GameOverTime = GetTime( );
 	}
-	
-	if( m_CallableGetTournament && m_CallableGetTournament->GetReady( ) )
+
+	if( callable == m_CallableGetTournament )
 	{
 		vector<string> Result = m_CallableGetTournament->GetResult( );
 		
@@ -696,16 +703,10 @@ bool CGame :: Update( void *fd, void *send_fd )
 		m_GHost->m_DB->RecoverCallable( m_CallableGetTournament );
 		delete m_CallableGetTournament;
 		m_CallableGetTournament = NULL;
+		return true;
 	}
 
-	// update gamelist every 12 seconds if in lobby, or every 60 seconds otherwise
-	if( !m_CallableGameUpdate && ( m_LastGameUpdateTime == 0 || GetTime( ) - m_LastGameUpdateTime >= 60 || ( !m_GameLoaded && !m_GameLoading && GetTime( ) - m_LastGameUpdateTime >= 12 ) ) )
-	{
-		m_CallableGameUpdate = m_GHost->m_DB->ThreadedGameUpdate(m_GameUpdateID, GetMapName(), GetGameName(), GetOwnerName(), GetCreatorName(), GetNumHumanPlayers(), GetPlayerList( ), GetNumHumanPlayers() + GetSlotsOpen(), m_GameLoaded ? 1 : 0, 0, true);
-		m_LastGameUpdateTime = GetTime();
-	}
-
-	if( m_CallableGameUpdate && m_CallableGameUpdate->GetReady()) {
+	if( callable == m_CallableGameUpdate ) {
 		m_LastGameUpdateTime = GetTime();
 		uint32_t ID = m_CallableGameUpdate->GetResult( );
 		
@@ -715,9 +716,11 @@ bool CGame :: Update( void *fd, void *send_fd )
 		m_GHost->m_DB->RecoverCallable( m_CallableGameUpdate );
 		delete m_CallableGameUpdate;
 		m_CallableGameUpdate = NULL;
+		ScheduleTime( m_LastGameUpdateTime, !m_GameLoaded && !m_GameLoading ? 12 : 60 );
+		return true;
 	}
 
-	return CBaseGame :: Update( fd, send_fd );
+	return CBaseGame :: EventCallableCompleted( callable );
 }
 
 CGamePlayer *CGame :: EventPlayerJoined( CPotentialPlayer *potential, CIncomingJoinPlayer *joinPlayer, double *score )
@@ -730,32 +733,32 @@ CGamePlayer *CGame :: EventPlayerJoined( CPotentialPlayer *potential, CIncomingJ
 		if( m_MapType == "dota" || m_MapType == "eihl" || m_MapType == "lod" || ( m_MapType == "dota2" && score != NULL ) )
 		{
 			if( m_GHost->m_Openstats )
-				m_PairedDPSChecks.push_back( PairedDPSCheck( string( ), m_GHost->m_DB->ThreadedDotAPlayerSummaryCheck( Player->GetName( ), Player->GetJoinedRealm( ), "openstats" ) ) );
+				m_PairedDPSChecks.push_back( PairedDPSCheck( string( ), m_CallableQueue->Attach( m_GHost->m_DB->ThreadedDotAPlayerSummaryCheck( Player->GetName( ), Player->GetJoinedRealm( ), "openstats" ) ) ) );
 			else
-				m_PairedDPSChecks.push_back( PairedDPSCheck( string( ), m_GHost->m_DB->ThreadedDotAPlayerSummaryCheck( Player->GetName( ), Player->GetJoinedRealm( ), m_MapType ) ) );
+				m_PairedDPSChecks.push_back( PairedDPSCheck( string( ), m_CallableQueue->Attach( m_GHost->m_DB->ThreadedDotAPlayerSummaryCheck( Player->GetName( ), Player->GetJoinedRealm( ), m_MapType ) ) ) );
 		}
 		
 		else if( !m_MapType.empty( ) )
 		{
-			m_PairedWPSChecks.push_back( PairedWPSCheck( string( ), m_GHost->m_DB->ThreadedW3MMDPlayerSummaryCheck( Player->GetName( ), Player->GetJoinedRealm( ), m_MapType ) ) );
+			m_PairedWPSChecks.push_back( PairedWPSCheck( string( ), m_CallableQueue->Attach( m_GHost->m_DB->ThreadedW3MMDPlayerSummaryCheck( Player->GetName( ), Player->GetJoinedRealm( ), m_MapType ) ) ) );
 		}
 
 		else
 		{
-			m_PairedGPSChecks.push_back( PairedGPSCheck( string( ), m_GHost->m_DB->ThreadedGamePlayerSummaryCheck( Player->GetName( ), Player->GetJoinedRealm( ) ) ) );
+			m_PairedGPSChecks.push_back( PairedGPSCheck( string( ), m_CallableQueue->Attach( m_GHost->m_DB->ThreadedGamePlayerSummaryCheck( Player->GetName( ), Player->GetJoinedRealm( ) ) ) ) );
 		}
 	}
 	else if( Player && m_MapType == "castlefight" )
 	{
-		m_PairedWPSChecks.push_back( PairedWPSCheck( string( ), m_GHost->m_DB->ThreadedW3MMDPlayerSummaryCheck( Player->GetName( ), Player->GetJoinedRealm( ), "castlefight" ) ) );
+		m_PairedWPSChecks.push_back( PairedWPSCheck( string( ), m_CallableQueue->Attach( m_GHost->m_DB->ThreadedW3MMDPlayerSummaryCheck( Player->GetName( ), Player->GetJoinedRealm( ), "castlefight" ) ) ) );
 	}
 	else if( Player && m_MapType == "legionmega" )
 	{
-		m_PairedWPSChecks.push_back( PairedWPSCheck( string( ), m_GHost->m_DB->ThreadedW3MMDPlayerSummaryCheck( Player->GetName( ), Player->GetJoinedRealm( ), "legionmega" ) ) );
+		m_PairedWPSChecks.push_back( PairedWPSCheck( string( ), m_CallableQueue->Attach( m_GHost->m_DB->ThreadedW3MMDPlayerSummaryCheck( Player->GetName( ), Player->GetJoinedRealm( ), "legionmega" ) ) ) );
 	}
 	else if( Player && m_MapType == "civwars" )
 	{
-		m_PairedWPSChecks.push_back( PairedWPSCheck( string( ), m_GHost->m_DB->ThreadedW3MMDPlayerSummaryCheck( Player->GetName( ), Player->GetJoinedRealm( ), "civwars" ) ) );
+		m_PairedWPSChecks.push_back( PairedWPSCheck( string( ), m_CallableQueue->Attach( m_GHost->m_DB->ThreadedW3MMDPlayerSummaryCheck( Player->GetName( ), Player->GetJoinedRealm( ), "civwars" ) ) ) );
 	}
 	
 	return Player;
@@ -1026,7 +1029,7 @@ bool CGame :: EventPlayerBotCommand( CGamePlayer *player, string command, string
 					if( Matches == 0 )
 						SendAllChat( m_GHost->m_Language->UnableToBanNoMatchesFound( Victim ) );
 					else if( Matches == 1 )
-						m_PairedBanAdds.push_back( PairedBanAdd( User, m_GHost->m_DB->ThreadedBanAdd( LastMatch->GetServer( ), LastMatch->GetName( ), LastMatch->GetIP( ), m_GameName, User, Reason, BanDuration, userContext ) ) );
+						m_PairedBanAdds.push_back( PairedBanAdd( User, m_CallableQueue->Attach( m_GHost->m_DB->ThreadedBanAdd( LastMatch->GetServer( ), LastMatch->GetName( ), LastMatch->GetIP( ), m_GameName, User, Reason, BanDuration, userContext ) ) ) );
 					else
 						SendAllChat( m_GHost->m_Language->UnableToBanFoundMoreThanOneMatch( Victim ) );
 				}
@@ -1038,7 +1041,7 @@ bool CGame :: EventPlayerBotCommand( CGamePlayer *player, string command, string
 					if( Matches == 0 )
 						SendAllChat( m_GHost->m_Language->UnableToBanNoMatchesFound( Victim ) );
 					else if( Matches == 1 )
-						m_PairedBanAdds.push_back( PairedBanAdd( User, m_GHost->m_DB->ThreadedBanAdd( LastMatch->GetJoinedRealm( ), LastMatch->GetName( ), LastMatch->GetExternalIPString( ), m_GameName, User, Reason, BanDuration, userContext ) ) );
+						m_PairedBanAdds.push_back( PairedBanAdd( User, m_CallableQueue->Attach( m_GHost->m_DB->ThreadedBanAdd( LastMatch->GetJoinedRealm( ), LastMatch->GetName( ), LastMatch->GetExternalIPString( ), m_GameName, User, Reason, BanDuration, userContext ) ) ) );
 					else
 						SendAllChat( m_GHost->m_Language->UnableToBanFoundMoreThanOneMatch( Victim ) );
 				}
@@ -1119,7 +1122,7 @@ bool CGame :: EventPlayerBotCommand( CGamePlayer *player, string command, string
 				string userContext = User;
 				if( AdminCheck || RootAdminCheck ) userContext = "ttr.cloud";
 				
-				m_PairedBanAdds.push_back( PairedBanAdd( User, m_GHost->m_DB->ThreadedBanAdd( m_DBBanLast->GetServer( ), m_DBBanLast->GetName( ), m_DBBanLast->GetIP( ), m_GameName, User, Payload, 3600 * 48, userContext ) ) );
+				m_PairedBanAdds.push_back( PairedBanAdd( User, m_CallableQueue->Attach( m_GHost->m_DB->ThreadedBanAdd( m_DBBanLast->GetServer( ), m_DBBanLast->GetName( ), m_DBBanLast->GetIP( ), m_GameName, User, Payload, 3600 * 48, userContext ) ) ) );
 			}
 
 			//
@@ -1175,7 +1178,7 @@ bool CGame :: EventPlayerBotCommand( CGamePlayer *player, string command, string
                         else if( Command == "checkban" && !Payload.empty( ) && !m_GHost->m_BNETs.empty( ) && ( AdminCheck || RootAdminCheck ) )
 			{
 				for( vector<CBNET *> :: iterator i = m_GHost->m_BNETs.begin( ); i != m_GHost->m_BNETs.end( ); ++i )
-					m_PairedBanChecks.push_back( PairedBanCheck( User, m_GHost->m_DB->ThreadedBanCheck( (*i)->GetServer( ), Payload, string( ), string( ), string( ) ) ) );
+					m_PairedBanChecks.push_back( PairedBanCheck( User, m_CallableQueue->Attach( m_GHost->m_DB->ThreadedBanCheck( (*i)->GetServer( ), Payload, string( ), string( ), string( ) ) ) ) );
 			}
 
 			//
@@ -1638,6 +1641,13 @@ bool CGame :: EventPlayerBotCommand( CGamePlayer *player, string command, string
 				}
 			}
 
+			//
+			// !JITTER (show how late the action packets have been sent)
+			//
+
+			else if( Command == "jitter" && ( AdminCheck || RootAdminCheck ) )
+				SendAllChat( "Actions " + GetActionJitterString( ) );
+
 			//
 			// !KICK (kick a player)
 			//
@@ -2316,9 +2326,9 @@ bool CGame :: EventPlayerBotCommand( CGamePlayer *player, string command, string
 			saveType = "openstats";
 
 		if( player->GetSpoofed( ) && ( AdminCheck || RootAdminCheck || IsOwner( User ) ) )
-			m_PairedDPSChecks.push_back( PairedDPSCheck( string( ), m_GHost->m_DB->ThreadedDotAPlayerSummaryCheck( StatsUser, StatsRealm, saveType ) ) );
+			m_PairedDPSChecks.push_back( PairedDPSCheck( string( ), m_CallableQueue->Attach( m_GHost->m_DB->ThreadedDotAPlayerSummaryCheck( StatsUser, StatsRealm, saveType ) ) ) );
 		else
-			m_PairedDPSChecks.push_back( PairedDPSCheck( User, m_GHost->m_DB->ThreadedDotAPlayerSummaryCheck( StatsUser, StatsRealm, saveType ) ) );
+			m_PairedDPSChecks.push_back( PairedDPSCheck( User, m_CallableQueue->Attach( m_GHost->m_DB->ThreadedDotAPlayerSummaryCheck( StatsUser, StatsRealm, saveType ) ) ) );
 
 		player->SetStatsDotASentTime( GetTime( ) );
 	}
@@ -2338,9 +2348,9 @@ bool CGame :: EventPlayerBotCommand( CGamePlayer *player, string command, string
 		GetStatsUser( &StatsUser, &StatsRealm );
 
 		if( player->GetSpoofed( ) && ( AdminCheck || RootAdminCheck || IsOwner( User ) ) )
-			m_PairedDPSChecks.push_back( PairedDPSCheck( string( ), m_GHost->m_DB->ThreadedDotAPlayerSummaryCheck( StatsUser, StatsRealm, "dota2" ) ) );
+			m_PairedDPSChecks.push_back( PairedDPSCheck( string( ), m_CallableQueue->Attach( m_GHost->m_DB->ThreadedDotAPlayerSummaryCheck( StatsUser, StatsRealm, "dota2" ) ) ) );
 		else
-			m_PairedDPSChecks.push_back( PairedDPSCheck( User, m_GHost->m_DB->ThreadedDotAPlayerSummaryCheck( StatsUser, StatsRealm, "dota2" ) ) );
+			m_PairedDPSChecks.push_back( PairedDPSCheck( User, m_CallableQueue->Attach( m_GHost->m_DB->ThreadedDotAPlayerSummaryCheck( StatsUser, StatsRealm, "dota2" ) ) ) );
 
 		player->SetStatsDotASentTime( GetTime( ) );
 	}
@@ -2360,9 +2370,9 @@ bool CGame :: EventPlayerBotCommand( CGamePlayer *player, string command, string
 		GetStatsUser( &StatsUser, &StatsRealm );
 
 		if( player->GetSpoofed( ) && ( AdminCheck || RootAdminCheck || IsOwner( User ) ) )
-			m_PairedDPSChecks.push_back( PairedDPSCheck( string( ), m_GHost->m_DB->ThreadedDotAPlayerSummaryCheck( StatsUser, StatsRealm, "eihl" ) ) );
+			m_PairedDPSChecks.push_back( PairedDPSCheck( string( ), m_CallableQueue->Attach( m_GHost->m_DB->ThreadedDotAPlayerSummaryCheck( StatsUser, StatsRealm, "eihl" ) ) ) );
 		else
-			m_PairedDPSChecks.push_back( PairedDPSCheck( User, m_GHost->m_DB->ThreadedDotAPlayerSummaryCheck( StatsUser, StatsRealm, "eihl" ) ) );
+			m_PairedDPSChecks.push_back( PairedDPSCheck( User, m_CallableQueue->Attach( m_GHost->m_DB->ThreadedDotAPlayerSummaryCheck( StatsUser, StatsRealm, "eihl" ) ) ) );
 
 		player->SetStatsDotASentTime( GetTime( ) );
 	}
@@ -2382,9 +2392,9 @@ bool CGame :: EventPlayerBotCommand( CGamePlayer *player, string command, string
 		GetStatsUser( &StatsUser, &StatsRealm );
 
 		if( player->GetSpoofed( ) && ( AdminCheck || RootAdminCheck || IsOwner( User ) ) )
-			m_PairedDPSChecks.push_back( PairedDPSCheck( string( ), m_GHost->m_DB->ThreadedDotAPlayerSummaryCheck( StatsUser, StatsRealm, "lod" ) ) );
+			m_PairedDPSChecks.push_back( PairedDPSCheck( string( ), m_CallableQueue->Attach( m_GHost->m_DB->ThreadedDotAPlayerSummaryCheck( StatsUser, StatsRealm, "lod" ) ) ) );
 		else
-			m_PairedDPSChecks.push_back( PairedDPSCheck( User, m_GHost->m_DB->ThreadedDotAPlayerSummaryCheck( StatsUser, StatsRealm, "lod" ) ) );
+			m_PairedDPSChecks.push_back( PairedDPSCheck( User, m_CallableQueue->Attach( m_GHost->m_DB->ThreadedDotAPlayerSummaryCheck( StatsUser, StatsRealm, "lod" ) ) ) );
 
 		player->SetStatsDotASentTime( GetTime( ) );
 	}
@@ -2404,9 +2414,9 @@ bool CGame :: EventPlayerBotCommand( CGamePlayer *player, string command, string
 		GetStatsUser( &StatsUser, &StatsRealm );
 
 		if( player->GetSpoofed( ) && ( AdminCheck || RootAdminCheck || IsOwner( User ) ) )
-			m_PairedTPSChecks.push_back( PairedTPSCheck( string( ), m_GHost->m_DB->ThreadedTreePlayerSummaryCheck( StatsUser, StatsRealm ) ) );
+			m_PairedTPSChecks.push_back( PairedTPSCheck( string( ), m_CallableQueue->Attach( m_GHost->m_DB->ThreadedTreePlayerSummaryCheck( StatsUser, StatsRealm ) ) ) );
 		else
-			m_PairedTPSChecks.push_back( PairedTPSCheck( User, m_GHost->m_DB->ThreadedTreePlayerSummaryCheck( StatsUser, StatsRealm ) ) );
+			m_PairedTPSChecks.push_back( PairedTPSCheck( User, m_CallableQueue->Attach( m_GHost->m_DB->ThreadedTreePlayerSummaryCheck( StatsUser, StatsRealm ) ) ) );
 
 		player->SetStatsDotASentTime( GetTime( ) );
 	}
@@ -2426,9 +2436,9 @@ bool CGame :: EventPlayerBotCommand( CGamePlayer *player, string command, string
 		GetStatsUser( &StatsUser, &StatsRealm );
 
 		if( player->GetSpoofed( ) && ( AdminCheck || RootAdminCheck || IsOwner( User ) ) )
-			m_PairedSPSChecks.push_back( PairedSPSCheck( string( ), m_GHost->m_DB->ThreadedSnipePlayerSummaryCheck( StatsUser, StatsRealm ) ) );
+			m_PairedSPSChecks.push_back( PairedSPSCheck( string( ), m_CallableQueue->Attach( m_GHost->m_DB->ThreadedSnipePlayerSummaryCheck( StatsUser, StatsRealm ) ) ) );
 		else
-			m_PairedSPSChecks.push_back( PairedSPSCheck( User, m_GHost->m_DB->ThreadedSnipePlayerSummaryCheck( StatsUser, StatsRealm ) ) );
+			m_PairedSPSChecks.push_back( PairedSPSCheck( User, m_CallableQueue->Attach( m_GHost->m_DB->ThreadedSnipePlayerSummaryCheck( StatsUser, StatsRealm ) ) ) );
 
 		player->SetStatsDotASentTime( GetTime( ) );
 	}
@@ -2448,9 +2458,9 @@ bool CGame :: EventPlayerBotCommand( CGamePlayer *player, string command, string
 		GetStatsUser( &StatsUser, &StatsRealm );
 
 		if( player->GetSpoofed( ) && ( AdminCheck || RootAdminCheck || IsOwner( User ) ) )
-			m_PairedBPSChecks.push_back( PairedBPSCheck( string( ), m_GHost->m_DB->ThreadedShipsPlayerSummaryCheck( StatsUser, StatsRealm ) ) );
+			m_PairedBPSChecks.push_back( PairedBPSCheck( string( ), m_CallableQueue->Attach( m_GHost->m_DB->ThreadedShipsPlayerSummaryCheck( StatsUser, StatsRealm ) ) ) );
 		else
-			m_PairedBPSChecks.push_back( PairedBPSCheck( User, m_GHost->m_DB->ThreadedShipsPlayerSummaryCheck( StatsUser, StatsRealm ) ) );
+			m_PairedBPSChecks.push_back( PairedBPSCheck( User, m_CallableQueue->Attach( m_GHost->m_DB->ThreadedShipsPlayerSummaryCheck( StatsUser, StatsRealm ) ) ) );
 
 		player->SetStatsDotASentTime( GetTime( ) );
 	}
@@ -2470,9 +2480,9 @@ bool CGame :: EventPlayerBotCommand( CGamePlayer *player, string command, string
 		GetStatsUser( &StatsUser, &StatsRealm );
 
 		if( player->GetSpoofed( ) && ( AdminCheck || RootAdminCheck || IsOwner( User ) ) )
-			m_PairedWPSChecks.push_back( PairedWPSCheck( string( ), m_GHost->m_DB->ThreadedW3MMDPlayerSummaryCheck( StatsUser, StatsRealm, "castlefight" ) ) );
+			m_PairedWPSChecks.push_back( PairedWPSCheck( string( ), m_CallableQueue->Attach( m_GHost->m_DB->ThreadedW3MMDPlayerSummaryCheck( StatsUser, StatsRealm, "castlefight" ) ) ) );
 		else
-			m_PairedWPSChecks.push_back( PairedWPSCheck( User, m_GHost->m_DB->ThreadedW3MMDPlayerSummaryCheck( StatsUser, StatsRealm, "castlefight" ) ) );
+			m_PairedWPSChecks.push_back( PairedWPSCheck( User, m_CallableQueue->Attach( m_GHost->m_DB->ThreadedW3MMDPlayerSummaryCheck( StatsUser, StatsRealm, "castlefight" ) ) ) );
 
 		player->SetStatsDotASentTime( GetTime( ) );
 	}
@@ -2492,9 +2502,9 @@ bool CGame :: EventPlayerBotCommand( CGamePlayer *player, string command, string
 		GetStatsUser( &StatsUser, &StatsRealm );
 
 		if( player->GetSpoofed( ) && ( AdminCheck || RootAdminCheck || IsOwner( User ) ) )
-			m_PairedWPSChecks.push_back( PairedWPSCheck( string( ), m_GHost->m_DB->ThreadedW3MMDPlayerSummaryCheck( StatsUser, StatsRealm, "castlefight2" ) ) );
+			m_PairedWPSChecks.push_back( PairedWPSCheck( string( ), m_CallableQueue->Attach( m_GHost->m_DB->ThreadedW3MMDPlayerSummaryCheck( StatsUser, StatsRealm, "castlefight2" ) ) ) );
 		else
-			m_PairedWPSChecks.push_back( PairedWPSCheck( User, m_GHost->m_DB->ThreadedW3MMDPlayerSummaryCheck( StatsUser, StatsRealm, "castlefight2" ) ) );
+			m_PairedWPSChecks.push_back( PairedWPSCheck( User, m_CallableQueue->Attach( m_GHost->m_DB->ThreadedW3MMDPlayerSummaryCheck( StatsUser, StatsRealm, "castlefight2" ) ) ) );
 
 		player->SetStatsDotASentTime( GetTime( ) );
 	}
@@ -2514,9 +2524,9 @@ bool CGame :: EventPlayerBotCommand( CGamePlayer *player, string command, string
 		GetStatsUser( &StatsUser, &StatsRealm );
 
 		if( player->GetSpoofed( ) && ( AdminCheck || RootAdminCheck || IsOwner( User ) ) )
-			m_PairedWPSChecks.push_back( PairedWPSCheck( string( ), m_GHost->m_DB->ThreadedW3MMDPlayerSummaryCheck( StatsUser, StatsRealm, "civwars" ) ) );
+			m_PairedWPSChecks.push_back( PairedWPSCheck( string( ), m_CallableQueue->Attach( m_GHost->m_DB->ThreadedW3MMDPlayerSummaryCheck( StatsUser, StatsRealm, "civwars" ) ) ) );
 		else
-			m_PairedWPSChecks.push_back( PairedWPSCheck( User, m_GHost->m_DB->ThreadedW3MMDPlayerSummaryCheck( StatsUser, StatsRealm, "civwars" ) ) );
+			m_PairedWPSChecks.push_back( PairedWPSCheck( User, m_CallableQueue->Attach( m_GHost->m_DB->ThreadedW3MMDPlayerSummaryCheck( StatsUser, StatsRealm, "civwars" ) ) ) );
 
 		player->SetStatsDotASentTime( GetTime( ) );
 	}
@@ -2536,9 +2546,9 @@ bool CGame :: EventPlayerBotCommand( CGamePlayer *player, string command, string
 		GetStatsUser( &StatsUser, &StatsRealm );
 
 		if( player->GetSpoofed( ) && ( AdminCheck || RootAdminCheck || IsOwner( User ) ) )
-			m_PairedWPSChecks.push_back( PairedWPSCheck( string( ), m_GHost->m_DB->ThreadedW3MMDPlayerSummaryCheck( StatsUser, StatsRealm, "legionmega" ) ) );
+			m_PairedWPSChecks.push_back( PairedWPSCheck( string( ), m_CallableQueue->Attach( m_GHost->m_DB->ThreadedW3MMDPlayerSummaryCheck( StatsUser, StatsRealm, "legionmega" ) ) ) );
 		else
-			m_PairedWPSChecks.push_back( PairedWPSCheck( User, m_GHost->m_DB->ThreadedW3MMDPlayerSummaryCheck( StatsUser, StatsRealm, "legionmega" ) ) );
+			m_PairedWPSChecks.push_back( PairedWPSCheck( User, m_CallableQueue->Attach( m_GHost->m_DB->ThreadedW3MMDPlayerSummaryCheck( StatsUser, StatsRealm, "legionmega" ) ) ) );
 
 		player->SetStatsDotASentTime( GetTime( ) );
 	}
@@ -2558,9 +2568,9 @@ bool CGame :: EventPlayerBotCommand( CGamePlayer *player, string command, string
 		GetStatsUser( &StatsUser, &StatsRealm );
 
 		if( player->GetSpoofed( ) && ( AdminCheck || RootAdminCheck || IsOwner( User ) ) )
-			m_PairedWPSChecks.push_back( PairedWPSCheck( string( ), m_GHost->m_DB->ThreadedW3MMDPlayerSummaryCheck( StatsUser, StatsRealm, "legionmega2" ) ) );
+			m_PairedWPSChecks.push_back( PairedWPSCheck( string( ), m_CallableQueue->Attach( m_GHost->m_DB->ThreadedW3MMDPlayerSummaryCheck( StatsUser, StatsRealm, "legionmega2" ) ) ) );
 		else
-			m_PairedWPSChecks.push_back( PairedWPSCheck( User, m_GHost->m_DB->ThreadedW3MMDPlayerSummaryCheck( StatsUser, StatsRealm, "legionmega2" ) ) );
+			m_PairedWPSChecks.push_back( PairedWPSCheck( User, m_CallableQueue->Attach( m_GHost->m_DB->ThreadedW3MMDPlayerSummaryCheck( StatsUser, StatsRealm, "legionmega2" ) ) ) );
 
 		player->SetStatsDotASentTime( GetTime( ) );
 	}
@@ -2591,9 +2601,9 @@ bool CGame :: EventPlayerBotCommand( CGamePlayer *player, string command, string
 		GetStatsUser( &StatsUser, &StatsRealm );
 
 		if( player->GetSpoofed( ) && ( AdminCheck || RootAdminCheck || IsOwner( User ) ) )
-			m_PairedWPSChecks.push_back( PairedWPSCheck( string( ), m_GHost->m_DB->ThreadedW3MMDPlayerSummaryCheck( StatsUser, StatsRealm, StatsCategory ) ) );
+			m_PairedWPSChecks.push_back( PairedWPSCheck( string( ), m_CallableQueue->Attach( m_GHost->m_DB->ThreadedW3MMDPlayerSummaryCheck( StatsUser, StatsRealm, StatsCategory ) ) ) );
 		else
-			m_PairedWPSChecks.push_back( PairedWPSCheck( User, m_GHost->m_DB->ThreadedW3MMDPlayerSummaryCheck( StatsUser, StatsRealm, StatsCategory ) ) );
+			m_PairedWPSChecks.push_back( PairedWPSCheck( User, m_CallableQueue->Attach( m_GHost->m_DB->ThreadedW3MMDPlayerSummaryCheck( StatsUser, StatsRealm, StatsCategory ) ) ) );
 
 		player->SetStatsDotASentTime( GetTime( ) );
 	}
@@ -2613,9 +2623,9 @@ bool CGame :: EventPlayerBotCommand( CGamePlayer *player, string command, string
 		GetStatsUser( &StatsUser, &StatsRealm );
 
 		if( player->GetSpoofed( ) && ( AdminCheck || RootAdminCheck || IsOwner( User ) ) )
-			m_PairedGPSChecks.push_back( PairedGPSCheck( string( ), m_GHost->m_DB->ThreadedGamePlayerSummaryCheck( StatsUser, StatsRealm ) ) );
+			m_PairedGPSChecks.push_back( PairedGPSCheck( string( ), m_CallableQueue->Attach( m_GHost->m_DB->ThreadedGamePlayerSummaryCheck( StatsUser, StatsRealm ) ) ) );
 		else
-			m_PairedGPSChecks.push_back( PairedGPSCheck( User, m_GHost->m_DB->ThreadedGamePlayerSummaryCheck( StatsUser, StatsRealm ) ) );
+			m_PairedGPSChecks.push_back( PairedGPSCheck( User, m_CallableQueue->Attach( m_GHost->m_DB->ThreadedGamePlayerSummaryCheck( StatsUser, StatsRealm ) ) ) );
 
 		player->SetStatsDotASentTime( GetTime( ) );
 	}
@@ -100,6 +100,7 @@ public:
 	virtual bool EventPlayerAction( CGamePlayer *player, CIncomingAction *action );
 	virtual bool EventPlayerBotCommand( CGamePlayer *player, string command, string payload );
 	virtual void EventGameStarted( );
+	virtual bool EventCallableCompleted( CBaseCallable *callable );
 	virtual bool IsGameDataSaved( );
 	virtual void SaveGameData( );
     virtual void GetStatsUser( string *statsUser, string *statsRealm );
@@ -34,9 +34,15 @@
 #include "packed.h"
 #include "savegame.h"
 #include "replay.h"
+#include "replayarchive.h"
+#include "relayfeed.h"
+#include "relay.h"
 #include "gameplayer.h"
 #include "gameprotocol.h"
 #include "game_base.h"
+#include "reactor.h"
+#include "gproxylog.h"
+#include "downloadpacer.h"
 
 #include <cmath>
 #include <string.h>
@@ -44,18 +50,41 @@
 
 #include "next_combination.h"
 
+//
+// CGameCallableQueue
+//
+
+// wakes the game up when one of its callables is ready
+
+class CGameCallableQueue : public CCallableQueue
+{
+private:
+	CBaseGame *m_Game;
+
+public:
+	CGameCallableQueue( CBaseGame *nGame ) : CCallableQueue( ), m_Game( nGame ) { }
+	virtual ~CGameCallableQueue( ) { }
+
+	virtual void Notify( )		{ m_Game->Wake( ); }
+};
+
 //
 // CBaseGame
 //
 
-CBaseGame :: CBaseGame( CGHost *nGHost, CMap *nMap, CSaveGame *nSaveGame, uint16_t nHostPort, unsigned char nGameState, string nGameName, string nOwnerName, string nCreatorName, string nCreatorServer ) : m_GHost( nGHost ), m_SaveGame( nSaveGame ), m_Replay( NULL ), m_Exiting( false ), m_Saving( false ), m_HostPort( nHostPort ), m_GameState( nGameState ), m_VirtualHostPID( 255 ), m_GProxyEmptyActions( 0 ), m_GameName( nGameName ), m_LastGameName( nGameName ), m_VirtualHostName( m_GHost->m_VirtualHostName ), m_OwnerName( nOwnerName ), m_CreatorName( nCreatorName ), m_CreatorServer( nCreatorServer ), m_HCLCommandString( nMap->GetMapDefaultHCL( ) ), m_RandomSeed( GetTicks( ) ), m_HostCounter( m_GHost->m_HostCounter++ ), m_EntryKey( rand( ) ), m_Latency( m_GHost->m_Latency ), m_SyncLimit( m_GHost->m_SyncLimit ), m_SyncCounter( 0 ), m_GameTicks( 0 ), m_CreationTime( GetTime( ) ), m_LastPingTime( GetTime( ) ), m_LastRefreshTime( GetTime( ) ), m_LastDownloadTicks( GetTime( ) ), m_DownloadCounter( 0 ), m_LastDownloadCounterResetTicks( GetTime( ) ), m_LastAnnounceTime( 0 ), m_AnnounceInterval( 0 ), m_LastAutoStartTime( GetTime( ) ), m_AutoStartPlayers( 0 ), m_LastCountDownTicks( 0 ), m_CountDownCounter( 0 ), m_StartedLoadingTicks( 0 ), m_StartPlayers( 0 ), m_LastLagScreenResetTime( 0 ), m_LastActionSentTicks( 0 ), m_LastActionLateBy( 0 ), m_StartedLaggingTime( 0 ), m_LastLagScreenTime( 0 ), m_LastReservedSeen( GetTime( ) ), m_StartedKickVoteTime( 0 ), m_StartedVoteStartTime( 0 ), m_GameOverTime( 0 ), m_LastPlayerLeaveTicks( 0 ), m_MinimumScore( 0. ), m_MaximumScore( 0. ), m_SlotInfoChanged( false ), m_Locked( false ), m_RefreshMessages( m_GHost->m_RefreshMessages ), m_RefreshError( false ), m_RefreshRehosted( false ), m_MuteAll( false ), m_MuteLobby( false ), m_CountDownStarted( false ), m_GameLoading( false ), m_GameLoaded( false ), m_LoadInGame( nMap->GetMapLoadInGame( ) ), m_Lagging( false ), m_AutoSave( m_GHost->m_AutoSave ), m_MatchMaking( false ), m_LocalAdminMessages( m_GHost->m_LocalAdminMessages ), m_DoDelete( 0 ), m_LastReconnectHandleTime( 0 ), m_League( false ), m_Tournament( false ), m_TournamentMatchID( 0 ), m_TournamentChatID( 0 ), m_SoftGameOver( false ), m_AllowDownloads( true )
+CBaseGame :: CBaseGame( CGHost *nGHost, CMap *nMap, CSaveGame *nSaveGame, uint16_t nHostPort, unsigned char nGameState, string nGameName, string nOwnerName, string nCreatorName, string nCreatorServer ) : m_GHost( nGHost ), m_SaveGame( nSaveGame ), m_Replay( NULL ), m_Exiting( false ), m_Saving( false ), m_HostPort( nHostPort ), m_GameState( nGameState ), m_VirtualHostPID( 255 ), m_GProxyEmptyActions( 0 ), m_GameName( nGameName ), m_LastGameName( nGameName ), m_VirtualHostName( m_GHost->m_VirtualHostName ), m_OwnerName( nOwnerName ), m_CreatorName( nCreatorName ), m_CreatorServer( nCreatorServer ), m_HCLCommandString( nMap->GetMapDefaultHCL( ) ), m_RandomSeed( GetTicks( ) ), m_HostCounter( m_GHost->m_HostCounter++ ), m_EntryKey( rand( ) ), m_Latency( m_GHost->m_Latency ), m_SyncLimit( m_GHost->m_SyncLimit ), m_SyncCounter( 0 ), m_GameTicks( 0 ), m_CreationTime( GetTime( ) ), m_LastPingTime( GetTime( ) ), m_LastRefreshTime( GetTime( ) ), m_LastDownloadTicks( GetTime( ) ), m_DownloadCounter( 0 ), m_LastDownloadCounterResetTicks( GetTime( ) ), m_LastAnnounceTime( 0 ), m_AnnounceInterval( 0 ), m_LastAutoStartTime( GetTime( ) ), m_AutoStartPlayers( 0 ), m_LastCountDownTicks( 0 ), m_CountDownCounter( 0 ), m_StartedLoadingTicks( 0 ), m_StartPlayers( 0 ), m_LastLagScreenResetTime( 0 ), m_LastActionSentTicks( 0 ), m_LastActionLateBy( 0 ), m_ActionJitterMax( 0 ), m_StartedLaggingTime( 0 ), m_LastLagScreenTime( 0 ), m_LastStatusTime( 0 ), m_LastReservedSeen( GetTime( ) ), m_StartedKickVoteTime( 0 ), m_StartedVoteStartTime( 0 ), m_GameOverTime( 0 ), m_LastPlayerLeaveTicks( 0 ), m_MinimumScore( 0. ), m_MaximumScore( 0. ), m_SlotInfoChanged( false ), m_Locked( false ), m_RefreshMessages( m_GHost->m_RefreshMessages ), m_RefreshError( false ), m_RefreshRehosted( false ), m_MuteAll( false ), m_MuteLobby( false ), m_CountDownStarted( false ), m_GameLoading( false ), m_GameLoaded( false ), m_LoadInGame( nMap->GetMapLoadInGame( ) ), m_Lagging( false ), m_AutoSave( m_GHost->m_AutoSave ), m_MatchMaking( false ), m_LocalAdminMessages( m_GHost->m_LocalAdminMessages ), m_DoDelete( 0 ), m_Reactor( NULL ), m_NextUpdateTicks( GetTicks( ) ), m_LastReconnectHandleTime( 0 ), m_League( false ), m_Tournament( false ), m_TournamentMatchID( 0 ), m_TournamentChatID( 0 ), m_SoftGameOver( false ), m_AllowDownloads( true ), m_MapFileChanged( false )
 {
 	m_Socket = new CTCPServer( );
 	m_Protocol = new CGameProtocol( m_GHost );
+	m_CallableQueue = new CGameCallableQueue( this );
+	m_GProxyLog = new CGProxyLog( m_GameName, m_GHost->m_ReconnectMaxBuffer );
 	m_Map = new CMap( *nMap );
 	m_MapName = m_Map->GetMapPath( );
     m_DatabaseID = 0;
 
+	for( uint32_t i = 0; i < ACTION_JITTER_BUCKETS; ++i )
+		m_ActionJitter[i] = 0;
+
 	if( m_GHost->m_SaveReplays && !m_SaveGame )
 		m_Replay = new CReplay( );
 
@@ -168,6 +197,13 @@ CBaseGame :: ~CBaseGame( )
 	for( vector<CGamePlayer *> :: iterator i = m_Players.begin( ); i != m_Players.end( ); ++i )
 		delete *i;
 
+	// the players remove themselves from the GProxy++ log when they're deleted so it has to go after them
+
+	if( m_GProxyLog->GetPeakEntries( ) > 0 )
+		CONSOLE_Print( "[GAME: " + m_GameName + "] " + m_GProxyLog->GetStatus( ) );
+
+	delete m_GProxyLog;
+
 	boost::mutex::scoped_lock lock( m_GHost->m_CallablesMutex );
 
 	for( vector<CCallableConnectCheck *> :: iterator i = m_ConnectChecks.begin( ); i != m_ConnectChecks.end( ); ++i )
@@ -187,6 +223,10 @@ CBaseGame :: ~CBaseGame( )
 
 	lock.unlock( );
 
+	// anything still attached to our queue has been orphaned by now
+
+	delete m_CallableQueue;
+
 	while( !m_Actions.empty( ) )
 	{
 		delete m_Actions.front( );
@@ -197,6 +237,7 @@ CBaseGame :: ~CBaseGame( )
 void CBaseGame :: doDelete( )
 {
 	m_DoDelete = 1;
+	Wake( );
 }
 
 bool CBaseGame :: readyDelete( )
@@ -216,10 +257,15 @@ void CBaseGame :: loop( )
 		int nfds = 0;
 		unsigned int NumFDs = SetFD( &fd, &send_fd, &nfds );
 
+		// sleep until the next timer is due but never for more than 50ms because other threads can't wake us up
+
 		long usecBlock = 50000;
+		uint32_t TicksUntilUpdate = m_NextUpdateTicks - GetTicks( );
 
-		if( GetNextTimedActionTicks( ) * 1000 < usecBlock )
-			usecBlock = GetNextTimedActionTicks( ) * 1000;
+		if( (int32_t)TicksUntilUpdate < 0 )
+			usecBlock = 0;
+		else if( TicksUntilUpdate * 1000 < usecBlock )
+			usecBlock = TicksUntilUpdate * 1000;
 
 		if(usecBlock < 1000) usecBlock = 1000;
 
@@ -245,6 +291,8 @@ void CBaseGame :: loop( )
 			MILLISLEEP( 50 );
 		}
 
+		ResetSchedule( );
+
 		if( Update( &fd, &send_fd ) )
 		{
 			CONSOLE_Print( "[GameThread] deleting game [" + GetGameName( ) + "]" );
@@ -257,6 +305,17 @@ void CBaseGame :: loop( )
 		}
 	}
 
+	loopEnd( );
+}
+
+void CBaseGame :: loopEnd( )
+{
+	// this is called exactly once after the game stops being updated, either by the game thread or by the reactor that owns the game
+	// warning: this function may delete the game
+
+	if( m_GameLoaded )
+		CONSOLE_Print( "[GAME: " + m_GameName + "] action timing " + GetActionJitterString( ) );
+
 	// save replay
 	if( m_Replay && ( m_GameLoading || m_GameLoaded ) )
 	{
@@ -277,6 +336,22 @@ void CBaseGame :: loop( )
 
 		if(m_DatabaseID == 0) {
 			m_Replay->Save( m_GHost->m_TFT, m_GHost->m_ReplayPath + UTIL_FileSafeName( "GHost++ " + string( Time ) + " " + m_GameName + " (" + MinString + "m" + SecString + "s).w3g" ) );
+		} else if( m_GHost->m_ReplayArchive ) {
+			// replays of games with a database ID go in the replay archive, they're only saved as a file if that fails
+
+			string FileName = m_GHost->m_ReplayPath + UTIL_FileSafeName( UTIL_ToString( m_DatabaseID ) + ".w3g" );
+			string TempFileName = FileName + ".archive";
+
+			if( m_Replay->Save( m_GHost->m_TFT, TempFileName ) )
+			{
+				if( m_GHost->m_ReplayArchive->AddFile( m_DatabaseID, TempFileName ) )
+					remove( TempFileName.c_str( ) );
+				else
+				{
+					CONSOLE_Print( "[GAME: " + m_GameName + "] unable to add replay to the replay archive, saving it to [" + FileName + "] instead" );
+					rename( TempFileName.c_str( ), FileName.c_str( ) );
+				}
+			}
 		} else {
 			m_Replay->Save( m_GHost->m_TFT, m_GHost->m_ReplayPath + UTIL_FileSafeName( UTIL_ToString( m_DatabaseID ) + ".w3g" ) );
 		}
@@ -292,7 +367,7 @@ uint32_t CBaseGame :: GetNextTimedActionTicks( )
 {
 	// return the number of ticks (ms) until the next "timed action", which for our purposes is the next game update
 	// the main GHost++ loop will make sure the next loop update happens at or before this value
-	// note: there's no reason this function couldn't take into account the game's other timers too but they're far less critical
+	// note: the game's other timers are taken into account through ScheduleUpdate
 	// warning: this function must take into account when actions are not being sent (e.g. during loading or lagging)
 
 	if( !m_GameLoaded || m_Lagging )
@@ -306,6 +381,24 @@ uint32_t CBaseGame :: GetNextTimedActionTicks( )
 		return m_Latency - m_LastActionLateBy - TicksSinceLastUpdate;
 }
 
+string CBaseGame :: GetActionJitterString( )
+{
+	// e.g. "late by 0ms: 5012, 1ms: 31, 2ms: 2, 3-5ms: 0, 6-10ms: 0, 11-25ms: 0, 26-50ms: 0, 51ms+: 0 (max 2ms)"
+
+	string Names[ACTION_JITTER_BUCKETS] = { "0ms", "1ms", "2ms", "3-5ms", "6-10ms", "11-25ms", "26-50ms", "51ms+" };
+	string JitterString = "late by ";
+
+	for( uint32_t i = 0; i < ACTION_JITTER_BUCKETS; ++i )
+	{
+		if( i > 0 )
+			JitterString += ", ";
+
+		JitterString += Names[i] + ": " + UTIL_ToString( m_ActionJitter[i] );
+	}
+
+	return JitterString + " (max " + UTIL_ToString( m_ActionJitterMax ) + "ms)";
+}
+
 uint32_t CBaseGame :: GetSlotsOccupied( )
 {
 	uint32_t NumSlotsOccupied = 0;
@@ -411,98 +504,113 @@ unsigned int CBaseGame :: SetFD( void *fd, void *send_fd, int *nfds )
 	return NumFDs;
 }
 
-bool CBaseGame :: Update( void *fd, void *send_fd )
+void CBaseGame :: WatchSockets( CGameReactor *reactor, ReactorGame *entry )
 {
-	// update callables
+	// register every socket we own with the reactor, sockets that are already registered are skipped
+	// entry is our entry in the reactor, each socket is tagged with it so the reactor can find us without searching
 
-	for( vector<CCallableScoreCheck *> :: iterator i = m_ScoreChecks.begin( ); i != m_ScoreChecks.end( ); )
-	{
-		if( (*i)->GetReady( ) )
-		{
-			double *Score = (*i)->GetResult( );
+#ifdef GHOST_REACTOR
+	if( m_Socket )
+		reactor->Watch( m_Socket, entry );
 
-			if( Score != NULL )
-			{
-				for( vector<CPotentialPlayer *> :: iterator j = m_Potentials.begin( ); j != m_Potentials.end( ); ++j )
-				{
-					if( (*j)->GetJoinPlayer( ) && (*j)->GetJoinPlayer( )->GetName( ) == (*i)->GetName( ) )
-						EventPlayerJoined( *j, (*j)->GetJoinPlayer( ), Score );
-				}
-			}
-			else
-			{
-				// this is bad, it means that the score check failed
-				// we ignore and eventually player will be kicked
-			}
+	for( vector<CPotentialPlayer *> :: iterator i = m_Potentials.begin( ); i != m_Potentials.end( ); ++i )
+		reactor->Watch( (*i)->GetSocket( ), entry );
 
-			m_GHost->m_DB->RecoverCallable( *i );
-			delete *i;
-			i = m_ScoreChecks.erase( i );
-		}
-		else
-			++i;
-	}
+	for( vector<CGamePlayer *> :: iterator i = m_Players.begin( ); i != m_Players.end( ); ++i )
+		reactor->Watch( (*i)->GetSocket( ), entry );
+#endif
+}
 
-	for( vector<CCallableLeagueCheck *> :: iterator i = m_LeagueChecks.begin( ); i != m_LeagueChecks.end( ); )
-	{
-		if( (*i)->GetReady( ) )
-		{
-			double SID = (*i)->GetResult( ); //convert to double so we don't need another parameter
-			double *Array = new double[2];
-			Array[0] = SID;
-			Array[1] = 1000.0;
+void CBaseGame :: UnwatchSockets( CGameReactor *reactor )
+{
+#ifdef GHOST_REACTOR
+	if( m_Socket )
+		reactor->Unwatch( m_Socket );
 
-			for( vector<CPotentialPlayer *> :: iterator j = m_Potentials.begin( ); j != m_Potentials.end( ); ++j )
-			{
-				if( (*j)->GetJoinPlayer( ) && (*j)->GetJoinPlayer( )->GetName( ) == (*i)->GetName( ) )
-					EventPlayerJoined( *j, (*j)->GetJoinPlayer( ), Array );
-			}
+	for( vector<CPotentialPlayer *> :: iterator i = m_Potentials.begin( ); i != m_Potentials.end( ); ++i )
+		reactor->Unwatch( (*i)->GetSocket( ) );
 
-			m_GHost->m_DB->RecoverCallable( *i );
-			delete *i;
-			delete [] Array;
-			i = m_LeagueChecks.erase( i );
-		}
-		else
-			++i;
-	}
+	for( vector<CGamePlayer *> :: iterator i = m_Players.begin( ); i != m_Players.end( ); ++i )
+		reactor->Unwatch( (*i)->GetSocket( ) );
+#endif
+}
 
-	for( vector<CCallableConnectCheck *> :: iterator i = m_ConnectChecks.begin( ); i != m_ConnectChecks.end( ); )
-	{
-		if( (*i)->GetReady( ) )
-		{
-			bool Check = (*i)->GetResult( );
+bool CBaseGame :: ReactorUpdate( )
+{
+	// one iteration of the game loop when the game is owned by a reactor
+	// the sockets track their own readiness so there are no fd_sets to pass around
+	// returns true when the game should stop being updated (the reactor then calls loopEnd)
 
-			for( vector<CGamePlayer *> :: iterator j = m_Players.begin( ); j != m_Players.end( ); ++j )
-			{
-				if( (*j)->GetName( ) == (*i)->GetName( ) )
-				{
-					if( Check )
-					{
-						(*j)->SetSpoofed( true );
-						(*j)->SetSpoofedRealm( "wc3connect" );
-					}
-					else
-					{
-						(*j)->SetDeleteMe( true );
-						(*j)->SetLeftReason( "invalid session" );
-						(*j)->SetLeftCode( PLAYERLEAVE_LOBBY );
-						m_GHost->DenyIP( (*j)->GetExternalIPString( ), 20000, "kicked for invalid session" );
-						OpenSlot( GetSIDFromPID( (*j)->GetPID( ) ), false );
-					}
+	if( m_DoDelete != 0 )
+		return true;
 
-					break;
-				}
-			}
+	ResetSchedule( );
 
-			m_GHost->m_DB->RecoverCallable( *i );
-			delete *i;
-			i = m_ConnectChecks.erase( i );
-		}
-		else
-			++i;
+	if( Update( NULL, NULL ) )
+	{
+		CONSOLE_Print( "[GameThread] deleting game [" + GetGameName( ) + "]" );
+		m_DoDelete = 3;
+		return true;
 	}
 
+	UpdatePost( NULL );
+	return false;
+}
+
+void CBaseGame :: Wake( )
+{
+	// ask for an update as soon as possible, this is called by other threads after queueing something for the game
+	// games running in their own thread can't be interrupted but they never sleep for more than 50ms anyway
+
+#ifdef GHOST_REACTOR
+	if( m_Reactor )
+		m_Reactor->WakeGame( this );
+#endif
+}
+
+void CBaseGame :: ResetSchedule( )
+{
+	// called before every update, the update then schedules each of the game's timers
+	// if nothing is scheduled at all we still update the game once a minute in case something was missed
+
+	m_NextUpdateTicks = GetTicks( ) + 60000;
+}
+
+void CBaseGame :: ScheduleUpdate( uint32_t ticks )
+{
+	if( (int32_t)( ticks - m_NextUpdateTicks ) < 0 )
+		m_NextUpdateTicks = ticks;
+}
+
+void CBaseGame :: ScheduleTicks( uint32_t lastTicks, uint32_t interval )
+{
+	// the timer is due when GetTicks( ) - lastTicks >= interval
+	// use interval + 1 for timers that check for GetTicks( ) - lastTicks > interval
+
+	if( GetTicks( ) - lastTicks < interval )
+		ScheduleUpdate( lastTicks + interval );
+}
+
+void CBaseGame :: ScheduleTime( uint32_t lastTime, uint32_t interval )
+{
+	// the timer is due when GetTime( ) - lastTime >= interval
+	// GetTime is GetTicks / 1000 so that's the same as GetTicks( ) >= ( lastTime + interval ) * 1000
+
+	if( GetTime( ) - lastTime < interval )
+		ScheduleUpdate( ( lastTime + interval ) * 1000 );
+}
+
+bool CBaseGame :: Update( void *fd, void *send_fd )
+{
+	// dispatch the callables that became ready since the last update
+	// our queue wakes us up when one does so there's no need to poll them
+
+	vector<CBaseCallable *> Completed;
+	m_CallableQueue->GetCompleted( Completed );
+
+	for( vector<CBaseCallable *> :: iterator i = Completed.begin( ); i != Completed.end( ); ++i )
+		EventCallableCompleted( *i );
+
 	// update players
 
 	for( vector<CGamePlayer *> :: iterator i = m_Players.begin( ); i != m_Players.end( ); )
@@ -622,6 +730,8 @@ bool CBaseGame :: Update( void *fd, void *send_fd )
 		m_LastPingTime = GetTime( );
 	}
 
+	ScheduleTime( m_LastPingTime, 5 );
+
 	// auto rehost if there was a refresh error in autohosted games
 
 	if( m_RefreshError && !m_CountDownStarted && m_GameState == GAME_PUBLIC && !m_GHost->m_AutoHostGameName.empty( ) && m_GHost->m_AutoHostMaximumGames != 0 && m_GHost->m_AutoHostAutoStartPlayers != 0 && m_AutoStartPlayers != 0 && GetTicks( ) - m_RefreshErrorTicks > 10000 )
@@ -656,6 +766,9 @@ bool CBaseGame :: Update( void *fd, void *send_fd )
 		lock.unlock( );
 	}
 
+	if( m_RefreshError )
+		ScheduleTicks( m_RefreshErrorTicks, 10001 );
+
 	// refresh every 3 seconds
 
 	if( !m_RefreshError && !m_CountDownStarted && m_GameState == GAME_PUBLIC && GetSlotsOpen( ) > 0 && GetTime( ) - m_LastRefreshTime >= 3 )
@@ -683,6 +796,9 @@ bool CBaseGame :: Update( void *fd, void *send_fd )
 		m_LastRefreshTime = GetTime( );
 	}
 
+	if( !m_RefreshError && !m_CountDownStarted && m_GameState == GAME_PUBLIC )
+		ScheduleTime( m_LastRefreshTime, 3 );
+
 	// send more map data
 
 	if( !m_GameLoading && !m_GameLoaded && GetTicks( ) - m_LastDownloadCounterResetTicks >= 1000 )
@@ -697,61 +813,79 @@ bool CBaseGame :: Update( void *fd, void *send_fd )
 		m_LastDownloadCounterResetTicks = GetTicks( );
 	}
 
+	// the download counter only has to be reset if something was downloaded
+
+	if( !m_GameLoading && !m_GameLoaded && ( m_SlotInfoChanged || m_DownloadCounter > 0 ) )
+		ScheduleTicks( m_LastDownloadCounterResetTicks, 1000 );
+
 	if( !m_GameLoading && !m_GameLoaded && GetTicks( ) - m_LastDownloadTicks >= 100 )
 	{
-		uint32_t Downloaders = 0;
+		// each downloader gets as much map data as its window allows (see CDownloadPacer)
+		// the window grows with the player's measured ack rate and round trip time so fast players fill their link and slow players don't build up a backlog
+		// most map data is actually sent as the acks come in (see EventPlayerMapSize), this just tops up the token buckets and gets things started
+
+		vector<CGamePlayer *> Downloaders;
 
 		for( vector<CGamePlayer *> :: iterator i = m_Players.begin( ); i != m_Players.end( ); ++i )
 		{
-			if( (*i)->GetDownloadStarted( ) && !(*i)->GetDownloadFinished( ) )
+			if( (*i)->GetDownloadStarted( ) && !(*i)->GetDownloadFinished( ) && !(*i)->GetDeleteMe( ) )
 			{
-				++Downloaders;
-
-				if( m_GHost->m_MaxDownloaders > 0 && Downloaders > m_GHost->m_MaxDownloaders )
+				if( m_GHost->m_MaxDownloaders > 0 && Downloaders.size( ) >= m_GHost->m_MaxDownloaders )
 					break;
 
-				// send up to 100 pieces of the map at once so that the download goes faster
-				// if we wait for each MAPPART packet to be acknowledged by the client it'll take a long time to download
-				// this is because we would have to wait the round trip time (the ping time) between sending every 1442 bytes of map data
-				// doing it this way allows us to send at least 140 KB in each round trip interval which is much more reasonable
-				// the theoretical throughput is [140 KB * 1000 / ping] in KB/sec so someone with 100 ping (round trip ping, not LC ping) could download at 1400 KB/sec
-				// note: this creates a queue of map data which clogs up the connection when the client is on a slower connection (e.g. dialup)
-				// in this case any changes to the lobby are delayed by the amount of time it takes to send the queued data (i.e. 140 KB, which could be 30 seconds or more)
-				// for example, players joining and leaving, slot changes, chat messages would all appear to happen much later for the low bandwidth player
-				// note: the throughput is also limited by the number of times this code is executed each second
-				// e.g. if we send the maximum amount (140 KB) 10 times per second the theoretical throughput is 1400 KB/sec
-				// therefore the maximum throughput is 1400 KB/sec regardless of ping and this value slowly diminishes as the player's ping increases
-				// in addition to this, the throughput is limited by the configuration value bot_maxdownloadspeed
-				// in summary: the actual throughput is MIN( 140 * 1000 / ping, 1400, bot_maxdownloadspeed ) in KB/sec assuming only one player is downloading the map
-
-				uint32_t MapSize = UTIL_ByteArrayToUInt32( m_Map->GetMapSize( ), false );
-
-				while( (*i)->GetLastMapPartSent( ) < (*i)->GetLastMapPartAcked( ) + 1442 * 100 && (*i)->GetLastMapPartSent( ) < MapSize )
-				{
-					if( (*i)->GetLastMapPartSent( ) == 0 )
-					{
-						// overwrite the "started download ticks" since this is the first time we've sent any map data to the player
-						// prior to this we've only determined if the player needs to download the map but it's possible we could have delayed sending any data due to download limits
+				Downloaders.push_back( *i );
+			}
+		}
 
-						(*i)->SetStartedDownloadingTicks( GetTicks( ) );
-					}
+		if( m_GHost->m_MaxDownloadSpeed > 0 && !Downloaders.empty( ) )
+		{
+			// share the bot_maxdownloadspeed budget for the time since the last cycle fairly between the downloaders
+			// a player that can't use its full share (because its window is smaller) only gets what it can use and the rest goes to the others
 
-					// limit the download speed if we're sending too much data
-					// the download counter is the # of map bytes downloaded in the last second (it's reset once per second)
+			uint32_t Elapsed = min( GetTicks( ) - m_LastDownloadTicks, (uint32_t)1000 );
+			uint32_t Budget = m_GHost->m_MaxDownloadSpeed * 1024 / 1000 * Elapsed;
+			uint32_t MapSize = UTIL_ByteArrayToUInt32( m_Map->GetMapSize( ), false );
+			vector<pair<uint32_t, CGamePlayer *> > Demands;
 
-					if( m_GHost->m_MaxDownloadSpeed > 0 && m_DownloadCounter > m_GHost->m_MaxDownloadSpeed * 1024 )
-						break;
+			for( vector<CGamePlayer *> :: iterator i = Downloaders.begin( ); i != Downloaders.end( ); ++i )
+			{
+				// the player can use whatever fits in its window now plus whatever it acks before the next cycle
 
-					Send( *i, m_Protocol->SEND_W3GS_MAPPART( GetHostPID( ), (*i)->GetPID( ), (*i)->GetLastMapPartSent( ), m_Map->GetMapData( ) ) );
-					(*i)->SetLastMapPartSent( (*i)->GetLastMapPartSent( ) + 1442 );
-					m_DownloadCounter += 1442;
-				}
+				CDownloadPacer *Pacer = (*i)->GetDownloadPacer( );
+				uint32_t Limit = min( (*i)->GetLastMapPartAcked( ) + Pacer->GetWindow( ), MapSize );
+				uint32_t Room = Limit > (*i)->GetLastMapPartSent( ) ? Limit - (*i)->GetLastMapPartSent( ) : 0;
+				uint32_t Demand = max( Room, Pacer->GetRate( ) / 1000 * Elapsed ) + MAPPART_SIZE;
+				Demands.push_back( make_pair( Demand, *i ) );
+			}
+
+			sort( Demands.begin( ), Demands.end( ) );
+
+			for( uint32_t i = 0; i < Demands.size( ); ++i )
+			{
+				uint32_t Share = min( Demands[i].first, Budget / (uint32_t)( Demands.size( ) - i ) );
+				Demands[i].second->GetDownloadPacer( )->AddTokens( Share, Demands[i].first );
+				Budget -= Share;
 			}
 		}
 
+		for( vector<CGamePlayer *> :: iterator i = Downloaders.begin( ); i != Downloaders.end( ); ++i )
+			SendMapParts( *i );
+
 		m_LastDownloadTicks = GetTicks( );
 	}
 
+	if( !m_GameLoading && !m_GameLoaded )
+	{
+		for( vector<CGamePlayer *> :: iterator i = m_Players.begin( ); i != m_Players.end( ); ++i )
+		{
+			if( (*i)->GetDownloadStarted( ) && !(*i)->GetDownloadFinished( ) )
+			{
+				ScheduleTicks( m_LastDownloadTicks, 100 );
+				break;
+			}
+		}
+	}
+
 	// announce every m_AnnounceInterval seconds
 
 	if( !m_AnnounceMessage.empty( ) && !m_CountDownStarted && GetTime( ) - m_LastAnnounceTime >= m_AnnounceInterval )
@@ -760,6 +894,9 @@ bool CBaseGame :: Update( void *fd, void *send_fd )
 		m_LastAnnounceTime = GetTime( );
 	}
 
+	if( !m_AnnounceMessage.empty( ) && !m_CountDownStarted )
+		ScheduleTime( m_LastAnnounceTime, m_AnnounceInterval );
+
 	// handle saygames vector
 
 	boost::mutex::scoped_lock lock( m_SayGamesMutex );
@@ -851,6 +988,8 @@ bool CBaseGame :: Update( void *fd, void *send_fd )
 				m_GHost->DenyIP( (*i)->GetExternalIPString( ), 20000, "kicked for spoof check" );
 				OpenSlot( GetSIDFromPID( (*i)->GetPID( ) ), false );
 			}
+			else if( !(*i)->GetSpoofed( ) )
+				ScheduleTime( (*i)->GetJoinTime( ), 30 );
 		}
 	}
 
@@ -862,6 +1001,9 @@ bool CBaseGame :: Update( void *fd, void *send_fd )
 		m_LastAutoStartTime = GetTime( );
 	}
 
+	if( !m_CountDownStarted && m_AutoStartPlayers != 0 )
+		ScheduleTime( m_LastAutoStartTime, 10 );
+
 	// countdown every 500 ms
 
 	if( m_CountDownStarted && GetTicks( ) - m_LastCountDownTicks >= 500 )
@@ -881,6 +1023,9 @@ bool CBaseGame :: Update( void *fd, void *send_fd )
 		m_LastCountDownTicks = GetTicks( );
 	}
 
+	if( m_CountDownStarted && !m_GameLoading && !m_GameLoaded )
+		ScheduleTicks( m_LastCountDownTicks, 500 );
+
 	// check if the lobby is "abandoned" and needs to be closed since it will never start
 
 	if( !m_GameLoading && !m_GameLoaded && m_GHost->m_LobbyTimeLimit > 0 && ( m_GHost->m_AutoHostGameName.empty( ) || m_GHost->m_AutoHostMaximumGames == 0 || m_GHost->m_AutoHostAutoStartPlayers == 0 || m_AutoStartPlayers == 0 ) )
@@ -900,6 +1045,8 @@ bool CBaseGame :: Update( void *fd, void *send_fd )
 			CONSOLE_Print( "[GAME: " + m_GameName + "] is over (lobby time limit hit)" );
 			return true;
 		}
+
+		ScheduleTime( m_LastReservedSeen, m_GHost->m_LobbyTimeLimit * 60 );
 	}
 
 	// check if the game is loaded
@@ -934,10 +1081,25 @@ bool CBaseGame :: Update( void *fd, void *send_fd )
 			m_LastActionSentTicks = GetTicks( );
 			m_GameLoading = false;
 			m_GameLoaded = true;
+			m_LastStatusTime = GetTime( );
+
+			// the start of the replay is final now so start compressing it in the background
+			// spectators watch the same data so the game is published to the spectator relay here too
+
+			if( m_Replay )
+			{
+				if( m_GHost->m_Relay )
+					m_Replay->SetRelayFeed( m_GHost->m_Relay->AddFeed( m_HostCounter, m_GameName, m_GHost->m_ReplayWar3Version, m_GHost->m_ReplayBuildNumber, m_GHost->m_TFT ) );
+
+				m_Replay->Stream( m_GHost->m_ReplayCompressor, m_GHost->m_ReplayPath + UTIL_FileSafeName( "GHost++ " + UTIL_ToString( m_HostCounter ) + ".w3g.tmp" ), m_GameName, m_StatString );
+			}
+
 			EventGameLoaded( );
 		}
 		else
 		{
+			ScheduleTicks( m_StartedLoadingTicks, 240001 );
+
 			// reset the "lag" screen (the load-in-game screen) every 30 seconds
 
 			if( m_LoadInGame && GetTime( ) - m_LastLagScreenResetTime >= 30 )
@@ -1006,13 +1168,15 @@ bool CBaseGame :: Update( void *fd, void *send_fd )
 
 				if( m_Replay )
 				{
+					BYTEARRAY EmptyActions = m_Protocol->SEND_W3GS_INCOMING_ACTION( queue<CIncomingAction *>( ), 0 );
+
 					if( UsingGProxy )
 					{
 						for( unsigned char i = 0; i < m_GProxyEmptyActions; ++i )
-							m_Replay->AddTimeSlot( 0, queue<CIncomingAction *>( ) );
+							m_Replay->AddTimeSlot( EmptyActions );
 					}
 
-					m_Replay->AddTimeSlot( 0, queue<CIncomingAction *>( ) );
+					m_Replay->AddTimeSlot( EmptyActions );
 				}
 
 				// Warcraft III doesn't seem to respond to empty actions
@@ -1023,6 +1187,9 @@ bool CBaseGame :: Update( void *fd, void *send_fd )
 				m_SyncCounter++; */
 				m_LastLagScreenResetTime = GetTime( );
 			}
+
+			if( m_LoadInGame )
+				ScheduleTime( m_LastLagScreenResetTime, 30 );
 		}
 	}
 
@@ -1099,6 +1266,8 @@ bool CBaseGame :: Update( void *fd, void *send_fd )
 
 			if( GetTime( ) - m_StartedLaggingTime >= WaitTime )
 				StopLaggers( m_GHost->m_Language->WasAutomaticallyDroppedAfterSeconds( UTIL_ToString( WaitTime ) ) );
+			else
+				ScheduleTime( m_StartedLaggingTime, WaitTime );
 
 			// we cannot allow the lag screen to stay up for more than ~65 seconds because Warcraft III disconnects if it doesn't receive an action packet at least this often
 			// one (easy) solution is to simply drop all the laggers if they lag for more than 60 seconds
@@ -1141,13 +1310,15 @@ bool CBaseGame :: Update( void *fd, void *send_fd )
 
 				if( m_Replay )
 				{
+					BYTEARRAY EmptyActions = m_Protocol->SEND_W3GS_INCOMING_ACTION( queue<CIncomingAction *>( ), 0 );
+
 					if( UsingGProxy )
 					{
 						for( unsigned char i = 0; i < m_GProxyEmptyActions; ++i )
-							m_Replay->AddTimeSlot( 0, queue<CIncomingAction *>( ) );
+							m_Replay->AddTimeSlot( EmptyActions );
 					}
 
-					m_Replay->AddTimeSlot( 0, queue<CIncomingAction *>( ) );
+					m_Replay->AddTimeSlot( EmptyActions );
 				}
 
 				// Warcraft III doesn't seem to respond to empty actions
@@ -1159,6 +1330,8 @@ bool CBaseGame :: Update( void *fd, void *send_fd )
 				m_LastLagScreenResetTime = GetTime( );
 			}
 
+			ScheduleTime( m_LastLagScreenResetTime, 60 );
+
 			// check if anyone has stopped lagging normally
 			// we consider a player to have stopped lagging if they're less than half m_SyncLimit keepalives behind
 
@@ -1201,17 +1374,22 @@ bool CBaseGame :: Update( void *fd, void *send_fd )
 		}
 
 		// see if we can handle any pending reconnects
-		if( !m_GHost->m_PendingReconnects.empty( ) && GetTicks( ) - m_LastReconnectHandleTime > 500 )
+		// the main thread adds to m_PendingReconnects at any time so it's only looked at while holding m_ReconnectMutex
+
+		boost::mutex::scoped_lock lock( m_GHost->m_ReconnectMutex );
+		bool StillPending = !m_GHost->m_PendingReconnects.empty( );
+
+		if( StillPending && GetTicks( ) - m_LastReconnectHandleTime > 500 )
 		{
 			m_LastReconnectHandleTime = GetTicks( );
 
-			boost::mutex::scoped_lock lock( m_GHost->m_ReconnectMutex );
-
 			for( vector<GProxyReconnector *> :: iterator i = m_GHost->m_PendingReconnects.begin( ); i != m_GHost->m_PendingReconnects.end( ); )
 			{
 				CGamePlayer *Player = GetPlayerFromPID( (*i)->PID );
 
-				if( Player && Player->GetGProxy( ) && Player->GetGProxyReconnectKey( ) == (*i)->ReconnectKey )
+				// players that were dropped from the GProxy++ log can't be resumed, the main thread rejects the reconnect when it times out
+
+				if( Player && Player->GetGProxy( ) && Player->GetGProxyReconnectKey( ) == (*i)->ReconnectKey && !m_GProxyLog->GetDropped( Player->GetPID( ) ) )
 				{
 					Player->EventGProxyReconnect( (*i)->socket, (*i)->LastPacket );
 					delete (*i);
@@ -1222,8 +1400,15 @@ bool CBaseGame :: Update( void *fd, void *send_fd )
 				i++;
 			}
 
-			lock.unlock();
+			StillPending = !m_GHost->m_PendingReconnects.empty( );
 		}
+
+		lock.unlock( );
+
+		// reconnects are posted by the main thread which wakes us up but keep trying in case the player's game hasn't caught up yet
+
+		if( StillPending )
+			ScheduleTicks( m_LastReconnectHandleTime, 501 );
 	}
 
 	// send actions every m_Latency milliseconds
@@ -1233,6 +1418,22 @@ bool CBaseGame :: Update( void *fd, void *send_fd )
 	if( m_GameLoaded && !m_Lagging && GetTicks( ) - m_LastActionSentTicks >= m_Latency - m_LastActionLateBy )
 		SendAllActions( );
 
+	if( m_GameLoaded && !m_Lagging )
+		ScheduleUpdate( GetTicks( ) + GetNextTimedActionTicks( ) );
+
+	// print the action timing and the GProxy++ log every GAME_STATUSINTERVAL seconds, not just when the game is deleted
+	// a log that's growing or dropping players shows up while the game is still running
+
+	if( m_GameLoaded && GetTime( ) - m_LastStatusTime >= GAME_STATUSINTERVAL )
+	{
+		CONSOLE_Print( "[GAME: " + m_GameName + "] action timing " + GetActionJitterString( ) );
+
+		if( m_GProxyLog->GetPeakEntries( ) > 0 )
+			CONSOLE_Print( "[GAME: " + m_GameName + "] " + m_GProxyLog->GetStatus( ) );
+
+		m_LastStatusTime = GetTime( );
+	}
+
 	// expire the votekick
 
 	if( !m_KickVotePlayer.empty( ) && GetTime( ) - m_StartedKickVoteTime >= 60 )
@@ -1243,6 +1444,9 @@ bool CBaseGame :: Update( void *fd, void *send_fd )
 		m_StartedKickVoteTime = 0;
 	}
 
+	if( !m_KickVotePlayer.empty( ) )
+		ScheduleTime( m_StartedKickVoteTime, 60 );
+
 	// expire the votestart
 
 	if( m_StartedVoteStartTime != 0 && GetTime( ) - m_StartedVoteStartTime >= 60 )
@@ -1252,6 +1456,9 @@ bool CBaseGame :: Update( void *fd, void *send_fd )
 		m_StartedVoteStartTime = 0;
 	}
 
+	if( m_StartedVoteStartTime != 0 )
+		ScheduleTime( m_StartedVoteStartTime, 60 );
+
 	// start the gameover timer if there's only one player left
 
 	if( m_Players.size( ) == 1 && m_FakePlayers.empty( ) && m_GameOverTime == 0 && ( m_GameLoading || m_GameLoaded ) && m_GHost->m_CloseSinglePlayer )
@@ -1282,6 +1489,9 @@ bool CBaseGame :: Update( void *fd, void *send_fd )
 		}
 	}
 
+	if( m_GameOverTime != 0 )
+		ScheduleTime( m_GameOverTime, 60 );
+
 	// end the game if there aren't any players left
 
 	if( m_Players.empty( ) && ( m_GameLoading || m_GameLoaded ) )
@@ -1294,15 +1504,21 @@ bool CBaseGame :: Update( void *fd, void *send_fd )
 		}
 		else if( IsGameDataSaved( ) )
 			return true;
+
+		// poll until the game data has been saved
+
+		ScheduleUpdate( GetTicks( ) + 100 );
 	}
 
 	// accept new connections
 
 	if( m_Socket )
 	{
-		CTCPSocket *NewSocket = m_Socket->Accept( (fd_set *)fd );
+		// accept every waiting connection since a reactor only tells us about them once
+
+		CTCPSocket *NewSocket;
 
-		if( NewSocket )
+		while( ( NewSocket = m_Socket->Accept( (fd_set *)fd ) ) )
 		{
 			// check the IP blacklist
 
@@ -1360,12 +1576,28 @@ void CBaseGame :: Send( unsigned char PID, BYTEARRAY data )
 
 void CBaseGame :: Send( BYTEARRAY PIDs, BYTEARRAY data )
 {
+	// the packet is encoded once and shared by every recipient's send buffer
+
+	SHAREDBYTEARRAY Packet = UTIL_CreateSharedByteArray( data );
+
 	for( unsigned int i = 0; i < PIDs.size( ); ++i )
-		Send( PIDs[i], data );
+	{
+		CGamePlayer *Player = GetPlayerFromPID( PIDs[i] );
+
+		if( Player )
+			Player->Send( Packet );
+	}
 }
 
 void CBaseGame :: SendAll( BYTEARRAY data )
 {
+	SendAll( UTIL_CreateSharedByteArray( data ) );
+}
+
+void CBaseGame :: SendAll( const SHAREDBYTEARRAY &data )
+{
+	// every player's send buffer (and GProxy++ buffer) references the same packet so broadcasting doesn't copy it once per player
+
 	for( vector<CGamePlayer *> :: iterator i = m_Players.begin( ); i != m_Players.end( ); ++i )
 		(*i)->Send( data );
 }
@@ -1527,20 +1759,24 @@ void CBaseGame :: SendAllActions( )
 		// we must send empty actions to non-GProxy++ players
 		// GProxy++ will insert these itself so we don't need to send them to GProxy++ players
 		// empty actions are used to extend the time a player can use when reconnecting
+		// the empty action packet is encoded once and shared by everyone who gets it
+
+		BYTEARRAY EmptyActionsPacket = m_Protocol->SEND_W3GS_INCOMING_ACTION( queue<CIncomingAction *>( ), 0 );
+		SHAREDBYTEARRAY EmptyActions = UTIL_CreateSharedByteArray( EmptyActionsPacket );
 
 		for( vector<CGamePlayer *> :: iterator i = m_Players.begin( ); i != m_Players.end( ); ++i )
 		{
 			if( !(*i)->GetGProxy( ) )
 			{
 				for( unsigned char j = 0; j < m_GProxyEmptyActions; ++j )
-					Send( *i, m_Protocol->SEND_W3GS_INCOMING_ACTION( queue<CIncomingAction *>( ), 0 ) );
+					(*i)->Send( EmptyActions );
 			}
 		}
 
 		if( m_Replay )
 		{
 			for( unsigned char i = 0; i < m_GProxyEmptyActions; ++i )
-				m_Replay->AddTimeSlot( 0, queue<CIncomingAction *>( ) );
+				m_Replay->AddTimeSlot( *EmptyActions );
 		}
 	}
 
@@ -1577,10 +1813,7 @@ void CBaseGame :: SendAllActions( )
 				// so send everything already in the queue and then clear it out
 				// the W3GS_INCOMING_ACTION2 packet handles the overflow but it must be sent *before* the corresponding W3GS_INCOMING_ACTION packet
 
-				SendAll( m_Protocol->SEND_W3GS_INCOMING_ACTION2( SubActions ) );
-
-				if( m_Replay )
-					m_Replay->AddTimeSlot2( SubActions );
+				SendAllActionPacket( m_Protocol->SEND_W3GS_INCOMING_ACTION2( SubActions ) );
 
 				while( !SubActions.empty( ) )
 				{
@@ -1595,10 +1828,7 @@ void CBaseGame :: SendAllActions( )
 			SubActionsLength += Action->GetLength( );
 		}
 
-		SendAll( m_Protocol->SEND_W3GS_INCOMING_ACTION( SubActions, m_Latency ) );
-
-		if( m_Replay )
-			m_Replay->AddTimeSlot( m_Latency, SubActions );
+		SendAllActionPacket( m_Protocol->SEND_W3GS_INCOMING_ACTION( SubActions, m_Latency ) );
 
 		while( !SubActions.empty( ) )
 		{
@@ -1608,16 +1838,18 @@ void CBaseGame :: SendAllActions( )
 	}
 	else
 	{
-		SendAll( m_Protocol->SEND_W3GS_INCOMING_ACTION( m_Actions, m_Latency ) );
-
-		if( m_Replay )
-			m_Replay->AddTimeSlot( m_Latency, m_Actions );
+		SendAllActionPacket( m_Protocol->SEND_W3GS_INCOMING_ACTION( m_Actions, m_Latency ) );
 	}
 
 	uint32_t ActualSendInterval = GetTicks( ) - m_LastActionSentTicks;
 	uint32_t ExpectedSendInterval = m_Latency - m_LastActionLateBy;
 	m_LastActionLateBy = ActualSendInterval - ExpectedSendInterval;
 
+	// the send interval is shortened on purpose when autosaving before a player drop so that isn't counted
+
+	if( ActualSendInterval >= ExpectedSendInterval )
+		RecordActionJitter( m_LastActionLateBy );
+
 	if( m_LastActionLateBy > m_Latency )
 	{
 		// something is going terribly wrong - GHost++ is probably starved of resources
@@ -1631,6 +1863,35 @@ void CBaseGame :: SendAllActions( )
 	m_LastActionSentTicks = GetTicks( );
 }
 
+void CBaseGame :: SendAllActionPacket( BYTEARRAY packet )
+{
+	// the actions of a time slot are serialized once into packet which is then shared by every consumer
+	// the players' send buffers and the GProxy++ log reference it and the replay builds its time slot block from it
+
+	SHAREDBYTEARRAY ActionPacket = UTIL_CreateSharedByteArray( packet );
+	SendAll( ActionPacket );
+
+	if( m_Replay )
+		m_Replay->AddTimeSlot( *ActionPacket );
+}
+
+void CBaseGame :: RecordActionJitter( uint32_t lateBy )
+{
+	// keep track of how late each action packet was sent so we can tell how stable the game's tick is
+	// the buckets are 0, 1, 2, 3-5, 6-10, 11-25, 26-50 and 51+ ticks
+
+	uint32_t Limits[ACTION_JITTER_BUCKETS - 1] = { 0, 1, 2, 5, 10, 25, 50 };
+	uint32_t Bucket = 0;
+
+	while( Bucket < ACTION_JITTER_BUCKETS - 1 && lateBy > Limits[Bucket] )
+		++Bucket;
+
+	++m_ActionJitter[Bucket];
+
+	if( lateBy > m_ActionJitterMax )
+		m_ActionJitterMax = lateBy;
+}
+
 void CBaseGame :: SendWelcomeMessage( CGamePlayer *player )
 {
 	// read from motd.txt if available (thanks to zeeg for this addition)
@@ -1800,6 +2061,7 @@ void CBaseGame :: EventPlayerDeleted( CGamePlayer *player )
 
 	// set the replay's host PID and name to the last player to leave the game
 	// this will get overwritten as each player leaves the game so it will eventually be set to the last player
+	// unless the replay is being streamed, then the host is whoever it was when the game finished loading (see CReplay :: Stream)
 
 	if( m_Replay && ( m_GameLoading || m_GameLoaded ) )
 	{
@@ -1840,7 +2102,7 @@ void CBaseGame :: EventPlayerDeleted( CGamePlayer *player )
 
 void CBaseGame :: EventPlayerDisconnectTimedOut( CGamePlayer *player )
 {
-	if( player->GetGProxy( ) && m_GameLoaded )
+	if( player->GetGProxy( ) && m_GameLoaded && !m_GProxyLog->GetDropped( player->GetPID( ) ) )
 	{
 		if( !player->GetGProxyDisconnectNoticeSent( ) )
 		{
@@ -1894,7 +2156,7 @@ void CBaseGame :: EventPlayerDisconnectPlayerError( CGamePlayer *player )
 
 void CBaseGame :: EventPlayerDisconnectSocketError( CGamePlayer *player )
 {
-	if( player->GetGProxy( ) && m_GameLoaded )
+	if( player->GetGProxy( ) && m_GameLoaded && !m_GProxyLog->GetDropped( player->GetPID( ) ) )
 	{
 		if( !player->GetGProxyDisconnectNoticeSent( ) )
 		{
@@ -1927,7 +2189,7 @@ void CBaseGame :: EventPlayerDisconnectSocketError( CGamePlayer *player )
 
 void CBaseGame :: EventPlayerDisconnectConnectionClosed( CGamePlayer *player )
 {
-	if( player->GetGProxy( ) && m_GameLoaded )
+	if( player->GetGProxy( ) && m_GameLoaded && !m_GProxyLog->GetDropped( player->GetPID( ) ) )
 	{
 		if( !player->GetGProxyDisconnectNoticeSent( ) )
 		{
@@ -2034,7 +2296,7 @@ CGamePlayer *CBaseGame :: EventPlayerJoined( CPotentialPlayer *potential, CIncom
 		// start a database query to determine the player's score
 		// when the query is complete we will call EventPlayerJoined, but with a score
 
-		m_ScoreChecks.push_back( m_GHost->m_DB->ThreadedScoreCheck( m_Map->GetMapMatchMakingCategory( ), joinPlayer->GetName( ), JoinedRealm ) );
+		m_ScoreChecks.push_back( m_CallableQueue->Attach( m_GHost->m_DB->ThreadedScoreCheck( m_Map->GetMapMatchMakingCategory( ), joinPlayer->GetName( ), JoinedRealm ) ) );
 		return NULL;
 	}
 	else if( m_League && score == NULL )
@@ -2043,9 +2305,9 @@ CGamePlayer *CBaseGame :: EventPlayerJoined( CPotentialPlayer *potential, CIncom
 		// this just means that we take slots from MySQL database (score will store SID...)
 
 		if( m_Tournament )
-			m_LeagueChecks.push_back( m_GHost->m_DB->ThreadedLeagueCheck( m_Map->GetMapMatchMakingCategory( ), joinPlayer->GetName( ), JoinedRealm, m_GameName ) );
+			m_LeagueChecks.push_back( m_CallableQueue->Attach( m_GHost->m_DB->ThreadedLeagueCheck( m_Map->GetMapMatchMakingCategory( ), joinPlayer->GetName( ), JoinedRealm, m_GameName ) ) );
 		else
-			m_LeagueChecks.push_back( m_GHost->m_DB->ThreadedLeagueCheck( m_Map->GetMapMatchMakingCategory( ), joinPlayer->GetName( ), JoinedRealm, "" ) );
+			m_LeagueChecks.push_back( m_CallableQueue->Attach( m_GHost->m_DB->ThreadedLeagueCheck( m_Map->GetMapMatchMakingCategory( ), joinPlayer->GetName( ), JoinedRealm, "" ) ) );
 
 		return NULL;
 	}
@@ -2285,7 +2547,7 @@ CGamePlayer *CBaseGame :: EventPlayerJoined( CPotentialPlayer *potential, CIncom
 			Player->SetSpoofedRealm( "wc3connect" );
 		}
 		else
-			m_ConnectChecks.push_back( m_GHost->m_DB->ThreadedConnectCheck( joinPlayer->GetName( ), joinPlayer->GetEntryKey( ) ) );
+			m_ConnectChecks.push_back( m_CallableQueue->Attach( m_GHost->m_DB->ThreadedConnectCheck( joinPlayer->GetName( ), joinPlayer->GetEntryKey( ) ) ) );
 	}
 
 	Player->SetWhoisShouldBeSent( m_GHost->m_SpoofChecks == 1 || ( m_GHost->m_SpoofChecks == 2 && AnyAdminCheck ) );
@@ -3055,6 +3317,84 @@ void CBaseGame :: EventPlayerDropRequest( CGamePlayer *player )
 	}
 }
 
+void CBaseGame :: SendMapParts( CGamePlayer *player )
+{
+	// send the player as many map parts as its download window and its share of bot_maxdownloadspeed allow
+
+	CDownloadPacer *Pacer = player->GetDownloadPacer( );
+	uint32_t MapSize = UTIL_ByteArrayToUInt32( m_Map->GetMapSize( ), false );
+
+	while( player->GetLastMapPartSent( ) < player->GetLastMapPartAcked( ) + Pacer->GetWindow( ) && player->GetLastMapPartSent( ) < MapSize )
+	{
+		if( m_GHost->m_MaxDownloadSpeed > 0 && Pacer->GetTokens( ) < MAPPART_SIZE )
+			break;
+
+		if( player->GetLastMapPartSent( ) == 0 )
+		{
+			// overwrite the "started download ticks" since this is the first time we've sent any map data to the player
+			// prior to this we've only determined if the player needs to download the map but it's possible we could have delayed sending any data due to download limits
+
+			player->SetStartedDownloadingTicks( GetTicks( ) );
+		}
+
+		// map parts go in the player's bulk send buffer so slot info, chat and pings still get through right away while it's downloading
+
+		player->SendBulk( m_Protocol->SEND_W3GS_MAPPART( GetHostPID( ), player->GetPID( ), player->GetLastMapPartSent( ), m_Map->GetMapData( ), m_Map->GetMapDataSize( ), m_Map->GetMapPartCRC( player->GetLastMapPartSent( ) ) ) );
+		player->SetLastMapPartSent( player->GetLastMapPartSent( ) + MAPPART_SIZE );
+		Pacer->Sent( min( player->GetLastMapPartSent( ), MapSize ), GetTicks( ) );
+		Pacer->TakeTokens( MAPPART_SIZE );
+		m_DownloadCounter += MAPPART_SIZE;
+	}
+}
+
+void CBaseGame :: CheckMapFile( )
+{
+	// make sure the map file still holds the map we advertised before anyone starts downloading it
+	// the new file is loaded into a copy of our map so we can keep sending the old one if the file was replaced with a different map (our view of the old file is still intact then)
+
+	if( m_MapFileChanged )
+		return;
+
+	CMap Map( *m_Map );
+	uint32_t Change = Map.CheckMapFile( );
+
+	if( Change == MAPPEDFILE_UNCHANGED )
+		return;
+
+	if( Map.GetMapSize( ) == m_Map->GetMapSize( ) && Map.GetMapInfo( ) == m_Map->GetMapInfo( ) && Map.GetMapCRC( ) == m_Map->GetMapCRC( ) && Map.GetMapSHA1( ) == m_Map->GetMapSHA1( ) )
+	{
+		// it's still the same map so just switch to the new file
+
+		*m_Map = Map;
+		return;
+	}
+
+	m_MapFileChanged = true;
+
+	if( Change == MAPPEDFILE_REPLACED )
+	{
+		CONSOLE_Print( "[GAME: " + m_GameName + "] map file was replaced with a different map, still sending the map this game was created with" );
+		return;
+	}
+
+	// the file was overwritten in place so we can't send the map we advertised any more
+	// anyone downloading it has already been sent parts of two different maps
+
+	CONSOLE_Print( "[GAME: " + m_GameName + "] map file was overwritten with a different map, disabling map downloads" );
+	m_AllowDownloads = false;
+
+	for( vector<CGamePlayer *> :: iterator i = m_Players.begin( ); i != m_Players.end( ); ++i )
+	{
+		if( (*i)->GetDownloadStarted( ) && !(*i)->GetDownloadFinished( ) && !(*i)->GetDeleteMe( ) )
+		{
+			(*i)->SetDeleteMe( true );
+			(*i)->SetLeftReason( "the map file changed while downloading the map" );
+			(*i)->SetLeftCode( PLAYERLEAVE_LOBBY );
+			OpenSlot( GetSIDFromPID( (*i)->GetPID( ) ), false );
+		}
+	}
+}
+
 void CBaseGame :: EventPlayerMapSize( CGamePlayer *player, CIncomingMapSize *mapSize )
 {
 	if( m_GameLoading || m_GameLoaded )
@@ -3068,11 +3408,12 @@ void CBaseGame :: EventPlayerMapSize( CGamePlayer *player, CIncomingMapSize *map
 	{
 		// the player doesn't have the map
 
+		if( m_GHost->m_AllowDownloads != 0 && m_AllowDownloads && !player->GetDownloadStarted( ) && mapSize->GetSizeFlag( ) == 1 )
+			CheckMapFile( );
+
 		if( m_GHost->m_AllowDownloads != 0 && m_AllowDownloads )
 		{
-			string *MapData = m_Map->GetMapData( );
-
-			if( !MapData->empty( ) )
+			if( m_Map->GetMapDataSize( ) != 0 )
 			{
 				if( m_GHost->m_AllowDownloads == 1 || ( m_GHost->m_AllowDownloads == 2 && player->GetDownloadAllowed( ) ) )
 				{
@@ -3086,7 +3427,16 @@ void CBaseGame :: EventPlayerMapSize( CGamePlayer *player, CIncomingMapSize *map
 						player->SetStartedDownloadingTicks( GetTicks( ) );
 					}
 					else
+					{
 						player->SetLastMapPartAcked( mapSize->GetMapSize( ) );
+						player->GetDownloadPacer( )->Acked( mapSize->GetMapSize( ), GetTicks( ) );
+
+						// the ack made room in the player's window so send more right away rather than waiting for the next download cycle
+						// only players that were already sent something are sent more here because they're the ones within bot_maxdownloaders
+
+						if( player->GetLastMapPartSent( ) > 0 )
+							SendMapParts( player );
+					}
 				}
 			}
 			else
@@ -3121,7 +3471,7 @@ void CBaseGame :: EventPlayerMapSize( CGamePlayer *player, CIncomingMapSize *map
 
 			float Seconds = (float)( GetTicks( ) - player->GetStartedDownloadingTicks( ) ) / 1000;
 			float Rate = (float)MapSize / 1024 / Seconds;
-			CONSOLE_Print( "[GAME: " + m_GameName + "] map download finished for player [" + player->GetName( ) + "] in " + UTIL_ToString( Seconds, 1 ) + " seconds" );
+			CONSOLE_Print( "[GAME: " + m_GameName + "] map download finished for player [" + player->GetName( ) + "] in " + UTIL_ToString( Seconds, 1 ) + " seconds (minimum RTT " + UTIL_ToString( player->GetDownloadPacer( )->GetMinRTT( ) ) + " ms, final window " + UTIL_ToString( player->GetDownloadPacer( )->GetWindow( ) / 1024 ) + " KB)" );
 			SendAllChat( m_GHost->m_Language->PlayerDownloadedTheMap( player->GetName( ), UTIL_ToString( Seconds, 1 ), UTIL_ToString( Rate, 1 ) ) );
 			player->SetDownloadFinished( true );
 			player->SetFinishedDownloadingTime( GetTime( ) );
@@ -3175,6 +3525,99 @@ void CBaseGame :: EventPlayerPongToHost( CGamePlayer *player, uint32_t pong )
 	}
 }
 
+bool CBaseGame :: EventCallableCompleted( CBaseCallable *callable )
+{
+	// find out which of our callables this is and handle its result
+	// returns false if it isn't one of ours (e.g. a potential player's ban check which the player takes care of itself)
+
+	for( vector<CCallableScoreCheck *> :: iterator i = m_ScoreChecks.begin( ); i != m_ScoreChecks.end( ); ++i )
+	{
+		if( *i == callable )
+		{
+			double *Score = (*i)->GetResult( );
+
+			if( Score != NULL )
+			{
+				for( vector<CPotentialPlayer *> :: iterator j = m_Potentials.begin( ); j != m_Potentials.end( ); ++j )
+				{
+					if( (*j)->GetJoinPlayer( ) && (*j)->GetJoinPlayer( )->GetName( ) == (*i)->GetName( ) )
+						EventPlayerJoined( *j, (*j)->GetJoinPlayer( ), Score );
+				}
+			}
+			else
+			{
+				// this is bad, it means that the score check failed
+				// we ignore and eventually player will be kicked
+			}
+
+			m_GHost->m_DB->RecoverCallable( *i );
+			delete *i;
+			m_ScoreChecks.erase( i );
+			return true;
+		}
+	}
+
+	for( vector<CCallableLeagueCheck *> :: iterator i = m_LeagueChecks.begin( ); i != m_LeagueChecks.end( ); ++i )
+	{
+		if( *i == callable )
+		{
+			double SID = (*i)->GetResult( ); //convert to double so we don't need another parameter
+			double *Array = new double[2];
+			Array[0] = SID;
+			Array[1] = 1000.0;
+
+			for( vector<CPotentialPlayer *> :: iterator j = m_Potentials.begin( ); j != m_Potentials.end( ); ++j )
+			{
+				if( (*j)->GetJoinPlayer( ) && (*j)->GetJoinPlayer( )->GetName( ) == (*i)->GetName( ) )
+					EventPlayerJoined( *j, (*j)->GetJoinPlayer( ), Array );
+			}
+
+			m_GHost->m_DB->RecoverCallable( *i );
+			delete *i;
+			delete [] Array;
+			m_LeagueChecks.erase( i );
+			return true;
+		}
+	}
+
+	for( vector<CCallableConnectCheck *> :: iterator i = m_ConnectChecks.begin( ); i != m_ConnectChecks.end( ); ++i )
+	{
+		if( *i == callable )
+		{
+			bool Check = (*i)->GetResult( );
+
+			for( vector<CGamePlayer *> :: iterator j = m_Players.begin( ); j != m_Players.end( ); ++j )
+			{
+				if( (*j)->GetName( ) == (*i)->GetName( ) )
+				{
+					if( Check )
+					{
+						(*j)->SetSpoofed( true );
+						(*j)->SetSpoofedRealm( "wc3connect" );
+					}
+					else
+					{
+						(*j)->SetDeleteMe( true );
+						(*j)->SetLeftReason( "invalid session" );
+						(*j)->SetLeftCode( PLAYERLEAVE_LOBBY );
+						m_GHost->DenyIP( (*j)->GetExternalIPString( ), 20000, "kicked for invalid session" );
+						OpenSlot( GetSIDFromPID( (*j)->GetPID( ) ), false );
+					}
+
+					break;
+				}
+			}
+
+			m_GHost->m_DB->RecoverCallable( *i );
+			delete *i;
+			m_ConnectChecks.erase( i );
+			return true;
+		}
+	}
+
+	return false;
+}
+
 void CBaseGame :: EventGameRefreshed( string server )
 {
 	if( m_RefreshRehosted )
@@ -3191,6 +3634,7 @@ void CBaseGame :: EventGameRefreshed( string server )
 void CBaseGame :: EventGameStarted( )
 {
 	CONSOLE_Print( "[GAME: " + m_GameName + "] started loading with " + UTIL_ToString( GetNumHumanPlayers( ) ) + " players" );
+	m_GProxyLog->SetGameName( m_GameName );
 
 	// encode the HCL command string in the slot handicaps
 	// here's how it works:
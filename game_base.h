@@ -28,6 +28,9 @@
 
 #include "gameslot.h"
 
+#define ACTION_JITTER_BUCKETS	8
+#define GAME_STATUSINTERVAL		300		// seconds between the action timing and GProxy++ log lines printed while a game is running
+
 //
 // CBaseGame
 //
@@ -46,6 +49,11 @@ class CIncomingMapSize;
 class CCallableScoreCheck;
 class CCallableLeagueCheck;
 class CCallableConnectCheck;
+class CBaseCallable;
+class CCallableQueue;
+class CGProxyLog;
+class CGameReactor;
+struct ReactorGame;
 struct QueuedSpoofAdd;
 struct FakePlayer;
 
@@ -63,6 +71,8 @@ protected:
 	vector<CCallableScoreCheck *> m_ScoreChecks;
 	vector<CCallableLeagueCheck *> m_LeagueChecks;
 	vector<CCallableConnectCheck *> m_ConnectChecks;	// session validation for entconnect system
+	CCallableQueue *m_CallableQueue;				// the callables we're waiting for are posted here when they're ready (see EventCallableCompleted)
+	CGProxyLog *m_GProxyLog;						// packets sent to GProxy++ players that haven't been acknowledged yet
 	queue<CIncomingAction *> m_Actions;				// queue of actions to be sent
 	vector<string> m_Reserved;						// vector of player names with reserved slots (from the !hold command)
 	set<string> m_IgnoredNames;						// set of player names to NOT print ban messages for when joining because they've already been printed
@@ -113,8 +123,11 @@ protected:
 	uint32_t m_LastLagScreenResetTime;				// GetTime when the "lag" screen was last reset
 	uint32_t m_LastActionSentTicks;					// GetTicks when the last action packet was sent
 	uint32_t m_LastActionLateBy;					// the number of ticks we were late sending the last action packet by
+	uint32_t m_ActionJitter[ACTION_JITTER_BUCKETS];	// histogram of how late the action packets were sent (see RecordActionJitter)
+	uint32_t m_ActionJitterMax;						// the most ticks any action packet was late by
 	uint32_t m_StartedLaggingTime;					// GetTime when the last lag screen started
 	uint32_t m_LastLagScreenTime;					// GetTime when the last lag screen was active (continuously updated)
+	uint32_t m_LastStatusTime;						// GetTime when the action timing and GProxy++ log were last printed
 	uint32_t m_LastReservedSeen;					// GetTime when the last reserved player was seen in the lobby
 	uint32_t m_StartedKickVoteTime;					// GetTime when the kick vote was started
 	uint32_t m_StartedVoteStartTime;					// GetTime when the votestart was started
@@ -140,8 +153,11 @@ protected:
 	bool m_LocalAdminMessages;						// if local admin messages should be relayed or not
 	bool m_SoftGameOver;							// whether the game is soft ended
 	bool m_AllowDownloads;
+	bool m_MapFileChanged;							// if the map file was changed to a different map since the game was created (see CheckMapFile)
     uint32_t m_DatabaseID;                          // the ID number from the database, which we'll use to save replay
 	int m_DoDelete;									// notifies thread to exit
+	CGameReactor *m_Reactor;						// the reactor driving this game, NULL if the game runs in its own thread
+	uint32_t m_NextUpdateTicks;						// GetTicks when the earliest timer scheduled during the last update is due
 	uint32_t m_LastReconnectHandleTime;				// last time we tried to handle GProxy reconnects
 	bool m_League;									// whether or not this is a league game
 	bool m_Tournament;								// whether or not this is a uxtourney system game
@@ -160,8 +176,10 @@ public:
 	virtual ~CBaseGame( );
 	
 	virtual void loop( );
+	virtual void loopEnd( );
 	virtual void doDelete( );
 	virtual bool readyDelete( );
+	virtual bool GetDeleteRequested( )				{ return m_DoDelete != 0; }
 
 	virtual vector<CGameSlot> GetEnforceSlots( )	{ return m_EnforceSlots; }
 	virtual vector<PIDPlayer> GetEnforcePlayers( )	{ return m_EnforcePlayers; }
@@ -189,7 +207,7 @@ public:
 
 	virtual void SetEnforceSlots( vector<CGameSlot> nEnforceSlots )		{ m_EnforceSlots = nEnforceSlots; }
 	virtual void SetEnforcePlayers( vector<PIDPlayer> nEnforcePlayers )	{ m_EnforcePlayers = nEnforcePlayers; }
-	virtual void SetExiting( bool nExiting )							{ m_Exiting = nExiting; }
+	virtual void SetExiting( bool nExiting )							{ m_Exiting = nExiting; Wake( ); }
 	virtual void SetAutoStartPlayers( uint32_t nAutoStartPlayers )		{ m_AutoStartPlayers = nAutoStartPlayers; }
 	virtual void SetMinimumScore( double nMinimumScore )				{ m_MinimumScore = nMinimumScore; }
 	virtual void SetMaximumScore( double nMaximumScore )				{ m_MaximumScore = nMaximumScore; }
@@ -197,6 +215,7 @@ public:
 	virtual void SetMatchMaking( bool nMatchMaking )					{ m_MatchMaking = nMatchMaking; }
 
 	virtual uint32_t GetNextTimedActionTicks( );
+	virtual string GetActionJitterString( );
 	virtual uint32_t GetSlotsOccupied( );
 	virtual uint32_t GetSlotsAllocated( );
 	virtual uint32_t GetSlotsOpen( );
@@ -212,12 +231,33 @@ public:
 	virtual bool Update( void *fd, void *send_fd );
 	virtual void UpdatePost( void *send_fd );
 
+	// reactor functions (see reactor.h)
+
+	virtual void WatchSockets( CGameReactor *reactor, ReactorGame *entry );
+	virtual void UnwatchSockets( CGameReactor *reactor );
+	virtual bool ReactorUpdate( );
+	virtual void SetReactor( CGameReactor *nReactor )	{ m_Reactor = nReactor; }
+	virtual uint32_t GetNextUpdateTicks( )			{ return m_NextUpdateTicks; }
+	virtual void Wake( );
+	virtual CCallableQueue *GetCallableQueue( )		{ return m_CallableQueue; }
+	virtual CGProxyLog *GetGProxyLog( )				{ return m_GProxyLog; }
+
+	// timer functions
+	// every timer checked during an update schedules the next time it's due so the game can sleep until then
+	// ScheduleTicks and ScheduleTime take the GetTicks/GetTime when the timer last fired and ignore timers that are already due
+
+	virtual void ResetSchedule( );
+	virtual void ScheduleUpdate( uint32_t ticks );
+	virtual void ScheduleTicks( uint32_t lastTicks, uint32_t interval );
+	virtual void ScheduleTime( uint32_t lastTime, uint32_t interval );
+
 	// generic functions to send packets to players
 
 	virtual void Send( CGamePlayer *player, BYTEARRAY data );
 	virtual void Send( unsigned char PID, BYTEARRAY data );
 	virtual void Send( BYTEARRAY PIDs, BYTEARRAY data );
 	virtual void SendAll( BYTEARRAY data );
+	virtual void SendAll( const SHAREDBYTEARRAY &data );
 
 	// functions to send packets to players
 
@@ -230,8 +270,12 @@ public:
 	virtual void SendLocalAdminChat( string message );
 	virtual void SendAllSlotInfo( );
 	virtual void SendVirtualHostPlayerInfo( CGamePlayer *player );
+	virtual void SendMapParts( CGamePlayer *player );
+	virtual void CheckMapFile( );
 	virtual void SendFakePlayerInfo( CGamePlayer *player );
 	virtual void SendAllActions( );
+	virtual void SendAllActionPacket( BYTEARRAY packet );
+	virtual void RecordActionJitter( uint32_t lateBy );
 	virtual void SendWelcomeMessage( CGamePlayer *player );
 	virtual void SendEndMessage( );
 
@@ -264,6 +308,7 @@ public:
 	virtual void EventGameRefreshed( string server );
 	virtual void EventGameStarted( );
 	virtual void EventGameLoaded( );
+	virtual bool EventCallableCompleted( CBaseCallable *callable );
 
 	// other functions
 
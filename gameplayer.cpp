@@ -36,6 +36,8 @@
 #include "gpsprotocol.h"
 #include "ghostdb.h"
 #include "game_base.h"
+#include "gproxylog.h"
+#include "downloadpacer.h"
 
 //
 // CPotentialPlayer
@@ -54,12 +56,6 @@ CPotentialPlayer :: ~CPotentialPlayer( )
 	if( m_Socket )
 		delete m_Socket;
 
-	while( !m_Packets.empty( ) )
-	{
-		delete m_Packets.front( );
-		m_Packets.pop( );
-	}
-
 	delete m_IncomingJoinPlayer;
 	delete m_IncomingGarenaUser;
 	
@@ -122,7 +118,6 @@ bool CPotentialPlayer :: Update( void *fd )
 		return false;
 
 	m_Socket->DoRecv( (fd_set *)fd );
-	ExtractPackets( );
 	ProcessPackets( );
 	
 	// make sure we don't keep this socket open forever (disconnect after five seconds)
@@ -138,6 +133,9 @@ bool CPotentialPlayer :: Update( void *fd )
 		m_DeleteMe = true;
         m_Game->m_GHost->DenyIP( GetExternalIPString( ), 30000, "banned player message" );
 	}
+
+	if( m_ConnectionState == 0 )
+		m_Game->ScheduleTicks( m_ConnectionTime, m_Banned ? 30001 : 5001 );
 	
 	// request join if we're ready or if ban check is taking too long
 	if( m_ConnectionState == 0 && m_CallableBanCheck && ( m_CallableBanCheck->GetReady( ) || GetTicks( ) - m_ConnectionTime > 2000 ) )
@@ -167,107 +165,94 @@ bool CPotentialPlayer :: Update( void *fd )
 		m_CallableBanCheck = NULL;
 	}
 
+	// the ban check is attached to the game's callable queue which wakes the game up when it's ready so we only have to schedule the timeout
+
+	if( m_ConnectionState == 0 && m_CallableBanCheck )
+		m_Game->ScheduleTicks( m_ConnectionTime, 2001 );
+
 	// don't call DoSend here because some other players may not have updated yet and may generate a packet for this player
 	// also m_Socket may have been set to NULL during ProcessPackets but we're banking on the fact that m_DeleteMe has been set to true as well so it'll short circuit before dereferencing
 
 	return m_DeleteMe || m_Error || m_Socket->HasError( ) || !m_Socket->GetConnected( );
 }
 
-void CPotentialPlayer :: ExtractPackets( )
+bool CPotentialPlayer :: ExtractPacket( CPacketView &packet )
 {
-	if( !m_Socket )
-		return;
-
-	// extract as many packets as possible from the socket's receive buffer and put them in the m_Packets queue
+	if( !m_Socket || m_Error )
+		return false;
 
-	string *RecvBuffer = m_Socket->GetBytes( );
-	BYTEARRAY Bytes = UTIL_CreateByteArray( (unsigned char *)RecvBuffer->c_str( ), RecvBuffer->size( ) );
+	// frame the next packet at the front of the socket's receive buffer without copying it
+	// the packet is consumed right away, this is safe because CRecvBuffer :: Consume never moves or frees any data so the view stays valid until the next DoRecv
+	// it also means that if a handler hands the socket to someone else (e.g. the CGamePlayer created by EventPlayerJoined) the packets we haven't looked at go along with it
 
-	// a packet is at least 4 bytes so loop as long as the buffer contains 4 bytes
+	CRecvBuffer *RecvBuffer = m_Socket->GetBytes( );
 
-	while( Bytes.size( ) >= 4 )
+	switch( packet.Frame( (unsigned char *)RecvBuffer->GetData( ), RecvBuffer->GetSize( ) ) )
 	{
-		if( Bytes[0] == W3GS_HEADER_CONSTANT || Bytes[0] == GPS_HEADER_CONSTANT || Bytes[0] == GCBI_HEADER_CONSTANT )
-		{
-			// bytes 2 and 3 contain the length of the packet
+	case CPacketView :: FRAME_INCOMPLETE:
+		return false;
 
-			uint16_t Length = UTIL_ByteArrayToUInt16( Bytes, false, 2 );
+	case CPacketView :: FRAME_BADLENGTH:
+		m_Error = true;
+		m_ErrorString = "received invalid packet from player (bad length)";
+		return false;
 
-			if( Length >= 4 )
-			{
-				if( Bytes.size( ) >= Length )
-				{
-					m_Packets.push( new CCommandPacket( Bytes[0], Bytes[1], BYTEARRAY( Bytes.begin( ), Bytes.begin( ) + Length ) ) );
-					*RecvBuffer = RecvBuffer->substr( Length );
-					Bytes = BYTEARRAY( Bytes.begin( ) + Length, Bytes.end( ) );
-				}
-				else
-					return;
-			}
-			else
-			{
-				m_Error = true;
-				m_ErrorString = "received invalid packet from player (bad length)";
-				return;
-			}
-		}
-		else
-		{
-			m_Error = true;
-			m_ErrorString = "received invalid packet from player (bad header constant)";
-			return;
-		}
+	default:
+		break;
+	}
+
+	if( packet.GetPacketType( ) != W3GS_HEADER_CONSTANT && packet.GetPacketType( ) != GPS_HEADER_CONSTANT && packet.GetPacketType( ) != GCBI_HEADER_CONSTANT )
+	{
+		m_Error = true;
+		m_ErrorString = "received invalid packet from player (bad header constant)";
+		return false;
 	}
+
+	RecvBuffer->Consume( packet.GetLength( ) );
+	return true;
 }
 
 void CPotentialPlayer :: ProcessPackets( )
 {
-	if( !m_Socket )
-		return;
+	// process all the complete packets in the socket's receive buffer
 
-	// process all the received packets in the m_Packets queue
+	CPacketView Packet;
 
-	while( !m_Packets.empty( ) )
+	while( ExtractPacket( Packet ) )
 	{
-		CCommandPacket *Packet = m_Packets.front( );
-		m_Packets.pop( );
-
-		if( Packet->GetPacketType( ) == W3GS_HEADER_CONSTANT )
+		if( Packet.GetPacketType( ) == W3GS_HEADER_CONSTANT )
 		{
 			// the only packet we care about as a potential player is W3GS_REQJOIN, ignore everything else
 
-			switch( Packet->GetID( ) )
+			switch( Packet.GetID( ) )
 			{
 			case CGameProtocol :: W3GS_REQJOIN:
 				delete m_IncomingJoinPlayer;
-				m_IncomingJoinPlayer = m_Protocol->RECEIVE_W3GS_REQJOIN( Packet->GetData( ) );
+				m_IncomingJoinPlayer = m_Protocol->RECEIVE_W3GS_REQJOIN( Packet.GetData( ) );
 
 				if( m_IncomingJoinPlayer && !m_Banned )
 				{
 					// check for bans on this player
-					m_CallableBanCheck = m_Game->m_GHost->m_DB->ThreadedBanCheck( m_Game->GetJoinedRealm( m_IncomingJoinPlayer->GetHostCounter( ) ), m_IncomingJoinPlayer->GetName( ), GetExternalIPString( ), m_Game->m_GHost->HostNameLookup( GetExternalIPString( ) ), m_Game->GetOwnerName( ) );
+					m_CallableBanCheck = m_Game->GetCallableQueue( )->Attach( m_Game->m_GHost->m_DB->ThreadedBanCheck( m_Game->GetJoinedRealm( m_IncomingJoinPlayer->GetHostCounter( ) ), m_IncomingJoinPlayer->GetName( ), GetExternalIPString( ), m_Game->m_GHost->HostNameLookup( GetExternalIPString( ) ), m_Game->GetOwnerName( ) ) );
 				}
 
 				// don't continue looping because there may be more packets waiting and this parent class doesn't handle them
 				// EventPlayerJoined creates the new player, NULLs the socket, and sets the delete flag on this object so it'll be deleted shortly
-				// any unprocessed packets will be copied to the new CGamePlayer in the constructor or discarded if we get deleted because the game is full
+				// any unprocessed packets are left in the socket's receive buffer so the new CGamePlayer will process them, or they're discarded if we get deleted because the game is full
 
-				delete Packet;
 				return;
 			}
 		}
 		
-		else if( Packet->GetPacketType( ) == GCBI_HEADER_CONSTANT )
+		else if( Packet.GetPacketType( ) == GCBI_HEADER_CONSTANT )
 		{
-			if( Packet->GetID( ) == CGCBIProtocol :: GCBI_INIT && m_Game->m_GHost->IsLocal( GetExternalIPString( ) ) )
+			if( Packet.GetID( ) == CGCBIProtocol :: GCBI_INIT && m_Game->m_GHost->IsLocal( GetExternalIPString( ) ) )
 			{
 				delete m_IncomingGarenaUser;
-				m_IncomingGarenaUser = m_Game->m_GHost->m_GCBIProtocol->RECEIVE_GCBI_INIT( Packet->GetData( ) );
+				m_IncomingGarenaUser = m_Game->m_GHost->m_GCBIProtocol->RECEIVE_GCBI_INIT( Packet.GetData( ) );
                 CONSOLE_Print( "[GCBI] Garena user detected; userid=" + UTIL_ToString( m_IncomingGarenaUser->GetUserID( ) ) + ", roomid=" + UTIL_ToString( m_IncomingGarenaUser->GetRoomID( ) ) + ", experience=" + UTIL_ToString( m_IncomingGarenaUser->GetUserExp( ) ) + ", country=" + m_IncomingGarenaUser->GetCountryCode( ) );
 			}
 		}
-
-		delete Packet;
 	}
 }
 
@@ -277,6 +262,12 @@ void CPotentialPlayer :: Send( BYTEARRAY data )
 		m_Socket->PutBytes( data );
 }
 
+void CPotentialPlayer :: Send( const SHAREDBYTEARRAY &data )
+{
+	if( m_Socket )
+		m_Socket->PutBytes( data );
+}
+
 void CPotentialPlayer :: SendBannedInfo( CDBBan *Ban, string type )
 {
 	// send slot info to the banned player
@@ -321,16 +312,15 @@ void CPotentialPlayer :: SendBannedInfo( CDBBan *Ban, string type )
 // CGamePlayer
 //
 
-CGamePlayer :: CGamePlayer( CGameProtocol *nProtocol, CBaseGame *nGame, CTCPSocket *nSocket, unsigned char nPID, string nJoinedRealm, string nName, BYTEARRAY nInternalIP, bool nReserved ) : CPotentialPlayer( nProtocol, nGame, nSocket ), m_PID( nPID ), m_Name( nName ), m_InternalIP( nInternalIP ), m_JoinedRealm( nJoinedRealm ), m_TotalPacketsSent( 0 ), m_TotalPacketsReceived( 0 ), m_LeftCode( PLAYERLEAVE_LOBBY ), m_SyncCounter( 0 ), m_JoinTime( GetTime( ) ), m_LastMapPartSent( 0 ), m_LastMapPartAcked( 0 ), m_StartedDownloadingTicks( 0 ), m_FinishedLoadingTicks( 0 ), m_StartedLaggingTicks( 0 ), m_TotalLaggingTicks( 0 ), m_StatsSentTime( 0 ), m_StatsDotASentTime( 0 ), m_LastGProxyWaitNoticeSentTime( 0 ), m_Score( -100000.0 ), m_Spoofed( false ), m_Reserved( nReserved ), m_WhoisShouldBeSent( false ), m_WhoisSent( false ), m_DownloadAllowed( false ), m_DownloadStarted( false ), m_DownloadFinished( false ), m_FinishedLoading( false ), m_Lagging( false ), m_DropVote( false ), m_KickVote( false ), m_StartVote( false ), m_Muted( false ), m_LeftMessageSent( false ), m_GProxy( false ), m_GProxyDisconnectNoticeSent( false ), m_GProxyReconnectKey( rand( ) ), m_LastGProxyAckTime( 0 ), m_Autoban( false ), m_ForfeitVote( false ), m_FriendlyName( nName ), m_DrawVote( false ), m_NoLag( false )
+CGamePlayer :: CGamePlayer( CGameProtocol *nProtocol, CBaseGame *nGame, CTCPSocket *nSocket, unsigned char nPID, string nJoinedRealm, string nName, BYTEARRAY nInternalIP, bool nReserved ) : CPotentialPlayer( nProtocol, nGame, nSocket ), m_PID( nPID ), m_Name( nName ), m_InternalIP( nInternalIP ), m_JoinedRealm( nJoinedRealm ), m_TotalPacketsSent( 0 ), m_TotalPacketsReceived( 0 ), m_LeftCode( PLAYERLEAVE_LOBBY ), m_SyncCounter( 0 ), m_JoinTime( GetTime( ) ), m_LastMapPartSent( 0 ), m_LastMapPartAcked( 0 ), m_DownloadPacer( new CDownloadPacer( ) ), m_StartedDownloadingTicks( 0 ), m_FinishedLoadingTicks( 0 ), m_StartedLaggingTicks( 0 ), m_TotalLaggingTicks( 0 ), m_StatsSentTime( 0 ), m_StatsDotASentTime( 0 ), m_LastGProxyWaitNoticeSentTime( 0 ), m_Score( -100000.0 ), m_Spoofed( false ), m_Reserved( nReserved ), m_WhoisShouldBeSent( false ), m_WhoisSent( false ), m_DownloadAllowed( false ), m_DownloadStarted( false ), m_DownloadFinished( false ), m_FinishedLoading( false ), m_Lagging( false ), m_DropVote( false ), m_KickVote( false ), m_StartVote( false ), m_Muted( false ), m_LeftMessageSent( false ), m_GProxy( false ), m_GProxyDisconnectNoticeSent( false ), m_GProxyReconnectKey( rand( ) ), m_LastGProxyAckTime( 0 ), m_Autoban( false ), m_ForfeitVote( false ), m_FriendlyName( nName ), m_DrawVote( false ), m_NoLag( false )
 {
     m_ConnectionState = 1;
 }
 
-CGamePlayer :: CGamePlayer( CPotentialPlayer *potential, unsigned char nPID, string nJoinedRealm, string nName, BYTEARRAY nInternalIP, bool nReserved ) : CPotentialPlayer( potential->m_Protocol, potential->m_Game, potential->GetSocket( ) ), m_PID( nPID ), m_Name( nName ), m_InternalIP( nInternalIP ), m_JoinedRealm( nJoinedRealm ), m_TotalPacketsSent( 0 ), m_TotalPacketsReceived( 1 ), m_LeftCode( PLAYERLEAVE_LOBBY ), m_Cookies( 0 ), m_SyncCounter( 0 ), m_JoinTime( GetTime( ) ), m_LastMapPartSent( 0 ), m_LastMapPartAcked( 0 ), m_StartedDownloadingTicks( 0 ), m_FinishedLoadingTicks( 0 ), m_StartedLaggingTicks( 0 ), m_TotalLaggingTicks( 0 ), m_StatsSentTime( 0 ), m_StatsDotASentTime( 0 ), m_LastGProxyWaitNoticeSentTime( 0 ), m_Score( -100000.0 ), m_Spoofed( false ), m_Reserved( nReserved ), m_WhoisShouldBeSent( false ), m_WhoisSent( false ), m_DownloadAllowed( false ), m_DownloadStarted( false ), m_DownloadFinished( false ), m_FinishedLoading( false ), m_Lagging( false ), m_DropVote( false ), m_KickVote( false ), m_StartVote( false ), m_Muted( false ), m_LeftMessageSent( false ), m_GProxy( false ), m_GProxyDisconnectNoticeSent( false ), m_GProxyReconnectKey( rand( ) ), m_LastGProxyAckTime( 0 ), m_Autoban( false ), m_ForfeitVote( false ), m_FriendlyName( nName ), m_DrawVote( false ), m_NoLag( false )
+CGamePlayer :: CGamePlayer( CPotentialPlayer *potential, unsigned char nPID, string nJoinedRealm, string nName, BYTEARRAY nInternalIP, bool nReserved ) : CPotentialPlayer( potential->m_Protocol, potential->m_Game, potential->GetSocket( ) ), m_PID( nPID ), m_Name( nName ), m_InternalIP( nInternalIP ), m_JoinedRealm( nJoinedRealm ), m_TotalPacketsSent( 0 ), m_TotalPacketsReceived( 1 ), m_LeftCode( PLAYERLEAVE_LOBBY ), m_Cookies( 0 ), m_SyncCounter( 0 ), m_JoinTime( GetTime( ) ), m_LastMapPartSent( 0 ), m_LastMapPartAcked( 0 ), m_DownloadPacer( new CDownloadPacer( ) ), m_StartedDownloadingTicks( 0 ), m_FinishedLoadingTicks( 0 ), m_StartedLaggingTicks( 0 ), m_TotalLaggingTicks( 0 ), m_StatsSentTime( 0 ), m_StatsDotASentTime( 0 ), m_LastGProxyWaitNoticeSentTime( 0 ), m_Score( -100000.0 ), m_Spoofed( false ), m_Reserved( nReserved ), m_WhoisShouldBeSent( false ), m_WhoisSent( false ), m_DownloadAllowed( false ), m_DownloadStarted( false ), m_DownloadFinished( false ), m_FinishedLoading( false ), m_Lagging( false ), m_DropVote( false ), m_KickVote( false ), m_StartVote( false ), m_Muted( false ), m_LeftMessageSent( false ), m_GProxy( false ), m_GProxyDisconnectNoticeSent( false ), m_GProxyReconnectKey( rand( ) ), m_LastGProxyAckTime( 0 ), m_Autoban( false ), m_ForfeitVote( false ), m_FriendlyName( nName ), m_DrawVote( false ), m_NoLag( false )
 {
-	// todotodo: properly copy queued packets to the new player, this just discards them
-	// this isn't a big problem because official Warcraft III clients don't send any packets after the join request until they receive a response
-	// m_Packets = potential->GetPackets( );
+	// any packets the potential player didn't process are still in the socket's receive buffer so we'll process them on our first update
+	// this doesn't matter much anyway because official Warcraft III clients don't send any packets after the join request until they receive a response
 
 
 	// hackhack: we initialize m_TotalPacketsReceived to 1 because the CPotentialPlayer must have received a W3GS_REQJOIN before this class was created
@@ -344,7 +334,8 @@ CGamePlayer :: CGamePlayer( CPotentialPlayer *potential, unsigned char nPID, str
 
 CGamePlayer :: ~CGamePlayer( )
 {
-
+	m_Game->GetGProxyLog( )->RemovePlayer( m_PID );
+	delete m_DownloadPacer;
 }
 
 string CGamePlayer :: GetNameTerminated( )
@@ -448,6 +439,9 @@ bool CGamePlayer :: Update( void *fd )
 		m_WhoisSent = true;
 	}
 
+	if( m_WhoisShouldBeSent && !m_Spoofed && !m_WhoisSent && !m_JoinedRealm.empty( ) )
+		m_Game->ScheduleTime( m_JoinTime, 4 );
+
 	// check for socket timeouts
 	// if we don't receive anything from a player for 30 seconds we can assume they've dropped
 	// this works because in the lobby we send pings every 5 seconds and expect a response to each one
@@ -455,6 +449,8 @@ bool CGamePlayer :: Update( void *fd )
 
 	if( m_Socket && GetTime( ) - m_Socket->GetLastRecv( ) >= 30 )
 		m_Game->EventPlayerDisconnectTimedOut( this );
+	else if( m_Socket )
+		m_Game->ScheduleTime( m_Socket->GetLastRecv( ), 30 );
 	
 	// make sure we're not waiting too long for the first MAPSIZE packet
 	
@@ -467,6 +463,8 @@ bool CGamePlayer :: Update( void *fd )
         m_Game->OpenSlot( m_Game->GetSIDFromPID( GetPID( ) ), false );
         m_Game->m_GHost->DenyIP( GetExternalIPString( ), 60000, "MAPSIZE not received within five seconds" );	
     }
+	else if( m_ConnectionState == 1 && !m_Game->GetGameLoaded( ) && !m_Game->GetGameLoading( ) )
+		m_Game->ScheduleTicks( m_ConnectionTime, 5001 );
 	
 	// disconnect if the player is downloading too slowly
 	
@@ -482,6 +480,8 @@ bool CGamePlayer :: Update( void *fd )
             SetLeftCode( PLAYERLEAVE_LOBBY );
             m_Game->OpenSlot( m_Game->GetSIDFromPID( GetPID( ) ), false );		
         }
+		else
+			m_Game->ScheduleTicks( m_StartedDownloadingTicks, 8001 );
 	}
 	
 	// unmute player
@@ -491,6 +491,8 @@ bool CGamePlayer :: Update( void *fd )
 		m_Game->SendAllChat( "[" + m_Name + "] has been automatically unmuted. (Don't spam or you'll be muted again!)" );
 		m_MuteMessages.clear( );
 	}
+	else if( GetMuted( ) )
+		m_Game->ScheduleTicks( m_MutedTicks, m_MutedAuto ? 15001 : 60001 );
 
 	// GProxy++ acks
 
@@ -502,6 +504,9 @@ bool CGamePlayer :: Update( void *fd )
 		m_LastGProxyAckTime = GetTime( );
 	}
 
+	if( m_GProxy )
+		m_Game->ScheduleTime( m_LastGProxyAckTime, 10 );
+
 	// base class update
 
 	CPotentialPlayer :: Update( fd );
@@ -541,57 +546,6 @@ bool CGamePlayer :: Update( void *fd )
 	return Deleting;
 }
 
-void CGamePlayer :: ExtractPackets( )
-{
-	if( !m_Socket )
-		return;
-
-	// extract as many packets as possible from the socket's receive buffer and put them in the m_Packets queue
-
-	string *RecvBuffer = m_Socket->GetBytes( );
-	BYTEARRAY Bytes = UTIL_CreateByteArray( (unsigned char *)RecvBuffer->c_str( ), RecvBuffer->size( ) );
-
-	// a packet is at least 4 bytes so loop as long as the buffer contains 4 bytes
-
-	while( Bytes.size( ) >= 4 )
-	{
-		if( Bytes[0] == W3GS_HEADER_CONSTANT || Bytes[0] == GPS_HEADER_CONSTANT || Bytes[0] == GCBI_HEADER_CONSTANT )
-		{
-			// bytes 2 and 3 contain the length of the packet
-
-			uint16_t Length = UTIL_ByteArrayToUInt16( Bytes, false, 2 );
-
-			if( Length >= 4 )
-			{
-				if( Bytes.size( ) >= Length )
-				{
-					m_Packets.push( new CCommandPacket( Bytes[0], Bytes[1], BYTEARRAY( Bytes.begin( ), Bytes.begin( ) + Length ) ) );
-
-					if( Bytes[0] == W3GS_HEADER_CONSTANT )
-                                                ++m_TotalPacketsReceived;
-
-					*RecvBuffer = RecvBuffer->substr( Length );
-					Bytes = BYTEARRAY( Bytes.begin( ) + Length, Bytes.end( ) );
-				}
-				else
-					return;
-			}
-			else
-			{
-				m_Error = true;
-				m_ErrorString = "received invalid packet from player (bad length)";
-				return;
-			}
-		}
-		else
-		{
-			m_Error = true;
-			m_ErrorString = "received invalid packet from player (bad header constant)";
-			return;
-		}
-	}
-}
-
 void CGamePlayer :: ProcessPackets( )
 {
 	if( !m_Socket )
@@ -604,23 +558,26 @@ void CGamePlayer :: ProcessPackets( )
 	uint32_t CheckSum = 0;
 	uint32_t Pong = 0;
 
-	// process all the received packets in the m_Packets queue
+	// process all the complete packets in the socket's receive buffer
+	// the packets are parsed in place, only the data a handler keeps (e.g. an action or a chat message) is copied out of the buffer
+	// note: a handler may hand our socket to someone else (see EventPlayerMapSize) in which case ExtractPacket stops on the next iteration
 
-	while( !m_Packets.empty( ) )
-	{
-		CCommandPacket *Packet = m_Packets.front( );
-		m_Packets.pop( );
+	CPacketView Packet;
 
-		if( Packet->GetPacketType( ) == W3GS_HEADER_CONSTANT )
+	while( ExtractPacket( Packet ) )
+	{
+		if( Packet.GetPacketType( ) == W3GS_HEADER_CONSTANT )
 		{
-			switch( Packet->GetID( ) )
+			++m_TotalPacketsReceived;
+
+			switch( Packet.GetID( ) )
 			{
 			case CGameProtocol :: W3GS_LEAVEGAME:
-				m_Game->EventPlayerLeft( this, m_Protocol->RECEIVE_W3GS_LEAVEGAME( Packet->GetData( ) ) );
+				m_Game->EventPlayerLeft( this, m_Protocol->RECEIVE_W3GS_LEAVEGAME( Packet ) );
 				break;
 
 			case CGameProtocol :: W3GS_GAMELOADED_SELF:
-				if( m_Protocol->RECEIVE_W3GS_GAMELOADED_SELF( Packet->GetData( ) ) )
+				if( m_Protocol->RECEIVE_W3GS_GAMELOADED_SELF( Packet ) )
 				{
 					if( !m_FinishedLoading && m_Game->GetGameLoading( ) )
 					{
@@ -637,7 +594,7 @@ void CGamePlayer :: ProcessPackets( )
 				break;
 
 			case CGameProtocol :: W3GS_OUTGOING_ACTION:
-				Action = m_Protocol->RECEIVE_W3GS_OUTGOING_ACTION( Packet->GetData( ), m_PID );
+				Action = m_Protocol->RECEIVE_W3GS_OUTGOING_ACTION( Packet, m_PID );
 
 				if( Action )
 					m_Game->EventPlayerAction( this, Action );
@@ -647,14 +604,14 @@ void CGamePlayer :: ProcessPackets( )
 				break;
 
 			case CGameProtocol :: W3GS_OUTGOING_KEEPALIVE:
-				CheckSum = m_Protocol->RECEIVE_W3GS_OUTGOING_KEEPALIVE( Packet->GetData( ) );
+				CheckSum = m_Protocol->RECEIVE_W3GS_OUTGOING_KEEPALIVE( Packet );
 				m_CheckSums.push( CheckSum );
                                 ++m_SyncCounter;
 				m_Game->EventPlayerKeepAlive( this, CheckSum );
 				break;
 
 			case CGameProtocol :: W3GS_CHAT_TO_HOST:
-				ChatPlayer = m_Protocol->RECEIVE_W3GS_CHAT_TO_HOST( Packet->GetData( ) );
+				ChatPlayer = m_Protocol->RECEIVE_W3GS_CHAT_TO_HOST( Packet.GetData( ) );
 				
 				if( ChatPlayer )
 				{
@@ -733,7 +690,7 @@ void CGamePlayer :: ProcessPackets( )
 				m_ConnectionState = 2;
 				m_ConnectionTime = GetTicks( );
 				
-				MapSize = m_Protocol->RECEIVE_W3GS_MAPSIZE( Packet->GetData( ), m_Game->m_GHost->m_Map->GetMapSize( ) );
+				MapSize = m_Protocol->RECEIVE_W3GS_MAPSIZE( Packet.GetData( ), m_Game->m_GHost->m_Map->GetMapSize( ) );
 
 				if( MapSize )
 					m_Game->EventPlayerMapSize( this, MapSize );
@@ -743,7 +700,7 @@ void CGamePlayer :: ProcessPackets( )
 				break;
 
 			case CGameProtocol :: W3GS_PONG_TO_HOST:
-				Pong = m_Protocol->RECEIVE_W3GS_PONG_TO_HOST( Packet->GetData( ) );
+				Pong = m_Protocol->RECEIVE_W3GS_PONG_TO_HOST( Packet );
 
 				// we discard pong values of 1
 				// the client sends one of these when connecting plus we return 1 on error to kill two birds with one stone
@@ -760,6 +717,7 @@ void CGamePlayer :: ProcessPackets( )
 						if( m_Game->m_GHost->m_PingDuringDownloads || !m_Game->IsDownloading( ) )
 						{
 							m_Pings.push_back( GetTicks( ) - Pong );
+							m_DownloadPacer->AddPing( GetTicks( ) - Pong );
 
 							if( m_Pings.size( ) > 20 )
 								m_Pings.erase( m_Pings.begin( ) );
@@ -771,11 +729,9 @@ void CGamePlayer :: ProcessPackets( )
 				break;
 			}
 		}
-		else if( Packet->GetPacketType( ) == GPS_HEADER_CONSTANT )
+		else if( Packet.GetPacketType( ) == GPS_HEADER_CONSTANT )
 		{
-			BYTEARRAY Data = Packet->GetData( );
-
-			if( Packet->GetID( ) == CGPSProtocol :: GPS_INIT )
+			if( Packet.GetID( ) == CGPSProtocol :: GPS_INIT )
 			{
 				if( m_Game->m_GHost->m_Reconnect )
 				{
@@ -790,32 +746,19 @@ void CGamePlayer :: ProcessPackets( )
 					// but it would be nice to cover this case anyway
 				}
 			}
-			else if( Packet->GetID( ) == CGPSProtocol :: GPS_RECONNECT )
+			else if( Packet.GetID( ) == CGPSProtocol :: GPS_RECONNECT )
 			{
 				// this is handled in ghost.cpp
 			}
-			else if( Packet->GetID( ) == CGPSProtocol :: GPS_ACK && Data.size( ) == 8 )
+			else if( Packet.GetID( ) == CGPSProtocol :: GPS_ACK && Packet.GetLength( ) == 8 )
 			{
-				uint32_t LastPacket = UTIL_ByteArrayToUInt32( Data, false, 4 );
-				uint32_t PacketsAlreadyUnqueued = m_TotalPacketsSent - m_GProxyBuffer.size( );
+				uint32_t LastPacket = Packet.GetUInt32( 4 );
+				uint32_t PacketsAlreadyUnqueued = m_TotalPacketsSent - m_Game->GetGProxyLog( )->GetNumUnacked( m_PID );
 
 				if( LastPacket > PacketsAlreadyUnqueued )
-				{
-					uint32_t PacketsToUnqueue = LastPacket - PacketsAlreadyUnqueued;
-
-					if( PacketsToUnqueue > m_GProxyBuffer.size( ) )
-						PacketsToUnqueue = m_GProxyBuffer.size( );
-
-					while( PacketsToUnqueue > 0 )
-					{
-						m_GProxyBuffer.pop( );
-                                                --PacketsToUnqueue;
-					}
-				}
+					m_Game->GetGProxyLog( )->Ack( m_PID, LastPacket - PacketsAlreadyUnqueued );
 			}
 		}
-
-		delete Packet;
 	}
 }
 
@@ -825,10 +768,41 @@ void CGamePlayer :: Send( BYTEARRAY data )
 	// but we can avoid buffering packets until we know the client is using GProxy++ since that'll be determined before the game starts
 	// this prevents us from buffering packets for non-GProxy++ clients
 
+	if( m_GProxy && m_Game->GetGameLoaded( ) )
+	{
+		// the packet is going to be logged so share it between the send buffer and the GProxy++ log instead of keeping two copies
+
+		Send( UTIL_CreateSharedByteArray( data ) );
+		return;
+	}
+
 	++m_TotalPacketsSent;
+	CPotentialPlayer :: Send( data );
+}
+
+void CGamePlayer :: SendBulk( BYTEARRAY data )
+{
+	// bulk data (map parts) waits until everything else queued for the player was sent
+	// anything that might have to be resent to a GProxy++ client goes through the normal path so the log stays in order
 
 	if( m_GProxy && m_Game->GetGameLoaded( ) )
-		m_GProxyBuffer.push( data );
+	{
+		Send( data );
+		return;
+	}
+
+	++m_TotalPacketsSent;
+
+	if( m_Socket )
+		m_Socket->PutBulkBytes( data );
+}
+
+void CGamePlayer :: Send( const SHAREDBYTEARRAY &data )
+{
+	++m_TotalPacketsSent;
+
+	if( m_GProxy && m_Game->GetGameLoaded( ) )
+		m_Game->GetGProxyLog( )->Append( m_PID, data );
 
 	CPotentialPlayer :: Send( data );
 }
@@ -839,34 +813,15 @@ void CGamePlayer :: EventGProxyReconnect( CTCPSocket *NewSocket, uint32_t LastPa
 	m_Socket = NewSocket;
 	m_Socket->PutBytes( m_Game->m_GHost->m_GPSProtocol->SEND_GPSS_RECONNECT( m_TotalPacketsReceived ) );
 
-	uint32_t PacketsAlreadyUnqueued = m_TotalPacketsSent - m_GProxyBuffer.size( );
+	CGProxyLog *GProxyLog = m_Game->GetGProxyLog( );
+	uint32_t PacketsAlreadyUnqueued = m_TotalPacketsSent - GProxyLog->GetNumUnacked( m_PID );
 
 	if( LastPacket > PacketsAlreadyUnqueued )
-	{
-		uint32_t PacketsToUnqueue = LastPacket - PacketsAlreadyUnqueued;
-
-		if( PacketsToUnqueue > m_GProxyBuffer.size( ) )
-			PacketsToUnqueue = m_GProxyBuffer.size( );
-
-		while( PacketsToUnqueue > 0 )
-		{
-			m_GProxyBuffer.pop( );
-                        --PacketsToUnqueue;
-		}
-	}
-
-	// send remaining packets from buffer, preserve buffer
+		GProxyLog->Ack( m_PID, LastPacket - PacketsAlreadyUnqueued );
 
-	queue<BYTEARRAY> TempBuffer;
-
-	while( !m_GProxyBuffer.empty( ) )
-	{
-		m_Socket->PutBytes( m_GProxyBuffer.front( ) );
-		TempBuffer.push( m_GProxyBuffer.front( ) );
-		m_GProxyBuffer.pop( );
-	}
+	// resend the packets the player missed straight from the log, they stay in the log until they're acknowledged
 
-	m_GProxyBuffer = TempBuffer;
+	GProxyLog->Replay( m_PID, m_Socket );
 	m_GProxyDisconnectNoticeSent = false;
 	m_Game->SendAllChat( m_Game->m_GHost->m_Language->PlayerReconnectedWithGProxy( m_Name ) );
 	m_CachedIP = m_Socket->GetIPString( );
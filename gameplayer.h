@@ -27,13 +27,14 @@
 #define GAMEPLAYER_H
 
 class CTCPSocket;
-class CCommandPacket;
+class CPacketView;
 class CGameProtocol;
 class CGame;
 class CIncomingJoinPlayer;
 class CIncomingGarenaUser;
 class CCallableBanCheck;
 class CDBBan;
+class CDownloadPacer;
 
 //
 // CPotentialPlayer
@@ -50,7 +51,6 @@ protected:
 	// it also allows us to convert CPotentialPlayers to CGamePlayers without the CPotentialPlayer's destructor closing the socket
 
 	CTCPSocket *m_Socket;
-	queue<CCommandPacket *> m_Packets;
 	bool m_DeleteMe;
 	bool m_Error;
 	string m_ErrorString;
@@ -71,7 +71,6 @@ public:
 	virtual CTCPSocket *GetSocket( )				{ return m_Socket; }
 	virtual BYTEARRAY GetExternalIP( );
 	virtual string GetExternalIPString( );
-	virtual queue<CCommandPacket *> GetPackets( )	{ return m_Packets; }
 	virtual bool GetDeleteMe( )						{ return m_DeleteMe; }
 	virtual bool GetError( )						{ return m_Error; }
 	virtual string GetErrorString( )				{ return m_ErrorString; }
@@ -87,12 +86,13 @@ public:
 	// processing functions
 
 	virtual bool Update( void *fd );
-	virtual void ExtractPackets( );
+	bool ExtractPacket( CPacketView &packet );
 	virtual void ProcessPackets( );
 
 	// other functions
 
 	virtual void Send( BYTEARRAY data );
+	virtual void Send( const SHAREDBYTEARRAY &data );
 	virtual void SendBannedInfo( CDBBan *Ban, string type );
 };
 
@@ -120,6 +120,7 @@ private:
 	uint32_t m_JoinTime;						// GetTime when the player joined the game (used to delay sending the /whois a few seconds to allow for some lag)
 	uint32_t m_LastMapPartSent;					// the last mappart sent to the player (for sending more than one part at a time)
 	uint32_t m_LastMapPartAcked;				// the last mappart acknowledged by the player
+	CDownloadPacer *m_DownloadPacer;			// how much map data the player can be sent at once
 	uint32_t m_StartedDownloadingTicks;			// GetTicks when the player started downloading the map
 	uint32_t m_FinishedDownloadingTime;			// GetTime when the player finished downloading the map
 	uint32_t m_FinishedLoadingTicks;			// GetTicks when the player finished loading the game
@@ -153,7 +154,6 @@ private:
 	bool m_LeftMessageSent;						// if the playerleave message has been sent or not
 	bool m_GProxy;								// if the player is using GProxy++
 	bool m_GProxyDisconnectNoticeSent;			// if a disconnection notice has been sent or not when using GProxy++
-	queue<BYTEARRAY> m_GProxyBuffer;
 	uint32_t m_GProxyReconnectKey;
 	uint32_t m_LastGProxyAckTime;
 	vector<string> m_IgnoreList;				// list of usernames this player is ignoring
@@ -180,6 +180,7 @@ public:
 	uint32_t GetJoinTime( )						{ return m_JoinTime; }
 	uint32_t GetLastMapPartSent( )				{ return m_LastMapPartSent; }
 	uint32_t GetLastMapPartAcked( )				{ return m_LastMapPartAcked; }
+	CDownloadPacer *GetDownloadPacer( )			{ return m_DownloadPacer; }
 	uint32_t GetStartedDownloadingTicks( )		{ return m_StartedDownloadingTicks; }
 	uint32_t GetFinishedDownloadingTime( )		{ return m_FinishedDownloadingTime; }
 	uint32_t GetFinishedLoadingTicks( )			{ return m_FinishedLoadingTicks; }
@@ -258,12 +259,13 @@ public:
 	// processing functions
 
 	virtual bool Update( void *fd );
-	virtual void ExtractPackets( );
 	virtual void ProcessPackets( );
 
 	// other functions
 
 	virtual void Send( BYTEARRAY data );
+	virtual void Send( const SHAREDBYTEARRAY &data );
+	virtual void SendBulk( BYTEARRAY data );
 	virtual void EventGProxyReconnect( CTCPSocket *NewSocket, uint32_t LastPacket );
 };
 
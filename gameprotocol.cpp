@@ -28,6 +28,7 @@
 #include "crc32.h"
 #include "gameplayer.h"
 #include "gameprotocol.h"
+#include "commandpacket.h"
 #include "game_base.h"
 
 //
@@ -296,6 +297,45 @@ uint32_t CGameProtocol :: RECEIVE_W3GS_PONG_TO_HOST( BYTEARRAY data )
 	return 1;
 }
 
+uint32_t CGameProtocol :: RECEIVE_W3GS_LEAVEGAME( CPacketView &packet )
+{
+	if( ValidateLength( packet ) && packet.GetLength( ) >= 8 )
+		return packet.GetUInt32( 4 );
+
+	return 0;
+}
+
+bool CGameProtocol :: RECEIVE_W3GS_GAMELOADED_SELF( CPacketView &packet )
+{
+	return ValidateLength( packet );
+}
+
+CIncomingAction *CGameProtocol :: RECEIVE_W3GS_OUTGOING_ACTION( CPacketView &packet, unsigned char PID )
+{
+	// the action is the only thing copied out of the receive buffer because the game keeps it until it's sent to everyone
+
+	if( PID != 255 && ValidateLength( packet ) && packet.GetLength( ) >= 8 )
+		return new CIncomingAction( PID, packet.GetBytes( ) + 4, packet.GetBytes( ) + 8, packet.GetLength( ) - 8 );
+
+	return NULL;
+}
+
+uint32_t CGameProtocol :: RECEIVE_W3GS_OUTGOING_KEEPALIVE( CPacketView &packet )
+{
+	if( ValidateLength( packet ) && packet.GetLength( ) == 9 )
+		return packet.GetUInt32( 5 );
+
+	return 0;
+}
+
+uint32_t CGameProtocol :: RECEIVE_W3GS_PONG_TO_HOST( CPacketView &packet )
+{
+	if( ValidateLength( packet ) && packet.GetLength( ) >= 8 )
+		return packet.GetUInt32( 4 );
+
+	return 1;
+}
+
 ////////////////////
 // SEND FUNCTIONS //
 ////////////////////
@@ -489,40 +529,7 @@ BYTEARRAY CGameProtocol :: SEND_W3GS_COUNTDOWN_END( )
 
 BYTEARRAY CGameProtocol :: SEND_W3GS_INCOMING_ACTION( queue<CIncomingAction *> actions, uint16_t sendInterval )
 {
-	BYTEARRAY packet;
-	packet.push_back( W3GS_HEADER_CONSTANT );				// W3GS header constant
-	packet.push_back( W3GS_INCOMING_ACTION );				// W3GS_INCOMING_ACTION
-	packet.push_back( 0 );									// packet length will be assigned later
-	packet.push_back( 0 );									// packet length will be assigned later
-	UTIL_AppendByteArray( packet, sendInterval, false );	// send interval
-
-	// create subpacket
-
-	if( !actions.empty( ) )
-	{
-		BYTEARRAY subpacket;
-
-		while( !actions.empty( ) )
-		{
-			CIncomingAction *Action = actions.front( );
-			actions.pop( );
-			subpacket.push_back( Action->GetPID( ) );
-			UTIL_AppendByteArray( subpacket, (uint16_t)Action->GetAction( )->size( ), false );
-			UTIL_AppendByteArrayFast( subpacket, *Action->GetAction( ) );
-		}
-
-		// calculate crc (we only care about the first 2 bytes though)
-
-		BYTEARRAY crc32 = UTIL_CreateByteArray( m_GHost->m_CRC->FullCRC( (unsigned char *)string( subpacket.begin( ), subpacket.end( ) ).c_str( ), subpacket.size( ) ), false );
-		crc32.resize( 2 );
-
-		// finish subpacket
-
-		UTIL_AppendByteArrayFast( packet, crc32 );			// crc
-		UTIL_AppendByteArrayFast( packet, subpacket );		// subpacket
-	}
-
-	AssignLength( packet );
+	BYTEARRAY packet = EncodeActions( W3GS_INCOMING_ACTION, sendInterval, actions );
 	// DEBUG_Print( "SENT W3GS_INCOMING_ACTION" );
 	// DEBUG_Print( packet );
 	return packet;
@@ -835,14 +842,24 @@ BYTEARRAY CGameProtocol :: SEND_W3GS_STARTDOWNLOAD( unsigned char fromPID )
 	return packet;
 }
 
-BYTEARRAY CGameProtocol :: SEND_W3GS_MAPPART( unsigned char fromPID, unsigned char toPID, uint32_t start, string *mapData )
+BYTEARRAY CGameProtocol :: SEND_W3GS_MAPPART( unsigned char fromPID, unsigned char toPID, uint32_t start, const unsigned char *mapData, uint32_t mapSize, uint32_t crc )
 {
+	// crc is the crc of the chunk starting at start, it's looked up in the map's chunk table (see CMap :: GetMapPartCRC) so we don't have to calculate it on every send
+
 	unsigned char Unknown[] = { 1, 0, 0, 0 };
 
 	BYTEARRAY packet;
 
-	if( start < mapData->size( ) )
+	if( start < mapSize )
 	{
+		// calculate end position (don't send more than MAPPART_SIZE map bytes in one packet)
+
+		uint32_t End = start + MAPPART_SIZE;
+
+		if( End > mapSize )
+			End = mapSize;
+
+		packet.reserve( 18 + End - start );
 		packet.push_back( W3GS_HEADER_CONSTANT );				// W3GS header constant
 		packet.push_back( W3GS_MAPPART );						// W3GS_MAPPART
 		packet.push_back( 0 );									// packet length will be assigned later
@@ -851,23 +868,11 @@ BYTEARRAY CGameProtocol :: SEND_W3GS_MAPPART( unsigned char fromPID, unsigned ch
 		packet.push_back( fromPID );							// from PID
 		UTIL_AppendByteArray( packet, Unknown, 4 );				// ???
 		UTIL_AppendByteArray( packet, start, false );			// start position
-
-		// calculate end position (don't send more than 1442 map bytes in one packet)
-
-		uint32_t End = start + 1442;
-
-		if( End > mapData->size( ) )
-			End = mapData->size( );
-
-		// calculate crc
-
-		BYTEARRAY crc32 = UTIL_CreateByteArray( m_GHost->m_CRC->FullCRC( (unsigned char *)mapData->c_str( ) + start, End - start ), false );
-		UTIL_AppendByteArrayFast( packet, crc32 );
+		UTIL_AppendByteArray( packet, crc, false );				// crc
 
 		// map data
 
-		BYTEARRAY Data = UTIL_CreateByteArray( (unsigned char *)mapData->c_str( ) + start, End - start );
-		UTIL_AppendByteArrayFast( packet, Data );
+		packet.insert( packet.end( ), mapData + start, mapData + End );
 		AssignLength( packet );
 	}
 	else
@@ -880,41 +885,9 @@ BYTEARRAY CGameProtocol :: SEND_W3GS_MAPPART( unsigned char fromPID, unsigned ch
 
 BYTEARRAY CGameProtocol :: SEND_W3GS_INCOMING_ACTION2( queue<CIncomingAction *> actions )
 {
-	BYTEARRAY packet;
-	packet.push_back( W3GS_HEADER_CONSTANT );				// W3GS header constant
-	packet.push_back( W3GS_INCOMING_ACTION2 );				// W3GS_INCOMING_ACTION2
-	packet.push_back( 0 );									// packet length will be assigned later
-	packet.push_back( 0 );									// packet length will be assigned later
-	packet.push_back( 0 );									// ??? (send interval?)
-	packet.push_back( 0 );									// ??? (send interval?)
-
-	// create subpacket
-
-	if( !actions.empty( ) )
-	{
-		BYTEARRAY subpacket;
-
-		while( !actions.empty( ) )
-		{
-			CIncomingAction *Action = actions.front( );
-			actions.pop( );
-			subpacket.push_back( Action->GetPID( ) );
-			UTIL_AppendByteArray( subpacket, (uint16_t)Action->GetAction( )->size( ), false );
-			UTIL_AppendByteArrayFast( subpacket, *Action->GetAction( ) );
-		}
-
-		// calculate crc (we only care about the first 2 bytes though)
-
-		BYTEARRAY crc32 = UTIL_CreateByteArray( m_GHost->m_CRC->FullCRC( (unsigned char *)string( subpacket.begin( ), subpacket.end( ) ).c_str( ), subpacket.size( ) ), false );
-		crc32.resize( 2 );
+	// the two bytes after the length are unknown (send interval?) and always zero
 
-		// finish subpacket
-
-		UTIL_AppendByteArrayFast( packet, crc32 );			// crc
-		UTIL_AppendByteArrayFast( packet, subpacket );		// subpacket
-	}
-
-	AssignLength( packet );
+	BYTEARRAY packet = EncodeActions( W3GS_INCOMING_ACTION2, 0, actions );
 	// DEBUG_Print( "SENT W3GS_INCOMING_ACTION2" );
 	// DEBUG_Print( packet );
 	return packet;
@@ -961,6 +934,67 @@ bool CGameProtocol :: ValidateLength( BYTEARRAY &content )
 	return false;
 }
 
+bool CGameProtocol :: ValidateLength( CPacketView &packet )
+{
+	return packet.GetLength( ) >= 4 && packet.GetLength( ) <= 65535 && packet.GetUInt16( 2 ) == packet.GetLength( );
+}
+
+BYTEARRAY CGameProtocol :: EncodeActions( unsigned char ID, uint16_t sendInterval, queue<CIncomingAction *> &actions )
+{
+	// serialize a W3GS_INCOMING_ACTION or W3GS_INCOMING_ACTION2 packet in a single pass
+	// the actions are written straight into the packet and the crc is calculated in place afterwards
+	// note: this empties actions
+
+	uint32_t Length = 6;
+
+	if( !actions.empty( ) )
+	{
+		Length += 2;
+
+		for( uint32_t i = 0; i < actions.size( ); ++i )
+		{
+			CIncomingAction *Action = actions.front( );
+			actions.pop( );
+			actions.push( Action );
+			Length += Action->GetLength( );
+		}
+	}
+
+	BYTEARRAY packet;
+	packet.reserve( Length );
+	packet.push_back( W3GS_HEADER_CONSTANT );				// W3GS header constant
+	packet.push_back( ID );									// W3GS_INCOMING_ACTION or W3GS_INCOMING_ACTION2
+	packet.push_back( (unsigned char)Length );				// packet length
+	packet.push_back( (unsigned char)( Length >> 8 ) );		// packet length
+	packet.push_back( (unsigned char)sendInterval );		// send interval
+	packet.push_back( (unsigned char)( sendInterval >> 8 ) );	// send interval
+
+	if( !actions.empty( ) )
+	{
+		packet.push_back( 0 );								// crc will be assigned later
+		packet.push_back( 0 );								// crc will be assigned later
+
+		while( !actions.empty( ) )
+		{
+			CIncomingAction *Action = actions.front( );
+			actions.pop( );
+			BYTEARRAY *ActionData = Action->GetAction( );
+			packet.push_back( Action->GetPID( ) );
+			packet.push_back( (unsigned char)ActionData->size( ) );
+			packet.push_back( (unsigned char)( ActionData->size( ) >> 8 ) );
+			packet.insert( packet.end( ), ActionData->begin( ), ActionData->end( ) );
+		}
+
+		// calculate crc of the actions (we only care about the first 2 bytes though)
+
+		uint32_t CRC = m_GHost->m_CRC->FullCRC( &packet[8], packet.size( ) - 8 );
+		packet[6] = (unsigned char)CRC;
+		packet[7] = (unsigned char)( CRC >> 8 );
+	}
+
+	return packet;
+}
+
 BYTEARRAY CGameProtocol :: EncodeSlotInfo( vector<CGameSlot> &slots, uint32_t randomSeed, unsigned char layoutStyle, unsigned char playerSlots )
 {
 	BYTEARRAY SlotInfo;
@@ -998,6 +1032,11 @@ CIncomingAction :: CIncomingAction( unsigned char nPID, BYTEARRAY &nCRC, BYTEARR
 
 }
 
+CIncomingAction :: CIncomingAction( unsigned char nPID, const unsigned char *nCRC, const unsigned char *nAction, uint32_t nActionLength ) : m_PID( nPID ), m_CRC( nCRC, nCRC + 4 ), m_Action( nAction, nAction + nActionLength )
+{
+
+}
+
 CIncomingAction :: ~CIncomingAction( )
 {
 
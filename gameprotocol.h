@@ -32,6 +32,8 @@
 
 #define W3GS_HEADER_CONSTANT		247
 
+#define MAPPART_SIZE				1442	// the maximum number of map bytes in one W3GS_MAPPART packet
+
 #define GAME_NONE					0		// this case isn't part of the protocol, it's for internal use only
 #define GAME_FULL					2
 #define GAME_PUBLIC					16
@@ -58,6 +60,7 @@
 class CGamePlayer;
 class CIncomingJoinPlayer;
 class CIncomingAction;
+class CPacketView;
 class CIncomingChatPlayer;
 class CIncomingMapSize;
 
@@ -122,6 +125,15 @@ public:
 	uint32_t RECEIVE_W3GS_MAPPARTOK( BYTEARRAY data );
 	uint32_t RECEIVE_W3GS_PONG_TO_HOST( BYTEARRAY data );
 
+	// receive functions that parse the packet in place in the socket's receive buffer (see CPacketView)
+	// these are used for the packets a player sends all game long so only data that's kept (e.g. the action itself) gets copied
+
+	uint32_t RECEIVE_W3GS_LEAVEGAME( CPacketView &packet );
+	bool RECEIVE_W3GS_GAMELOADED_SELF( CPacketView &packet );
+	CIncomingAction *RECEIVE_W3GS_OUTGOING_ACTION( CPacketView &packet, unsigned char PID );
+	uint32_t RECEIVE_W3GS_OUTGOING_KEEPALIVE( CPacketView &packet );
+	uint32_t RECEIVE_W3GS_PONG_TO_HOST( CPacketView &packet );
+
 	// send functions
 
 	BYTEARRAY SEND_W3GS_PING_FROM_HOST( );
@@ -145,7 +157,7 @@ public:
 	BYTEARRAY SEND_W3GS_DECREATEGAME( );
 	BYTEARRAY SEND_W3GS_MAPCHECK( string mapPath, BYTEARRAY mapSize, BYTEARRAY mapInfo, BYTEARRAY mapCRC, BYTEARRAY mapSHA1 );
 	BYTEARRAY SEND_W3GS_STARTDOWNLOAD( unsigned char fromPID );
-	BYTEARRAY SEND_W3GS_MAPPART( unsigned char fromPID, unsigned char toPID, uint32_t start, string *mapData );
+	BYTEARRAY SEND_W3GS_MAPPART( unsigned char fromPID, unsigned char toPID, uint32_t start, const unsigned char *mapData, uint32_t mapSize, uint32_t crc );
 	BYTEARRAY SEND_W3GS_INCOMING_ACTION2( queue<CIncomingAction *> actions );
 
 	// other functions
@@ -153,6 +165,8 @@ public:
 private:
 	bool AssignLength( BYTEARRAY &content );
 	bool ValidateLength( BYTEARRAY &content );
+	bool ValidateLength( CPacketView &packet );
+	BYTEARRAY EncodeActions( unsigned char ID, uint16_t sendInterval, queue<CIncomingAction *> &actions );
 	BYTEARRAY EncodeSlotInfo( vector<CGameSlot> &slots, uint32_t randomSeed, unsigned char layoutStyle, unsigned char playerSlots );
 };
 
@@ -191,6 +205,7 @@ private:
 
 public:
 	CIncomingAction( unsigned char nPID, BYTEARRAY &nCRC, BYTEARRAY &nAction );
+	CIncomingAction( unsigned char nPID, const unsigned char *nCRC, const unsigned char *nAction, uint32_t nActionLength );
 	~CIncomingAction( );
 
 	unsigned char GetPID( )	{ return m_PID; }
@@ -31,11 +31,18 @@
 #include "config.h"
 #include "language.h"
 #include "socket.h"
+#include "commandpacket.h"
 #include "ghostdb.h"
 #include "ghostdbmysql.h"
 #include "bnet.h"
 #include "map.h"
+#include "mapindex.h"
+#include "mapwarmer.h"
 #include "packed.h"
+#include "replaywriter.h"
+#include "replayarchive.h"
+#include "relayfeed.h"
+#include "relay.h"
 #include "savegame.h"
 #include "gameplayer.h"
 #include "gameprotocol.h"
@@ -43,6 +50,7 @@
 #include "gpsprotocol.h"
 #include "game_base.h"
 #include "game.h"
+#include "reactor.h"
 
 #include <signal.h>
 #include <execinfo.h> //to generate stack trace-like thing on exception
@@ -394,8 +402,26 @@ CGHost :: CGHost( CConfig *CFG )
 	m_GCBIProtocol = new CGCBIProtocol( );
 	m_CRC = new CCRC32( );
 	m_CRC->Initialize( );
-	m_SHA = new CSHA1( );
+
+	if( m_CRC->UsingCLMUL( ) )
+		CONSOLE_Print( "[GHOST] calculating CRC32 with PCLMULQDQ" );
+	else
+		CONSOLE_Print( "[GHOST] calculating CRC32 with slicing-by-8" );
+
+	if( CSHA1 :: UsingSHANI( ) )
+		CONSOLE_Print( "[GHOST] calculating SHA1 with SHA-NI" );
+
 	m_CurrentGame = NULL;
+	m_CallableQueue = new CCallableQueue( );
+
+	// the packed file settings are read by every thread that compresses or decompresses packed files (games and the replay compressor)
+	// so unlike most settings they're only read at startup and not on reload
+
+	CPacked :: SetLevel( CFG->GetInt( "replay_compressionlevel", 6 ) );
+	m_PackedPool = new CPackedPool( CFG->GetInt( "bot_packedthreads", 4 ) );
+	CPacked :: SetPool( m_PackedPool );
+	CONSOLE_Print( "[GHOST] using " + UTIL_ToString( m_PackedPool->GetNumThreads( ) ) + " threads for packed files" );
+	m_ReplayCompressor = new CReplayCompressor( );
 	m_CallableCommandList = NULL;
 	m_LastDenyCleanTime = 0;
 
@@ -469,6 +495,9 @@ CGHost :: CGHost( CConfig *CFG )
 #endif
 
 	m_Language = NULL;
+	m_MapCFGIndex = NULL;
+	m_MapIndex = NULL;
+	m_MapWarmer = NULL;
 	m_Exiting = false;
 	m_ExitingNice = false;
 	m_Enabled = true;
@@ -500,9 +529,72 @@ CGHost :: CGHost( CConfig *CFG )
 	m_LANWar3Version = CFG->GetInt( "lan_war3version", 26 );
 	m_ReplayWar3Version = CFG->GetInt( "replay_war3version", 26 );
 	m_ReplayBuildNumber = CFG->GetInt( "replay_buildnumber", 6059 );
+	m_MapWarmup = CFG->GetInt( "bot_mapwarmup", 0 ) == 0 ? false : true;
+	m_MapWarmupThreads = CFG->GetInt( "bot_mapwarmupthreads", 2 );
 	bool IPToCountry = CFG->GetInt( "bot_iptocountry", 0 ) == 0 ? false : true;
 	SetConfigs( CFG );
 
+	// the replay archive's file name is relative to the replay path
+
+	string ReplayArchive = CFG->GetString( "bot_replayarchive", string( ) );
+	m_ReplayArchive = NULL;
+
+	if( !ReplayArchive.empty( ) )
+	{
+		m_ReplayArchive = new CReplayArchive( m_ReplayPath + ReplayArchive );
+
+		if( !m_ReplayArchive->GetValid( ) )
+		{
+			CONSOLE_Print( "[GHOST] unable to open the replay archive, replays will be saved as files" );
+			delete m_ReplayArchive;
+			m_ReplayArchive = NULL;
+		}
+	}
+
+	// the spectator relay publishes the replay data of running games so it only sees games with replays enabled (bot_savereplays)
+
+	uint16_t RelayPort = CFG->GetInt( "bot_relayport", 0 );
+	m_Relay = NULL;
+
+	if( RelayPort != 0 )
+	{
+		m_Relay = new CRelay( m_BindAddress, RelayPort, CFG->GetInt( "bot_relaydelay", 120 ) * 1000, CFG->GetInt( "bot_relaymaxclients", 500 ), CFG->GetInt( "bot_relaymaxbuffer", 256 ) * 1024 );
+
+		if( !m_Relay->GetValid( ) )
+		{
+			delete m_Relay;
+			m_Relay = NULL;
+		}
+	}
+
+#ifdef GHOST_REACTOR
+	// start the reactor threads
+	// every game is assigned to one of these instead of getting a thread of its own
+
+	uint32_t ReactorThreads = CFG->GetInt( "bot_reactorthreads", 0 );
+
+	if( ReactorThreads == 0 )
+		ReactorThreads = boost::thread :: hardware_concurrency( );
+
+	if( ReactorThreads == 0 )
+		ReactorThreads = 2;
+
+	for( uint32_t i = 1; i <= ReactorThreads; ++i )
+	{
+		CGameReactor *Reactor = new CGameReactor( i );
+
+		if( Reactor->HasError( ) )
+			delete Reactor;
+		else
+			m_Reactors.push_back( Reactor );
+	}
+
+	if( m_Reactors.empty( ) )
+		CONSOLE_Print( "[GHOST] warning - unable to start any reactor threads, games will run in their own threads" );
+	else
+		CONSOLE_Print( "[GHOST] started " + UTIL_ToString( m_Reactors.size( ) ) + " reactor threads" );
+#endif
+
 	// load the battle.net connections
 	// we're just loading the config data and creating the CBNET classes here, the connections are established later (in the Update function)
 
@@ -627,6 +719,11 @@ CGHost :: CGHost( CConfig *CFG )
 	m_AutoHostMap = new CMap( *m_Map );
 	m_SaveGame = new CSaveGame( );
 
+	// validate the other map configs in the background so the first !load of each one is fast
+
+	if( m_MapWarmup )
+		m_MapWarmer = new CMapWarmer( this, m_MapWarmupThreads );
+
 	if( m_BNETs.empty( ) )
 		CONSOLE_Print( "[GHOST] warning - no battle.net connections found" );
 
@@ -669,6 +766,27 @@ CGHost :: CGHost( CConfig *CFG )
 
 CGHost :: ~CGHost( )
 {
+	// stop the map warmer first, its threads load maps with m_CRC and the other members deleted below
+
+	delete m_MapWarmer;
+	m_MapWarmer = NULL;
+
+	// then tell every game to delete itself and wait for the reactors to finish them
+	// this has to happen before anything the games use is deleted, deleting a game walks m_BNETs and its final update uses m_CRC, m_GPSProtocol, the database, the replay compressor and archive and the spectator relay
+
+	if( m_CurrentGame )
+		m_CurrentGame->doDelete();
+
+	boost::mutex::scoped_lock lock( m_GamesMutex );
+	for( vector<CBaseGame *> :: iterator i = m_Games.begin( ); i != m_Games.end( ); ++i )
+		(*i)->doDelete();
+	lock.unlock( );
+
+#ifdef GHOST_REACTOR
+	for( vector<CGameReactor *> :: iterator i = m_Reactors.begin( ); i != m_Reactors.end( ); ++i )
+		delete *i;
+#endif
+
 	delete m_UDPSocket;
 	delete m_GamelistSocket;
 	delete m_LocalSocket;
@@ -680,29 +798,31 @@ CGHost :: ~CGHost( )
 	delete m_GPSProtocol;
 	delete m_GCBIProtocol;
 	delete m_CRC;
-	delete m_SHA;
 
 	for( vector<CBNET *> :: iterator i = m_BNETs.begin( ); i != m_BNETs.end( ); ++i )
 		delete *i;
 
-	if( m_CurrentGame )
-		m_CurrentGame->doDelete();
-
-	boost::mutex::scoped_lock lock( m_GamesMutex );
-	for( vector<CBaseGame *> :: iterator i = m_Games.begin( ); i != m_Games.end( ); ++i )
-		(*i)->doDelete();
-	lock.unlock( );
-
+	delete m_ReplayCompressor;
+	CPacked :: SetPool( NULL );
+	delete m_PackedPool;
+	delete m_ReplayArchive;
+	delete m_Relay;
 	delete m_DB;
 
 	// warning: we don't delete any entries of m_Callables here because we can't be guaranteed that the associated threads have terminated
 	// this is fine if the program is currently exiting because the OS will clean up after us
 	// but if you try to recreate the CGHost object within a single session you will probably leak resources!
 
-	if( !m_Callables.empty( ) )
-		CONSOLE_Print( "[GHOST] warning - " + UTIL_ToString( m_Callables.size( ) ) + " orphaned callables were leaked (this is not an error)" );
+	uint32_t NumLeaked = m_Callables.size( ) + m_CallableQueue->GetNumPending( );
+
+	if( NumLeaked > 0 )
+		CONSOLE_Print( "[GHOST] warning - " + UTIL_ToString( NumLeaked ) + " orphaned callables were leaked (this is not an error)" );
+
+	delete m_CallableQueue;
 
 	delete m_Language;
+	delete m_MapCFGIndex;
+	delete m_MapIndex;
 	delete m_Map;
 	delete m_AdminMap;
 	delete m_AutoHostMap;
@@ -770,16 +890,18 @@ bool CGHost :: Update( long usecBlock )
 
 		if( m_Games.empty( ) )
 		{
+			uint32_t NumCallables = m_Callables.size( ) + m_CallableQueue->GetNumPending( );
+
 			if( !m_AllGamesFinished )
 			{
 				CONSOLE_Print( "[GHOST] all games finished, waiting 60 seconds for threads to finish" );
-				CONSOLE_Print( "[GHOST] there are " + UTIL_ToString( m_Callables.size( ) ) + " threads in progress" );
+				CONSOLE_Print( "[GHOST] there are " + UTIL_ToString( NumCallables ) + " threads in progress" );
 				m_AllGamesFinished = true;
 				m_AllGamesFinishedTime = GetTime( );
 			}
 			else
 			{
-				if( m_Callables.empty( ) )
+				if( NumCallables == 0 )
 				{
 					CONSOLE_Print( "[GHOST] all threads finished, exiting nicely" );
 					m_Exiting = true;
@@ -787,36 +909,65 @@ bool CGHost :: Update( long usecBlock )
 				else if( GetTime( ) - m_AllGamesFinishedTime >= 60 )
 				{
 					CONSOLE_Print( "[GHOST] waited 60 seconds for threads to finish, exiting anyway" );
-					CONSOLE_Print( "[GHOST] there are " + UTIL_ToString( m_Callables.size( ) ) + " threads still in progress which will be terminated" );
+					CONSOLE_Print( "[GHOST] there are " + UTIL_ToString( NumCallables ) + " threads still in progress which will be terminated" );
 					m_Exiting = true;
 				}
 			}
 		}
 	}
 
+	// clean up the map warmer once it's done
+
+	if( m_MapWarmer && m_MapWarmer->GetDone( ) )
+	{
+		delete m_MapWarmer;
+		m_MapWarmer = NULL;
+	}
+
 	// update callables
+	// newly orphaned callables are attached to our callable queue (NULL ones from unimplemented database calls are ignored)
+	// then we only have to deal with the callables the queue says are ready rather than polling all of them
 
 	boost::mutex::scoped_lock callablesLock( m_CallablesMutex );
+	vector<CBaseCallable *> Orphans;
+	Orphans.swap( m_Callables );
+	callablesLock.unlock( );
+
+	for( vector<CBaseCallable *> :: iterator i = Orphans.begin( ); i != Orphans.end( ); ++i )
+		m_CallableQueue->AttachCallable( *i );
 
-	for( vector<CBaseCallable *> :: iterator i = m_Callables.begin( ); i != m_Callables.end( ); )
+	vector<CBaseCallable *> Completed;
+	m_CallableQueue->GetCompleted( Completed );
+
+	for( vector<CBaseCallable *> :: iterator i = Completed.begin( ); i != Completed.end( ); ++i )
 	{
-		if( !(*i) )
+		if( *i == m_CallableCommandList )
 		{
-			// NULL presumably because we're using SQLite database with unimplemented database call
-			// so just remove it from callables
-			i = m_Callables.erase( i );
+			vector<string> commands = m_CallableCommandList->GetResult( );
+			
+			for( vector<string> :: iterator j = commands.begin( ); j != commands.end( ); ++j )
+			{
+				CONSOLE_Print("[GHOST] Executing command from MYSQL: " + *j);
+				
+				if( !m_BNETs.empty( ) && !(*j).empty( ) )
+					m_BNETs[0]->BotCommand( *j, m_BNETs[0]->GetUserName(), true, true );
+			}
+			
+			m_CallableCommandList = NULL;
+			m_LastCommandListTime = GetTime();
 		}
-		else if( (*i)->GetReady( ) )
+		else if( *i == m_CallableSpoofList )
 		{
-			m_DB->RecoverCallable( *i );
-			delete *i;
-			i = m_Callables.erase( i );
+			boost::mutex::scoped_lock lock( m_SpoofMutex );
+			m_SpoofList = m_CallableSpoofList->GetResult( );
+			m_CallableSpoofList = NULL;
+			m_LastSpoofRefreshTime = GetTime( );
+			lock.unlock( );
 		}
-		else
-			++i;
+
+		m_DB->RecoverCallable( *i );
+		delete *i;
 	}
-	
-	callablesLock.unlock( );
 
 	// create the GProxy++ reconnect listener
 
@@ -944,70 +1095,49 @@ bool CGHost :: Update( long usecBlock )
 		}
 
 		(*i)->DoRecv( &fd );
-		string *RecvBuffer = (*i)->GetBytes( );
-		BYTEARRAY Bytes = UTIL_CreateByteArray( (unsigned char *)RecvBuffer->c_str( ), RecvBuffer->size( ) );
+		CRecvBuffer *RecvBuffer = (*i)->GetBytes( );
+
+		// frame the packet in place, the only packet we accept on a reconnect socket is a 13 byte GPS_RECONNECT
 
-		// a packet is at least 4 bytes
+		CPacketView Packet;
+		CPacketView :: FrameResult Result = Packet.Frame( (unsigned char *)RecvBuffer->GetData( ), RecvBuffer->GetSize( ) );
 
-		if( Bytes.size( ) >= 4 )
+		if( Result == CPacketView :: FRAME_OK && Packet.GetPacketType( ) == GPS_HEADER_CONSTANT && Packet.GetID( ) == CGPSProtocol :: GPS_RECONNECT && Packet.GetLength( ) == 13 )
 		{
-			if( Bytes[0] == GPS_HEADER_CONSTANT )
-			{
-				// bytes 2 and 3 contain the length of the packet
+			GProxyReconnector *Reconnector = new GProxyReconnector;
+			Reconnector->PID = Packet.GetBytes( )[4];
+			Reconnector->ReconnectKey = Packet.GetUInt32( 5 );
+			Reconnector->LastPacket = Packet.GetUInt32( 9 );
+			Reconnector->PostedTime = GetTicks( );
+			Reconnector->socket = (*i);
+
+			// update the receive buffer
+			RecvBuffer->Consume( Packet.GetLength( ) );
+			i = m_ReconnectSockets.erase( i );
 
-				uint16_t Length = UTIL_ByteArrayToUInt16( Bytes, false, 2 );
+			// post in the reconnects buffer and wait to see if a game thread will pick it up
+			boost::mutex::scoped_lock lock( m_ReconnectMutex );
+			m_PendingReconnects.push_back( Reconnector );
+			lock.unlock();
 
-				if( Length >= 4 )
-				{
-					if( Bytes.size( ) >= Length )
-					{
-						if( Bytes[1] == CGPSProtocol :: GPS_RECONNECT && Length == 13 )
-						{
-							GProxyReconnector *Reconnector = new GProxyReconnector;
-							Reconnector->PID = Bytes[4];
-							Reconnector->ReconnectKey = UTIL_ByteArrayToUInt32( Bytes, false, 5 );
-							Reconnector->LastPacket = UTIL_ByteArrayToUInt32( Bytes, false, 9 );
-							Reconnector->PostedTime = GetTicks( );
-							Reconnector->socket = (*i);
-
-							// update the receive buffer
-							*RecvBuffer = RecvBuffer->substr( Length );
-							i = m_ReconnectSockets.erase( i );
-
-							// post in the reconnects buffer and wait to see if a game thread will pick it up
-							boost::mutex::scoped_lock lock( m_ReconnectMutex );
-							m_PendingReconnects.push_back( Reconnector );
-							lock.unlock();
-							continue;
-						}
-						
-						else
-						{
-							(*i)->PutBytes( m_GPSProtocol->SEND_GPSS_REJECT( REJECTGPS_INVALID ) );
-							(*i)->DoSend( &send_fd );
-							delete *i;
-							i = m_ReconnectSockets.erase( i );
-							continue;
-						}
-					}
-				}
-				else
-				{
-					(*i)->PutBytes( m_GPSProtocol->SEND_GPSS_REJECT( REJECTGPS_INVALID ) );
-					(*i)->DoSend( &send_fd );
-					delete *i;
-					i = m_ReconnectSockets.erase( i );
-					continue;
-				}
-			}
-			else
-			{
-				(*i)->PutBytes( m_GPSProtocol->SEND_GPSS_REJECT( REJECTGPS_INVALID ) );
-				(*i)->DoSend( &send_fd );
-				delete *i;
-				i = m_ReconnectSockets.erase( i );
-				continue;
-			}
+			// we don't know which game the player is in so wake them all up
+
+#ifdef GHOST_REACTOR
+			for( vector<CGameReactor *> :: iterator j = m_Reactors.begin( ); j != m_Reactors.end( ); ++j )
+				(*j)->WakeAll( );
+#endif
+
+			continue;
+		}
+		else if( Result != CPacketView :: FRAME_INCOMPLETE || ( RecvBuffer->GetSize( ) >= 4 && (unsigned char)RecvBuffer->GetData( )[0] != GPS_HEADER_CONSTANT ) )
+		{
+			// anything else is rejected, including a partial packet that isn't a GPS packet
+
+			(*i)->PutBytes( m_GPSProtocol->SEND_GPSS_REJECT( REJECTGPS_INVALID ) );
+			(*i)->DoSend( &send_fd );
+			delete *i;
+			i = m_ReconnectSockets.erase( i );
+			continue;
 		}
 
 		(*i)->DoSend( &send_fd );
@@ -1118,45 +1248,14 @@ bool CGHost :: Update( long usecBlock )
 	//refresh command list every 20 seconds
 	if( !m_CallableCommandList && GetTime( ) - m_LastCommandListTime >= 20 )
 	{
-		m_CallableCommandList = m_DB->ThreadedCommandList( );
-		m_LastCommandListTime = GetTime();
-	}
-
-	if( m_CallableCommandList && m_CallableCommandList->GetReady( ) )
-	{
-		vector<string> commands = m_CallableCommandList->GetResult( );
-		
-		for( vector<string> :: iterator i = commands.begin( ); i != commands.end( ); ++i )
-		{
-			CONSOLE_Print("[GHOST] Executing command from MYSQL: " + *i);
-			
-			if( !m_BNETs.empty( ) && !(*i).empty( ) )
-				m_BNETs[0]->BotCommand( *i, m_BNETs[0]->GetUserName(), true, true );
-		}
-		
-		m_DB->RecoverCallable( m_CallableCommandList );
-		delete m_CallableCommandList;
-		m_CallableCommandList = NULL;
+		m_CallableCommandList = m_CallableQueue->Attach( m_DB->ThreadedCommandList( ) );
 		m_LastCommandListTime = GetTime();
 	}
 
 	// refresh spoof list
 
 	if( !m_CallableSpoofList && GetTime( ) - m_LastSpoofRefreshTime >= 1200 )
-		m_CallableSpoofList = m_DB->ThreadedSpoofList( );
-
-	if( m_CallableSpoofList && m_CallableSpoofList->GetReady( ) )
-	{
-		boost::mutex::scoped_lock lock( m_SpoofMutex );
-		
-		m_SpoofList = m_CallableSpoofList->GetResult( );
-		m_DB->RecoverCallable( m_CallableSpoofList );
-		delete m_CallableSpoofList;
-		m_CallableSpoofList = NULL;
-		m_LastSpoofRefreshTime = GetTime( );
-		
-		lock.unlock( );
-	}
+		m_CallableSpoofList = m_CallableQueue->Attach( m_DB->ThreadedSpoofList( ) );
 	
 	//clean the deny table every two minutes
 	
@@ -1221,6 +1320,7 @@ void CGHost :: EventBNETGameRefreshFailed( CBNET *bnet )
 		boost::mutex::scoped_lock sayLock( m_CurrentGame->m_SayGamesMutex );
 		m_CurrentGame->m_DoSayGames.push_back( m_Language->UnableToCreateGameTryAnotherName( bnet->GetServer( ), m_CurrentGame->GetGameName( ) ) );
 		sayLock.unlock( );
+		m_CurrentGame->Wake( );
 
 		// we take the easy route and simply close the lobby if a refresh fails
 		// it's possible at least one refresh succeeded and therefore the game is still joinable on at least one battle.net (plus on the local network) but we don't keep track of that
@@ -1276,6 +1376,15 @@ string CGHost :: GetSpoofName( string name )
 
 void CGHost :: ReloadConfigs( )
 {
+	// the map warmer reads the paths we're about to change so stop it first
+
+	if( m_MapWarmer )
+	{
+		CONSOLE_Print( "[GHOST] stopping map warmup to reload the config" );
+		delete m_MapWarmer;
+		m_MapWarmer = NULL;
+	}
+
 	CConfig CFG;
 	CFG.Read( "default.cfg" );
 	CFG.Read( gCFGFile );
@@ -1293,6 +1402,7 @@ void CGHost :: SetConfigs( CConfig *CFG )
 	m_Warcraft3Path = UTIL_AddPathSeperator( CFG->GetString( "bot_war3path", "C:\\Program Files\\Warcraft III\\" ) );
 	m_BindAddress = CFG->GetString( "bot_bindaddress", string( ) );
 	m_ReconnectWaitTime = CFG->GetInt( "bot_reconnectwaittime", 3 );
+	m_ReconnectMaxBuffer = CFG->GetInt( "bot_reconnectmaxbuffer", 8192 ) * 1024;
 	m_MaxGames = CFG->GetInt( "bot_maxgames", 5 );
 	string BotCommandTrigger = CFG->GetString( "bot_commandtrigger", "!" );
 
@@ -1303,6 +1413,29 @@ void CGHost :: SetConfigs( CConfig *CFG )
 	m_MapCFGPath = UTIL_AddPathSeperator( CFG->GetString( "bot_mapcfgpath", string( ) ) );
 	m_SaveGamePath = UTIL_AddPathSeperator( CFG->GetString( "bot_savegamepath", string( ) ) );
 	m_MapPath = UTIL_AddPathSeperator( CFG->GetString( "bot_mappath", string( ) ) );
+	m_MapMMap = CFG->GetInt( "bot_mapmmap", 1 ) == 0 ? false : true;
+	m_MapCachePath = UTIL_AddPathSeperator( CFG->GetString( "bot_mapcachepath", string( ) ) );
+	m_MapCacheForce = CFG->GetInt( "bot_mapcacheforce", 0 ) == 0 ? false : true;
+	m_MapIndexRescan = CFG->GetInt( "bot_mapindexrescan", 300 );
+
+	// the map indexes only have to be rebuilt if their path changed
+
+	if( !m_MapCFGIndex || m_MapCFGIndex->GetPath( ) != m_MapCFGPath )
+	{
+		delete m_MapCFGIndex;
+		m_MapCFGIndex = new CMapIndex( m_MapCFGPath, ".cfg", m_MapIndexRescan );
+	}
+	else
+		m_MapCFGIndex->SetRescanInterval( m_MapIndexRescan );
+
+	if( !m_MapIndex || m_MapIndex->GetPath( ) != m_MapPath )
+	{
+		delete m_MapIndex;
+		m_MapIndex = new CMapIndex( m_MapPath, string( ), m_MapIndexRescan );
+	}
+	else
+		m_MapIndex->SetRescanInterval( m_MapIndexRescan );
+
 	m_SaveReplays = CFG->GetInt( "bot_savereplays", 0 ) == 0 ? false : true;
 	m_ReplayPath = UTIL_AddPathSeperator( CFG->GetString( "bot_replaypath", string( ) ) );
 	m_VirtualHostName = CFG->GetString( "bot_virtualhostname", "|cFF4080C0GHost" );
@@ -1470,6 +1603,10 @@ void CGHost :: CreateGame( CMap *map, unsigned char gameState, bool saveGame, st
 		return;
 	}
 
+	// the game gets a copy of the map so make sure it's a copy of what's in the map file now
+
+	map->CheckMapFile( );
+
 	if( !map->GetValid( ) )
 	{
 		for( vector<CBNET *> :: iterator i = m_BNETs.begin( ); i != m_BNETs.end( ); ++i )
@@ -1614,7 +1751,25 @@ void CGHost :: CreateGame( CMap *map, unsigned char gameState, bool saveGame, st
 			(*i)->HoldClan( m_CurrentGame );
 	}
 	
-	// start the game thread
+	// hand the game to the least loaded reactor, or start a game thread if there aren't any
+
+#ifdef GHOST_REACTOR
+	if( !m_Reactors.empty( ) )
+	{
+		CGameReactor *Reactor = m_Reactors[0];
+
+		for( vector<CGameReactor *> :: iterator i = m_Reactors.begin( ); i != m_Reactors.end( ); ++i )
+		{
+			if( (*i)->GetNumGames( ) < Reactor->GetNumGames( ) )
+				Reactor = *i;
+		}
+
+		Reactor->AddGame( m_CurrentGame );
+		CONSOLE_Print( "[GameThread] Added new game to reactor #" + UTIL_ToString( Reactor->GetID( ) ) );
+		return;
+	}
+#endif
+
 	boost::thread(&CBaseGame::loop, m_CurrentGame);
 	CONSOLE_Print("[GameThread] Made new game thread");
 }
@@ -38,13 +38,20 @@ class CTCPSocket;
 class CGPSProtocol;
 class CGCBIProtocol;
 class CCRC32;
-class CSHA1;
 class CBNET;
 class CBaseGame;
+class CGameReactor;
 class CGHostDB;
 class CBaseCallable;
+class CCallableQueue;
 class CLanguage;
 class CMap;
+class CMapIndex;
+class CMapWarmer;
+class CReplayCompressor;
+class CPackedPool;
+class CReplayArchive;
+class CRelay;
 class CSaveGame;
 class CConfig;
 class CCallableCommandList;
@@ -72,20 +79,28 @@ public:
 	CGPSProtocol *m_GPSProtocol;
 	CGCBIProtocol *m_GCBIProtocol;
 	CCRC32 *m_CRC;							// for calculating CRC's
-	CSHA1 *m_SHA;							// for calculating SHA1's
 	vector<CBNET *> m_BNETs;				// all our battle.net connections (there can be more than one)
 	string m_UserName;						// first username seen in battle.net connection, to identify this bot
 	CBaseGame *m_CurrentGame;				// this game is still in the lobby state
 	vector<CBaseGame *> m_Games;			// these games are in progress
 	boost::mutex m_GamesMutex;
+	vector<CGameReactor *> m_Reactors;		// reactor threads that drive the games (see reactor.h)
 	CGHostDB *m_DB;							// database
-	vector<CBaseCallable *> m_Callables;	// vector of orphaned callables waiting to die
+	vector<CBaseCallable *> m_Callables;	// vector of orphaned callables waiting to be handed to m_CallableQueue
 	boost::mutex m_CallablesMutex;
+	CCallableQueue *m_CallableQueue;		// orphaned callables and our own callables are posted here when they're ready
+	CReplayCompressor *m_ReplayCompressor;	// compresses the replays of running games in the background (see CReplay :: Stream)
+	CPackedPool *m_PackedPool;				// the threads packed files are compressed and decompressed on (see CPacked)
+	CReplayArchive *m_ReplayArchive;		// the archive replays of games with a database ID are saved in, NULL to save them as files
+	CRelay *m_Relay;						// the spectator relay, NULL if it's disabled
 	vector<BYTEARRAY> m_LocalAddresses;		// vector of local IP addresses
 	map<string, DenyInfo> m_DenyIP;			// map (IP -> DenyInfo) of denied IP addresses
 	boost::mutex m_DenyMutex;
 	CLanguage *m_Language;					// language
 	CMap *m_Map;							// the currently loaded map
+	CMapIndex *m_MapCFGIndex;				// the map configs in m_MapCFGPath (used with !load)
+	CMapIndex *m_MapIndex;					// the maps in m_MapPath (used with !map)
+	CMapWarmer *m_MapWarmer;				// validates every map config in the background at startup, NULL when it's not running
 	CMap *m_AdminMap;						// the map to use in the admin game
 	CMap *m_AutoHostMap;					// the map to use when autohosting
 	CSaveGame *m_SaveGame;					// the save game to use
@@ -117,11 +132,18 @@ public:
 	bool m_Reconnect;						// config value: GProxy++ reliable reconnects enabled or not
 	uint16_t m_ReconnectPort;				// config value: the port to listen for GProxy++ reliable reconnects on
 	uint32_t m_ReconnectWaitTime;			// config value: the maximum number of minutes to wait for a GProxy++ reliable reconnect
+	uint32_t m_ReconnectMaxBuffer;			// config value: the maximum number of bytes each game keeps for GProxy++ reliable reconnects (see CGProxyLog)
 	uint32_t m_MaxGames;					// config value: maximum number of games in progress
 	char m_CommandTrigger;					// config value: the command trigger inside games
 	string m_MapCFGPath;					// config value: map cfg path
 	string m_SaveGamePath;					// config value: savegame path
 	string m_MapPath;						// config value: map path
+	bool m_MapMMap;							// config value: memory map map files rather than reading them into memory (see CMappedFile)
+	string m_MapCachePath;					// config value: map metadata cache path, empty to disable the cache (see CMapCache)
+	bool m_MapCacheForce;					// config value: ignore the map metadata cache and recalculate everything when loading maps
+	bool m_MapWarmup;						// config value: validate every map config and fill the map cache at startup (see CMapWarmer)
+	uint32_t m_MapWarmupThreads;			// config value: the number of threads to validate map configs on at startup
+	uint32_t m_MapIndexRescan;				// config value: how often to rescan the map and map config paths in seconds in case inotify missed something (see CMapIndex)
 	bool m_SaveReplays;						// config value: save replays
 	string m_ReplayPath;					// config value: replay path
 	string m_VirtualHostName;				// config value: virtual host name
@@ -230,7 +230,7 @@ bool CGHostDB :: W3MMDVarAdd( uint32_t gameid, map<VarP,string> var_strings, str
 
 void CGHostDB :: CreateThread( CBaseCallable *callable )
 {
-	callable->SetReady( true );
+	CCallableQueue :: Complete( callable );
 }
 
 CCallableAdminCount *CGHostDB :: ThreadedAdminCount( string server )
@@ -417,6 +417,14 @@ CCallableW3MMDVarAdd *CGHostDB :: ThreadedW3MMDVarAdd( uint32_t gameid, map<VarP
 // Callables
 //
 
+CBaseCallable :: ~CBaseCallable( )
+{
+	// make sure no queue is left holding a pointer to us
+
+	if( m_CompletionQueue )
+		CCallableQueue :: Detach( this );
+}
+
 void CBaseCallable :: Init( )
 {
 	m_StartTicks = GetTicks( );
@@ -425,7 +433,118 @@ void CBaseCallable :: Init( )
 void CBaseCallable :: Close( )
 {
 	m_EndTicks = GetTicks( );
-	m_Ready = true;
+	CCallableQueue :: Complete( this );
+}
+
+//
+// CCallableQueue
+//
+
+boost::mutex CCallableQueue :: m_Mutex;
+
+CCallableQueue :: CCallableQueue( )
+{
+
+}
+
+CCallableQueue :: ~CCallableQueue( )
+{
+	// the callables still attached to us are owned by someone else now (e.g. they were orphaned), they just won't be posted anywhere until they're attached again
+
+	boost::mutex::scoped_lock lock( m_Mutex );
+
+	for( set<CBaseCallable *> :: iterator i = m_Pending.begin( ); i != m_Pending.end( ); ++i )
+		(*i)->m_CompletionQueue = NULL;
+
+	for( vector<CBaseCallable *> :: iterator i = m_Completed.begin( ); i != m_Completed.end( ); ++i )
+		(*i)->m_CompletionQueue = NULL;
+}
+
+uint32_t CCallableQueue :: GetNumPending( )
+{
+	boost::mutex::scoped_lock lock( m_Mutex );
+	return m_Pending.size( );
+}
+
+void CCallableQueue :: AttachCallable( CBaseCallable *callable )
+{
+	// callables can be NULL if the database doesn't implement the call
+
+	if( !callable )
+		return;
+
+	boost::mutex::scoped_lock lock( m_Mutex );
+
+	if( callable->m_CompletionQueue )
+		callable->m_CompletionQueue->Remove( callable );
+
+	callable->m_CompletionQueue = this;
+
+	// the callable might already be ready (e.g. the database rejected it straight away) in which case we post it immediately
+
+	if( callable->m_Ready )
+	{
+		m_Completed.push_back( callable );
+		Notify( );
+	}
+	else
+		m_Pending.insert( callable );
+}
+
+void CCallableQueue :: GetCompleted( vector<CBaseCallable *> &completed )
+{
+	boost::mutex::scoped_lock lock( m_Mutex );
+
+	for( vector<CBaseCallable *> :: iterator i = m_Completed.begin( ); i != m_Completed.end( ); ++i )
+	{
+		(*i)->m_CompletionQueue = NULL;
+		completed.push_back( *i );
+	}
+
+	m_Completed.clear( );
+}
+
+void CCallableQueue :: Complete( CBaseCallable *callable )
+{
+	// post the callable to its queue and mark it ready
+	// this happens with the mutex locked so the owner can't see the callable as ready before it's been posted
+	// m_Ready has to be set last, an owner that polls GetReady instead of using a queue may delete the callable as soon as it's set
+
+	boost::mutex::scoped_lock lock( m_Mutex );
+	CCallableQueue *Queue = callable->m_CompletionQueue;
+
+	if( Queue )
+	{
+		Queue->m_Pending.erase( callable );
+		Queue->m_Completed.push_back( callable );
+		Queue->Notify( );
+	}
+
+	callable->m_Ready = true;
+}
+
+void CCallableQueue :: Detach( CBaseCallable *callable )
+{
+	boost::mutex::scoped_lock lock( m_Mutex );
+
+	if( callable->m_CompletionQueue )
+	{
+		callable->m_CompletionQueue->Remove( callable );
+		callable->m_CompletionQueue = NULL;
+	}
+}
+
+void CCallableQueue :: Remove( CBaseCallable *callable )
+{
+	m_Pending.erase( callable );
+
+	for( vector<CBaseCallable *> :: iterator i = m_Completed.begin( ); i != m_Completed.end( ); )
+	{
+		if( *i == callable )
+			i = m_Completed.erase( i );
+		else
+			++i;
+	}
 }
 
 CCallableAdminCount :: ~CCallableAdminCount( )
@@ -31,6 +31,7 @@
 //
 
 class CBaseCallable;
+class CCallableQueue;
 class CCallableAdminCount;
 class CCallableAdminCheck;
 class CCallableAdminAdd;
@@ -196,18 +197,22 @@ public:
 //  - be careful not to leak any callables, it's NOT safe to delete a callable even if you decide that you don't want the result anymore
 //  - you should deliver any to-be-orphaned callables to the main vector in CGHost so they can be properly deleted when ready even if you don't care about the result anymore
 //  - e.g. if a player does a stats check immediately before a game is deleted you can't just delete the callable on game deletion unless it's ready
+//  - instead of polling GetReady you can attach the callable to a CCallableQueue when you create it and you'll be handed the callable once it's ready
 
 class CBaseCallable
 {
+	friend class CCallableQueue;
+
 protected:
 	string m_Error;
 	volatile bool m_Ready;
 	uint32_t m_StartTicks;
 	uint32_t m_EndTicks;
+	CCallableQueue *m_CompletionQueue;	// the queue this callable is attached to (protected by the CCallableQueue mutex)
 
 public:
-	CBaseCallable( ) : m_Error( ), m_Ready( false ), m_StartTicks( 0 ), m_EndTicks( 0 ) { }
-	virtual ~CBaseCallable( ) { }
+	CBaseCallable( ) : m_Error( ), m_Ready( false ), m_StartTicks( 0 ), m_EndTicks( 0 ), m_CompletionQueue( NULL ) { }
+	virtual ~CBaseCallable( );
 
 	virtual void operator( )( ) { }
 
@@ -217,9 +222,47 @@ public:
 	virtual string GetError( )				{ return m_Error; }
 	virtual bool GetReady( )				{ return m_Ready; }
 	virtual void SetReady( bool nReady )	{ m_Ready = nReady; }
+	virtual void SetError( string nError )	{ m_Error = nError; }
 	virtual uint32_t GetElapsed( )			{ return m_Ready ? m_EndTicks - m_StartTicks : 0; }
 };
 
+//
+// CCallableQueue
+//
+
+// a completion queue for callables
+// the owner attaches each callable to its queue when it's created and the database thread posts the callable to the queue when it becomes ready
+// so the owner only has to look at the callables that actually completed instead of polling every callable it's waiting for
+// Notify is called by the database thread after posting a callable, owners override it to wake up their event loop
+// all the queues share one mutex so callables can move between queues and queues can be deleted while the callables are still running
+// a callable can only be attached to one queue at a time, attaching it to another queue (e.g. when orphaning it) moves it there
+// warning: Notify is called with the mutex locked so it mustn't touch any callable queue
+
+class CCallableQueue
+{
+private:
+	static boost::mutex m_Mutex;
+	set<CBaseCallable *> m_Pending;			// attached callables that aren't ready yet
+	vector<CBaseCallable *> m_Completed;	// attached callables that are ready and haven't been taken by the owner yet
+
+public:
+	CCallableQueue( );
+	virtual ~CCallableQueue( );
+
+	uint32_t GetNumPending( );
+
+	template<class T> T *Attach( T *callable )	{ AttachCallable( callable ); return callable; }
+	void AttachCallable( CBaseCallable *callable );
+	void GetCompleted( vector<CBaseCallable *> &completed );
+	virtual void Notify( ) { }
+
+	static void Complete( CBaseCallable *callable );
+	static void Detach( CBaseCallable *callable );
+
+private:
+	void Remove( CBaseCallable *callable );
+};
+
 class CCallableAdminCount : virtual public CBaseCallable
 {
 protected:
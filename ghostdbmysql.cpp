@@ -53,6 +53,16 @@ CGHostDBMySQL :: CGHostDBMySQL( CConfig *CFG ) : CGHostDB( CFG )
 	m_BotID = CFG->GetInt( "db_mysql_botid", 0 );
 	m_NumConnections = 1;
 	m_OutstandingCallables = 0;
+	m_QueueSize = 0;
+	m_QueuePeak = 0;
+	m_MaxQueueSize = CFG->GetInt( "db_mysql_maxqueue", 2000 );
+	m_NumRejected = 0;
+	m_LastQueueWarningTime = 0;
+	m_Exiting = false;
+	uint32_t NumWorkers = CFG->GetInt( "db_mysql_threads", 8 );
+
+	if( NumWorkers == 0 )
+		NumWorkers = 1;
 
 	mysql_library_init( 0, NULL, NULL );
 
@@ -81,11 +91,67 @@ CGHostDBMySQL :: CGHostDBMySQL( CConfig *CFG ) : CGHostDB( CFG )
 	}
 
 	m_IdleConnections.push( Connection );
+
+	// start the worker threads
+
+	CONSOLE_Print( "[MYSQL] starting " + UTIL_ToString( NumWorkers ) + " database worker threads" );
+
+	for( uint32_t i = 0; i < NumWorkers; ++i )
+	{
+		try
+		{
+			m_Workers.push_back( new boost::thread( &CGHostDBMySQL :: WorkerThread, this ) );
+		}
+		catch( boost :: thread_resource_error tre )
+		{
+			CONSOLE_Print( "[MYSQL] error spawning worker thread #" + UTIL_ToString( i + 1 ) + " [" + string( tre.what( ) ) + "]" );
+			break;
+		}
+	}
+
+	if( m_Workers.empty( ) )
+	{
+		m_HasError = true;
+		m_Error = "error starting MySQL worker threads";
+	}
 }
 
 CGHostDBMySQL :: ~CGHostDBMySQL( )
 {
+	// let the workers finish the callables they're running and wait for them
+	// anything still in the queue is never run, it's marked ready with an error so nobody waits on it forever
+
+	{
+		boost::mutex::scoped_lock lock(m_DatabaseMutex);
+		m_Exiting = true;
+	}
+
+	m_QueueCondition.notify_all( );
+
+	for( vector<boost::thread *> :: iterator i = m_Workers.begin( ); i != m_Workers.end( ); ++i )
+	{
+		(*i)->join( );
+		delete *i;
+	}
+
+	m_Workers.clear( );
+
 	boost::mutex::scoped_lock lock(m_DatabaseMutex);
+
+	if( m_QueueSize > 0 )
+		CONSOLE_Print( "[MYSQL] discarding " + UTIL_ToString( m_QueueSize ) + " queued callables" );
+
+	for( uint32_t i = 0; i < MYSQL_NUM_PRIORITIES; ++i )
+	{
+		while( !m_Queue[i].empty( ) )
+		{
+			m_Queue[i].front( )->SetError( "database is shutting down" );
+			CCallableQueue :: Complete( m_Queue[i].front( ) );
+			m_Queue[i].pop( );
+		}
+	}
+
+	m_QueueSize = 0;
 	CONSOLE_Print( "[MYSQL] closing " + UTIL_ToString( m_IdleConnections.size( ) ) + "/" + UTIL_ToString( m_NumConnections ) + " idle MySQL connections" );
 
 	while( !m_IdleConnections.empty( ) )
@@ -102,11 +168,14 @@ CGHostDBMySQL :: ~CGHostDBMySQL( )
 
 string CGHostDBMySQL :: GetStatus( )
 {
-	return "DB STATUS --- Connections: " + UTIL_ToString( m_IdleConnections.size( ) ) + "/" + UTIL_ToString( m_NumConnections ) + " idle. Outstanding callables: " + UTIL_ToString( m_OutstandingCallables ) + ".";
+	boost::mutex::scoped_lock lock(m_DatabaseMutex);
+	return "DB STATUS --- Connections: " + UTIL_ToString( m_IdleConnections.size( ) ) + "/" + UTIL_ToString( m_NumConnections ) + " idle. Outstanding callables: " + UTIL_ToString( m_OutstandingCallables ) + ". Queued: " + UTIL_ToString( m_QueueSize ) + " (join " + UTIL_ToString( m_Queue[MYSQL_PRIORITY_JOIN].size( ) ) + ", normal " + UTIL_ToString( m_Queue[MYSQL_PRIORITY_NORMAL].size( ) ) + ", stats " + UTIL_ToString( m_Queue[MYSQL_PRIORITY_STATS].size( ) ) + "), peak " + UTIL_ToString( m_QueuePeak ) + ", rejected " + UTIL_ToString( m_NumRejected ) + ". Workers: " + UTIL_ToString( m_Workers.size( ) ) + ".";
 }
 
 void CGHostDBMySQL :: RecoverCallable( CBaseCallable *callable )
 {
+	// the connection has already been given back by the worker thread (see CMySQLCallable :: Close)
+
 	boost::mutex::scoped_lock lock(m_DatabaseMutex);
 	CMySQLCallable *MySQLCallable = dynamic_cast<CMySQLCallable *>( callable );
 
@@ -115,18 +184,10 @@ void CGHostDBMySQL :: RecoverCallable( CBaseCallable *callable )
 		if( !MySQLCallable->GetError( ).empty( ) )
 			CONSOLE_Print( "[MYSQL] error --- " + MySQLCallable->GetError( ) );
 
-		if( m_IdleConnections.size( ) > 8 || !MySQLCallable->GetError( ).empty( ) )
-		{
-			mysql_close( (MYSQL *)MySQLCallable->GetConnection( ) );
-                        --m_NumConnections;
-		}
-		else
-			m_IdleConnections.push( MySQLCallable->GetConnection( ) );
-
 		if( m_OutstandingCallables == 0 )
 			CONSOLE_Print( "[MYSQL] recovered a mysql callable with zero outstanding" );
 		else
-                        --m_OutstandingCallables;
+			--m_OutstandingCallables;
 	}
 	else
 		CONSOLE_Print( "[MYSQL] tried to recover a non-mysql callable" );
@@ -134,492 +195,340 @@ void CGHostDBMySQL :: RecoverCallable( CBaseCallable *callable )
 
 void CGHostDBMySQL :: CreateThread( CBaseCallable *callable )
 {
-	try
+	QueueCallable( callable, MYSQL_PRIORITY_NORMAL );
+}
+
+void CGHostDBMySQL :: QueueCallable( CBaseCallable *callable, uint32_t priority )
+{
+	if( priority >= MYSQL_NUM_PRIORITIES )
+		priority = MYSQL_NUM_PRIORITIES - 1;
+
+	boost::mutex::scoped_lock lock(m_DatabaseMutex);
+	++m_OutstandingCallables;
+
+	// backpressure: when the database can't keep up we fail new callables straight away instead of queueing them forever
+	// callers already have to handle errors so this just looks like a failed query to them
+	// stats callables are exempt, rejecting one would lose a game's records for good and they're only queued when a game ends so they can't pile up like lookups can
+
+	uint32_t NumReads = m_Queue[MYSQL_PRIORITY_JOIN].size( ) + m_Queue[MYSQL_PRIORITY_NORMAL].size( );
+
+	if( m_Workers.empty( ) || m_Exiting || ( priority != MYSQL_PRIORITY_STATS && NumReads >= m_MaxQueueSize ) )
 	{
-		boost :: thread Thread( boost :: ref( *callable ) );
+		++m_NumRejected;
+		callable->SetError( m_Workers.empty( ) || m_Exiting ? "database is not running" : "database queue is full" );
+		CCallableQueue :: Complete( callable );
+		return;
 	}
-	catch( boost :: thread_resource_error tre )
+
+	m_Queue[priority].push( callable );
+	++m_QueueSize;
+
+	if( m_QueueSize > m_QueuePeak )
+		m_QueuePeak = m_QueueSize;
+
+	if( ( NumReads >= m_MaxQueueSize / 2 || m_Queue[MYSQL_PRIORITY_STATS].size( ) >= m_MaxQueueSize / 2 ) && GetTime( ) - m_LastQueueWarningTime >= 60 )
 	{
-		CONSOLE_Print( "[MYSQL] error spawning thread on attempt #1 [" + string( tre.what( ) ) + "], pausing execution and trying again in 50ms" );
-		MILLISLEEP( 50 );
+		CONSOLE_Print( "[MYSQL] warning - " + UTIL_ToString( m_QueueSize ) + " callables are waiting for a database worker (" + UTIL_ToString( m_Queue[MYSQL_PRIORITY_STATS].size( ) ) + " stats, limit " + UTIL_ToString( m_MaxQueueSize ) + " for the rest)" );
+		m_LastQueueWarningTime = GetTime( );
+	}
+
+	lock.unlock( );
+	m_QueueCondition.notify_one( );
+}
+
+void CGHostDBMySQL :: WorkerThread( )
+{
+#ifndef WIN32
+	// disable SIGPIPE since this is a new thread and it doesn't inherit the spawning thread's signal handlers
+	// MySQL should automatically disable SIGPIPE when we initialize it but we do so anyway here
+
+	signal( SIGPIPE, SIG_IGN );
+#endif
+
+	mysql_thread_init( );
+
+	while( true )
+	{
+		CBaseCallable *Callable = NULL;
 
-		try
-		{
-			boost :: thread Thread( boost :: ref( *callable ) );
-		}
-		catch( boost :: thread_resource_error tre2 )
 		{
-			CONSOLE_Print( "[MYSQL] error spawning thread on attempt #2 [" + string( tre2.what( ) ) + "], giving up" );
-			callable->SetReady( true );
+			boost::mutex::scoped_lock lock(m_DatabaseMutex);
+
+			while( !m_Exiting && m_QueueSize == 0 )
+				m_QueueCondition.wait( lock );
+
+			if( m_Exiting )
+				break;
+
+			for( uint32_t i = 0; i < MYSQL_NUM_PRIORITIES && !Callable; ++i )
+			{
+				if( !m_Queue[i].empty( ) )
+				{
+					Callable = m_Queue[i].front( );
+					m_Queue[i].pop( );
+				}
+			}
+
+			--m_QueueSize;
 		}
+
+		// the callable is marked ready at the end of this call and may be deleted by the main thread at any time afterwards so don't touch it again
+
+		( *Callable )( );
 	}
+
+	mysql_thread_end( );
 }
 
 CCallableAdminCount *CGHostDBMySQL :: ThreadedAdminCount( string server )
 {
-	void *Connection = GetIdleConnection( );
-
-	if( !Connection )
-                ++m_NumConnections;
-
-	CCallableAdminCount *Callable = new CMySQLCallableAdminCount( server, Connection, m_BotID, m_Server, m_Database, m_User, m_Password, m_Port, this );
-	CreateThread( Callable );
-        ++m_OutstandingCallables;
+	CCallableAdminCount *Callable = new CMySQLCallableAdminCount( server, NULL, m_BotID, m_Server, m_Database, m_User, m_Password, m_Port, this );
+	QueueCallable( Callable, MYSQL_PRIORITY_NORMAL );
 	return Callable;
 }
 
 CCallableAdminCheck *CGHostDBMySQL :: ThreadedAdminCheck( string server, string user )
 {
-	void *Connection = GetIdleConnection( );
-
-	if( !Connection )
-                ++m_NumConnections;
-
-	CCallableAdminCheck *Callable = new CMySQLCallableAdminCheck( server, user, Connection, m_BotID, m_Server, m_Database, m_User, m_Password, m_Port, this );
-	CreateThread( Callable );
-        ++m_OutstandingCallables;
+	CCallableAdminCheck *Callable = new CMySQLCallableAdminCheck( server, user, NULL, m_BotID, m_Server, m_Database, m_User, m_Password, m_Port, this );
+	QueueCallable( Callable, MYSQL_PRIORITY_JOIN );
 	return Callable;
 }
 
 CCallableAdminAdd *CGHostDBMySQL :: ThreadedAdminAdd( string server, string user )
 {
-	void *Connection = GetIdleConnection( );
-
-	if( !Connection )
-                ++m_NumConnections;
-
-	CCallableAdminAdd *Callable = new CMySQLCallableAdminAdd( server, user, Connection, m_BotID, m_Server, m_Database, m_User, m_Password, m_Port, this );
-	CreateThread( Callable );
-        ++m_OutstandingCallables;
+	CCallableAdminAdd *Callable = new CMySQLCallableAdminAdd( server, user, NULL, m_BotID, m_Server, m_Database, m_User, m_Password, m_Port, this );
+	QueueCallable( Callable, MYSQL_PRIORITY_NORMAL );
 	return Callable;
 }
 
 CCallableAdminRemove *CGHostDBMySQL :: ThreadedAdminRemove( string server, string user )
 {
-	void *Connection = GetIdleConnection( );
-
-	if( !Connection )
-                ++m_NumConnections;
-
-	CCallableAdminRemove *Callable = new CMySQLCallableAdminRemove( server, user, Connection, m_BotID, m_Server, m_Database, m_User, m_Password, m_Port, this );
-	CreateThread( Callable );
-        ++m_OutstandingCallables;
+	CCallableAdminRemove *Callable = new CMySQLCallableAdminRemove( server, user, NULL, m_BotID, m_Server, m_Database, m_User, m_Password, m_Port, this );
+	QueueCallable( Callable, MYSQL_PRIORITY_NORMAL );
 	return Callable;
 }
 
 CCallableAdminList *CGHostDBMySQL :: ThreadedAdminList( string server )
 {
-	void *Connection = GetIdleConnection( );
-
-	if( !Connection )
-                ++m_NumConnections;
-
-	CCallableAdminList *Callable = new CMySQLCallableAdminList( server, Connection, m_BotID, m_Server, m_Database, m_User, m_Password, m_Port, this );
-	CreateThread( Callable );
-        ++m_OutstandingCallables;
+	CCallableAdminList *Callable = new CMySQLCallableAdminList( server, NULL, m_BotID, m_Server, m_Database, m_User, m_Password, m_Port, this );
+	QueueCallable( Callable, MYSQL_PRIORITY_NORMAL );
 	return Callable;
 }
 
 CCallableBanCount *CGHostDBMySQL :: ThreadedBanCount( string server )
 {
-	void *Connection = GetIdleConnection( );
-
-	if( !Connection )
-                ++m_NumConnections;
-
-	CCallableBanCount *Callable = new CMySQLCallableBanCount( server, Connection, m_BotID, m_Server, m_Database, m_User, m_Password, m_Port, this );
-	CreateThread( Callable );
-        ++m_OutstandingCallables;
+	CCallableBanCount *Callable = new CMySQLCallableBanCount( server, NULL, m_BotID, m_Server, m_Database, m_User, m_Password, m_Port, this );
+	QueueCallable( Callable, MYSQL_PRIORITY_NORMAL );
 	return Callable;
 }
 
 CCallableBanCheck *CGHostDBMySQL :: ThreadedBanCheck( string server, string user, string ip, string hostname, string ownername )
 {
-	void *Connection = GetIdleConnection( );
-
-	if( !Connection )
-                ++m_NumConnections;
-
-	CCallableBanCheck *Callable = new CMySQLCallableBanCheck( server, user, ip, hostname, ownername, Connection, m_BotID, m_Server, m_Database, m_User, m_Password, m_Port, this );
-	CreateThread( Callable );
-        ++m_OutstandingCallables;
+	CCallableBanCheck *Callable = new CMySQLCallableBanCheck( server, user, ip, hostname, ownername, NULL, m_BotID, m_Server, m_Database, m_User, m_Password, m_Port, this );
+	QueueCallable( Callable, MYSQL_PRIORITY_JOIN );
 	return Callable;
 }
 
 CCallableBanAdd *CGHostDBMySQL :: ThreadedBanAdd( string server, string user, string ip, string gamename, string admin, string reason, uint32_t expiretime, string context )
 {
-	void *Connection = GetIdleConnection( );
-
-	if( !Connection )
-                ++m_NumConnections;
-
-	CCallableBanAdd *Callable = new CMySQLCallableBanAdd( server, user, ip, gamename, admin, reason, expiretime, context, Connection, m_BotID, m_Server, m_Database, m_User, m_Password, m_Port, this );
-	CreateThread( Callable );
-        ++m_OutstandingCallables;
+	CCallableBanAdd *Callable = new CMySQLCallableBanAdd( server, user, ip, gamename, admin, reason, expiretime, context, NULL, m_BotID, m_Server, m_Database, m_User, m_Password, m_Port, this );
+	QueueCallable( Callable, MYSQL_PRIORITY_NORMAL );
 	return Callable;
 }
 
 CCallableBanRemove *CGHostDBMySQL :: ThreadedBanRemove( string server, string user, string context )
 {
-	void *Connection = GetIdleConnection( );
-
-	if( !Connection )
-                ++m_NumConnections;
-
-	CCallableBanRemove *Callable = new CMySQLCallableBanRemove( server, user, context, Connection, m_BotID, m_Server, m_Database, m_User, m_Password, m_Port, this );
-	CreateThread( Callable );
-        ++m_OutstandingCallables;
+	CCallableBanRemove *Callable = new CMySQLCallableBanRemove( server, user, context, NULL, m_BotID, m_Server, m_Database, m_User, m_Password, m_Port, this );
+	QueueCallable( Callable, MYSQL_PRIORITY_NORMAL );
 	return Callable;
 }
 
 CCallableBanRemove *CGHostDBMySQL :: ThreadedBanRemove( string user, string context )
 {
-	void *Connection = GetIdleConnection( );
-
-	if( !Connection )
-                ++m_NumConnections;
-
-	CCallableBanRemove *Callable = new CMySQLCallableBanRemove( string( ), user, context, Connection, m_BotID, m_Server, m_Database, m_User, m_Password, m_Port, this );
-	CreateThread( Callable );
-        ++m_OutstandingCallables;
+	CCallableBanRemove *Callable = new CMySQLCallableBanRemove( string( ), user, context, NULL, m_BotID, m_Server, m_Database, m_User, m_Password, m_Port, this );
+	QueueCallable( Callable, MYSQL_PRIORITY_NORMAL );
 	return Callable;
 }
 
 CCallableSpoofList *CGHostDBMySQL :: ThreadedSpoofList( )
 {
-	void *Connection = GetIdleConnection( );
-
-	if( !Connection )
-                ++m_NumConnections;
-
-	CCallableSpoofList *Callable = new CMySQLCallableSpoofList( Connection, m_BotID, m_Server, m_Database, m_User, m_Password, m_Port, this );
-	CreateThread( Callable );
-        ++m_OutstandingCallables;
+	CCallableSpoofList *Callable = new CMySQLCallableSpoofList( NULL, m_BotID, m_Server, m_Database, m_User, m_Password, m_Port, this );
+	QueueCallable( Callable, MYSQL_PRIORITY_NORMAL );
 	return Callable;
 }
 
 CCallableReconUpdate *CGHostDBMySQL :: ThreadedReconUpdate( uint32_t hostcounter, uint32_t seconds )
 {
-	void *Connection = GetIdleConnection( );
-
-	if( !Connection )
-		++m_NumConnections;
-
-	CCallableReconUpdate *Callable = new CMySQLCallableReconUpdate( hostcounter, seconds, Connection, m_BotID, m_Server, m_Database, m_User, m_Password, m_Port, this );
-	CreateThread( Callable );
-	++m_OutstandingCallables;
+	CCallableReconUpdate *Callable = new CMySQLCallableReconUpdate( hostcounter, seconds, NULL, m_BotID, m_Server, m_Database, m_User, m_Password, m_Port, this );
+	QueueCallable( Callable, MYSQL_PRIORITY_STATS );
 	return Callable;
 }
 
 CCallableCommandList *CGHostDBMySQL :: ThreadedCommandList( )
 {
-	void *Connection = GetIdleConnection( );
-
-	if( !Connection )
-                ++m_NumConnections;
-
-	CCallableCommandList *Callable = new CMySQLCallableCommandList( Connection, m_BotID, m_Server, m_Database, m_User, m_Password, m_Port, this );
-	CreateThread( Callable );
-        ++m_OutstandingCallables;
+	CCallableCommandList *Callable = new CMySQLCallableCommandList( NULL, m_BotID, m_Server, m_Database, m_User, m_Password, m_Port, this );
+	QueueCallable( Callable, MYSQL_PRIORITY_NORMAL );
 	return Callable;
 }
 
 CCallableGameAdd *CGHostDBMySQL :: ThreadedGameAdd( string server, string map, string gamename, string ownername, uint32_t duration, uint32_t gamestate, string creatorname, string creatorserver, string savetype )
 {
-	void *Connection = GetIdleConnection( );
-
-	if( !Connection )
-                ++m_NumConnections;
-
-	CCallableGameAdd *Callable = new CMySQLCallableGameAdd( server, map, gamename, ownername, duration, gamestate, creatorname, creatorserver, savetype, Connection, m_BotID, m_Server, m_Database, m_User, m_Password, m_Port, this );
-	CreateThread( Callable );
-        ++m_OutstandingCallables;
+	CCallableGameAdd *Callable = new CMySQLCallableGameAdd( server, map, gamename, ownername, duration, gamestate, creatorname, creatorserver, savetype, NULL, m_BotID, m_Server, m_Database, m_User, m_Password, m_Port, this );
+	QueueCallable( Callable, MYSQL_PRIORITY_STATS );
 	return Callable;
 }
 
 CCallableGameUpdate *CGHostDBMySQL :: ThreadedGameUpdate( uint32_t id, string map, string gamename, string ownername, string creatorname, uint32_t players, string usernames, uint32_t slotsTotal, uint32_t totalGames, uint32_t totalPlayers, bool add )
 {
-	void *Connection = GetIdleConnection( );
-
-	if( !Connection )
-                ++m_NumConnections;
-
-	CCallableGameUpdate *Callable = new CMySQLCallableGameUpdate( id, map, gamename, ownername, creatorname, players, usernames, slotsTotal, totalGames, totalPlayers, add, Connection, m_BotID, m_Server, m_Database, m_User, m_Password, m_Port, this );
-	CreateThread( Callable );
-        ++m_OutstandingCallables;
+	CCallableGameUpdate *Callable = new CMySQLCallableGameUpdate( id, map, gamename, ownername, creatorname, players, usernames, slotsTotal, totalGames, totalPlayers, add, NULL, m_BotID, m_Server, m_Database, m_User, m_Password, m_Port, this );
+	QueueCallable( Callable, MYSQL_PRIORITY_NORMAL );
 	return Callable;
 }
 
 CCallableGamePlayerAdd *CGHostDBMySQL :: ThreadedGamePlayerAdd( uint32_t gameid, string name, string ip, uint32_t spoofed, string spoofedrealm, uint32_t reserved, uint32_t loadingtime, uint32_t left, string leftreason, uint32_t team, uint32_t colour, string savetype )
 {
-	void *Connection = GetIdleConnection( );
-
-	if( !Connection )
-                ++m_NumConnections;
-
-	CCallableGamePlayerAdd *Callable = new CMySQLCallableGamePlayerAdd( gameid, name, ip, spoofed, spoofedrealm, reserved, loadingtime, left, leftreason, team, colour, savetype, Connection, m_BotID, m_Server, m_Database, m_User, m_Password, m_Port, this );
-	CreateThread( Callable );
-        ++m_OutstandingCallables;
+	CCallableGamePlayerAdd *Callable = new CMySQLCallableGamePlayerAdd( gameid, name, ip, spoofed, spoofedrealm, reserved, loadingtime, left, leftreason, team, colour, savetype, NULL, m_BotID, m_Server, m_Database, m_User, m_Password, m_Port, this );
+	QueueCallable( Callable, MYSQL_PRIORITY_STATS );
 	return Callable;
 }
 
 CCallableGamePlayerSummaryCheck *CGHostDBMySQL :: ThreadedGamePlayerSummaryCheck( string name, string realm )
 {
-	void *Connection = GetIdleConnection( );
-
-	if( !Connection )
-                ++m_NumConnections;
-
-	CCallableGamePlayerSummaryCheck *Callable = new CMySQLCallableGamePlayerSummaryCheck( name, realm, Connection, m_BotID, m_Server, m_Database, m_User, m_Password, m_Port, this );
-	CreateThread( Callable );
-        ++m_OutstandingCallables;
+	CCallableGamePlayerSummaryCheck *Callable = new CMySQLCallableGamePlayerSummaryCheck( name, realm, NULL, m_BotID, m_Server, m_Database, m_User, m_Password, m_Port, this );
+	QueueCallable( Callable, MYSQL_PRIORITY_NORMAL );
 	return Callable;
 }
 
 CCallableVampPlayerSummaryCheck *CGHostDBMySQL :: ThreadedVampPlayerSummaryCheck( string name )
 {
-	void *Connection = GetIdleConnection( );
-
-	if( !Connection )
-                ++m_NumConnections;
-
-	CCallableVampPlayerSummaryCheck *Callable = new CMySQLCallableVampPlayerSummaryCheck( name, Connection, m_BotID, m_Server, m_Database, m_User, m_Password, m_Port, this );
-	CreateThread( Callable );
-        ++m_OutstandingCallables;
+	CCallableVampPlayerSummaryCheck *Callable = new CMySQLCallableVampPlayerSummaryCheck( name, NULL, m_BotID, m_Server, m_Database, m_User, m_Password, m_Port, this );
+	QueueCallable( Callable, MYSQL_PRIORITY_NORMAL );
 	return Callable;
 }
 
 CCallableDotAGameAdd *CGHostDBMySQL :: ThreadedDotAGameAdd( uint32_t gameid, uint32_t winner, uint32_t min, uint32_t sec, string saveType )
 {
-	void *Connection = GetIdleConnection( );
-
-	if( !Connection )
-                ++m_NumConnections;
-
-	CCallableDotAGameAdd *Callable = new CMySQLCallableDotAGameAdd( gameid, winner, min, sec, saveType, Connection, m_BotID, m_Server, m_Database, m_User, m_Password, m_Port, this );
-	CreateThread( Callable );
-        ++m_OutstandingCallables;
+	CCallableDotAGameAdd *Callable = new CMySQLCallableDotAGameAdd( gameid, winner, min, sec, saveType, NULL, m_BotID, m_Server, m_Database, m_User, m_Password, m_Port, this );
+	QueueCallable( Callable, MYSQL_PRIORITY_STATS );
 	return Callable;
 }
 
 CCallableDotAPlayerAdd *CGHostDBMySQL :: ThreadedDotAPlayerAdd( uint32_t gameid, uint32_t colour, uint32_t kills, uint32_t deaths, uint32_t creepkills, uint32_t creepdenies, uint32_t assists, uint32_t gold, uint32_t neutralkills, string item1, string item2, string item3, string item4, string item5, string item6, string hero, uint32_t newcolour, uint32_t towerkills, uint32_t raxkills, uint32_t courierkills, string saveType )
 {
-	void *Connection = GetIdleConnection( );
-
-	if( !Connection )
-                ++m_NumConnections;
-
-	CCallableDotAPlayerAdd *Callable = new CMySQLCallableDotAPlayerAdd( gameid, colour, kills, deaths, creepkills, creepdenies, assists, gold, neutralkills, item1, item2, item3, item4, item5, item6, hero, newcolour, towerkills, raxkills, courierkills, saveType, Connection, m_BotID, m_Server, m_Database, m_User, m_Password, m_Port, this );
-	CreateThread( Callable );
-        ++m_OutstandingCallables;
+	CCallableDotAPlayerAdd *Callable = new CMySQLCallableDotAPlayerAdd( gameid, colour, kills, deaths, creepkills, creepdenies, assists, gold, neutralkills, item1, item2, item3, item4, item5, item6, hero, newcolour, towerkills, raxkills, courierkills, saveType, NULL, m_BotID, m_Server, m_Database, m_User, m_Password, m_Port, this );
+	QueueCallable( Callable, MYSQL_PRIORITY_STATS );
 	return Callable;
 }
 
 CCallableDotAPlayerSummaryCheck *CGHostDBMySQL :: ThreadedDotAPlayerSummaryCheck( string name, string realm, string saveType )
 {
-	void *Connection = GetIdleConnection( );
-
-	if( !Connection )
-                ++m_NumConnections;
-
-	CCallableDotAPlayerSummaryCheck *Callable = new CMySQLCallableDotAPlayerSummaryCheck( name, realm, saveType, Connection, m_BotID, m_Server, m_Database, m_User, m_Password, m_Port, this );
-	CreateThread( Callable );
-        ++m_OutstandingCallables;
+	CCallableDotAPlayerSummaryCheck *Callable = new CMySQLCallableDotAPlayerSummaryCheck( name, realm, saveType, NULL, m_BotID, m_Server, m_Database, m_User, m_Password, m_Port, this );
+	QueueCallable( Callable, MYSQL_PRIORITY_NORMAL );
 	return Callable;
 }
 
 CCallableTreePlayerSummaryCheck *CGHostDBMySQL :: ThreadedTreePlayerSummaryCheck( string name, string realm )
 {
-	void *Connection = GetIdleConnection( );
-
-	if( !Connection )
-                ++m_NumConnections;
-
-	CCallableTreePlayerSummaryCheck *Callable = new CMySQLCallableTreePlayerSummaryCheck( name, realm, Connection, m_BotID, m_Server, m_Database, m_User, m_Password, m_Port, this );
-	CreateThread( Callable );
-        ++m_OutstandingCallables;
+	CCallableTreePlayerSummaryCheck *Callable = new CMySQLCallableTreePlayerSummaryCheck( name, realm, NULL, m_BotID, m_Server, m_Database, m_User, m_Password, m_Port, this );
+	QueueCallable( Callable, MYSQL_PRIORITY_NORMAL );
 	return Callable;
 }
 
 CCallableSnipePlayerSummaryCheck *CGHostDBMySQL :: ThreadedSnipePlayerSummaryCheck( string name, string realm )
 {
-	void *Connection = GetIdleConnection( );
-
-	if( !Connection )
-                ++m_NumConnections;
-
-	CCallableSnipePlayerSummaryCheck *Callable = new CMySQLCallableSnipePlayerSummaryCheck( name, realm, Connection, m_BotID, m_Server, m_Database, m_User, m_Password, m_Port, this );
-	CreateThread( Callable );
-        ++m_OutstandingCallables;
+	CCallableSnipePlayerSummaryCheck *Callable = new CMySQLCallableSnipePlayerSummaryCheck( name, realm, NULL, m_BotID, m_Server, m_Database, m_User, m_Password, m_Port, this );
+	QueueCallable( Callable, MYSQL_PRIORITY_NORMAL );
 	return Callable;
 }
 
 CCallableShipsPlayerSummaryCheck *CGHostDBMySQL :: ThreadedShipsPlayerSummaryCheck( string name, string realm )
 {
-	void *Connection = GetIdleConnection( );
-
-	if( !Connection )
-                ++m_NumConnections;
-
-	CCallableShipsPlayerSummaryCheck *Callable = new CMySQLCallableShipsPlayerSummaryCheck( name, realm, Connection, m_BotID, m_Server, m_Database, m_User, m_Password, m_Port, this );
-	CreateThread( Callable );
-        ++m_OutstandingCallables;
+	CCallableShipsPlayerSummaryCheck *Callable = new CMySQLCallableShipsPlayerSummaryCheck( name, realm, NULL, m_BotID, m_Server, m_Database, m_User, m_Password, m_Port, this );
+	QueueCallable( Callable, MYSQL_PRIORITY_NORMAL );
 	return Callable;
 }
 
 CCallableW3MMDPlayerSummaryCheck *CGHostDBMySQL :: ThreadedW3MMDPlayerSummaryCheck( string name, string realm, string category )
 {
-	void *Connection = GetIdleConnection( );
-
-	if( !Connection )
-                ++m_NumConnections;
-
-	CCallableW3MMDPlayerSummaryCheck *Callable = new CMySQLCallableW3MMDPlayerSummaryCheck( name, realm, category, Connection, m_BotID, m_Server, m_Database, m_User, m_Password, m_Port, this );
-	CreateThread( Callable );
-        ++m_OutstandingCallables;
+	CCallableW3MMDPlayerSummaryCheck *Callable = new CMySQLCallableW3MMDPlayerSummaryCheck( name, realm, category, NULL, m_BotID, m_Server, m_Database, m_User, m_Password, m_Port, this );
+	QueueCallable( Callable, MYSQL_PRIORITY_NORMAL );
 	return Callable;
 }
 
 CCallableDownloadAdd *CGHostDBMySQL :: ThreadedDownloadAdd( string map, uint32_t mapsize, string name, string ip, uint32_t spoofed, string spoofedrealm, uint32_t downloadtime )
 {
-	void *Connection = GetIdleConnection( );
-
-	if( !Connection )
-                ++m_NumConnections;
-
-	CCallableDownloadAdd *Callable = new CMySQLCallableDownloadAdd( map, mapsize, name, ip, spoofed, spoofedrealm, downloadtime, Connection, m_BotID, m_Server, m_Database, m_User, m_Password, m_Port, this );
-	CreateThread( Callable );
-        ++m_OutstandingCallables;
+	CCallableDownloadAdd *Callable = new CMySQLCallableDownloadAdd( map, mapsize, name, ip, spoofed, spoofedrealm, downloadtime, NULL, m_BotID, m_Server, m_Database, m_User, m_Password, m_Port, this );
+	QueueCallable( Callable, MYSQL_PRIORITY_STATS );
 	return Callable;
 }
 
 CCallableConnectCheck *CGHostDBMySQL :: ThreadedConnectCheck( string name, uint32_t sessionkey )
 {
-	void *Connection = GetIdleConnection( );
-
-	if( !Connection )
-                ++m_NumConnections;
-
-	CCallableConnectCheck *Callable = new CMySQLCallableConnectCheck( name, sessionkey, Connection, m_BotID, m_Server, m_Database, m_User, m_Password, m_Port, this );
-	CreateThread( Callable );
-        ++m_OutstandingCallables;
+	CCallableConnectCheck *Callable = new CMySQLCallableConnectCheck( name, sessionkey, NULL, m_BotID, m_Server, m_Database, m_User, m_Password, m_Port, this );
+	QueueCallable( Callable, MYSQL_PRIORITY_JOIN );
 	return Callable;
 }
 
 CCallableScoreCheck *CGHostDBMySQL :: ThreadedScoreCheck( string category, string name, string server )
 {
-	void *Connection = GetIdleConnection( );
-
-	if( !Connection )
-                ++m_NumConnections;
-
-	CCallableScoreCheck *Callable = new CMySQLCallableScoreCheck( category, name, server, Connection, m_BotID, m_Server, m_Database, m_User, m_Password, m_Port, this );
-	CreateThread( Callable );
-        ++m_OutstandingCallables;
+	CCallableScoreCheck *Callable = new CMySQLCallableScoreCheck( category, name, server, NULL, m_BotID, m_Server, m_Database, m_User, m_Password, m_Port, this );
+	QueueCallable( Callable, MYSQL_PRIORITY_JOIN );
 	return Callable;
 }
 
 CCallableLeagueCheck *CGHostDBMySQL :: ThreadedLeagueCheck( string category, string name, string server, string gamename )
 {
-	void *Connection = GetIdleConnection( );
-
-	if( !Connection )
-                ++m_NumConnections;
-
-	CCallableLeagueCheck *Callable = new CMySQLCallableLeagueCheck( category, name, server, gamename, Connection, m_BotID, m_Server, m_Database, m_User, m_Password, m_Port, this );
-	CreateThread( Callable );
-        ++m_OutstandingCallables;
+	CCallableLeagueCheck *Callable = new CMySQLCallableLeagueCheck( category, name, server, gamename, NULL, m_BotID, m_Server, m_Database, m_User, m_Password, m_Port, this );
+	QueueCallable( Callable, MYSQL_PRIORITY_JOIN );
 	return Callable;
 }
 
 CCallableGetTournament *CGHostDBMySQL :: ThreadedGetTournament( string gamename )
 {
-	void *Connection = GetIdleConnection( );
-
-	if( !Connection )
-                ++m_NumConnections;
-
-	CCallableGetTournament *Callable = new CMySQLCallableGetTournament( gamename, Connection, m_BotID, m_Server, m_Database, m_User, m_Password, m_Port, this );
-	CreateThread( Callable );
-        ++m_OutstandingCallables;
+	CCallableGetTournament *Callable = new CMySQLCallableGetTournament( gamename, NULL, m_BotID, m_Server, m_Database, m_User, m_Password, m_Port, this );
+	QueueCallable( Callable, MYSQL_PRIORITY_NORMAL );
 	return Callable;
 }
 
 CCallableTournamentChat *CGHostDBMySQL :: ThreadedTournamentChat( uint32_t chatid, string message )
 {
-	void *Connection = GetIdleConnection( );
-
-	if( !Connection )
-                ++m_NumConnections;
-
-	CCallableTournamentChat *Callable = new CMySQLCallableTournamentChat( chatid, message, Connection, m_BotID, m_Server, m_Database, m_User, m_Password, m_Port, this );
-	CreateThread( Callable );
-        ++m_OutstandingCallables;
+	CCallableTournamentChat *Callable = new CMySQLCallableTournamentChat( chatid, message, NULL, m_BotID, m_Server, m_Database, m_User, m_Password, m_Port, this );
+	QueueCallable( Callable, MYSQL_PRIORITY_NORMAL );
 	return Callable;
 }
 
 CCallableTournamentUpdate *CGHostDBMySQL :: ThreadedTournamentUpdate( uint32_t matchid, string gamename, uint32_t status )
 {
-	void *Connection = GetIdleConnection( );
-
-	if( !Connection )
-                ++m_NumConnections;
-
-	CCallableTournamentUpdate *Callable = new CMySQLCallableTournamentUpdate( matchid, gamename, status, Connection, m_BotID, m_Server, m_Database, m_User, m_Password, m_Port, this );
-	CreateThread( Callable );
-        ++m_OutstandingCallables;
+	CCallableTournamentUpdate *Callable = new CMySQLCallableTournamentUpdate( matchid, gamename, status, NULL, m_BotID, m_Server, m_Database, m_User, m_Password, m_Port, this );
+	QueueCallable( Callable, MYSQL_PRIORITY_NORMAL );
 	return Callable;
 }
 
 CCallableW3MMDPlayerAdd *CGHostDBMySQL :: ThreadedW3MMDPlayerAdd( string category, uint32_t gameid, uint32_t pid, string name, string flag, uint32_t leaver, uint32_t practicing, string saveType )
 {
-	void *Connection = GetIdleConnection( );
-
-	if( !Connection )
-                ++m_NumConnections;
-
-	CCallableW3MMDPlayerAdd *Callable = new CMySQLCallableW3MMDPlayerAdd( category, gameid, pid, name, flag, leaver, practicing, saveType, Connection, m_BotID, m_Server, m_Database, m_User, m_Password, m_Port, this );
-	CreateThread( Callable );
-        ++m_OutstandingCallables;
+	CCallableW3MMDPlayerAdd *Callable = new CMySQLCallableW3MMDPlayerAdd( category, gameid, pid, name, flag, leaver, practicing, saveType, NULL, m_BotID, m_Server, m_Database, m_User, m_Password, m_Port, this );
+	QueueCallable( Callable, MYSQL_PRIORITY_STATS );
 	return Callable;
 }
 
 CCallableW3MMDVarAdd *CGHostDBMySQL :: ThreadedW3MMDVarAdd( uint32_t gameid, map<VarP,int32_t> var_ints, string saveType )
 {
-	void *Connection = GetIdleConnection( );
-
-	if( !Connection )
-                ++m_NumConnections;
-
-	CCallableW3MMDVarAdd *Callable = new CMySQLCallableW3MMDVarAdd( gameid, var_ints, saveType, Connection, m_BotID, m_Server, m_Database, m_User, m_Password, m_Port, this );
-	CreateThread( Callable );
-        ++m_OutstandingCallables;
+	CCallableW3MMDVarAdd *Callable = new CMySQLCallableW3MMDVarAdd( gameid, var_ints, saveType, NULL, m_BotID, m_Server, m_Database, m_User, m_Password, m_Port, this );
+	QueueCallable( Callable, MYSQL_PRIORITY_STATS );
 	return Callable;
 }
 
 CCallableW3MMDVarAdd *CGHostDBMySQL :: ThreadedW3MMDVarAdd( uint32_t gameid, map<VarP,double> var_reals, string saveType )
 {
-	void *Connection = GetIdleConnection( );
-
-	if( !Connection )
-                ++m_NumConnections;
-
-	CCallableW3MMDVarAdd *Callable = new CMySQLCallableW3MMDVarAdd( gameid, var_reals, saveType, Connection, m_BotID, m_Server, m_Database, m_User, m_Password, m_Port, this );
-	CreateThread( Callable );
-        ++m_OutstandingCallables;
+	CCallableW3MMDVarAdd *Callable = new CMySQLCallableW3MMDVarAdd( gameid, var_reals, saveType, NULL, m_BotID, m_Server, m_Database, m_User, m_Password, m_Port, this );
+	QueueCallable( Callable, MYSQL_PRIORITY_STATS );
 	return Callable;
 }
 
 CCallableW3MMDVarAdd *CGHostDBMySQL :: ThreadedW3MMDVarAdd( uint32_t gameid, map<VarP,string> var_strings, string saveType )
 {
-	void *Connection = GetIdleConnection( );
-
-	if( !Connection )
-                ++m_NumConnections;
-
-	CCallableW3MMDVarAdd *Callable = new CMySQLCallableW3MMDVarAdd( gameid, var_strings, saveType, Connection, m_BotID, m_Server, m_Database, m_User, m_Password, m_Port, this );
-	CreateThread( Callable );
-        ++m_OutstandingCallables;
+	CCallableW3MMDVarAdd *Callable = new CMySQLCallableW3MMDVarAdd( gameid, var_strings, saveType, NULL, m_BotID, m_Server, m_Database, m_User, m_Password, m_Port, this );
+	QueueCallable( Callable, MYSQL_PRIORITY_STATS );
 	return Callable;
 }
 
@@ -637,6 +546,49 @@ void *CGHostDBMySQL :: GetIdleConnection( )
 	return Connection;
 }
 
+void *CGHostDBMySQL :: CreateConnection( string *error )
+{
+	// every worker holds at most one connection so we only get here when all the idle ones are in use by other workers
+
+	{
+		boost::mutex::scoped_lock lock(m_DatabaseMutex);
+		++m_NumConnections;
+	}
+
+	MYSQL *Connection = NULL;
+
+	if( !( Connection = mysql_init( NULL ) ) )
+	{
+		*error = "error initializing MySQL connection";
+		return NULL;
+	}
+
+	my_bool Reconnect = true;
+	mysql_options( Connection, MYSQL_OPT_RECONNECT, &Reconnect );
+
+	if( !( mysql_real_connect( Connection, m_Server.c_str( ), m_User.c_str( ), m_Password.c_str( ), m_Database.c_str( ), m_Port, NULL, 0 ) ) )
+		*error = mysql_error( Connection );
+
+	return Connection;
+}
+
+void CGHostDBMySQL :: ReleaseConnection( void *connection, bool error )
+{
+	// connections that had an error are closed rather than reused, the next callable will open a fresh one
+
+	boost::mutex::scoped_lock lock(m_DatabaseMutex);
+
+	if( !connection || error )
+	{
+		if( connection )
+			mysql_close( (MYSQL *)connection );
+
+		--m_NumConnections;
+	}
+	else
+		m_IdleConnections.push( connection );
+}
+
 //
 // unprototyped global helper functions
 //
@@ -2225,45 +2177,24 @@ void CMySQLCallable :: Init( )
 {
 	CBaseCallable :: Init( );
 
-#ifndef WIN32
-	// disable SIGPIPE since this is (or should be) a new thread and it doesn't inherit the spawning thread's signal handlers
-	// MySQL should automatically disable SIGPIPE when we initialize it but we do so anyway here
-
-	signal( SIGPIPE, SIG_IGN );
-#endif
-
-	mysql_thread_init( );
+	// callables are run by the database worker threads which have already initialized the MySQL thread state
+	// the connection is picked up here rather than when the callable is queued so a callable waiting in the queue doesn't tie one up
 
 	if( !m_Connection )
-	{
-		// try again to get idle connection
-		for( unsigned int i = 0; i < 3 && !m_Connection; i++ )
-		{
-			CONSOLE_Print( "[MYSQL] No connection yet, trying again (" + UTIL_ToString( i + 1 ) + ")" );
-			MILLISLEEP( rand() % 1000 + 300 );
-			m_Connection = m_DB->GetIdleConnection( );
-		}
-		
-		if( !m_Connection )
-		{
-			CONSOLE_Print( "[MYSQL] Failed to get an idle connection, creating a new one instead" );
-			if( !( m_Connection = mysql_init( NULL ) ) )
-				m_Error = mysql_error( (MYSQL *)m_Connection );
+		m_Connection = m_DB->GetIdleConnection( );
 
-			my_bool Reconnect = true;
-			mysql_options( (MYSQL *)m_Connection, MYSQL_OPT_RECONNECT, &Reconnect );
-
-			if( !( mysql_real_connect( (MYSQL *)m_Connection, m_SQLServer.c_str( ), m_SQLUser.c_str( ), m_SQLPassword.c_str( ), m_SQLDatabase.c_str( ), m_SQLPort, NULL, 0 ) ) )
-				m_Error = mysql_error( (MYSQL *)m_Connection );
-		}
-	}
+	if( !m_Connection )
+		m_Connection = m_DB->CreateConnection( &m_Error );
 	else if( mysql_ping( (MYSQL *)m_Connection ) != 0 )
 		m_Error = mysql_error( (MYSQL *)m_Connection );
 }
 
 void CMySQLCallable :: Close( )
 {
-	mysql_thread_end( );
+	// give the connection back before we're marked ready, the main thread may delete us as soon as we are
+
+	m_DB->ReleaseConnection( m_Connection, !m_Error.empty( ) );
+	m_Connection = NULL;
 
 	CBaseCallable :: Close( );
 }
@@ -163,10 +163,21 @@ CREATE TABLE w3mmdvars (
  *** SCHEMA ***
  **************/
 
+// callables are run by a fixed pool of worker threads in the order of these priorities (lowest first) and FIFO within a priority
+// the checks a player has to pass before they can join a game go first, stats inserts nobody is waiting on go last
+
+#define MYSQL_PRIORITY_JOIN		0
+#define MYSQL_PRIORITY_NORMAL	1
+#define MYSQL_PRIORITY_STATS	2
+#define MYSQL_NUM_PRIORITIES	3
+
 //
 // CGHostDBMySQL
 //
 
+// each worker thread holds at most one connection at a time (taken from m_IdleConnections when it starts a callable and given back when it's done)
+// so the number of open connections and concurrent queries is capped by the number of workers
+
 class CGHostDBMySQL : public CGHostDB
 {
 private:
@@ -179,7 +190,16 @@ private:
 	queue<void *> m_IdleConnections;
 	uint32_t m_NumConnections;
 	uint32_t m_OutstandingCallables;
-	boost::mutex m_DatabaseMutex;
+	boost::mutex m_DatabaseMutex;							// protects everything below and the members above
+	queue<CBaseCallable *> m_Queue[MYSQL_NUM_PRIORITIES];	// callables waiting for a worker thread
+	uint32_t m_QueueSize;									// total number of callables in m_Queue
+	uint32_t m_QueuePeak;									// largest m_QueueSize we've seen
+	uint32_t m_MaxQueueSize;								// join and normal callables are rejected when this many of them are queued (backpressure), stats callables are always queued
+	uint32_t m_NumRejected;									// number of callables rejected because the queue was full
+	uint32_t m_LastQueueWarningTime;
+	vector<boost::thread *> m_Workers;
+	boost::condition_variable m_QueueCondition;				// signalled when a callable is queued or we're exiting
+	bool m_Exiting;
 
 public:
 	CGHostDBMySQL( CConfig *CFG );
@@ -192,6 +212,7 @@ public:
 	// threaded database functions
 
 	virtual void CreateThread( CBaseCallable *callable );
+	virtual void QueueCallable( CBaseCallable *callable, uint32_t priority );
 	virtual CCallableAdminCount *ThreadedAdminCount( string server );
 	virtual CCallableAdminCheck *ThreadedAdminCheck( string server, string user );
 	virtual CCallableAdminAdd *ThreadedAdminAdd( string server, string user );
@@ -232,6 +253,11 @@ public:
 	// other database functions
 
 	virtual void *GetIdleConnection( );
+	virtual void *CreateConnection( string *error );
+	virtual void ReleaseConnection( void *connection, bool error );
+
+private:
+	void WorkerThread( );
 };
 
 //
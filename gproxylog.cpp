@@ -0,0 +1,185 @@
+/*
+
+	ent-ghost
+	Copyright [2011-2013] [Jack Lu]
+
+	This file is part of the ent-ghost source code.
+
+	ent-ghost is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	ent-ghost source code is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with ent-ghost source code. If not, see <http://www.gnu.org/licenses/>.
+
+	ent-ghost is modified from GHost++ (http://ghostplusplus.googlecode.com/)
+	GHost++ is Copyright [2008] [Trevor Hogan]
+
+*/
+
+#include "ghost.h"
+#include "util.h"
+#include "socket.h"
+#include "gproxylog.h"
+
+//
+// CGProxyLog
+//
+
+CGProxyLog :: CGProxyLog( string nGameName, uint32_t nMaxSize ) : m_GameName( nGameName ), m_FirstSequence( 0 ), m_Size( 0 ), m_MaxSize( nMaxSize ), m_PeakSize( 0 ), m_PeakEntries( 0 ), m_NumDropped( 0 )
+{
+
+}
+
+CGProxyLog :: ~CGProxyLog( )
+{
+
+}
+
+void CGProxyLog :: Append( unsigned char PID, const SHAREDBYTEARRAY &packet )
+{
+	if( !packet || m_Dropped.test( PID ) )
+		return;
+
+	// a broadcast packet is sent to each player in turn so if this packet was just logged for someone else add this player to the same entry
+
+	if( m_Entries.empty( ) || m_Entries.back( ).packet != packet || m_Entries.back( ).recipients.test( PID ) )
+	{
+		m_Entries.push_back( GProxyLogEntry( packet ) );
+		m_Size += packet->size( );
+
+		if( m_Size > m_PeakSize )
+			m_PeakSize = m_Size;
+
+		if( m_Entries.size( ) > m_PeakEntries )
+			m_PeakEntries = m_Entries.size( );
+	}
+
+	m_Entries.back( ).recipients.set( PID );
+
+	// the player's cursor starts at the first packet logged for it
+
+	map<unsigned char, GProxyCursor> :: iterator Cursor = m_Cursors.find( PID );
+
+	if( Cursor == m_Cursors.end( ) )
+	{
+		Cursor = m_Cursors.insert( make_pair( PID, GProxyCursor( ) ) ).first;
+		Cursor->second.sequence = m_FirstSequence + m_Entries.size( ) - 1;
+	}
+
+	++Cursor->second.unacked;
+
+	// if the log is too big drop the players that are furthest behind until it isn't
+
+	while( m_MaxSize != 0 && m_Size > m_MaxSize && !m_Cursors.empty( ) )
+	{
+		map<unsigned char, GProxyCursor> :: iterator Furthest = m_Cursors.begin( );
+
+		for( map<unsigned char, GProxyCursor> :: iterator i = m_Cursors.begin( ); i != m_Cursors.end( ); ++i )
+		{
+			if( i->second.sequence - m_FirstSequence < Furthest->second.sequence - m_FirstSequence )
+				Furthest = i;
+		}
+
+		CONSOLE_Print( "[GPROXY: " + m_GameName + "] log is over " + UTIL_ToString( m_MaxSize / 1024 ) + " KB, dropping PID " + UTIL_ToString( Furthest->first ) + " with " + UTIL_ToString( Furthest->second.unacked ) + " unacknowledged packets, it can't reconnect any more" );
+		m_Dropped.set( Furthest->first );
+		++m_NumDropped;
+		m_Cursors.erase( Furthest );
+		Reclaim( );
+	}
+}
+
+uint32_t CGProxyLog :: GetNumUnacked( unsigned char PID )
+{
+	map<unsigned char, GProxyCursor> :: iterator Cursor = m_Cursors.find( PID );
+
+	if( Cursor == m_Cursors.end( ) )
+		return 0;
+
+	return Cursor->second.unacked;
+}
+
+void CGProxyLog :: Ack( unsigned char PID, uint32_t numPackets )
+{
+	// the player acknowledged its oldest numPackets unacknowledged packets, move its cursor past them
+
+	map<unsigned char, GProxyCursor> :: iterator Cursor = m_Cursors.find( PID );
+
+	if( Cursor == m_Cursors.end( ) )
+		return;
+
+	uint32_t End = m_FirstSequence + m_Entries.size( );
+
+	while( numPackets > 0 && Cursor->second.unacked > 0 && Cursor->second.sequence != End )
+	{
+		if( m_Entries[Cursor->second.sequence - m_FirstSequence].recipients.test( PID ) )
+		{
+			--numPackets;
+			--Cursor->second.unacked;
+		}
+
+		++Cursor->second.sequence;
+	}
+
+	// skip the entries that weren't sent to this player so it doesn't keep them alive
+
+	while( Cursor->second.sequence != End && !m_Entries[Cursor->second.sequence - m_FirstSequence].recipients.test( PID ) )
+		++Cursor->second.sequence;
+
+	Reclaim( );
+}
+
+void CGProxyLog :: Replay( unsigned char PID, CTCPSocket *socket )
+{
+	// queue every packet the player hasn't acknowledged on the socket
+	// the socket's send buffer references the logged packets so nothing is copied
+
+	map<unsigned char, GProxyCursor> :: iterator Cursor = m_Cursors.find( PID );
+
+	if( Cursor == m_Cursors.end( ) || !socket )
+		return;
+
+	for( uint32_t i = Cursor->second.sequence - m_FirstSequence; i < m_Entries.size( ); ++i )
+	{
+		if( m_Entries[i].recipients.test( PID ) )
+			socket->PutBytes( m_Entries[i].packet );
+	}
+}
+
+void CGProxyLog :: RemovePlayer( unsigned char PID )
+{
+	m_Cursors.erase( PID );
+	Reclaim( );
+}
+
+string CGProxyLog :: GetStatus( )
+{
+	return "GProxy++ log has " + UTIL_ToString( m_Entries.size( ) ) + " packets (" + UTIL_ToString( m_Size / 1024 ) + " KB), peak was " + UTIL_ToString( m_PeakEntries ) + " packets (" + UTIL_ToString( m_PeakSize / 1024 ) + " KB), " + UTIL_ToString( m_NumDropped ) + " players dropped";
+}
+
+void CGProxyLog :: Reclaim( )
+{
+	// free every entry before the oldest cursor
+
+	uint32_t Oldest = m_Entries.size( );
+
+	for( map<unsigned char, GProxyCursor> :: iterator i = m_Cursors.begin( ); i != m_Cursors.end( ); ++i )
+	{
+		if( i->second.sequence - m_FirstSequence < Oldest )
+			Oldest = i->second.sequence - m_FirstSequence;
+	}
+
+	while( Oldest > 0 )
+	{
+		m_Size -= m_Entries.front( ).packet->size( );
+		m_Entries.pop_front( );
+		++m_FirstSequence;
+		--Oldest;
+	}
+}
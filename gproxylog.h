@@ -0,0 +1,93 @@
+/*
+
+	ent-ghost
+	Copyright [2011-2013] [Jack Lu]
+
+	This file is part of the ent-ghost source code.
+
+	ent-ghost is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	ent-ghost source code is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with ent-ghost source code. If not, see <http://www.gnu.org/licenses/>.
+
+	ent-ghost is modified from GHost++ (http://ghostplusplus.googlecode.com/)
+	GHost++ is Copyright [2008] [Trevor Hogan]
+
+*/
+
+#ifndef GPROXYLOG_H
+#define GPROXYLOG_H
+
+class CTCPSocket;
+
+struct GProxyLogEntry {
+	SHAREDBYTEARRAY packet;
+	bitset<256> recipients;						// PIDs the packet was sent to
+
+	GProxyLogEntry( const SHAREDBYTEARRAY &nPacket ) : packet( nPacket ) { }
+};
+
+struct GProxyCursor {
+	uint32_t sequence;							// sequence number of the first entry the player hasn't acknowledged
+	uint32_t unacked;							// number of packets sent to the player from that entry on
+
+	GProxyCursor( ) : sequence( 0 ), unacked( 0 ) { }
+};
+
+//
+// CGProxyLog
+//
+
+// the packets a game sent to its GProxy++ players since they were last acknowledged, kept so they can be resent after a reconnect
+// there's one log per game rather than one buffer per player, a broadcast packet is appended once no matter how many players it went to
+// each entry remembers which players it was sent to and each player has a cursor pointing at the first entry it hasn't acknowledged yet
+// entries are freed as soon as every cursor has moved past them
+// the log is capped at a configurable size (bot_reconnectmaxbuffer), when it's full the player furthest behind is dropped from the log
+// a dropped player can't reconnect any more because the packets it missed are gone
+
+class CGProxyLog
+{
+private:
+	string m_GameName;							// for console output
+	deque<GProxyLogEntry> m_Entries;
+	uint32_t m_FirstSequence;					// sequence number of the first entry in m_Entries
+	map<unsigned char, GProxyCursor> m_Cursors;	// PID -> cursor
+	bitset<256> m_Dropped;						// PIDs of the players that were dropped from the log
+	uint32_t m_Size;							// bytes of packet data in the log
+	uint32_t m_MaxSize;							// the maximum bytes of packet data in the log, zero for no limit
+	uint32_t m_PeakSize;
+	uint32_t m_PeakEntries;
+	uint32_t m_NumDropped;
+
+public:
+	CGProxyLog( string nGameName, uint32_t nMaxSize );
+	~CGProxyLog( );
+
+	void SetGameName( string nGameName )		{ m_GameName = nGameName; }
+	uint32_t GetSize( )							{ return m_Size; }
+	uint32_t GetNumEntries( )					{ return m_Entries.size( ); }
+	uint32_t GetPeakSize( )						{ return m_PeakSize; }
+	uint32_t GetPeakEntries( )					{ return m_PeakEntries; }
+	uint32_t GetNumDropped( )					{ return m_NumDropped; }
+	bool GetDropped( unsigned char PID )		{ return m_Dropped.test( PID ); }
+
+	void Append( unsigned char PID, const SHAREDBYTEARRAY &packet );
+	uint32_t GetNumUnacked( unsigned char PID );
+	void Ack( unsigned char PID, uint32_t numPackets );
+	void Replay( unsigned char PID, CTCPSocket *socket );
+	void RemovePlayer( unsigned char PID );
+	string GetStatus( );
+
+private:
+	void Reclaim( );
+};
+
+#endif
@@ -41,6 +41,7 @@
 #include <sstream>
 #include <iomanip>
 #include <algorithm>
+#include <bitset>
 #include <map>
 #include <queue>
 #include <deque>
@@ -48,11 +49,13 @@
 #include <string>
 #include <vector>
 #include <boost/thread.hpp>
+#include <boost/shared_ptr.hpp>
 #include <GeoIP.h>
 
 using namespace std;
 
 typedef vector<unsigned char> BYTEARRAY;
+typedef boost::shared_ptr<const BYTEARRAY> SHAREDBYTEARRAY;	// an immutable reference counted byte array, used for packets with more than one recipient
 typedef pair<unsigned char,string> PIDPlayer;
 
 // time
@@ -1281,11 +1281,6 @@ string CLanguage :: RatedPlayersSpread( string rated, string total, string sprea
 	return Out;
 }
 
-string CLanguage :: ErrorListingMaps( )
-{
-	return m_CFG->GetString( "lang_0171", "lang_0171" );
-}
-
 string CLanguage :: FoundMaps( string maps )
 {
 	string Out = m_CFG->GetString( "lang_0172", "lang_0172" );
@@ -1298,11 +1293,6 @@ string CLanguage :: NoMapsFound( )
 	return m_CFG->GetString( "lang_0173", "lang_0173" );
 }
 
-string CLanguage :: ErrorListingMapConfigs( )
-{
-	return m_CFG->GetString( "lang_0174", "lang_0174" );
-}
-
 string CLanguage :: FoundMapConfigs( string mapconfigs )
 {
 	string Out = m_CFG->GetString( "lang_0175", "lang_0175" );
@@ -1633,3 +1623,17 @@ string CLanguage :: ForfeitVotesNeeded( string votes, string total, string team
 	UTIL_Replace( Out, "$TEAM$", team );
 	return Out;
 }
+
+string CLanguage :: DidYouMeanMaps( string maps )
+{
+	string Out = m_CFG->GetString( "lang_0229", "lang_0229" );
+	UTIL_Replace( Out, "$MAPS$", maps );
+	return Out;
+}
+
+string CLanguage :: DidYouMeanMapConfigs( string mapconfigs )
+{
+	string Out = m_CFG->GetString( "lang_0230", "lang_0230" );
+	UTIL_Replace( Out, "$MAPCONFIGS$", mapconfigs );
+	return Out;
+}
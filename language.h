@@ -213,10 +213,8 @@ public:
 	string WasKickedForHavingFurthestScore( string score, string average );
 	string PlayerHasScore( string player, string score );
 	string RatedPlayersSpread( string rated, string total, string spread );
-	string ErrorListingMaps( );
 	string FoundMaps( string maps );
 	string NoMapsFound( );
-	string ErrorListingMapConfigs( );
 	string FoundMapConfigs( string mapconfigs );
 	string NoMapConfigsFound( );
 	string PlayerFinishedLoading( string user );
@@ -269,6 +267,8 @@ public:
 	string ForfeitStatsWarning( );
 	string ForfeitVote( string user );
 	string ForfeitVotesNeeded( string votes, string total, string team );
+	string DidYouMeanMaps( string maps );
+	string DidYouMeanMapConfigs( string mapconfigs );
 };
 
 #endif
@@ -29,6 +29,8 @@
 #include "sha1.h"
 #include "config.h"
 #include "map.h"
+#include "mapcache.h"
+#include "gameprotocol.h"
 
 #define __STORMLIB_SELF__
 #include <stormlib/StormLib.h>
@@ -36,11 +38,36 @@
 #define ROTL(x,n) ((x)<<(n))|((x)>>(32-(n)))	// this won't work with signed types
 #define ROTR(x,n) ((x)>>(n))|((x)<<(32-(n)))	// this won't work with signed types
 
+//
+// CMapAsset
+//
+
+CMapAsset :: CMapAsset( )
+{
+
+}
+
+CMapAsset :: ~CMapAsset( )
+{
+
+}
+
+bool CMapAsset :: GetMapPartCRC( uint32_t start, uint32_t *crc ) const
+{
+	// chunks are always sent from a multiple of MAPPART_SIZE so this should always be in the table
+
+	if( start % MAPPART_SIZE != 0 || start / MAPPART_SIZE >= m_MapPartCRCs.size( ) )
+		return false;
+
+	*crc = m_MapPartCRCs[start / MAPPART_SIZE];
+	return true;
+}
+
 //
 // CMap
 //
 
-CMap :: CMap( CGHost *nGHost ) : m_GHost( nGHost ), m_Valid( true ), m_MapPath( "Maps\\FrozenThrone\\(12)EmeraldGardens.w3x" ), m_MapSize( UTIL_ExtractNumbers( "174 221 4 0", 4 ) ), m_MapInfo( UTIL_ExtractNumbers( "251 57 68 98", 4 ) ), m_MapCRC( UTIL_ExtractNumbers( "108 250 204 59", 4 ) ), m_MapSHA1( UTIL_ExtractNumbers( "35 81 104 182 223 63 204 215 1 17 87 234 220 66 3 185 82 99 6 13", 20 ) ), m_MapSpeed( MAPSPEED_FAST ), m_MapVisibility( MAPVIS_DEFAULT ), m_MapObservers( MAPOBS_NONE ), m_MapFlags( MAPFLAG_TEAMSTOGETHER | MAPFLAG_FIXEDTEAMS ), m_MapFilterMaker( MAPFILTER_MAKER_BLIZZARD ), m_MapFilterType( MAPFILTER_TYPE_MELEE ), m_MapFilterSize( MAPFILTER_SIZE_LARGE ), m_MapFilterObs( MAPFILTER_OBS_NONE ), m_MapOptions( MAPOPT_MELEE ), m_MapWidth( UTIL_ExtractNumbers( "172 0", 2 ) ), m_MapHeight( UTIL_ExtractNumbers( "172 0", 2 ) ), m_MapLoadInGame( false ), m_MapNumPlayers( 12 ), m_MapNumTeams( 12 )
+CMap :: CMap( CGHost *nGHost ) : m_GHost( nGHost ), m_Valid( true ), m_MapPath( "Maps\\FrozenThrone\\(12)EmeraldGardens.w3x" ), m_MapSize( UTIL_ExtractNumbers( "174 221 4 0", 4 ) ), m_MapInfo( UTIL_ExtractNumbers( "251 57 68 98", 4 ) ), m_MapCRC( UTIL_ExtractNumbers( "108 250 204 59", 4 ) ), m_MapSHA1( UTIL_ExtractNumbers( "35 81 104 182 223 63 204 215 1 17 87 234 220 66 3 185 82 99 6 13", 20 ) ), m_MapSpeed( MAPSPEED_FAST ), m_MapVisibility( MAPVIS_DEFAULT ), m_MapObservers( MAPOBS_NONE ), m_MapFlags( MAPFLAG_TEAMSTOGETHER | MAPFLAG_FIXEDTEAMS ), m_MapFilterMaker( MAPFILTER_MAKER_BLIZZARD ), m_MapFilterType( MAPFILTER_TYPE_MELEE ), m_MapFilterSize( MAPFILTER_SIZE_LARGE ), m_MapFilterObs( MAPFILTER_OBS_NONE ), m_MapOptions( MAPOPT_MELEE ), m_MapWidth( UTIL_ExtractNumbers( "172 0", 2 ) ), m_MapHeight( UTIL_ExtractNumbers( "172 0", 2 ) ), m_MapLoadInGame( false ), m_Asset( new CMapAsset( ) ), m_MapNumPlayers( 12 ), m_MapNumTeams( 12 )
 {
 	CONSOLE_Print( "[MAP] using hardcoded Emerald Gardens map data for Warcraft 3 version 1.24 & 1.24b" );
 	m_Slots.push_back( CGameSlot( 0, 255, SLOTSTATUS_OPEN, 0, 0, 0, SLOTRACE_RANDOM | SLOTRACE_SELECTABLE ) );
@@ -57,7 +84,7 @@ CMap :: CMap( CGHost *nGHost ) : m_GHost( nGHost ), m_Valid( true ), m_MapPath(
 	m_Slots.push_back( CGameSlot( 0, 255, SLOTSTATUS_OPEN, 0, 11, 11, SLOTRACE_RANDOM | SLOTRACE_SELECTABLE ) );
 }
 
-CMap :: CMap( CGHost *nGHost, CConfig *CFG, string nCFGFile ) : m_GHost( nGHost )
+CMap :: CMap( CGHost *nGHost, CConfig *CFG, string nCFGFile ) : m_GHost( nGHost ), m_Asset( new CMapAsset( ) )
 {
 	Load( CFG, nCFGFile );
 }
@@ -232,54 +259,181 @@ unsigned char CMap :: GetMapLayoutStyle( )
 	return 3;
 }
 
+uint32_t CMap :: GetMapPartCRC( uint32_t start )
+{
+	uint32_t CRC;
+
+	if( m_Asset->GetMapPartCRC( start, &CRC ) )
+		return CRC;
+
+	if( start >= m_Asset->GetSize( ) )
+		return 0;
+
+	return m_GHost->m_CRC->FullCRC( (unsigned char *)m_Asset->GetData( ) + start, min( m_Asset->GetSize( ) - start, (uint32_t)MAPPART_SIZE ) );
+}
+
+uint32_t CMap :: CheckMapFile( )
+{
+	// if the map file changed since it was loaded load it again, otherwise we'd send players data that doesn't match the map_info/crc/sha1 we calculated
+	// returns how the file changed (MAPPEDFILE_*)
+
+	uint32_t Change = m_Asset->m_File.GetChange( );
+
+	if( Change != MAPPEDFILE_UNCHANGED )
+	{
+		CONSOLE_Print( "[MAP] map file [" + m_Asset->m_File.GetFileName( ) + "] changed since it was loaded, loading it again" );
+		CConfig CFG = m_Config;
+		Load( &CFG, m_CFGFile );
+	}
+
+	return Change;
+}
+
 void CMap :: Load( CConfig *CFG, string nCFGFile )
 {
 	m_Valid = true;
 	m_CFGFile = nCFGFile;
+	m_Config = *CFG;
 
 	// load the map data
 
 	m_MapLocalPath = CFG->GetString( "map_localpath", string( ) );
-	m_MapData.clear( );
+
+	// the map file is memory mapped rather than read so it's only in memory once (in the page cache) however many bots on this machine load it
+	// the previous asset isn't touched, any copies of this map that still use it keep it alive
+	// with bot_mapmmap = 0 the file is read into a heap buffer instead so a map file that's overwritten in place can't crash us (see CMappedFile)
+
+	boost::shared_ptr<CMapAsset> Asset( new CMapAsset( ) );
 
 	if( !m_MapLocalPath.empty( ) )
-		m_MapData = UTIL_FileRead( m_GHost->m_MapPath + m_MapLocalPath );
+		Asset->m_File.Open( m_GHost->m_MapPath + m_MapLocalPath, MAPPEDFILE_NORMAL, !m_GHost->m_MapMMap );
+
+	const unsigned char *MapData = Asset->m_File.GetData( );
+	uint32_t MapDataSize = Asset->m_File.GetSize( );
+
+	BYTEARRAY MapSize;
+	BYTEARRAY MapInfo;
+	BYTEARRAY MapCRC;
+	BYTEARRAY MapSHA1;
+	uint32_t MapOptions = 0;
+	BYTEARRAY MapWidth;
+	BYTEARRAY MapHeight;
+	uint32_t MapNumPlayers = 0;
+	uint32_t MapNumTeams = 0;
+	uint32_t MapFilterType = MAPFILTER_TYPE_SCENARIO;
+	vector<CGameSlot> Slots;
+
+	// if the map hasn't changed since we last calculated its values use the cached values instead (see CMapCache)
+
+	CMapCache Cache( m_GHost );
+	CConfig Cached;
+	bool FromCache = Cache.Read( m_MapLocalPath, Asset->m_File, &Cached );
+
+	if( FromCache )
+	{
+		MapSize = UTIL_CreateByteArray( MapDataSize, false );
+		MapInfo = UTIL_ExtractNumbers( Cached.GetString( "map_info", string( ) ), 4 );
+		MapCRC = UTIL_ExtractNumbers( Cached.GetString( "map_crc", string( ) ), 4 );
+		MapSHA1 = UTIL_ExtractNumbers( Cached.GetString( "map_sha1", string( ) ), 20 );
+		MapOptions = Cached.GetInt( "map_options", 0 );
+		MapWidth = UTIL_ExtractNumbers( Cached.GetString( "map_width", string( ) ), 2 );
+		MapHeight = UTIL_ExtractNumbers( Cached.GetString( "map_height", string( ) ), 2 );
+		MapNumPlayers = Cached.GetInt( "map_numplayers", 0 );
+		MapNumTeams = Cached.GetInt( "map_numteams", 0 );
+		MapFilterType = Cached.GetInt( "map_filter_type", MAPFILTER_TYPE_SCENARIO );
+
+		for( uint32_t Slot = 1; Slot <= 12; ++Slot )
+		{
+			string SlotString = Cached.GetString( "map_slot" + UTIL_ToString( Slot ), string( ) );
+
+			if( SlotString.empty( ) )
+				break;
+
+			BYTEARRAY SlotData = UTIL_ExtractNumbers( SlotString, 9 );
+			Slots.push_back( CGameSlot( SlotData ) );
+		}
+
+		stringstream SS( Cached.GetString( "map_partcrcs", string( ) ) );
+		uint32_t PartCRC;
+
+		while( SS >> PartCRC )
+			Asset->m_MapPartCRCs.push_back( PartCRC );
+
+		if( MapInfo.size( ) != 4 || MapCRC.size( ) != 4 || MapSHA1.size( ) != 20 || MapWidth.size( ) != 2 || MapHeight.size( ) != 2 || Slots.empty( ) || Asset->m_MapPartCRCs.size( ) != ( MapDataSize + MAPPART_SIZE - 1 ) / MAPPART_SIZE )
+		{
+			CONSOLE_Print( "[MAP] cached values are incomplete, recalculating" );
+			MapSize.clear( );
+			MapInfo.clear( );
+			MapCRC.clear( );
+			MapSHA1.clear( );
+			MapOptions = 0;
+			MapWidth.clear( );
+			MapHeight.clear( );
+			MapNumPlayers = 0;
+			MapNumTeams = 0;
+			MapFilterType = MAPFILTER_TYPE_SCENARIO;
+			Slots.clear( );
+			Asset->m_MapPartCRCs.clear( );
+			FromCache = false;
+		}
+		else
+		{
+			CONSOLE_Print( "[MAP] cached map_size = " + UTIL_ByteArrayToDecString( MapSize ) + ", map_info = " + UTIL_ByteArrayToDecString( MapInfo ) + ", map_crc = " + UTIL_ByteArrayToDecString( MapCRC ) );
+			CONSOLE_Print( "[MAP] cached map_sha1 = " + UTIL_ByteArrayToDecString( MapSHA1 ) );
+		}
+	}
 
-	// load the map MPQ
+	// load the map MPQ, we don't need it if everything came from the cache
 
 	string MapMPQFileName = m_GHost->m_MapPath + m_MapLocalPath;
 	HANDLE MapMPQ;
 	bool MapMPQReady = false;
 
-	if( SFileOpenArchive( MapMPQFileName.c_str( ), 0, MPQ_OPEN_FORCE_MPQ_V1, &MapMPQ ) )
+	if( !FromCache )
 	{
-		CONSOLE_Print( "[MAP] loading MPQ file [" + MapMPQFileName + "]" );
-		MapMPQReady = true;
+		if( SFileOpenArchive( MapMPQFileName.c_str( ), 0, MPQ_OPEN_FORCE_MPQ_V1, &MapMPQ ) )
+		{
+			CONSOLE_Print( "[MAP] loading MPQ file [" + MapMPQFileName + "]" );
+			MapMPQReady = true;
+		}
+		else
+			CONSOLE_Print( "[MAP] warning - unable to load MPQ file [" + MapMPQFileName + "]" );
 	}
-	else
-		CONSOLE_Print( "[MAP] warning - unable to load MPQ file [" + MapMPQFileName + "]" );
 
 	// try to calculate map_size, map_info, map_crc, map_sha1
 
-	BYTEARRAY MapSize;
-	BYTEARRAY MapInfo;
-	BYTEARRAY MapCRC;
-	BYTEARRAY MapSHA1;
-
-	if( !m_MapData.empty( ) )
+	if( !FromCache && MapDataSize != 0 )
 	{
-		m_GHost->m_SHA->Reset( );
+		// we're about to read the whole map to calculate the map_info and the chunk crcs so ask for it to be read ahead
+
+		Asset->m_File.Advise( MAPPEDFILE_SEQUENTIAL | MAPPEDFILE_WILLNEED );
+
+		// the sha1 is calculated with our own CSHA1 rather than a shared one so maps can be loaded on several threads at once
+
+		CSHA1 SHA;
 
 		// calculate map_size
 
-		MapSize = UTIL_CreateByteArray( (uint32_t)m_MapData.size( ), false );
+		MapSize = UTIL_CreateByteArray( MapDataSize, false );
 		CONSOLE_Print( "[MAP] calculated map_size = " + UTIL_ByteArrayToDecString( MapSize ) );
 
 		// calculate map_info (this is actually the CRC)
 
-		MapInfo = UTIL_CreateByteArray( (uint32_t)m_GHost->m_CRC->FullCRC( (unsigned char *)m_MapData.c_str( ), m_MapData.size( ) ), false );
+		MapInfo = UTIL_CreateByteArray( (uint32_t)m_GHost->m_CRC->FullCRC( (unsigned char *)MapData, MapDataSize ), false );
 		CONSOLE_Print( "[MAP] calculated map_info = " + UTIL_ByteArrayToDecString( MapInfo ) );
 
+		// calculate the crc of every chunk we'll send in a W3GS_MAPPART packet
+		// every game and every downloader sends the same chunks so there's no need to calculate them more than once
+
+		Asset->m_MapPartCRCs.reserve( ( MapDataSize + MAPPART_SIZE - 1 ) / MAPPART_SIZE );
+
+		for( uint32_t i = 0; i < MapDataSize; i += MAPPART_SIZE )
+			Asset->m_MapPartCRCs.push_back( m_GHost->m_CRC->FullCRC( (unsigned char *)MapData + i, min( MapDataSize - i, (uint32_t)MAPPART_SIZE ) ) );
+
+		// from now on the map is only read a chunk at a time as players download it
+
+		Asset->m_File.Advise( MAPPEDFILE_NORMAL );
+
 		// calculate map_crc (this is not the CRC) and map_sha1
 		// a big thank you to Strilanc for figuring the map_crc algorithm out
 
@@ -323,7 +477,7 @@ void CMap :: Load( CConfig *CFG, string nCFGFile )
 								CONSOLE_Print( "[MAP] overriding default common.j with map copy while calculating map_crc/sha1" );
 								OverrodeCommonJ = true;
 								Val = Val ^ XORRotateLeft( (unsigned char *)SubFileData, BytesRead );
-								m_GHost->m_SHA->Update( (unsigned char *)SubFileData, BytesRead );
+								SHA.Update( (unsigned char *)SubFileData, BytesRead );
 							}
 
 							delete [] SubFileData;
@@ -336,7 +490,7 @@ void CMap :: Load( CConfig *CFG, string nCFGFile )
 				if( !OverrodeCommonJ )
 				{
 					Val = Val ^ XORRotateLeft( (unsigned char *)CommonJ.c_str( ), CommonJ.size( ) );
-					m_GHost->m_SHA->Update( (unsigned char *)CommonJ.c_str( ), CommonJ.size( ) );
+					SHA.Update( (unsigned char *)CommonJ.c_str( ), CommonJ.size( ) );
 				}
 
 				if( MapMPQReady )
@@ -359,7 +513,7 @@ void CMap :: Load( CConfig *CFG, string nCFGFile )
 								CONSOLE_Print( "[MAP] overriding default blizzard.j with map copy while calculating map_crc/sha1" );
 								OverrodeBlizzardJ = true;
 								Val = Val ^ XORRotateLeft( (unsigned char *)SubFileData, BytesRead );
-								m_GHost->m_SHA->Update( (unsigned char *)SubFileData, BytesRead );
+								SHA.Update( (unsigned char *)SubFileData, BytesRead );
 							}
 
 							delete [] SubFileData;
@@ -372,12 +526,12 @@ void CMap :: Load( CConfig *CFG, string nCFGFile )
 				if( !OverrodeBlizzardJ )
 				{
 					Val = Val ^ XORRotateLeft( (unsigned char *)BlizzardJ.c_str( ), BlizzardJ.size( ) );
-					m_GHost->m_SHA->Update( (unsigned char *)BlizzardJ.c_str( ), BlizzardJ.size( ) );
+					SHA.Update( (unsigned char *)BlizzardJ.c_str( ), BlizzardJ.size( ) );
 				}
 
 				Val = ROTL( Val, 3 );
 				Val = ROTL( Val ^ 0x03F1379E, 3 );
-				m_GHost->m_SHA->Update( (unsigned char *)"\x9E\x37\xF1\x03", 4 );
+				SHA.Update( (unsigned char *)"\x9E\x37\xF1\x03", 4 );
 
 				if( MapMPQReady )
 				{
@@ -418,7 +572,7 @@ void CMap :: Load( CConfig *CFG, string nCFGFile )
 										FoundScript = true;
 
 									Val = ROTL( Val ^ XORRotateLeft( (unsigned char *)SubFileData, BytesRead ), 3 );
-									m_GHost->m_SHA->Update( (unsigned char *)SubFileData, BytesRead );
+									SHA.Update( (unsigned char *)SubFileData, BytesRead );
 									// DEBUG_Print( "*** found: " + *i );
 								}
 
@@ -439,10 +593,10 @@ void CMap :: Load( CConfig *CFG, string nCFGFile )
 					MapCRC = UTIL_CreateByteArray( Val, false );
 					CONSOLE_Print( "[MAP] calculated map_crc = " + UTIL_ByteArrayToDecString( MapCRC ) );
 
-					m_GHost->m_SHA->Final( );
+					SHA.Final( );
 					unsigned char SHA1[20];
 					memset( SHA1, 0, sizeof( unsigned char ) * 20 );
-					m_GHost->m_SHA->GetHash( SHA1 );
+					SHA.GetHash( SHA1 );
 					MapSHA1 = UTIL_CreateByteArray( SHA1, 20 );
 					CONSOLE_Print( "[MAP] calculated map_sha1 = " + UTIL_ByteArrayToDecString( MapSHA1 ) );
 				}
@@ -451,20 +605,19 @@ void CMap :: Load( CConfig *CFG, string nCFGFile )
 			}
 		}
 	}
-	else
+	else if( !FromCache )
 		CONSOLE_Print( "[MAP] no map data available, using config file for map_size, map_info, map_crc, map_sha1" );
 
-	// try to calculate map_width, map_height, map_slot<x>, map_numplayers, map_numteams
+	// the asset is complete, from now on it's only read
 
-	uint32_t MapOptions = 0;
-	BYTEARRAY MapWidth;
-	BYTEARRAY MapHeight;
-	uint32_t MapNumPlayers = 0;
-	uint32_t MapNumTeams = 0;
-    uint32_t MapFilterType = MAPFILTER_TYPE_SCENARIO;
-	vector<CGameSlot> Slots;
+	Asset->m_MapInfo = MapInfo;
+	Asset->m_MapCRC = MapCRC;
+	Asset->m_MapSHA1 = MapSHA1;
+	m_Asset = Asset;
+
+	// try to calculate map_width, map_height, map_slot<x>, map_numplayers, map_numteams
 
-	if( !m_MapData.empty( ) )
+	if( !FromCache && MapDataSize != 0 )
 	{
 		if( MapMPQReady )
 		{
@@ -693,7 +846,7 @@ void CMap :: Load( CConfig *CFG, string nCFGFile )
 		else
 			CONSOLE_Print( "[MAP] unable to calculate map_options, map_width, map_height, map_slot<x>, map_numplayers, map_numteams - map MPQ file not loaded" );
 	}
-	else
+	else if( !FromCache )
 		CONSOLE_Print( "[MAP] no map data available, using config file for map_options, map_width, map_height, map_slot<x>, map_numplayers, map_numteams" );
 
 	// close the map MPQ
@@ -701,6 +854,38 @@ void CMap :: Load( CConfig *CFG, string nCFGFile )
 	if( MapMPQReady )
 		SFileCloseArchive( MapMPQ );
 
+	// cache what we calculated if we managed to calculate everything
+
+	if( !FromCache && Cache.GetEnabled( ) && MapSHA1.size( ) == 20 && MapWidth.size( ) == 2 )
+	{
+		CConfig Calculated;
+		Calculated.Set( "map_info", UTIL_ByteArrayToDecString( MapInfo ) );
+		Calculated.Set( "map_crc", UTIL_ByteArrayToDecString( MapCRC ) );
+		Calculated.Set( "map_sha1", UTIL_ByteArrayToDecString( MapSHA1 ) );
+		Calculated.Set( "map_options", UTIL_ToString( MapOptions ) );
+		Calculated.Set( "map_width", UTIL_ByteArrayToDecString( MapWidth ) );
+		Calculated.Set( "map_height", UTIL_ByteArrayToDecString( MapHeight ) );
+		Calculated.Set( "map_numplayers", UTIL_ToString( MapNumPlayers ) );
+		Calculated.Set( "map_numteams", UTIL_ToString( MapNumTeams ) );
+		Calculated.Set( "map_filter_type", UTIL_ToString( MapFilterType ) );
+
+		for( uint32_t i = 0; i < Slots.size( ) && i < 12; ++i )
+			Calculated.Set( "map_slot" + UTIL_ToString( i + 1 ), UTIL_ByteArrayToDecString( Slots[i].GetByteArray( ) ) );
+
+		string PartCRCs;
+
+		for( vector<uint32_t> :: iterator i = Asset->m_MapPartCRCs.begin( ); i != Asset->m_MapPartCRCs.end( ); ++i )
+		{
+			if( !PartCRCs.empty( ) )
+				PartCRCs += " ";
+
+			PartCRCs += UTIL_ToString( *i );
+		}
+
+		Calculated.Set( "map_partcrcs", PartCRCs );
+		Cache.Write( m_MapLocalPath, Asset->m_File, &Calculated );
+	}
+
 	m_MapPath = CFG->GetString( "map_path", string( ) );
 
 	if( MapSize.empty( ) )
@@ -913,7 +1098,7 @@ void CMap :: CheckValid( )
 		m_Valid = false;
 		CONSOLE_Print( "[MAP] invalid map_size detected" );
 	}
-	else if( !m_MapData.empty( ) && m_MapData.size( ) != UTIL_ByteArrayToUInt32( m_MapSize, false ) )
+	else if( m_Asset->GetSize( ) != 0 && m_Asset->GetSize( ) != UTIL_ByteArrayToUInt32( m_MapSize, false ) )
 	{
 		m_Valid = false;
 		CONSOLE_Print( "[MAP] invalid map_size detected - size mismatch with actual map data" );
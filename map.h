@@ -88,7 +88,45 @@
 #define MAPGAMETYPE_OBSONDEATH			1 << 21
 #define MAPGAMETYPE_OBSNONE				1 << 22
 
+#include "config.h"
 #include "gameslot.h"
+#include "mappedfile.h"
+
+class CMapAsset;
+
+typedef boost::shared_ptr<const CMapAsset> SHAREDMAPASSET;
+
+//
+// CMapAsset
+//
+
+// the contents of a map file and everything we calculated from them
+// every game gets its own copy of the CMap it was created with (and so does the autohost map) but they all share the same asset, so the map file is only held in memory once per load
+// an asset is built by CMap :: Load and never changes afterwards so any thread can read it without locking
+
+class CMapAsset
+{
+	friend class CMap;
+
+private:
+	CMappedFile m_File;							// the map data itself, for sending the map to players
+	vector<uint32_t> m_MapPartCRCs;				// the crc of each MAPPART_SIZE byte chunk of m_File
+	BYTEARRAY m_MapInfo;						// calculated map info (4 bytes), empty if it couldn't be calculated
+	BYTEARRAY m_MapCRC;							// calculated map crc (4 bytes), empty if it couldn't be calculated
+	BYTEARRAY m_MapSHA1;						// calculated map sha1 (20 bytes), empty if it couldn't be calculated
+
+public:
+	CMapAsset( );
+	~CMapAsset( );
+
+	const unsigned char *GetData( ) const			{ return m_File.GetData( ); }
+	uint32_t GetSize( ) const						{ return m_File.GetSize( ); }
+	uint32_t GetNumMapParts( ) const				{ return m_MapPartCRCs.size( ); }
+	BYTEARRAY GetMapInfo( ) const					{ return m_MapInfo; }
+	BYTEARRAY GetMapCRC( ) const					{ return m_MapCRC; }
+	BYTEARRAY GetMapSHA1( ) const					{ return m_MapSHA1; }
+	bool GetMapPartCRC( uint32_t start, uint32_t *crc ) const;
+};
 
 //
 // CMap
@@ -102,6 +140,7 @@ public:
 private:
 	bool m_Valid;
 	string m_CFGFile;
+	CConfig m_Config;							// the config the map was loaded from, for loading it again (see CheckMapFile)
 	string m_MapPath;							// config value: map path
 	BYTEARRAY m_MapSize;						// config value: map size (4 bytes)
 	BYTEARRAY m_MapInfo;						// config value: map info (4 bytes) -> this is the real CRC
@@ -127,7 +166,7 @@ private:
 	bool m_MapLoadInGame;
 	bool m_Tournament;							// config value: whether this is involved with uxtourney system
 	uint32_t m_TournamentFakeSlot;				// config value: if tournament, this is SID for fake player
-	string m_MapData;							// the map data itself, for sending the map to players
+	SHAREDMAPASSET m_Asset;						// the map data and everything calculated from it, shared with every copy of this map
 	uint32_t m_MapNumPlayers;
 	uint32_t m_MapNumTeams;
 	vector<CGameSlot> m_Slots;
@@ -166,7 +205,10 @@ public:
 	bool GetMapLoadInGame( )				{ return m_MapLoadInGame; }
 	bool GetMapTournament( )				{ return m_Tournament; }
 	uint32_t GetMapTournamentFakeSlot( )	{ return m_TournamentFakeSlot; }
-	string *GetMapData( )					{ return &m_MapData; }
+	const unsigned char *GetMapData( )		{ return m_Asset->GetData( ); }
+	uint32_t GetMapDataSize( )				{ return m_Asset->GetSize( ); }
+	SHAREDMAPASSET GetAsset( )				{ return m_Asset; }
+	uint32_t GetMapPartCRC( uint32_t start );
 	uint32_t GetMapNumPlayers( )			{ return m_MapNumPlayers; }
 	uint32_t GetMapNumTeams( )				{ return m_MapNumTeams; }
 	vector<CGameSlot> GetSlots( )			{ return m_Slots; }
@@ -175,6 +217,7 @@ public:
 	string GetConditions( )					{ return m_Conditions; }
 
 	void Load( CConfig *CFG, string nCFGFile );
+	uint32_t CheckMapFile( );
 	void CheckValid( );
 	uint32_t XORRotateLeft( unsigned char *data, uint32_t length );
 };
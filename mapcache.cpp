@@ -0,0 +1,173 @@
+/*
+
+	ent-ghost
+	Copyright [2011-2013] [Jack Lu]
+
+	This file is part of the ent-ghost source code.
+
+	ent-ghost is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	ent-ghost source code is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with ent-ghost source code. If not, see <http://www.gnu.org/licenses/>.
+
+	ent-ghost is modified from GHost++ (http://ghostplusplus.googlecode.com/)
+	GHost++ is Copyright [2008] [Trevor Hogan]
+
+*/
+
+#include "ghost.h"
+#include "util.h"
+#include "crc32.h"
+#include "config.h"
+#include "mappedfile.h"
+#include "mapcache.h"
+
+#include <sys/stat.h>
+
+#include <boost/filesystem.hpp>
+
+//
+// CMapCache
+//
+
+CMapCache :: CMapCache( CGHost *nGHost ) : m_GHost( nGHost )
+{
+
+}
+
+CMapCache :: ~CMapCache( )
+{
+
+}
+
+bool CMapCache :: GetEnabled( )
+{
+	return !m_GHost->m_MapCachePath.empty( );
+}
+
+bool CMapCache :: Read( string mapFile, const CMappedFile &file, CConfig *entry )
+{
+	if( !GetEnabled( ) || file.GetSize( ) == 0 )
+		return false;
+
+	// bot_mapcacheforce throws the entry away so it's recalculated and written again
+
+	if( m_GHost->m_MapCacheForce )
+	{
+		Invalidate( mapFile );
+		return false;
+	}
+
+	string EntryFile = GetEntryFile( mapFile );
+
+	if( !UTIL_FileExists( EntryFile ) )
+		return false;
+
+	entry->Read( EntryFile );
+
+	if( entry->GetString( "cache_key", string( ) ) != GetKey( file ) )
+	{
+		CONSOLE_Print( "[MAPCACHE] cached values for [" + mapFile + "] are out of date" );
+		return false;
+	}
+
+	CONSOLE_Print( "[MAPCACHE] using cached values for [" + mapFile + "]" );
+	return true;
+}
+
+bool CMapCache :: Write( string mapFile, const CMappedFile &file, CConfig *entry )
+{
+	if( !GetEnabled( ) || file.GetSize( ) == 0 )
+		return false;
+
+	boost :: system :: error_code Error;
+	boost :: filesystem :: create_directories( m_GHost->m_MapCachePath, Error );
+
+	entry->Set( "cache_file", mapFile );
+	entry->Set( "cache_key", GetKey( file ) );
+
+	// write to a temporary file first so an entry is never seen half written
+	// the temporary file name is unique because two configs for the same map can be loaded on different threads at once (see CMapWarmer)
+
+	string EntryFile = GetEntryFile( mapFile );
+	string TempFile = boost :: filesystem :: unique_path( EntryFile + ".%%%%%%%%.tmp", Error ).string( );
+
+	if( !entry->Write( TempFile ) )
+	{
+		CONSOLE_Print( "[MAPCACHE] warning - unable to write cache file [" + TempFile + "]" );
+		return false;
+	}
+
+#ifdef WIN32
+	remove( EntryFile.c_str( ) );
+#endif
+
+	if( rename( TempFile.c_str( ), EntryFile.c_str( ) ) != 0 )
+	{
+		CONSOLE_Print( "[MAPCACHE] warning - unable to write cache file [" + EntryFile + "]" );
+		remove( TempFile.c_str( ) );
+		return false;
+	}
+
+	CONSOLE_Print( "[MAPCACHE] cached values for [" + mapFile + "]" );
+	return true;
+}
+
+void CMapCache :: Invalidate( string mapFile )
+{
+	if( !GetEnabled( ) )
+		return;
+
+	string EntryFile = GetEntryFile( mapFile );
+
+	if( UTIL_FileExists( EntryFile ) && remove( EntryFile.c_str( ) ) == 0 )
+		CONSOLE_Print( "[MAPCACHE] removed cached values for [" + mapFile + "]" );
+}
+
+string CMapCache :: GetEntryFile( string mapFile )
+{
+	return m_GHost->m_MapCachePath + UTIL_FileSafeName( mapFile ) + ".cache";
+}
+
+string CMapCache :: GetKey( const CMappedFile &file )
+{
+	// the key doesn't read the whole map, only up to three samples of MAPCACHE_SAMPLESIZE bytes
+
+	struct stat MapStat;
+	struct stat CommonJStat;
+	struct stat BlizzardJStat;
+
+	if( stat( file.GetFileName( ).c_str( ), &MapStat ) != 0 )
+		return string( );
+
+	if( stat( ( m_GHost->m_MapCFGPath + "common.j" ).c_str( ), &CommonJStat ) != 0 )
+		CommonJStat.st_size = CommonJStat.st_mtime = 0;
+
+	if( stat( ( m_GHost->m_MapCFGPath + "blizzard.j" ).c_str( ), &BlizzardJStat ) != 0 )
+		BlizzardJStat.st_size = BlizzardJStat.st_mtime = 0;
+
+	unsigned char *Data = (unsigned char *)file.GetData( );
+	uint32_t Size = file.GetSize( );
+	uint32_t CRC = 0xFFFFFFFF;
+
+	if( Size <= MAPCACHE_SAMPLESIZE * 3 )
+		m_GHost->m_CRC->PartialCRC( &CRC, Data, Size );
+	else
+	{
+		m_GHost->m_CRC->PartialCRC( &CRC, Data, MAPCACHE_SAMPLESIZE );
+		m_GHost->m_CRC->PartialCRC( &CRC, Data + Size / 2 - MAPCACHE_SAMPLESIZE / 2, MAPCACHE_SAMPLESIZE );
+		m_GHost->m_CRC->PartialCRC( &CRC, Data + Size - MAPCACHE_SAMPLESIZE, MAPCACHE_SAMPLESIZE );
+	}
+
+	CRC ^= 0xFFFFFFFF;
+
+	return UTIL_ToString( MAPCACHE_VERSION ) + " " + UTIL_ToString( Size ) + " " + UTIL_ToString( (unsigned long)MapStat.st_mtime ) + " " + UTIL_ToString( CRC ) + " " + UTIL_ToString( (unsigned long)CommonJStat.st_size ) + ":" + UTIL_ToString( (unsigned long)CommonJStat.st_mtime ) + " " + UTIL_ToString( (unsigned long)BlizzardJStat.st_size ) + ":" + UTIL_ToString( (unsigned long)BlizzardJStat.st_mtime );
+}
@@ -0,0 +1,64 @@
+/*
+
+	ent-ghost
+	Copyright [2011-2013] [Jack Lu]
+
+	This file is part of the ent-ghost source code.
+
+	ent-ghost is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	ent-ghost source code is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with ent-ghost source code. If not, see <http://www.gnu.org/licenses/>.
+
+	ent-ghost is modified from GHost++ (http://ghostplusplus.googlecode.com/)
+	GHost++ is Copyright [2008] [Trevor Hogan]
+
+*/
+
+#ifndef MAPCACHE_H
+#define MAPCACHE_H
+
+#define MAPCACHE_VERSION		1
+#define MAPCACHE_SAMPLESIZE		65536		// bytes of the map file sampled from the start, middle and end for the cache key
+
+class CMappedFile;
+class CConfig;
+
+//
+// CMapCache
+//
+
+// an on disk cache of everything CMap :: Load calculates from a map file (map_size, map_info, map_crc, map_sha1, the chunk crcs and the war3map.w3i values)
+// there's one entry per map in bot_mapcachepath, stored as a config file so it can be inspected (and deleted) by hand
+// an entry is keyed by the map's size, modification time and a crc of the start, middle and end of the file
+// the size and modification time of common.j and blizzard.j are part of the key too since map_crc and map_sha1 depend on them
+// an entry that doesn't match the map any more is ignored and replaced when the map is loaded, bot_mapcacheforce ignores every entry
+
+class CMapCache
+{
+private:
+	CGHost *m_GHost;
+
+public:
+	CMapCache( CGHost *nGHost );
+	~CMapCache( );
+
+	bool GetEnabled( );
+	bool Read( string mapFile, const CMappedFile &file, CConfig *entry );
+	bool Write( string mapFile, const CMappedFile &file, CConfig *entry );
+	void Invalidate( string mapFile );
+
+private:
+	string GetEntryFile( string mapFile );
+	string GetKey( const CMappedFile &file );
+};
+
+#endif
@@ -0,0 +1,397 @@
+/*
+
+	ent-ghost
+	Copyright [2011-2013] [Jack Lu]
+
+	This file is part of the ent-ghost source code.
+
+	ent-ghost is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	ent-ghost source code is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with ent-ghost source code. If not, see <http://www.gnu.org/licenses/>.
+
+	ent-ghost is modified from GHost++ (http://ghostplusplus.googlecode.com/)
+	GHost++ is Copyright [2008] [Trevor Hogan]
+
+*/
+
+#include "ghost.h"
+#include "util.h"
+#include "mapindex.h"
+
+#include <boost/filesystem.hpp>
+
+#ifdef __linux__
+ #include <sys/inotify.h>
+ #include <sys/prctl.h>
+ #include <poll.h>
+ #include <unistd.h>
+ #include <errno.h>
+#endif
+
+using namespace boost :: filesystem;
+
+//
+// CMapIndex
+//
+
+CMapIndex :: CMapIndex( string nPath, string nExtension, uint32_t nRescanInterval ) : m_Path( nPath ), m_Extension( nExtension ), m_RescanInterval( nRescanInterval ), m_Data( new MapIndexData( ) ), m_Exiting( false ), m_Thread( NULL )
+{
+	transform( m_Extension.begin( ), m_Extension.end( ), m_Extension.begin( ), (int(*)(int))tolower );
+
+	// the first scan happens right here so the index is complete as soon as the bot starts
+
+	if( Scan( ) )
+		CONSOLE_Print( "[MAPINDEX] indexed " + UTIL_ToString( GetNumFiles( ) ) + " files in [" + m_Path + "]" );
+
+	m_Thread = new boost::thread( &CMapIndex :: loop, this );
+}
+
+CMapIndex :: ~CMapIndex( )
+{
+	if( m_Thread )
+	{
+		m_Exiting = true;
+		m_Thread->join( );
+		delete m_Thread;
+	}
+}
+
+uint32_t CMapIndex :: GetNumFiles( )
+{
+	boost::mutex::scoped_lock lock( m_DataMutex );
+	return m_Data->entries.size( );
+}
+
+void CMapIndex :: GetFiles( vector<string> &files )
+{
+	files.clear( );
+
+	boost::mutex::scoped_lock lock( m_DataMutex );
+	SHAREDMAPINDEXDATA Data = m_Data;
+	lock.unlock( );
+
+	for( vector<MapIndexEntry> :: const_iterator i = Data->entries.begin( ); i != Data->entries.end( ); ++i )
+		files.push_back( i->name );
+}
+
+uint32_t CMapIndex :: Find( string pattern, vector<string> &matches )
+{
+	// return the number of files with pattern in their name, and their names (at most MAPINDEX_MAXMATCHES) in matches
+	// if the pattern matches a file name exactly, with or without extension, that file is the only match
+	// otherwise the matches are ranked: names starting with the pattern first, then shorter names first, then alphabetically
+	// if nothing contains the pattern the closest names by trigram similarity are returned in matches as suggestions but zero is returned
+	// so the caller never loads a file the user didn't actually ask for
+
+	matches.clear( );
+	transform( pattern.begin( ), pattern.end( ), pattern.begin( ), (int(*)(int))tolower );
+
+	boost::mutex::scoped_lock lock( m_DataMutex );
+	SHAREDMAPINDEXDATA Data = m_Data;
+	lock.unlock( );
+
+	vector<pair<pair<int, uint32_t>, uint32_t> > Ranked;
+
+	for( uint32_t i = 0; i < Data->entries.size( ); ++i )
+	{
+		const MapIndexEntry &Entry = Data->entries[i];
+
+		if( Entry.lower == pattern || Entry.lowerStem == pattern )
+		{
+			matches.push_back( Entry.name );
+			return 1;
+		}
+
+		string :: size_type Position = Entry.lower.find( pattern );
+
+		if( Position != string :: npos )
+			Ranked.push_back( make_pair( make_pair( Position == 0 ? 0 : 1, (uint32_t)Entry.lower.size( ) ), i ) );
+	}
+
+	if( !Ranked.empty( ) )
+	{
+		// the entries are sorted by name so the index breaks ties alphabetically
+
+		sort( Ranked.begin( ), Ranked.end( ) );
+
+		for( uint32_t i = 0; i < Ranked.size( ) && i < MAPINDEX_MAXMATCHES; ++i )
+			matches.push_back( Data->entries[Ranked[i].second].name );
+
+		return Ranked.size( );
+	}
+
+	// nothing contains the pattern, look for names containing the most trigrams of it (this catches most typos)
+
+	vector<uint32_t> Trigrams;
+	GetTrigrams( pattern, Trigrams );
+
+	if( Trigrams.empty( ) )
+		return 0;
+
+	map<uint32_t, uint32_t> Shared;
+
+	for( vector<uint32_t> :: iterator i = Trigrams.begin( ); i != Trigrams.end( ); ++i )
+	{
+		map<uint32_t, vector<uint32_t> > :: const_iterator Posting = Data->trigrams.find( *i );
+
+		if( Posting != Data->trigrams.end( ) )
+		{
+			for( vector<uint32_t> :: const_iterator j = Posting->second.begin( ); j != Posting->second.end( ); ++j )
+				++Shared[*j];
+		}
+	}
+
+	// rank by the number of shared trigrams, then by the number of trigrams that aren't shared so shorter names come first
+
+	vector<pair<pair<int, uint32_t>, uint32_t> > Similar;
+
+	for( map<uint32_t, uint32_t> :: iterator i = Shared.begin( ); i != Shared.end( ); ++i )
+	{
+		if( i->second >= MAPINDEX_MINSCORE * Trigrams.size( ) )
+			Similar.push_back( make_pair( make_pair( -(int)i->second, Data->entries[i->first].numTrigrams - i->second ), i->first ) );
+	}
+
+	sort( Similar.begin( ), Similar.end( ) );
+
+	for( uint32_t i = 0; i < Similar.size( ) && i < MAPINDEX_MAXMATCHES; ++i )
+		matches.push_back( Data->entries[Similar[i].second].name );
+
+	return 0;
+}
+
+uint32_t CMapIndex :: GetUnwatchedInterval( )
+{
+	uint32_t RescanInterval = m_RescanInterval;
+	return RescanInterval != 0 && RescanInterval < MAPINDEX_UNWATCHEDRESCAN ? RescanInterval : MAPINDEX_UNWATCHEDRESCAN;
+}
+
+void CMapIndex :: loop( )
+{
+#ifdef __linux__
+	prctl( PR_SET_NAME, "ghost-mapindex", 0, 0, 0 );
+
+	int Notify = inotify_init1( IN_NONBLOCK | IN_CLOEXEC );
+	int Watch = -1;
+
+	if( Notify == -1 )
+		CONSOLE_Print( "[MAPINDEX] error initializing inotify for [" + m_Path + "], only rescanning every " + UTIL_ToString( GetUnwatchedInterval( ) ) + " seconds" );
+	else
+	{
+		Watch = inotify_add_watch( Notify, m_Path.empty( ) ? "." : m_Path.c_str( ), IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_CLOSE_WRITE | IN_DELETE_SELF | IN_MOVE_SELF );
+
+		if( Watch == -1 )
+			CONSOLE_Print( "[MAPINDEX] error watching [" + m_Path + "], only rescanning every " + UTIL_ToString( GetUnwatchedInterval( ) ) + " seconds" );
+	}
+#endif
+
+	uint32_t LastScanTime = GetTime( );
+
+	while( !m_Exiting )
+	{
+		// without a watch nothing tells us about changes so keep rescanning even if bot_mapindexrescan is zero
+
+		bool Watched = false;
+
+#ifdef __linux__
+		Watched = Watch != -1;
+#endif
+
+		uint32_t RescanInterval = Watched ? m_RescanInterval : GetUnwatchedInterval( );
+		bool Rescan = RescanInterval != 0 && GetTime( ) - LastScanTime >= RescanInterval;
+
+#ifdef __linux__
+		if( Watch != -1 )
+		{
+			// wait up to one second for something to happen in the directory so we notice m_Exiting quickly
+
+			struct pollfd PollFD;
+			PollFD.fd = Notify;
+			PollFD.events = POLLIN;
+			PollFD.revents = 0;
+
+			if( poll( &PollFD, 1, 1000 ) > 0 )
+			{
+				// the buffer must be aligned for struct inotify_event and big enough for at least one event with the longest file name
+
+				char Buffer[4096] __attribute__ ((aligned(__alignof__(struct inotify_event))));
+				bool Changed = false;
+				ssize_t Length;
+
+				while( ( Length = read( Notify, Buffer, sizeof( Buffer ) ) ) > 0 )
+				{
+					for( char *Pointer = Buffer; Pointer < Buffer + Length; )
+					{
+						struct inotify_event *Event = (struct inotify_event *)Pointer;
+						Pointer += sizeof( struct inotify_event ) + Event->len;
+
+						if( Event->mask & IN_Q_OVERFLOW )
+						{
+							// the kernel dropped some events so we don't know what changed anymore
+
+							Rescan = true;
+						}
+						else if( Event->mask & ( IN_DELETE_SELF | IN_MOVE_SELF | IN_IGNORED ) )
+						{
+							// the directory itself is gone, keep rescanning in case it comes back
+							// deleting it queues both IN_DELETE_SELF and IN_IGNORED so only report the first
+
+							if( Watch != -1 )
+								CONSOLE_Print( "[MAPINDEX] lost the watch on [" + m_Path + "], only rescanning every " + UTIL_ToString( GetUnwatchedInterval( ) ) + " seconds" );
+
+							Watch = -1;
+							Rescan = true;
+						}
+						else if( Event->len > 0 && !( Event->mask & IN_ISDIR ) )
+						{
+							string Name = Event->name;
+
+							if( Event->mask & ( IN_DELETE | IN_MOVED_FROM ) )
+								Changed = m_Names.erase( Name ) > 0 || Changed;
+							else if( Wanted( Name ) && m_Names.insert( Name ).second )
+								Changed = true;
+						}
+					}
+				}
+
+				if( Changed && !Rescan )
+					Publish( );
+			}
+		}
+		else
+			MILLISLEEP( 1000 );
+#else
+		MILLISLEEP( 1000 );
+#endif
+
+		if( Rescan && !m_Exiting )
+		{
+#ifdef __linux__
+			// try to watch the directory again before scanning it so nothing that changes in between is missed
+
+			if( Notify != -1 && Watch == -1 )
+			{
+				Watch = inotify_add_watch( Notify, m_Path.empty( ) ? "." : m_Path.c_str( ), IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_CLOSE_WRITE | IN_DELETE_SELF | IN_MOVE_SELF );
+
+				if( Watch != -1 )
+					CONSOLE_Print( "[MAPINDEX] watching [" + m_Path + "] again" );
+			}
+#endif
+
+			Scan( );
+			LastScanTime = GetTime( );
+		}
+	}
+
+#ifdef __linux__
+	if( Notify != -1 )
+		close( Notify );
+#endif
+}
+
+bool CMapIndex :: Scan( )
+{
+	set<string> Names;
+
+	try
+	{
+		path Path( m_Path.empty( ) ? "." : m_Path );
+
+		if( !exists( Path ) )
+		{
+			CONSOLE_Print( "[MAPINDEX] error indexing [" + m_Path + "] - path doesn't exist" );
+			return false;
+		}
+
+		directory_iterator EndIterator;
+
+		for( directory_iterator i( Path ); i != EndIterator; ++i )
+		{
+			string Name = i->path( ).filename( ).string( );
+
+			if( !is_directory( i->status( ) ) && Wanted( Name ) )
+				Names.insert( Name );
+		}
+	}
+	catch( const exception &ex )
+	{
+		CONSOLE_Print( "[MAPINDEX] error indexing [" + m_Path + "] - caught exception [" + ex.what( ) + "]" );
+		return false;
+	}
+
+	if( Names != m_Names )
+	{
+		m_Names.swap( Names );
+		Publish( );
+	}
+
+	return true;
+}
+
+bool CMapIndex :: Wanted( string name )
+{
+	if( m_Extension.empty( ) )
+		return true;
+
+	if( name.size( ) < m_Extension.size( ) )
+		return false;
+
+	string Extension = name.substr( name.size( ) - m_Extension.size( ) );
+	transform( Extension.begin( ), Extension.end( ), Extension.begin( ), (int(*)(int))tolower );
+	return Extension == m_Extension;
+}
+
+void CMapIndex :: Publish( )
+{
+	// build a new snapshot from m_Names and swap it in, lookups still using the old one keep it alive until they're done
+
+	boost::shared_ptr<MapIndexData> Data( new MapIndexData( ) );
+	Data->entries.reserve( m_Names.size( ) );
+
+	for( set<string> :: iterator i = m_Names.begin( ); i != m_Names.end( ); ++i )
+	{
+		MapIndexEntry Entry;
+		Entry.name = *i;
+		Entry.lower = *i;
+		transform( Entry.lower.begin( ), Entry.lower.end( ), Entry.lower.begin( ), (int(*)(int))tolower );
+		string :: size_type Dot = Entry.lower.rfind( '.' );
+		Entry.lowerStem = Dot == string :: npos || Dot == 0 ? Entry.lower : Entry.lower.substr( 0, Dot );
+
+		vector<uint32_t> Trigrams;
+		GetTrigrams( Entry.lowerStem, Trigrams );
+		Entry.numTrigrams = Trigrams.size( );
+
+		for( vector<uint32_t> :: iterator j = Trigrams.begin( ); j != Trigrams.end( ); ++j )
+			Data->trigrams[*j].push_back( Data->entries.size( ) );
+
+		Data->entries.push_back( Entry );
+	}
+
+	boost::mutex::scoped_lock lock( m_DataMutex );
+	m_Data = Data;
+	lock.unlock( );
+}
+
+void CMapIndex :: GetTrigrams( const string &s, vector<uint32_t> &trigrams )
+{
+	// the distinct trigrams of s padded with a space on both sides so short patterns and word boundaries still count
+
+	trigrams.clear( );
+	string Padded = " " + s + " ";
+
+	if( Padded.size( ) < 3 )
+		return;
+
+	for( uint32_t i = 0; i + 3 <= Padded.size( ); ++i )
+		trigrams.push_back( ( (unsigned char)Padded[i] << 16 ) | ( (unsigned char)Padded[i + 1] << 8 ) | (unsigned char)Padded[i + 2] );
+
+	sort( trigrams.begin( ), trigrams.end( ) );
+	trigrams.erase( unique( trigrams.begin( ), trigrams.end( ) ), trigrams.end( ) );
+}
@@ -0,0 +1,94 @@
+/*
+
+	ent-ghost
+	Copyright [2011-2013] [Jack Lu]
+
+	This file is part of the ent-ghost source code.
+
+	ent-ghost is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	ent-ghost source code is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with ent-ghost source code. If not, see <http://www.gnu.org/licenses/>.
+
+	ent-ghost is modified from GHost++ (http://ghostplusplus.googlecode.com/)
+	GHost++ is Copyright [2008] [Trevor Hogan]
+
+*/
+
+#ifndef MAPINDEX_H
+#define MAPINDEX_H
+
+#define MAPINDEX_MAXMATCHES		10		// the maximum number of file names returned by CMapIndex :: Find
+#define MAPINDEX_MINSCORE		0.25	// the minimum fraction of the pattern's trigrams a file name needs for a fuzzy match
+#define MAPINDEX_UNWATCHEDRESCAN	60		// the most seconds between rescans of a directory inotify isn't watching
+
+struct MapIndexEntry {
+	string name;							// the file name as it is on disk
+	string lower;							// lower case file name
+	string lowerStem;						// lower case file name without the extension
+	uint32_t numTrigrams;					// number of distinct trigrams in lowerStem
+
+	MapIndexEntry( ) : numTrigrams( 0 ) { }
+};
+
+struct MapIndexData {
+	vector<MapIndexEntry> entries;			// sorted by name
+	map<uint32_t, vector<uint32_t> > trigrams;	// trigram -> indexes into entries of the files with that trigram in their stem
+};
+
+typedef boost::shared_ptr<const MapIndexData> SHAREDMAPINDEXDATA;
+
+//
+// CMapIndex
+//
+
+// an in memory list of the files in one directory (the map configs or the maps) for the !load and !map commands
+// the list is kept up to date by a background thread so looking something up never touches the filesystem
+// on Linux the thread watches the directory with inotify and applies every change as it happens
+// inotify doesn't see changes made by other machines to network storage so the directory is also rescanned every bot_mapindexrescan seconds
+// without a watch (no inotify, it failed or the directory was deleted or moved) it's rescanned at least every MAPINDEX_UNWATCHEDRESCAN seconds
+// and on Linux the thread tries to watch the directory again every time it rescans
+// the thread publishes a new immutable MapIndexData every time something changed, a lookup just takes a reference to the latest one
+
+class CMapIndex
+{
+private:
+	string m_Path;
+	string m_Extension;						// only index files with this extension, empty for every file
+	volatile uint32_t m_RescanInterval;		// seconds between full rescans, zero to only rescan when inotify asks for it (or MAPINDEX_UNWATCHEDRESCAN without a watch)
+	SHAREDMAPINDEXDATA m_Data;
+	boost::mutex m_DataMutex;				// protects m_Data (just the pointer, the data itself never changes)
+	set<string> m_Names;					// the file names in the directory, only touched by the index thread after construction
+	volatile bool m_Exiting;
+	boost::thread *m_Thread;
+
+public:
+	CMapIndex( string nPath, string nExtension, uint32_t nRescanInterval );
+	~CMapIndex( );
+
+	string GetPath( )						{ return m_Path; }
+	void SetRescanInterval( uint32_t nRescanInterval )	{ m_RescanInterval = nRescanInterval; }
+	uint32_t GetNumFiles( );
+	void GetFiles( vector<string> &files );
+
+	uint32_t Find( string pattern, vector<string> &matches );
+
+	void loop( );
+
+private:
+	bool Scan( );
+	uint32_t GetUnwatchedInterval( );
+	bool Wanted( string name );
+	void Publish( );
+	static void GetTrigrams( const string &s, vector<uint32_t> &trigrams );
+};
+
+#endif
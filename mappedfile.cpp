@@ -0,0 +1,208 @@
+/*
+
+	ent-ghost
+	Copyright [2011-2013] [Jack Lu]
+
+	This file is part of the ent-ghost source code.
+
+	ent-ghost is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	ent-ghost source code is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with ent-ghost source code. If not, see <http://www.gnu.org/licenses/>.
+
+	ent-ghost is modified from GHost++ (http://ghostplusplus.googlecode.com/)
+	GHost++ is Copyright [2008] [Trevor Hogan]
+
+*/
+
+#include "ghost.h"
+#include "util.h"
+#include "mappedfile.h"
+
+#ifndef WIN32
+ #include <errno.h>
+ #include <fcntl.h>
+ #include <unistd.h>
+ #include <sys/mman.h>
+ #include <sys/stat.h>
+#endif
+
+//
+// CMappedFile
+//
+
+CMappedFile :: CMappedFile( ) : m_Data( NULL ), m_Size( 0 ), m_Mapped( false ), m_Device( 0 ), m_Inode( 0 ), m_FileSize( 0 ), m_ModifiedTime( 0 )
+{
+
+}
+
+CMappedFile :: ~CMappedFile( )
+{
+	Close( );
+}
+
+bool CMappedFile :: Open( string fileName, int advice, bool copy )
+{
+	Close( );
+	m_FileName = fileName;
+
+#ifdef WIN32
+	string Data = UTIL_FileRead( fileName );
+
+	if( Data.empty( ) )
+		return false;
+
+	m_Data = new unsigned char[Data.size( )];
+	m_Size = Data.size( );
+	memcpy( m_Data, Data.data( ), m_Size );
+	return true;
+#else
+	int FD = open( fileName.c_str( ), O_RDONLY );
+
+	if( FD == -1 )
+	{
+		CONSOLE_Print( "[UTIL] warning - unable to read file [" + fileName + "]" );
+		return false;
+	}
+
+	struct stat Stat;
+
+	if( fstat( FD, &Stat ) == -1 || !S_ISREG( Stat.st_mode ) || Stat.st_size == 0 || (uint64_t)Stat.st_size > 0xFFFFFFFF )
+	{
+		CONSOLE_Print( "[UTIL] warning - unable to read file [" + fileName + "]" );
+		close( FD );
+		return false;
+	}
+
+	m_Device = Stat.st_dev;
+	m_Inode = Stat.st_ino;
+	m_FileSize = Stat.st_size;
+	m_ModifiedTime = Stat.st_mtime;
+
+	if( copy )
+	{
+		// a heap copy can't be changed (or truncated) under us so it's safe to read even if the file is overwritten in place
+
+		m_Data = new unsigned char[Stat.st_size];
+		m_Size = Stat.st_size;
+		uint32_t Read = 0;
+
+		while( Read < m_Size )
+		{
+			ssize_t Result = read( FD, m_Data + Read, m_Size - Read );
+
+			if( Result == -1 && errno == EINTR )
+				continue;
+
+			if( Result <= 0 )
+				break;
+
+			Read += Result;
+		}
+
+		close( FD );
+
+		if( Read < m_Size )
+		{
+			CONSOLE_Print( "[UTIL] warning - unable to read file [" + fileName + "]" );
+			Close( );
+			return false;
+		}
+
+		return true;
+	}
+
+	void *Data = mmap( NULL, Stat.st_size, PROT_READ, MAP_SHARED, FD, 0 );
+
+	// the mapping keeps the file open so we don't need the descriptor any more
+
+	close( FD );
+
+	if( Data == MAP_FAILED )
+	{
+		CONSOLE_Print( "[UTIL] warning - unable to map file [" + fileName + "], error " + UTIL_ToString( errno ) );
+		return false;
+	}
+
+	m_Data = (unsigned char *)Data;
+	m_Size = Stat.st_size;
+	m_Mapped = true;
+	Advise( advice );
+	return true;
+#endif
+}
+
+uint32_t CMappedFile :: GetChange( ) const
+{
+#ifdef WIN32
+	// the file was read into a heap buffer so it can't have changed under us and we don't notice replacements either
+
+	return MAPPEDFILE_UNCHANGED;
+#else
+	if( !m_Data )
+		return MAPPEDFILE_UNCHANGED;
+
+	struct stat Stat;
+
+	// if the file was deleted our view of it is still intact so keep using it
+
+	if( stat( m_FileName.c_str( ), &Stat ) == -1 )
+		return MAPPEDFILE_UNCHANGED;
+
+	if( (uint64_t)Stat.st_dev != m_Device || (uint64_t)Stat.st_ino != m_Inode )
+		return MAPPEDFILE_REPLACED;
+
+	if( (uint64_t)Stat.st_size == m_FileSize && (int64_t)Stat.st_mtime == m_ModifiedTime )
+		return MAPPEDFILE_UNCHANGED;
+
+	// the file was written to in place, a mapping now shows the new contents (or raises SIGBUS past the new end) but a heap copy doesn't
+
+	return m_Mapped ? MAPPEDFILE_MODIFIED : MAPPEDFILE_REPLACED;
+#endif
+}
+
+void CMappedFile :: Advise( int advice )
+{
+	// these are only hints so errors are ignored
+
+#ifndef WIN32
+	if( !m_Mapped )
+		return;
+
+	if( advice & MAPPEDFILE_SEQUENTIAL )
+		madvise( m_Data, m_Size, MADV_SEQUENTIAL );
+	else if( advice & MAPPEDFILE_RANDOM )
+		madvise( m_Data, m_Size, MADV_RANDOM );
+	else
+		madvise( m_Data, m_Size, MADV_NORMAL );
+
+	if( advice & MAPPEDFILE_WILLNEED )
+		madvise( m_Data, m_Size, MADV_WILLNEED );
+#endif
+}
+
+void CMappedFile :: Close( )
+{
+#ifndef WIN32
+	if( m_Mapped )
+		munmap( m_Data, m_Size );
+	else
+#endif
+		delete [] m_Data;
+
+	m_Data = NULL;
+	m_Size = 0;
+	m_Mapped = false;
+	m_Device = 0;
+	m_Inode = 0;
+	m_FileSize = 0;
+	m_ModifiedTime = 0;
+}
@@ -0,0 +1,79 @@
+/*
+
+	ent-ghost
+	Copyright [2011-2013] [Jack Lu]
+
+	This file is part of the ent-ghost source code.
+
+	ent-ghost is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	ent-ghost source code is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with ent-ghost source code. If not, see <http://www.gnu.org/licenses/>.
+
+	ent-ghost is modified from GHost++ (http://ghostplusplus.googlecode.com/)
+	GHost++ is Copyright [2008] [Trevor Hogan]
+
+*/
+
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#define MAPPEDFILE_NORMAL		0		// no particular access pattern
+#define MAPPEDFILE_SEQUENTIAL	1		// the file will be read from start to end (read ahead aggressively)
+#define MAPPEDFILE_RANDOM		2		// the file will be read in no particular order (don't read ahead)
+#define MAPPEDFILE_WILLNEED		4		// the whole file will be needed soon (start reading it in now)
+
+#define MAPPEDFILE_UNCHANGED	0		// the file hasn't changed since it was opened
+#define MAPPEDFILE_REPLACED		1		// the file name refers to a different file now (or our copy of a changed file is still intact)
+#define MAPPEDFILE_MODIFIED		2		// the file was changed in place, the mapping might not match what was read when it was opened
+
+//
+// CMappedFile
+//
+
+// a read only view of a whole file
+// on POSIX systems the file is memory mapped so its contents are only held once in the page cache no matter how many times (or by how many processes) it's opened
+// on Windows (or when asked to) it's just read into a heap buffer
+// the file must not be truncated while it's mapped (reading past the new end raises SIGBUS), replace files by writing a new file and renaming it over the old one instead
+// GetChange compares the file on disk with the one we opened so users can notice a file that was changed anyway and open it again
+
+class CMappedFile
+{
+private:
+	string m_FileName;
+	unsigned char *m_Data;
+	uint32_t m_Size;
+	bool m_Mapped;						// if m_Data is a memory mapping rather than a heap buffer
+	uint64_t m_Device;					// the device, inode, size and modification time of the file when it was opened (see GetChange)
+	uint64_t m_Inode;
+	uint64_t m_FileSize;
+	int64_t m_ModifiedTime;
+
+public:
+	CMappedFile( );
+	~CMappedFile( );
+
+	string GetFileName( ) const				{ return m_FileName; }
+	const unsigned char *GetData( ) const	{ return m_Data; }
+	uint32_t GetSize( ) const				{ return m_Size; }
+	bool GetMapped( ) const					{ return m_Mapped; }
+
+	bool Open( string fileName, int advice, bool copy = false );
+	uint32_t GetChange( ) const;
+	void Advise( int advice );
+	void Close( );
+
+private:
+	CMappedFile( const CMappedFile & );
+	CMappedFile &operator=( const CMappedFile & );
+};
+
+#endif
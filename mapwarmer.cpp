@@ -0,0 +1,126 @@
+/*
+
+	ent-ghost
+	Copyright [2011-2013] [Jack Lu]
+
+	This file is part of the ent-ghost source code.
+
+	ent-ghost is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	ent-ghost source code is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with ent-ghost source code. If not, see <http://www.gnu.org/licenses/>.
+
+	ent-ghost is modified from GHost++ (http://ghostplusplus.googlecode.com/)
+	GHost++ is Copyright [2008] [Trevor Hogan]
+
+*/
+
+#include "ghost.h"
+#include "util.h"
+#include "config.h"
+#include "map.h"
+#include "mapindex.h"
+#include "mapwarmer.h"
+
+//
+// CMapWarmer
+//
+
+CMapWarmer :: CMapWarmer( CGHost *nGHost, uint32_t nNumThreads ) : m_GHost( nGHost ), m_NextFile( 0 ), m_NumDone( 0 ), m_StartTicks( GetTicks( ) ), m_LastProgressTime( GetTime( ) ), m_NumRunning( 0 ), m_Exiting( false )
+{
+	m_GHost->m_MapCFGIndex->GetFiles( m_Files );
+
+	if( m_Files.empty( ) )
+	{
+		CONSOLE_Print( "[MAPWARMER] no map configs found in [" + m_GHost->m_MapCFGPath + "]" );
+		return;
+	}
+
+	if( nNumThreads == 0 )
+		nNumThreads = 1;
+
+	if( nNumThreads > m_Files.size( ) )
+		nNumThreads = m_Files.size( );
+
+	if( !m_GHost->m_MapCachePath.empty( ) )
+		CONSOLE_Print( "[MAPWARMER] validating " + UTIL_ToString( m_Files.size( ) ) + " map configs on " + UTIL_ToString( nNumThreads ) + " threads" );
+	else
+		CONSOLE_Print( "[MAPWARMER] validating " + UTIL_ToString( m_Files.size( ) ) + " map configs on " + UTIL_ToString( nNumThreads ) + " threads (warning - the map cache is disabled so nothing will be remembered)" );
+
+	m_NumRunning = nNumThreads;
+
+	for( uint32_t i = 0; i < nNumThreads; ++i )
+		m_Threads.push_back( new boost::thread( &CMapWarmer :: loop, this ) );
+}
+
+CMapWarmer :: ~CMapWarmer( )
+{
+	// the workers finish the config they're loading and stop
+
+	m_Exiting = true;
+
+	for( vector<boost::thread *> :: iterator i = m_Threads.begin( ); i != m_Threads.end( ); ++i )
+	{
+		(*i)->join( );
+		delete *i;
+	}
+}
+
+void CMapWarmer :: loop( )
+{
+	while( !m_Exiting )
+	{
+		boost::mutex::scoped_lock lock( m_Mutex );
+
+		if( m_NextFile >= m_Files.size( ) )
+			break;
+
+		string File = m_Files[m_NextFile++];
+		lock.unlock( );
+
+		CConfig MapCFG;
+		MapCFG.Read( m_GHost->m_MapCFGPath + File );
+		CMap Map( m_GHost, &MapCFG, m_GHost->m_MapCFGPath + File );
+
+		lock.lock( );
+		++m_NumDone;
+
+		if( !Map.GetValid( ) )
+			m_Invalid.push_back( File );
+
+		if( GetTime( ) - m_LastProgressTime >= MAPWARMER_PROGRESSINTERVAL && m_NumDone < m_Files.size( ) )
+		{
+			CONSOLE_Print( "[MAPWARMER] validated " + UTIL_ToString( m_NumDone ) + "/" + UTIL_ToString( m_Files.size( ) ) + " map configs, " + UTIL_ToString( m_Invalid.size( ) ) + " invalid" );
+			m_LastProgressTime = GetTime( );
+		}
+	}
+
+	// the last worker to finish reports the results
+
+	boost::mutex::scoped_lock lock( m_Mutex );
+
+	if( m_NumRunning == 1 )
+	{
+		if( m_NumDone < m_Files.size( ) )
+			CONSOLE_Print( "[MAPWARMER] stopped after validating " + UTIL_ToString( m_NumDone ) + "/" + UTIL_ToString( m_Files.size( ) ) + " map configs" );
+		else
+		{
+			CONSOLE_Print( "[MAPWARMER] validated " + UTIL_ToString( m_NumDone ) + " map configs in " + UTIL_ToString( ( GetTicks( ) - m_StartTicks ) / 1000 ) + " seconds, " + UTIL_ToString( m_Invalid.size( ) ) + " invalid" );
+
+			sort( m_Invalid.begin( ), m_Invalid.end( ) );
+
+			for( vector<string> :: iterator i = m_Invalid.begin( ); i != m_Invalid.end( ); ++i )
+				CONSOLE_Print( "[MAPWARMER] warning - map config [" + m_GHost->m_MapCFGPath + *i + "] is invalid" );
+		}
+	}
+
+	--m_NumRunning;
+}
@@ -0,0 +1,65 @@
+/*
+
+	ent-ghost
+	Copyright [2011-2013] [Jack Lu]
+
+	This file is part of the ent-ghost source code.
+
+	ent-ghost is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	ent-ghost source code is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with ent-ghost source code. If not, see <http://www.gnu.org/licenses/>.
+
+	ent-ghost is modified from GHost++ (http://ghostplusplus.googlecode.com/)
+	GHost++ is Copyright [2008] [Trevor Hogan]
+
+*/
+
+#ifndef MAPWARMER_H
+#define MAPWARMER_H
+
+#define MAPWARMER_PROGRESSINTERVAL	10		// seconds between progress messages
+
+//
+// CMapWarmer
+//
+
+// validates every map config in the map config path in the background when the bot starts (bot_mapwarmup)
+// each config is loaded into a throwaway CMap exactly like !load would, which calculates the map values and stores them in the map cache (see CMapCache)
+// so the first !load of each map afterwards only has to read the cache and the map is already in the page cache
+// the configs are spread over a small number of worker threads (bot_mapwarmupthreads), hashing is cheap enough that a few threads are bound by the disk
+// invalid configs are reported when everything is done rather than when someone tries to load them
+
+class CMapWarmer
+{
+private:
+	CGHost *m_GHost;
+	vector<string> m_Files;					// the map config file names to validate
+	uint32_t m_NextFile;					// index into m_Files of the next config a worker should take
+	uint32_t m_NumDone;
+	vector<string> m_Invalid;				// the map config file names that didn't pass CMap :: CheckValid
+	uint32_t m_StartTicks;
+	uint32_t m_LastProgressTime;
+	boost::mutex m_Mutex;					// protects everything above
+	vector<boost::thread *> m_Threads;
+	volatile uint32_t m_NumRunning;			// number of workers still running
+	volatile bool m_Exiting;
+
+public:
+	CMapWarmer( CGHost *nGHost, uint32_t nNumThreads );
+	~CMapWarmer( );
+
+	bool GetDone( )						{ return m_NumRunning == 0; }
+
+	void loop( );
+};
+
+#endif
@@ -27,9 +27,17 @@
 #include "util.h"
 #include "crc32.h"
 #include "packed.h"
+#include "mappedfile.h"
 
 #include <zlib.h>
 
+#ifdef GHOST_LIBDEFLATE
+ #include <libdeflate.h>
+#endif
+
+#include <boost/bind.hpp>
+#include <boost/function.hpp>
+
 // we can't use zlib's uncompress function because it expects a complete compressed buffer
 // however, we're going to be passing it chunks of incomplete data
 // this custom tzuncompress function will do the job
@@ -67,10 +75,180 @@ int tzuncompress( Bytef *dest, uLongf *destLen, const Bytef *source, uLong sourc
 	return err;
 }
 
+// the blocks of a packed file are independent zlib streams so they're compressed and decompressed on the threads of CPacked :: m_Pool
+// each thread gets a contiguous range of blocks and writes into its own part of the preallocated output
+
+struct PackedBlock {
+	uint32_t position;						// position of the compressed data in the source
+	uint16_t compressedSize;
+	uint32_t offset;						// position of the decompressed data in the destination
+	uint16_t decompressedSize;
+	int result;
+	uLongf actualSize;
+
+	PackedBlock( uint32_t nPosition, uint16_t nCompressedSize, uint32_t nOffset, uint16_t nDecompressedSize ) : position( nPosition ), compressedSize( nCompressedSize ), offset( nOffset ), decompressedSize( nDecompressedSize ), result( Z_OK ), actualSize( 0 ) { }
+};
+
+struct PackedJob {
+	boost::function<void( uint32_t, uint32_t )> work;
+	uint32_t numBlocks;
+	uint32_t numRanges;
+	uint32_t remaining;						// ranges that haven't finished yet (protected by the pool's mutex)
+
+	PackedJob( const boost::function<void( uint32_t, uint32_t )> &nWork, uint32_t nNumBlocks, uint32_t nNumRanges ) : work( nWork ), numBlocks( nNumBlocks ), numRanges( nNumRanges ), remaining( nNumRanges ) { }
+};
+
+void RunBlocks( CPackedPool *pool, uint32_t numBlocks, const boost::function<void( uint32_t, uint32_t )> &work )
+{
+	if( pool )
+		pool->Run( numBlocks, work );
+	else
+		work( 0, numBlocks );
+}
+
+void DecompressBlocks( const unsigned char *data, unsigned char *decompressed, vector<PackedBlock> *blocks, uint32_t first, uint32_t last )
+{
+	for( uint32_t i = first; i < last; ++i )
+	{
+		PackedBlock &Block = (*blocks)[i];
+		Block.actualSize = Block.decompressedSize;
+		Block.result = tzuncompress( (Bytef *)decompressed + Block.offset, &Block.actualSize, data + Block.position, Block.compressedSize );
+	}
+}
+
+void CompressBlocks( CCRC32 *crc, const string *decompressed, const string *lastBlock, vector<string> *blocks, vector<unsigned char> *results, uint32_t first, uint32_t last )
+{
+	// the last block comes from lastBlock because it has to be padded
+
+	for( uint32_t i = first; i < last; ++i )
+	{
+		const unsigned char *Data = i + 1 == blocks->size( ) ? (const unsigned char *)lastBlock->data( ) : (const unsigned char *)decompressed->data( ) + i * PACKED_BLOCKSIZE;
+		(*results)[i] = CPacked :: CompressBlock( crc, Data, (*blocks)[i] );
+	}
+}
+
+#ifdef GHOST_LIBDEFLATE
+
+// libdeflate compressors aren't thread safe and are expensive to allocate so every thread that compresses blocks keeps its own
+
+struct PackedDeflater {
+	struct libdeflate_compressor *compressor;
+	int level;
+
+	PackedDeflater( int nLevel ) : compressor( libdeflate_alloc_compressor( nLevel ) ), level( nLevel ) { }
+	~PackedDeflater( )		{ if( compressor ) libdeflate_free_compressor( compressor ); }
+};
+
+boost::thread_specific_ptr<PackedDeflater> gPackedDeflater;
+
+#endif
+
+//
+// CPackedPool
+//
+
+CPackedPool :: CPackedPool( uint32_t nNumThreads ) : m_Exiting( false )
+{
+	// the calling thread always works on one range itself so it counts as one of the threads
+
+	for( uint32_t i = 1; i < nNumThreads; ++i )
+		m_Threads.push_back( new boost::thread( &CPackedPool :: loop, this ) );
+}
+
+CPackedPool :: ~CPackedPool( )
+{
+	boost::mutex::scoped_lock lock( m_Mutex );
+	m_Exiting = true;
+	m_QueueCond.notify_all( );
+	lock.unlock( );
+
+	for( vector<boost::thread *> :: iterator i = m_Threads.begin( ); i != m_Threads.end( ); ++i )
+	{
+		(*i)->join( );
+		delete *i;
+	}
+}
+
+void CPackedPool :: Run( uint32_t numBlocks, const boost::function<void( uint32_t, uint32_t )> &work )
+{
+	// call work( first, last ) for every range of blocks and return when they're all done
+
+	uint32_t NumRanges = min( GetNumThreads( ), numBlocks / PACKED_THREADBLOCKS );
+
+	if( NumRanges <= 1 )
+	{
+		work( 0, numBlocks );
+		return;
+	}
+
+	PackedJob Job( work, numBlocks, NumRanges );
+	boost::mutex::scoped_lock lock( m_Mutex );
+
+	for( uint32_t i = 1; i < NumRanges; ++i )
+		m_Queue.push_back( make_pair( &Job, i ) );
+
+	m_QueueCond.notify_all( );
+	lock.unlock( );
+
+	RunRange( &Job, 0 );
+
+	lock.lock( );
+
+	while( Job.remaining > 0 )
+	{
+		if( m_Queue.empty( ) )
+		{
+			m_DoneCond.wait( lock );
+			continue;
+		}
+
+		pair<PackedJob *, uint32_t> Range = m_Queue.front( );
+		m_Queue.pop_front( );
+		lock.unlock( );
+		RunRange( Range.first, Range.second );
+		lock.lock( );
+	}
+}
+
+void CPackedPool :: loop( )
+{
+	boost::mutex::scoped_lock lock( m_Mutex );
+
+	while( true )
+	{
+		while( m_Queue.empty( ) && !m_Exiting )
+			m_QueueCond.wait( lock );
+
+		if( m_Queue.empty( ) )
+			break;
+
+		pair<PackedJob *, uint32_t> Range = m_Queue.front( );
+		m_Queue.pop_front( );
+		lock.unlock( );
+		RunRange( Range.first, Range.second );
+		lock.lock( );
+	}
+}
+
+void CPackedPool :: RunRange( PackedJob *job, uint32_t range )
+{
+	// the job belongs to a caller that's waiting in Run so it's valid until its last range is done
+
+	job->work( (uint32_t)( (uint64_t)job->numBlocks * range / job->numRanges ), (uint32_t)( (uint64_t)job->numBlocks * ( range + 1 ) / job->numRanges ) );
+
+	boost::mutex::scoped_lock lock( m_Mutex );
+
+	if( --job->remaining == 0 )
+		m_DoneCond.notify_all( );
+}
+
 //
 // CPacked
 //
 
+int CPacked :: m_Level = 6;
+CPackedPool *CPacked :: m_Pool = NULL;
+
 CPacked :: CPacked( ) : m_Valid( true ), m_HeaderSize( 0 ), m_CompressedSize( 0 ), m_HeaderVersion( 0 ), m_DecompressedSize( 0 ), m_NumBlocks( 0 ), m_War3Identifier( 0 ), m_War3Version( 0 ), m_BuildNumber( 0 ), m_Flags( 0 ), m_ReplayLength( 0 )
 {
 	m_CRC = new CCRC32( );
@@ -86,8 +264,13 @@ void CPacked :: Load( string fileName, bool allBlocks )
 {
 	m_Valid = true;
 	CONSOLE_Print( "[PACKED] loading data from file [" + fileName + "]" );
-	m_Compressed = UTIL_FileRead( fileName );
-	Decompress( allBlocks );
+
+	// decompress straight from the mapped file instead of reading it into m_Compressed first
+
+	CMappedFile File;
+	File.Open( fileName, MAPPEDFILE_SEQUENTIAL );
+	m_Compressed.clear( );
+	Decompress( File.GetData( ), File.GetSize( ), allBlocks );
 }
 
 bool CPacked :: Save( bool TFT, string fileName )
@@ -107,8 +290,10 @@ bool CPacked :: Extract( string inFileName, string outFileName )
 {
 	m_Valid = true;
 	CONSOLE_Print( "[PACKED] extracting data from file [" + inFileName + "] to file [" + outFileName + "]" );
-	m_Compressed = UTIL_FileRead( inFileName );
-	Decompress( true );
+	CMappedFile File;
+	File.Open( inFileName, MAPPEDFILE_SEQUENTIAL );
+	m_Compressed.clear( );
+	Decompress( File.GetData( ), File.GetSize( ), true );
 
 	if( m_Valid )
 		return UTIL_FileWrite( outFileName, (unsigned char *)m_Decompressed.c_str( ), m_Decompressed.size( ) );
@@ -130,131 +315,133 @@ bool CPacked :: Pack( bool TFT, string inFileName, string outFileName )
 }
 
 void CPacked :: Decompress( bool allBlocks )
+{
+	Decompress( (const unsigned char *)m_Compressed.data( ), m_Compressed.size( ), allBlocks );
+}
+
+void CPacked :: Decompress( const unsigned char *data, uint32_t size, bool allBlocks )
 {
 	CONSOLE_Print( "[PACKED] decompressing data" );
 
 	// format found at http://www.thehelper.net/forums/showthread.php?t=42787
 
 	m_Decompressed.clear( );
-	istringstream ISS( m_Compressed );
-	string GarbageString;
+	uint32_t Position = 0;
 
 	// read header
 
-	getline( ISS, GarbageString, '\0' );
+	const unsigned char *HeaderEnd = size > 0 ? (const unsigned char *)memchr( data, 0, size ) : NULL;
 
-	if( GarbageString != "Warcraft III recorded game\x01A" )
+	if( !HeaderEnd || string( (const char *)data, HeaderEnd - data ) != "Warcraft III recorded game\x01A" )
 	{
 		CONSOLE_Print( "[PACKED] not a valid packed file" );
 		m_Valid = false;
 		return;
 	}
 
-	ISS.read( (char *)&m_HeaderSize, 4 );			// header size
-	ISS.read( (char *)&m_CompressedSize, 4 );		// compressed file size
-	ISS.read( (char *)&m_HeaderVersion, 4 );		// header version
-	ISS.read( (char *)&m_DecompressedSize, 4 );		// decompressed file size
-	ISS.read( (char *)&m_NumBlocks, 4 );			// number of blocks
+	Position = HeaderEnd - data + 1;
 
-	if( m_HeaderVersion == 0 )
+	if( size - Position < 20 )
 	{
-		ISS.seekg( 2, ios :: cur );					// unknown
-		ISS.seekg( 2, ios :: cur );					// version number
-
-		CONSOLE_Print( "[PACKED] header version is too old" );
+		CONSOLE_Print( "[PACKED] failed to read header" );
 		m_Valid = false;
 		return;
 	}
-	else
+
+	memcpy( &m_HeaderSize, data + Position, 4 );			// header size
+	memcpy( &m_CompressedSize, data + Position + 4, 4 );	// compressed file size
+	memcpy( &m_HeaderVersion, data + Position + 8, 4 );		// header version
+	memcpy( &m_DecompressedSize, data + Position + 12, 4 );	// decompressed file size
+	memcpy( &m_NumBlocks, data + Position + 16, 4 );		// number of blocks
+	Position += 20;
+
+	if( m_HeaderVersion == 0 )
 	{
-		ISS.read( (char *)&m_War3Identifier, 4 );	// version identifier
-		ISS.read( (char *)&m_War3Version, 4 );		// version number
+		CONSOLE_Print( "[PACKED] header version is too old" );
+		m_Valid = false;
+		return;
 	}
 
-	ISS.read( (char *)&m_BuildNumber, 2 );			// build number
-	ISS.read( (char *)&m_Flags, 2 );				// flags
-	ISS.read( (char *)&m_ReplayLength, 4 );			// replay length
-	ISS.seekg( 4, ios :: cur );						// CRC
-
-	if( ISS.fail( ) )
+	if( size - Position < 20 )
 	{
 		CONSOLE_Print( "[PACKED] failed to read header" );
 		m_Valid = false;
 		return;
 	}
 
+	memcpy( &m_War3Identifier, data + Position, 4 );		// version identifier
+	memcpy( &m_War3Version, data + Position + 4, 4 );		// version number
+	memcpy( &m_BuildNumber, data + Position + 8, 2 );		// build number
+	memcpy( &m_Flags, data + Position + 10, 2 );			// flags
+	memcpy( &m_ReplayLength, data + Position + 12, 4 );		// replay length
+	Position += 20;											// CRC
+
 	if( allBlocks )
 		CONSOLE_Print( "[PACKED] reading " + UTIL_ToString( m_NumBlocks ) + " blocks" );
 	else
 		CONSOLE_Print( "[PACKED] reading 1/" + UTIL_ToString( m_NumBlocks ) + " blocks" );
 
-	// read blocks
+	// read the block headers first so we know where each block goes in m_Decompressed
+
+	uint32_t NumBlocks = allBlocks ? m_NumBlocks : min( m_NumBlocks, (uint32_t)1 );
+	uint32_t DecompressedSize = 0;
+	vector<PackedBlock> Blocks;
+	Blocks.reserve( min( NumBlocks, size / 8 ) );
 
-        for( uint32_t i = 0; i < m_NumBlocks; ++i )
+	for( uint32_t i = 0; i < NumBlocks; ++i )
 	{
 		uint16_t BlockCompressed;
 		uint16_t BlockDecompressed;
 
 		// read block header
 
-		ISS.read( (char *)&BlockCompressed, 2 );	// block compressed size
-		ISS.read( (char *)&BlockDecompressed, 2 );	// block decompressed size
-		ISS.seekg( 4, ios :: cur );					// checksum
-
-		if( ISS.fail( ) )
+		if( size - Position < 8 )
 		{
 			CONSOLE_Print( "[PACKED] failed to read block header" );
 			m_Valid = false;
 			return;
 		}
 
-		// read block data
+		memcpy( &BlockCompressed, data + Position, 2 );			// block compressed size
+		memcpy( &BlockDecompressed, data + Position + 2, 2 );	// block decompressed size
+		Position += 8;											// checksum
 
-		uLongf BlockCompressedLong = BlockCompressed;
-		uLongf BlockDecompressedLong = BlockDecompressed;
-		unsigned char *CompressedData = new unsigned char[BlockCompressed];
-		unsigned char *DecompressedData = new unsigned char[BlockDecompressed];
-		ISS.read( (char*)CompressedData, BlockCompressed );
+		// skip block data
 
-		if( ISS.fail( ) )
+		if( size - Position < BlockCompressed )
 		{
 			CONSOLE_Print( "[PACKED] failed to read block data" );
-			delete [] DecompressedData;
-			delete [] CompressedData;
 			m_Valid = false;
 			return;
 		}
 
-		// decompress block data
+		Blocks.push_back( PackedBlock( Position, BlockCompressed, DecompressedSize, BlockDecompressed ) );
+		Position += BlockCompressed;
+		DecompressedSize += BlockDecompressed;
+	}
+
+	// decompress the blocks straight from the source into m_Decompressed
+
+	m_Decompressed.resize( DecompressedSize );
 
-		int Result = tzuncompress( DecompressedData, &BlockDecompressedLong, CompressedData, BlockCompressedLong );
+	if( !Blocks.empty( ) )
+		RunBlocks( m_Pool, Blocks.size( ), boost::bind( DecompressBlocks, data, DecompressedSize > 0 ? (unsigned char *)&m_Decompressed[0] : NULL, &Blocks, _1, _2 ) );
 
-		if( Result != Z_OK )
+	for( vector<PackedBlock> :: iterator i = Blocks.begin( ); i != Blocks.end( ); ++i )
+	{
+		if( i->result != Z_OK )
 		{
-			CONSOLE_Print( "[PACKED] tzuncompress error " + UTIL_ToString( Result ) );
-			delete [] DecompressedData;
-			delete [] CompressedData;
+			CONSOLE_Print( "[PACKED] tzuncompress error " + UTIL_ToString( i->result ) );
 			m_Valid = false;
 			return;
 		}
 
-		if( BlockDecompressedLong != (uLongf)BlockDecompressed )
+		if( i->actualSize != (uLongf)i->decompressedSize )
 		{
-			CONSOLE_Print( "[PACKED] block decompressed size mismatch, actual = " + UTIL_ToString( BlockDecompressedLong ) + ", expected = " + UTIL_ToString( BlockDecompressed ) );
-			delete [] DecompressedData;
-			delete [] CompressedData;
+			CONSOLE_Print( "[PACKED] block decompressed size mismatch, actual = " + UTIL_ToString( i->actualSize ) + ", expected = " + UTIL_ToString( i->decompressedSize ) );
 			m_Valid = false;
 			return;
 		}
-
-		m_Decompressed += string( (char *)DecompressedData, BlockDecompressedLong );
-		delete [] DecompressedData;
-		delete [] CompressedData;
-
-		// stop after one iteration if not decompressing all blocks
-
-		if( !allBlocks )
-			break;
 	}
 
 	CONSOLE_Print( "[PACKED] decompressed " + UTIL_ToString( m_Decompressed.size( ) ) + " bytes" );
@@ -283,48 +470,52 @@ void CPacked :: Compress( bool TFT )
 
 	m_Compressed.clear( );
 
-	// compress data into blocks of size 8192 bytes
-	// use a buffer of size 8213 bytes because in the worst case zlib will grow the data 0.1% plus 12 bytes
+	// compress data into blocks of size PACKED_BLOCKSIZE bytes
+	// the last block is padded with zeros (a whole block of zeros if the data fills the last block exactly)
 
-	uint32_t CompressedSize = 0;
-	string Padded = m_Decompressed;
-	Padded.append( 8192 - ( Padded.size( ) % 8192 ), 0 );
-	vector<string> CompressedBlocks;
-	string :: size_type Position = 0;
-	unsigned char *CompressedData = new unsigned char[8213];
+	uint32_t NumBlocks = m_Decompressed.size( ) / PACKED_BLOCKSIZE + 1;
+	string LastBlock = m_Decompressed.substr( ( NumBlocks - 1 ) * PACKED_BLOCKSIZE );
+	LastBlock.resize( PACKED_BLOCKSIZE, 0 );
+	vector<string> CompressedBlocks( NumBlocks );
+	vector<unsigned char> Results( NumBlocks, 0 );
+	RunBlocks( m_Pool, NumBlocks, boost::bind( CompressBlocks, m_CRC, &m_Decompressed, &LastBlock, &CompressedBlocks, &Results, _1, _2 ) );
+	string :: size_type BlocksSize = 0;
 
-	while( Position < Padded.size( ) )
+	for( uint32_t i = 0; i < NumBlocks; ++i )
 	{
-		uLongf BlockCompressedLong = 8213;
-		int Result = compress( CompressedData, &BlockCompressedLong, (const Bytef *)Padded.c_str( ) + Position, 8192 );
-
-		if( Result != Z_OK )
+		if( !Results[i] )
 		{
-			CONSOLE_Print( "[PACKED] compress error " + UTIL_ToString( Result ) );
-			delete [] CompressedData;
 			m_Valid = false;
 			return;
 		}
 
-		CompressedBlocks.push_back( string( (char *)CompressedData, BlockCompressedLong ) );
-		CompressedSize += BlockCompressedLong;
-		Position += 8192;
+		BlocksSize += CompressedBlocks[i].size( );
 	}
 
-	delete [] CompressedData;
+	// the header goes first, then the blocks
 
-	// build header
+	BYTEARRAY Header = BuildHeader( TFT, BlocksSize, NumBlocks, m_Decompressed.size( ) );
+	m_Compressed.reserve( Header.size( ) + BlocksSize );
+	m_Compressed.append( Header.begin( ), Header.end( ) );
 
-	uint32_t HeaderSize = 68;
-	uint32_t HeaderCompressedSize = HeaderSize + CompressedSize + CompressedBlocks.size( ) * 8;
+	for( vector<string> :: iterator i = CompressedBlocks.begin( ); i != CompressedBlocks.end( ); ++i )
+		m_Compressed += *i;
+}
+
+BYTEARRAY CPacked :: BuildHeader( bool TFT, uint32_t blocksSize, uint32_t numBlocks, uint32_t decompressedSize )
+{
+	// blocksSize is the size of all the blocks including their block headers
+
+	uint32_t HeaderSize = PACKED_HEADERSIZE;
+	uint32_t HeaderCompressedSize = HeaderSize + blocksSize;
 	uint32_t HeaderVersion = 1;
 	BYTEARRAY Header;
 	UTIL_AppendByteArray( Header, "Warcraft III recorded game\x01A" );
 	UTIL_AppendByteArray( Header, HeaderSize, false );
 	UTIL_AppendByteArray( Header, HeaderCompressedSize, false );
 	UTIL_AppendByteArray( Header, HeaderVersion, false );
-	UTIL_AppendByteArray( Header, (uint32_t)m_Decompressed.size( ), false );
-	UTIL_AppendByteArray( Header, (uint32_t)CompressedBlocks.size( ), false );
+	UTIL_AppendByteArray( Header, decompressedSize, false );
+	UTIL_AppendByteArray( Header, numBlocks, false );
 
 	if( TFT )
 	{
@@ -354,46 +545,86 @@ void CPacked :: Compress( bool TFT )
 
 	// calculate header CRC
 
-	string HeaderString = string( Header.begin( ), Header.end( ) );
-	uint32_t CRC = m_CRC->FullCRC( (unsigned char *)HeaderString.c_str( ), HeaderString.size( ) );
+	uint32_t CRC = m_CRC->FullCRC( &Header[0], Header.size( ) );
 
 	// overwrite the (currently zero) header CRC with the calculated CRC
 
 	Header.erase( Header.end( ) - 4, Header.end( ) );
 	UTIL_AppendByteArray( Header, CRC, false );
+	return Header;
+}
 
-	// append header
+bool CPacked :: CompressBlock( CCRC32 *crc, const unsigned char *data, string &blocks )
+{
+	// compress PACKED_BLOCKSIZE bytes of data and append the block (block header followed by the compressed data) to blocks
+	// this only reads the compression level so blocks can be compressed on any thread (see CPacked :: Compress and CReplayWriter)
+	// use a buffer of size 8213 bytes because in the worst case zlib will grow the data 0.1% plus 12 bytes
 
-	m_Compressed += string( Header.begin( ), Header.end( ) );
+	unsigned char CompressedData[8213];
+	uLongf BlockCompressedLong = 8213;
+	int Level = m_Level;
 
-	// append blocks
+#ifdef GHOST_LIBDEFLATE
+	// libdeflate writes a complete zlib stream just like compress2 does, it's usually smaller and faster at the same level
 
-        for( vector<string> :: iterator i = CompressedBlocks.begin( ); i != CompressedBlocks.end( ); ++i )
+	PackedDeflater *Deflater = gPackedDeflater.get( );
+
+	if( !Deflater || Deflater->level != Level )
 	{
-		BYTEARRAY BlockHeader;
-		UTIL_AppendByteArray( BlockHeader, (uint16_t)(*i).size( ), false );
-		UTIL_AppendByteArray( BlockHeader, (uint16_t)8192, false );
+		Deflater = new PackedDeflater( Level );
+		gPackedDeflater.reset( Deflater );
+	}
 
-		// append zero block header CRC
-		UTIL_AppendByteArray( BlockHeader, (uint32_t)0, false );
+	BlockCompressedLong = Deflater->compressor ? libdeflate_zlib_compress( Deflater->compressor, data, PACKED_BLOCKSIZE, CompressedData, sizeof( CompressedData ) ) : 0;
 
-		// calculate block header CRC
+	if( BlockCompressedLong == 0 )
+	{
+		CONSOLE_Print( "[PACKED] libdeflate compress error" );
+		return false;
+	}
+#else
+	int Result = compress2( CompressedData, &BlockCompressedLong, (const Bytef *)data, PACKED_BLOCKSIZE, Level );
 
-		string BlockHeaderString = string( BlockHeader.begin( ), BlockHeader.end( ) );
-		uint32_t CRC1 = m_CRC->FullCRC( (unsigned char *)BlockHeaderString.c_str( ), BlockHeaderString.size( ) );
-		CRC1 = CRC1 ^ ( CRC1 >> 16 );
-		uint32_t CRC2 = m_CRC->FullCRC( (unsigned char *)(*i).c_str( ), (*i).size( ) );
-		CRC2 = CRC2 ^ ( CRC2 >> 16 );
-		uint32_t BlockCRC = ( CRC1 & 0xFFFF ) | ( CRC2 << 16 );
+	if( Result != Z_OK )
+	{
+		CONSOLE_Print( "[PACKED] compress error " + UTIL_ToString( Result ) );
+		return false;
+	}
+#endif
 
-		// overwrite the block header CRC with the calculated CRC
+	BYTEARRAY BlockHeader;
+	UTIL_AppendByteArray( BlockHeader, (uint16_t)BlockCompressedLong, false );
+	UTIL_AppendByteArray( BlockHeader, (uint16_t)PACKED_BLOCKSIZE, false );
 
-		BlockHeader.erase( BlockHeader.end( ) - 4, BlockHeader.end( ) );
-		UTIL_AppendByteArray( BlockHeader, BlockCRC, false );
+	// calculate the block header CRC over the block header with a zero CRC and the compressed data
 
-		// append block header and data
+	UTIL_AppendByteArray( BlockHeader, (uint32_t)0, false );
+	uint32_t CRC1 = crc->FullCRC( &BlockHeader[0], BlockHeader.size( ) );
+	CRC1 = CRC1 ^ ( CRC1 >> 16 );
+	uint32_t CRC2 = crc->FullCRC( CompressedData, BlockCompressedLong );
+	CRC2 = CRC2 ^ ( CRC2 >> 16 );
+	uint32_t BlockCRC = ( CRC1 & 0xFFFF ) | ( CRC2 << 16 );
 
-		m_Compressed += string( BlockHeader.begin( ), BlockHeader.end( ) );
-		m_Compressed += *i;
-	}
+	// overwrite the block header CRC with the calculated CRC
+
+	BlockHeader.erase( BlockHeader.end( ) - 4, BlockHeader.end( ) );
+	UTIL_AppendByteArray( BlockHeader, BlockCRC, false );
+
+	// append block header and data
+
+	blocks.append( BlockHeader.begin( ), BlockHeader.end( ) );
+	blocks.append( (const char *)CompressedData, BlockCompressedLong );
+	return true;
+}
+
+void CPacked :: SetLevel( int nLevel )
+{
+	// the level is read by every thread that compresses blocks so it's only set at startup before any of them run
+
+	if( nLevel < 1 )
+		nLevel = 1;
+	else if( nLevel > 9 )
+		nLevel = 9;
+
+	m_Level = nLevel;
 }
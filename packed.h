@@ -26,11 +26,51 @@
 #ifndef PACKED_H
 #define PACKED_H
 
+#define PACKED_HEADERSIZE	68		// bytes in the header of a packed file
+#define PACKED_BLOCKSIZE	8192	// bytes of decompressed data in each block
+#define PACKED_THREADBLOCKS	16		// the minimum number of blocks worth starting another thread for when compressing or decompressing
+
+#include <boost/function.hpp>
+
+class CCRC32;
+struct PackedJob;
+
 //
-// CPacked
+// CPackedPool
 //
 
-class CCRC32;
+// the worker threads that compress and decompress the blocks of large packed files (bot_packedthreads)
+// the threads are started once and shared by every CPacked on every thread
+// a caller splits its blocks into contiguous ranges, queues all but the first and works on the first itself
+// while it waits for the rest it runs queued ranges too (its own or another caller's) so a busy pool never leaves it idle
+
+class CPackedPool
+{
+private:
+	deque<pair<PackedJob *, uint32_t> > m_Queue;	// ranges waiting for a thread (job, range number)
+	boost::mutex m_Mutex;					// protects m_Queue, m_Exiting and the remaining count of every job
+	boost::condition_variable m_QueueCond;	// signalled when ranges are queued or we're exiting
+	boost::condition_variable m_DoneCond;	// signalled when the last range of a job finishes
+	vector<boost::thread *> m_Threads;
+	bool m_Exiting;
+
+public:
+	CPackedPool( uint32_t nNumThreads );
+	~CPackedPool( );
+
+	uint32_t GetNumThreads( )				{ return m_Threads.size( ) + 1; }
+
+	void Run( uint32_t numBlocks, const boost::function<void( uint32_t, uint32_t )> &work );
+
+	void loop( );
+
+private:
+	void RunRange( PackedJob *job, uint32_t range );
+};
+
+//
+// CPacked
+//
 
 class CPacked
 {
@@ -52,6 +92,9 @@ protected:
 	uint16_t m_Flags;
 	uint32_t m_ReplayLength;
 
+	static int m_Level;						// zlib compression level, 1 (fastest) to 9 (smallest)
+	static CPackedPool *m_Pool;				// the pool blocks are compressed and decompressed on, NULL to use the calling thread only
+
 public:
 	CPacked( );
 	virtual ~CPacked( );
@@ -78,7 +121,13 @@ public:
 	virtual bool Extract( string inFileName, string outFileName );
 	virtual bool Pack( bool TFT, string inFileName, string outFileName );
 	virtual void Decompress( bool allBlocks );
+	virtual void Decompress( const unsigned char *data, uint32_t size, bool allBlocks );
 	virtual void Compress( bool TFT );
+	virtual BYTEARRAY BuildHeader( bool TFT, uint32_t blocksSize, uint32_t numBlocks, uint32_t decompressedSize );
+
+	static bool CompressBlock( CCRC32 *crc, const unsigned char *data, string &blocks );
+	static void SetLevel( int nLevel );
+	static void SetPool( CPackedPool *nPool )	{ m_Pool = nPool; }
 };
 
 #endif
@@ -0,0 +1,227 @@
+/*
+
+	ent-ghost
+	Copyright [2011-2013] [Jack Lu]
+
+	This file is part of the ent-ghost source code.
+
+	ent-ghost is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	ent-ghost source code is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with ent-ghost source code. If not, see <http://www.gnu.org/licenses/>.
+
+	ent-ghost is modified from GHost++ (http://ghostplusplus.googlecode.com/)
+	GHost++ is Copyright [2008] [Trevor Hogan]
+
+*/
+
+#include "ghost.h"
+#include "util.h"
+#include "packed.h"
+
+#include <time.h>
+
+#ifndef WIN32
+ #include <sys/time.h>
+#endif
+
+#ifdef __APPLE__
+ #include <mach/mach_time.h>
+#endif
+
+// packedbench is a separate program that times compressing and decompressing packed files (replays and savegames) on CPackedPool's of different sizes
+// it checks that every pool size produces the same compressed data and that it decompresses back to the original data
+// without arguments it uses large generated files, otherwise it uses the given replays and savegames
+
+#define PACKEDBENCH_MINTICKS 1000
+
+boost::mutex PrintMutex;
+
+uint32_t GetTime( )
+{
+	return GetTicks( ) / 1000;
+}
+
+uint32_t GetTicks( )
+{
+#ifdef WIN32
+	return timeGetTime( );
+#elif __APPLE__
+	uint64_t current = mach_absolute_time( );
+	static mach_timebase_info_data_t info = { 0, 0 };
+
+	if( info.denom == 0 )
+		mach_timebase_info( &info );
+
+	uint64_t elapsednano = current * ( info.numer / info.denom );
+	return elapsednano / 1e6;
+#else
+	uint32_t ticks;
+	struct timespec t;
+	clock_gettime( CLOCK_MONOTONIC, &t );
+	ticks = t.tv_sec * 1000;
+	ticks += t.tv_nsec / 1000000;
+	return ticks;
+#endif
+}
+
+void CONSOLE_Print( string message )
+{
+	// CPacked prints several lines every time it compresses or decompresses so only show errors and our own output
+
+	if( message.compare( 0, 9, "[PACKED] " ) == 0 && message.find( "error" ) == string :: npos && message.find( "failed" ) == string :: npos && message.find( "mismatch" ) == string :: npos )
+		return;
+
+	boost::mutex::scoped_lock printLock( PrintMutex );
+	cout << message << endl;
+}
+
+//
+// CPackedBench
+//
+
+class CPackedBench : public CPacked
+{
+public:
+	string &GetCompressed( )		{ return m_Compressed; }
+	string &GetDecompressed( )		{ return m_Decompressed; }
+};
+
+string GenerateData( uint32_t size )
+{
+	// something that compresses about as well as a replay, short runs of repeated actions mixed with noise
+
+	string Data;
+	Data.reserve( size );
+	uint32_t Seed = 12345;
+
+	while( Data.size( ) < size )
+	{
+		Seed = Seed * 1103515245 + 12345;
+		unsigned char Action[8];
+
+		for( int i = 0; i < 8; ++i )
+			Action[i] = (unsigned char)( ( Seed >> ( ( i % 4 ) * 8 ) ) & ( i < 4 ? 0x0F : 0xFF ) );
+
+		uint32_t Repeat = 1 + ( Seed >> 28 );
+
+		for( uint32_t i = 0; i < Repeat && Data.size( ) < size; ++i )
+			Data.append( (const char *)Action, min( (uint32_t)8, size - (uint32_t)Data.size( ) ) );
+	}
+
+	return Data;
+}
+
+bool Bench( string name, const string &decompressed, vector<uint32_t> &threads )
+{
+	CONSOLE_Print( "[PACKEDBENCH] " + name + ", " + UTIL_ToString( decompressed.size( ) ) + " bytes, " + UTIL_ToString( decompressed.size( ) / PACKED_BLOCKSIZE + 1 ) + " blocks" );
+	string Reference;
+
+	for( vector<uint32_t> :: iterator i = threads.begin( ); i != threads.end( ); ++i )
+	{
+		CPackedPool Pool( *i );
+		CPacked :: SetPool( &Pool );
+		CPackedBench Packed;
+
+		// compress
+
+		uint32_t Runs = 0;
+		uint32_t StartTicks = GetTicks( );
+
+		do
+		{
+			Packed.GetDecompressed( ) = decompressed;
+			Packed.Compress( true );
+			++Runs;
+		} while( Packed.GetValid( ) && GetTicks( ) - StartTicks < PACKEDBENCH_MINTICKS );
+
+		uint32_t CompressTicks = GetTicks( ) - StartTicks;
+		uint32_t CompressRuns = Runs;
+		string Compressed = Packed.GetCompressed( );
+
+		if( !Packed.GetValid( ) )
+		{
+			CONSOLE_Print( "[PACKEDBENCH] compressing failed with " + UTIL_ToString( *i ) + " threads" );
+			CPacked :: SetPool( NULL );
+			return false;
+		}
+
+		if( Reference.empty( ) )
+			Reference = Compressed;
+		else if( Compressed != Reference )
+		{
+			CONSOLE_Print( "[PACKEDBENCH] compressing with " + UTIL_ToString( *i ) + " threads gave different data than with " + UTIL_ToString( threads.front( ) ) );
+			CPacked :: SetPool( NULL );
+			return false;
+		}
+
+		// decompress
+
+		Runs = 0;
+		StartTicks = GetTicks( );
+
+		do
+		{
+			Packed.Decompress( (const unsigned char *)Compressed.data( ), Compressed.size( ), true );
+			++Runs;
+		} while( Packed.GetValid( ) && GetTicks( ) - StartTicks < PACKEDBENCH_MINTICKS );
+
+		uint32_t DecompressTicks = GetTicks( ) - StartTicks;
+		CPacked :: SetPool( NULL );
+
+		if( !Packed.GetValid( ) || Packed.GetDecompressed( ) != decompressed )
+		{
+			CONSOLE_Print( "[PACKEDBENCH] decompressing with " + UTIL_ToString( *i ) + " threads didn't give back the original data" );
+			return false;
+		}
+
+		double MB = decompressed.size( ) / 1048576.0;
+		CONSOLE_Print( "[PACKEDBENCH]   " + UTIL_ToString( *i ) + " threads: compress " + UTIL_ToString( MB * CompressRuns * 1000 / max( CompressTicks, (uint32_t)1 ), 1 ) + " MB/s, decompress " + UTIL_ToString( MB * Runs * 1000 / max( DecompressTicks, (uint32_t)1 ), 1 ) + " MB/s" );
+	}
+
+	return true;
+}
+
+int main( int argc, char **argv )
+{
+	vector<uint32_t> Threads;
+	Threads.push_back( 1 );
+	Threads.push_back( 2 );
+	Threads.push_back( 4 );
+	Threads.push_back( 8 );
+	CPacked :: SetLevel( 6 );
+	bool Success = true;
+
+	if( argc < 2 )
+	{
+		// a long replay is a few MB and a late game savegame can be more than that
+
+		Success = Bench( "generated 4 MB", GenerateData( 4 * 1024 * 1024 ), Threads ) && Success;
+		Success = Bench( "generated 32 MB", GenerateData( 32 * 1024 * 1024 ), Threads ) && Success;
+	}
+
+	for( int i = 1; i < argc; ++i )
+	{
+		CPackedBench Packed;
+		Packed.Load( argv[i], true );
+
+		if( !Packed.GetValid( ) )
+		{
+			CONSOLE_Print( "[PACKEDBENCH] skipping [" + string( argv[i] ) + "], it isn't a valid packed file" );
+			Success = false;
+			continue;
+		}
+
+		Success = Bench( argv[i], Packed.GetDecompressed( ), Threads ) && Success;
+	}
+
+	return Success ? 0 : 1;
+}
@@ -0,0 +1,415 @@
+/*
+
+	ent-ghost
+	Copyright [2011-2013] [Jack Lu]
+
+	This file is part of the ent-ghost source code.
+
+	ent-ghost is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	ent-ghost source code is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with ent-ghost source code. If not, see <http://www.gnu.org/licenses/>.
+
+	ent-ghost is modified from GHost++ (http://ghostplusplus.googlecode.com/)
+	GHost++ is Copyright [2008] [Trevor Hogan]
+
+*/
+
+#include "ghost.h"
+#include "util.h"
+#include "socket.h"
+#include "game_base.h"
+#include "reactor.h"
+
+#ifdef GHOST_REACTOR
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <sys/prctl.h>
+#include <string.h>
+#include <time.h>
+
+#define REACTOR_MAX_EVENTS 128
+#define REACTOR_MAX_WAIT 60000
+
+//
+// CGameReactor
+//
+
+CGameReactor :: CGameReactor( uint32_t nID ) : m_ID( nID ), m_EPoll( -1 ), m_WakeFD( -1 ), m_TimerFD( -1 ), m_TimerTicks( 0 ), m_TimerArmed( false ), m_HasError( false ), m_Timers( GetTicks( ) ), m_WakeAll( false ), m_NumGames( 0 ), m_Exiting( false ), m_Thread( NULL )
+{
+	m_EPoll = epoll_create( REACTOR_MAX_EVENTS );
+
+	if( m_EPoll == -1 )
+	{
+		CONSOLE_Print( "[REACTOR] error creating epoll descriptor for reactor #" + UTIL_ToString( m_ID ) + " (error code " + UTIL_ToString( errno ) + ")" );
+		m_HasError = true;
+		return;
+	}
+
+	m_WakeFD = eventfd( 0, EFD_NONBLOCK );
+
+	if( m_WakeFD == -1 )
+	{
+		CONSOLE_Print( "[REACTOR] error creating wakeup descriptor for reactor #" + UTIL_ToString( m_ID ) + " (error code " + UTIL_ToString( errno ) + ")" );
+		m_HasError = true;
+		return;
+	}
+
+	// the wakeup descriptor is registered with a NULL pointer so the loop can tell it apart from sockets
+
+	struct epoll_event Event;
+	memset( &Event, 0, sizeof( Event ) );
+	Event.events = EPOLLIN;
+	Event.data.ptr = NULL;
+
+	if( epoll_ctl( m_EPoll, EPOLL_CTL_ADD, m_WakeFD, &Event ) == -1 )
+	{
+		CONSOLE_Print( "[REACTOR] error registering wakeup descriptor for reactor #" + UTIL_ToString( m_ID ) + " (error code " + UTIL_ToString( errno ) + ")" );
+		m_HasError = true;
+		return;
+	}
+
+	// the timer descriptor is registered with a pointer to the reactor itself
+
+	m_TimerFD = timerfd_create( CLOCK_MONOTONIC, TFD_NONBLOCK );
+
+	if( m_TimerFD == -1 )
+	{
+		CONSOLE_Print( "[REACTOR] error creating timer descriptor for reactor #" + UTIL_ToString( m_ID ) + " (error code " + UTIL_ToString( errno ) + ")" );
+		m_HasError = true;
+		return;
+	}
+
+	Event.events = EPOLLIN;
+	Event.data.ptr = this;
+
+	if( epoll_ctl( m_EPoll, EPOLL_CTL_ADD, m_TimerFD, &Event ) == -1 )
+	{
+		CONSOLE_Print( "[REACTOR] error registering timer descriptor for reactor #" + UTIL_ToString( m_ID ) + " (error code " + UTIL_ToString( errno ) + ")" );
+		m_HasError = true;
+		return;
+	}
+
+	m_Thread = new boost::thread( &CGameReactor :: loop, this );
+}
+
+CGameReactor :: ~CGameReactor( )
+{
+	// the reactor thread keeps running until every game it owns has finished
+	// so make sure all the games have been told to delete themselves before deleting the reactor
+
+	if( m_Thread )
+	{
+		m_Exiting = true;
+		Wake( );
+		m_Thread->join( );
+		delete m_Thread;
+	}
+
+	if( m_TimerFD != -1 )
+		close( m_TimerFD );
+
+	if( m_WakeFD != -1 )
+		close( m_WakeFD );
+
+	if( m_EPoll != -1 )
+		close( m_EPoll );
+}
+
+void CGameReactor :: AddGame( CBaseGame *game )
+{
+	game->SetReactor( this );
+
+	boost::mutex::scoped_lock lock( m_QueueMutex );
+	m_NewGames.push_back( game );
+	++m_NumGames;
+	lock.unlock( );
+
+	Wake( );
+}
+
+void CGameReactor :: Watch( CSocket *socket, ReactorGame *game )
+{
+	if( !socket || socket->GetReactor( ) == this || socket->GetFD( ) == INVALID_SOCKET )
+		return;
+
+	// edge triggered so we only hear about each socket when its state changes
+	// note: registering a socket that already has data waiting reports it immediately
+
+	struct epoll_event Event;
+	memset( &Event, 0, sizeof( Event ) );
+	Event.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+	Event.data.ptr = socket;
+
+	if( epoll_ctl( m_EPoll, EPOLL_CTL_ADD, socket->GetFD( ), &Event ) == -1 )
+	{
+		CONSOLE_Print( "[REACTOR] error registering socket with reactor #" + UTIL_ToString( m_ID ) + " (error code " + UTIL_ToString( errno ) + ")" );
+		return;
+	}
+
+	socket->SetReactor( this, game );
+}
+
+void CGameReactor :: Unwatch( CSocket *socket )
+{
+	if( !socket || socket->GetReactor( ) != this )
+		return;
+
+	if( socket->GetFD( ) != INVALID_SOCKET )
+		epoll_ctl( m_EPoll, EPOLL_CTL_DEL, socket->GetFD( ), NULL );
+
+	socket->SetReactor( NULL, NULL );
+}
+
+void CGameReactor :: Wake( )
+{
+	if( m_WakeFD == -1 )
+		return;
+
+	uint64_t One = 1;
+
+	if( write( m_WakeFD, &One, sizeof( One ) ) == -1 )
+	{
+		// the counter is already non zero so the reactor is going to wake up anyway
+	}
+}
+
+void CGameReactor :: WakeGame( CBaseGame *game )
+{
+	// this can be called from any thread
+	// the game is only looked up by the reactor thread so it's fine if it has already finished by then
+
+	boost::mutex::scoped_lock lock( m_QueueMutex );
+	m_WokenGames.push_back( game );
+	lock.unlock( );
+
+	Wake( );
+}
+
+void CGameReactor :: WakeAll( )
+{
+	boost::mutex::scoped_lock lock( m_QueueMutex );
+	m_WakeAll = true;
+	lock.unlock( );
+
+	Wake( );
+}
+
+void CGameReactor :: MarkReady( CBaseGame *game )
+{
+	// this is only used for games woken up by other threads, socket events find their game through the socket's tag
+	// the game might have finished already so it's only compared and never dereferenced
+
+	for( vector<ReactorGame *> :: iterator i = m_Games.begin( ); i != m_Games.end( ); ++i )
+	{
+		if( (*i)->game == game )
+		{
+			(*i)->ready = true;
+			break;
+		}
+	}
+}
+
+bool CGameReactor :: ArmTimer( uint32_t ticks )
+{
+	// arm the timerfd for the start of the millisecond when GetTicks( ) reaches ticks
+
+	if( m_TimerArmed && m_TimerTicks == ticks )
+		return true;
+
+	// GetTicks is CLOCK_MONOTONIC in milliseconds so work out the deadline from the same clock reading
+
+	struct timespec Now;
+
+	if( clock_gettime( CLOCK_MONOTONIC, &Now ) == -1 )
+		return false;
+
+	uint32_t NowTicks = Now.tv_sec * 1000 + Now.tv_nsec / 1000000;
+	int32_t Delta = (int32_t)( ticks - NowTicks );
+
+	if( Delta < 0 )
+		Delta = 0;
+
+	uint64_t Deadline = (uint64_t)Now.tv_sec * 1000000000 + (uint64_t)( Now.tv_nsec / 1000000 ) * 1000000 + (uint64_t)Delta * 1000000;
+
+	struct itimerspec Timer;
+	memset( &Timer, 0, sizeof( Timer ) );
+	Timer.it_value.tv_sec = Deadline / 1000000000;
+	Timer.it_value.tv_nsec = Deadline % 1000000000;
+
+	// note: an it_value of zero would disarm the timer but that can only happen right at boot
+
+	if( timerfd_settime( m_TimerFD, TFD_TIMER_ABSTIME, &Timer, NULL ) == -1 )
+	{
+		m_TimerArmed = false;
+		return false;
+	}
+
+	m_TimerTicks = ticks;
+	m_TimerArmed = true;
+	return true;
+}
+
+void CGameReactor :: loop( )
+{
+	struct epoll_event Events[REACTOR_MAX_EVENTS];
+	vector<TimerEntry *> Expired;
+
+	// the default timer slack lets the kernel delay our wakeups by up to 50us to batch them with others
+	// we're only woken up when something is actually due so ask for the wakeups to be as precise as possible
+
+	prctl( PR_SET_TIMERSLACK, 1 );
+
+	while( true )
+	{
+		// pick up any new games and wakeups
+
+		boost::mutex::scoped_lock lock( m_QueueMutex );
+
+		for( vector<CBaseGame *> :: iterator i = m_NewGames.begin( ); i != m_NewGames.end( ); ++i )
+			m_Games.push_back( new ReactorGame( *i ) );
+
+		for( vector<CBaseGame *> :: iterator i = m_WokenGames.begin( ); i != m_WokenGames.end( ); ++i )
+			MarkReady( *i );
+
+		if( m_WakeAll )
+		{
+			for( vector<ReactorGame *> :: iterator i = m_Games.begin( ); i != m_Games.end( ); ++i )
+				(*i)->ready = true;
+		}
+
+		m_NewGames.clear( );
+		m_WokenGames.clear( );
+		m_WakeAll = false;
+		lock.unlock( );
+
+		if( m_Exiting && m_Games.empty( ) )
+			break;
+
+		// block until a socket becomes ready, we're woken up, or the next timer fires
+		// without any games there's nothing to time out so we only wake up when a game is added
+		// the epoll_wait timeout is only used if the timerfd can't be armed because it has a coarser resolution and tends to fire late
+
+		int Timeout = -1;
+
+		if( !m_Games.empty( ) )
+		{
+			uint32_t Ticks = GetTicks( );
+			uint32_t TicksUntilNext = m_Timers.GetTicksUntilNext( Ticks, REACTOR_MAX_WAIT );
+
+			for( vector<ReactorGame *> :: iterator i = m_Games.begin( ); i != m_Games.end( ); ++i )
+			{
+				if( (*i)->ready || (*i)->game->GetDeleteRequested( ) )
+				{
+					TicksUntilNext = 0;
+					break;
+				}
+			}
+
+			if( TicksUntilNext == 0 )
+				Timeout = 0;
+			else if( !ArmTimer( Ticks + TicksUntilNext ) )
+				Timeout = TicksUntilNext;
+		}
+
+		int NumEvents = epoll_wait( m_EPoll, Events, REACTOR_MAX_EVENTS, Timeout );
+
+		// dispatch readiness to the sockets
+		// this has to happen before any game is updated because updating a game can delete its sockets
+
+		for( int i = 0; i < NumEvents; ++i )
+		{
+			if( Events[i].data.ptr == this )
+			{
+				uint64_t Expirations;
+
+				if( read( m_TimerFD, &Expirations, sizeof( Expirations ) ) == -1 )
+				{
+					// nothing to do, the timer was re-armed since it fired
+				}
+
+				m_TimerArmed = false;
+				continue;
+			}
+
+			CSocket *Socket = (CSocket *)Events[i].data.ptr;
+
+			if( !Socket )
+			{
+				uint64_t Count;
+
+				if( read( m_WakeFD, &Count, sizeof( Count ) ) == -1 )
+				{
+					// nothing to do, the counter was already cleared
+				}
+
+				continue;
+			}
+
+			// errors and hangups are reported as both readable and writable so the next recv or send picks them up
+
+			bool Failed = ( Events[i].events & ( EPOLLERR | EPOLLHUP ) ) != 0;
+			Socket->EventReadiness( Failed || ( Events[i].events & ( EPOLLIN | EPOLLRDHUP ) ), Failed || ( Events[i].events & EPOLLOUT ) );
+			( (ReactorGame *)Socket->GetReactorTag( ) )->ready = true;
+		}
+
+		// fire the timers
+
+		Expired.clear( );
+		m_Timers.Advance( GetTicks( ), Expired );
+
+		for( vector<TimerEntry *> :: iterator i = Expired.begin( ); i != Expired.end( ); ++i )
+			( (ReactorGame *)(*i)->data )->ready = true;
+
+		// update every game that's ready
+
+		for( vector<ReactorGame *> :: iterator i = m_Games.begin( ); i != m_Games.end( ); )
+		{
+			ReactorGame *Game = *i;
+
+			if( !Game->ready && !Game->game->GetDeleteRequested( ) )
+			{
+				++i;
+				continue;
+			}
+
+			Game->ready = false;
+
+			if( Game->game->ReactorUpdate( ) )
+			{
+				// the game is finished or it's being deleted
+				// unregister its sockets first because the main thread may delete the game as soon as loopEnd returns
+
+				CBaseGame *BaseGame = Game->game;
+				BaseGame->UnwatchSockets( this );
+				m_Timers.Cancel( &Game->timer );
+				delete Game;
+				i = m_Games.erase( i );
+				--m_NumGames;
+				BaseGame->loopEnd( );
+				continue;
+			}
+
+			// register any sockets that were created during the update (new connections and GProxy++ reconnects)
+			// then sleep until the earliest timer the game scheduled during the update
+
+			Game->game->WatchSockets( this, Game );
+			m_Timers.Add( &Game->timer, Game->game->GetNextUpdateTicks( ) );
+			++i;
+		}
+	}
+
+	CONSOLE_Print( "[REACTOR] reactor #" + UTIL_ToString( m_ID ) + " finished" );
+}
+
+#endif
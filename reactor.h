@@ -0,0 +1,105 @@
+/*
+
+	ent-ghost
+	Copyright [2011-2013] [Jack Lu]
+
+	This file is part of the ent-ghost source code.
+
+	ent-ghost is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	ent-ghost source code is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with ent-ghost source code. If not, see <http://www.gnu.org/licenses/>.
+
+	ent-ghost is modified from GHost++ (http://ghostplusplus.googlecode.com/)
+	GHost++ is Copyright [2008] [Trevor Hogan]
+
+*/
+
+#ifndef REACTOR_H
+#define REACTOR_H
+
+#include "timerwheel.h"
+
+// the reactor is built on epoll so it's only available on Linux
+// other platforms keep running one select( ) thread per game (see CBaseGame :: loop)
+
+#ifdef __linux__
+ #define GHOST_REACTOR
+#endif
+
+//
+// CGameReactor
+//
+
+// a reactor thread drives many games from a single edge triggered epoll set
+// every socket owned by one of its games is registered once and reports readiness through CSocket :: EventReadiness
+// each socket is tagged with its game's ReactorGame entry so an event marks the game ready without searching for it
+// a game is only updated when one of its sockets became ready, when it's woken up by another thread, or when its next timer is due
+// each game has one entry in the reactor's timer wheel which is set to the earliest timer the game scheduled during its last update (see CBaseGame :: ScheduleUpdate)
+// so a reactor with nothing but idle games sleeps until the first of their timers fires
+// the wheel is driven by a timerfd armed for the exact millisecond the next timer is due rather than by the epoll_wait timeout
+// this keeps the action packets of running games on schedule even when the box is busy (see CBaseGame :: RecordActionJitter)
+
+class CSocket;
+class CBaseGame;
+struct ReactorGame;
+
+class CGameReactor
+{
+private:
+	uint32_t m_ID;							// reactor number (for console output)
+	int m_EPoll;							// epoll descriptor
+	int m_WakeFD;							// eventfd used to interrupt epoll_wait when a game is added or woken up or we're exiting
+	int m_TimerFD;							// timerfd that fires when the next timer in m_Timers is due
+	uint32_t m_TimerTicks;					// GetTicks the timerfd is armed for
+	bool m_TimerArmed;
+	bool m_HasError;
+	CTimerWheel m_Timers;					// the game timers, only touched by the reactor thread
+	vector<ReactorGame *> m_Games;			// games owned by this reactor, only touched by the reactor thread
+	vector<CBaseGame *> m_NewGames;			// games waiting to be picked up by the reactor thread
+	vector<CBaseGame *> m_WokenGames;		// games that other threads want updated as soon as possible
+	bool m_WakeAll;							// if every game should be updated as soon as possible
+	boost::mutex m_QueueMutex;				// protects m_NewGames, m_WokenGames and m_WakeAll
+	volatile uint32_t m_NumGames;			// number of games owned or waiting (used for load balancing)
+	volatile bool m_Exiting;
+	boost::thread *m_Thread;
+
+public:
+	CGameReactor( uint32_t nID );
+	~CGameReactor( );
+
+	bool HasError( )					{ return m_HasError; }
+	uint32_t GetID( )					{ return m_ID; }
+	uint32_t GetNumGames( )				{ return m_NumGames; }
+
+	void AddGame( CBaseGame *game );
+	void Watch( CSocket *socket, ReactorGame *game );
+	void Unwatch( CSocket *socket );
+	void Wake( );
+	void WakeGame( CBaseGame *game );
+	void WakeAll( );
+
+	void loop( );
+
+private:
+	void MarkReady( CBaseGame *game );
+	bool ArmTimer( uint32_t ticks );
+};
+
+struct ReactorGame {
+	CBaseGame *game;
+	TimerEntry timer;						// fires when the game must be updated even without any socket activity
+	bool ready;								// if the game should be updated on this iteration
+
+	ReactorGame( CBaseGame *nGame ) : game( nGame ), timer( this ), ready( true ) { }
+};
+
+#endif
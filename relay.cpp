@@ -0,0 +1,362 @@
+/*
+
+	ent-ghost
+	Copyright [2011-2013] [Jack Lu]
+
+	This file is part of the ent-ghost source code.
+
+	ent-ghost is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	ent-ghost source code is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with ent-ghost source code. If not, see <http://www.gnu.org/licenses/>.
+
+	ent-ghost is modified from GHost++ (http://ghostplusplus.googlecode.com/)
+	GHost++ is Copyright [2008] [Trevor Hogan]
+
+*/
+
+#include "ghost.h"
+#include "util.h"
+#include "socket.h"
+#include "commandpacket.h"
+#include "relayfeed.h"
+#include "relay.h"
+
+#include <boost/thread.hpp>
+
+//
+// CRelay
+//
+
+CRelay :: CRelay( string nBindAddress, uint16_t nPort, uint32_t nDelay, uint32_t nMaxClients, uint32_t nMaxBuffer ) : m_Port( nPort ), m_Delay( nDelay ), m_MaxClients( nMaxClients ), m_MaxBuffer( nMaxBuffer ), m_Valid( false ), m_Exiting( false ), m_Thread( NULL )
+{
+	m_Socket = new CTCPServer( );
+
+	if( !m_Socket->Listen( nBindAddress, m_Port ) )
+	{
+		CONSOLE_Print( "[RELAY] error listening for spectators on port " + UTIL_ToString( m_Port ) );
+		return;
+	}
+
+	CONSOLE_Print( "[RELAY] listening for spectators on port " + UTIL_ToString( m_Port ) + " with a delay of " + UTIL_ToString( m_Delay / 1000 ) + " seconds" );
+	m_Valid = true;
+	m_Thread = new boost::thread( boost::bind( &CRelay :: loop, this ) );
+}
+
+CRelay :: ~CRelay( )
+{
+	m_Exiting = true;
+
+	if( m_Thread )
+	{
+		m_Thread->join( );
+		delete m_Thread;
+	}
+
+	for( vector<RelayClient *> :: iterator i = m_Clients.begin( ); i != m_Clients.end( ); ++i )
+	{
+		delete (*i)->socket;
+		delete *i;
+	}
+
+	delete m_Socket;
+}
+
+bool CRelay :: GetValid( )
+{
+	boost::mutex::scoped_lock lock( m_NewFeedsMutex );
+	return m_Valid;
+}
+
+SHAREDRELAYFEED CRelay :: AddFeed( uint32_t hostCounter, string gameName, uint32_t war3Version, uint16_t buildNumber, bool TFT )
+{
+	// this is called by game threads
+	// once the relay has stopped nobody would ever take the data so the game doesn't get a feed at all
+
+	boost::mutex::scoped_lock lock( m_NewFeedsMutex );
+
+	if( !m_Valid )
+		return SHAREDRELAYFEED( );
+
+	SHAREDRELAYFEED Feed( new CRelayFeed( hostCounter, gameName, war3Version, buildNumber, TFT ) );
+	m_NewFeeds.push_back( Feed );
+	return Feed;
+}
+
+void CRelay :: loop( )
+{
+	while( !m_Exiting )
+	{
+		// pick up the games that started since the last iteration
+
+		boost::mutex::scoped_lock lock( m_NewFeedsMutex );
+		m_Feeds.insert( m_Feeds.end( ), m_NewFeeds.begin( ), m_NewFeeds.end( ) );
+		m_NewFeeds.clear( );
+		lock.unlock( );
+
+		uint32_t Ticks = GetTicks( );
+
+		for( vector<SHAREDRELAYFEED> :: iterator i = m_Feeds.begin( ); i != m_Feeds.end( ); ++i )
+			(*i)->Update( Ticks, m_Delay );
+
+		int nfds = 0;
+		fd_set fd;
+		fd_set send_fd;
+		FD_ZERO( &fd );
+		FD_ZERO( &send_fd );
+		m_Socket->SetFD( &fd, &send_fd, &nfds );
+
+		for( vector<RelayClient *> :: iterator i = m_Clients.begin( ); i != m_Clients.end( ); ++i )
+			(*i)->socket->SetFD( &fd, &send_fd, &nfds );
+
+		struct timeval tv;
+		tv.tv_sec = 0;
+		tv.tv_usec = RELAY_INTERVAL * 1000;
+
+		struct timeval send_tv;
+		send_tv.tv_sec = 0;
+		send_tv.tv_usec = 0;
+
+#ifdef WIN32
+		select( 1, &fd, NULL, NULL, &tv );
+		select( 1, NULL, &send_fd, NULL, &send_tv );
+#else
+		select( nfds + 1, &fd, NULL, NULL, &tv );
+		select( nfds + 1, NULL, &send_fd, NULL, &send_tv );
+#endif
+
+		if( m_Socket->HasError( ) )
+		{
+			CONSOLE_Print( "[RELAY] spectator listener error (" + m_Socket->GetErrorString( ) + "), the relay is stopped until the bot is restarted" );
+			Stop( );
+			break;
+		}
+
+		// accept new spectators
+
+		while( CTCPSocket *NewSocket = m_Socket->Accept( &fd ) )
+		{
+#ifndef WIN32
+			// select can't watch sockets beyond FD_SETSIZE
+
+			if( NewSocket->GetFD( ) >= FD_SETSIZE )
+			{
+				delete NewSocket;
+				continue;
+			}
+#endif
+
+			if( m_Clients.size( ) >= m_MaxClients )
+			{
+				delete NewSocket;
+				continue;
+			}
+
+			m_Clients.push_back( new RelayClient( NewSocket ) );
+		}
+
+		for( vector<RelayClient *> :: iterator i = m_Clients.begin( ); i != m_Clients.end( ); )
+		{
+			if( !UpdateClient( *i, &fd, &send_fd ) )
+			{
+				delete (*i)->socket;
+				delete *i;
+				i = m_Clients.erase( i );
+			}
+			else
+				++i;
+		}
+
+		// forget the games that are over, their spectators keep a reference to the feed until they've been sent everything
+
+		for( vector<SHAREDRELAYFEED> :: iterator i = m_Feeds.begin( ); i != m_Feeds.end( ); )
+		{
+			if( (*i)->GetFinished( ) )
+				i = m_Feeds.erase( i );
+			else
+				++i;
+		}
+	}
+}
+
+void CRelay :: Stop( )
+{
+	// the relay thread is about to exit so nothing will turn the feeds' data into packets any more
+	// end every feed so running games stop appending to it, drop the pending ones and make sure new games don't get one
+
+	boost::mutex::scoped_lock lock( m_NewFeedsMutex );
+	m_Valid = false;
+	m_Feeds.insert( m_Feeds.end( ), m_NewFeeds.begin( ), m_NewFeeds.end( ) );
+	m_NewFeeds.clear( );
+	lock.unlock( );
+
+	for( vector<SHAREDRELAYFEED> :: iterator i = m_Feeds.begin( ); i != m_Feeds.end( ); ++i )
+		(*i)->End( );
+
+	m_Feeds.clear( );
+
+	for( vector<RelayClient *> :: iterator i = m_Clients.begin( ); i != m_Clients.end( ); ++i )
+	{
+		delete (*i)->socket;
+		delete *i;
+	}
+
+	m_Clients.clear( );
+}
+
+bool CRelay :: UpdateClient( RelayClient *client, fd_set *fd, fd_set *send_fd )
+{
+	// returns false if the spectator should be disconnected
+
+	CTCPSocket *Socket = client->socket;
+
+	if( Socket->HasError( ) || !Socket->GetConnected( ) )
+		return false;
+
+	if( client->closing )
+	{
+		Socket->DoSend( send_fd );
+		return !Socket->HasError( ) && Socket->GetSendSize( ) > 0;
+	}
+
+	Socket->DoRecv( fd );
+	CRecvBuffer *RecvBuffer = Socket->GetBytes( );
+
+	while( !client->closing )
+	{
+		CPacketView Packet;
+		CPacketView :: FrameResult Result = Packet.Frame( (unsigned char *)RecvBuffer->GetData( ), RecvBuffer->GetSize( ) );
+
+		if( Result == CPacketView :: FRAME_INCOMPLETE )
+		{
+			if( !RecvBuffer->empty( ) && (unsigned char)RecvBuffer->GetData( )[0] != RELAY_HEADER_CONSTANT )
+				return false;
+
+			break;
+		}
+
+		if( Result != CPacketView :: FRAME_OK || Packet.GetPacketType( ) != RELAY_HEADER_CONSTANT || !ProcessPacket( client, Packet ) )
+			return false;
+
+		RecvBuffer->Consume( Packet.GetLength( ) );
+	}
+
+	if( !client->feed )
+	{
+		if( !client->closing && GetTime( ) - client->connectedTime >= RELAY_IDLETIMEOUT )
+			return false;
+	}
+	else if( Socket->GetSendSize( ) < m_MaxBuffer / 2 )
+	{
+		// the send buffer has room, top it up with released packets
+		// they're shared with every other spectator of the game so this doesn't copy anything
+
+		client->stalledTime = 0;
+
+		while( client->next < client->feed->GetNumReleased( ) && Socket->GetSendSize( ) < m_MaxBuffer )
+			Socket->PutBytes( client->feed->GetPacket( client->next++ ) );
+
+		if( client->next == client->feed->GetNumReleased( ) && client->feed->GetFinished( ) )
+		{
+			BYTEARRAY Packet;
+			StartRelayPacket( Packet, RELAY_END );
+			FinishRelayPacket( Packet );
+			Socket->PutBytes( Packet );
+			client->closing = true;
+		}
+	}
+	else if( client->next < client->feed->GetNumReleased( ) )
+	{
+		// the spectator is behind and its send buffer hasn't drained, drop it if that goes on for too long
+
+		if( client->stalledTime == 0 )
+			client->stalledTime = GetTime( );
+		else if( GetTime( ) - client->stalledTime >= RELAY_STALLTIMEOUT )
+		{
+			CONSOLE_Print( "[RELAY] dropping spectator [" + Socket->GetIPString( ) + "] of game [" + client->feed->GetGameName( ) + "], it can't keep up" );
+			return false;
+		}
+	}
+	else
+		client->stalledTime = 0;
+
+	Socket->DoSend( send_fd );
+	return !Socket->HasError( );
+}
+
+bool CRelay :: ProcessPacket( RelayClient *client, CPacketView &packet )
+{
+	// returns false if the packet is invalid
+
+	BYTEARRAY Packet;
+
+	if( packet.GetID( ) == RELAY_LIST && packet.GetLength( ) == 4 )
+	{
+		// list as many games as fit in one packet
+
+		StartRelayPacket( Packet, RELAY_GAMELIST );
+		Packet.push_back( 0 );
+
+		for( vector<SHAREDRELAYFEED> :: reverse_iterator i = m_Feeds.rbegin( ); i != m_Feeds.rend( ) && Packet[4] < 255; ++i )
+		{
+			if( Packet.size( ) + 9 + (*i)->GetGameName( ).size( ) > 65535 )
+				break;
+
+			UTIL_AppendByteArray( Packet, (*i)->GetHostCounter( ), false );
+			UTIL_AppendByteArray( Packet, GetTime( ) - (*i)->GetStartTime( ), false );
+			UTIL_AppendByteArray( Packet, (*i)->GetGameName( ) );
+			++Packet[4];
+		}
+	}
+	else if( packet.GetID( ) == RELAY_SUBSCRIBE && packet.GetLength( ) == 8 && !client->feed )
+	{
+		client->feed = FindFeed( packet.GetUInt32( 4 ) );
+
+		if( client->feed )
+		{
+			StartRelayPacket( Packet, RELAY_START );
+			UTIL_AppendByteArray( Packet, client->feed->GetHostCounter( ), false );
+			UTIL_AppendByteArray( Packet, m_Delay / 1000, false );
+			UTIL_AppendByteArray( Packet, client->feed->GetWar3Version( ), false );
+			UTIL_AppendByteArray( Packet, client->feed->GetBuildNumber( ), false );
+			Packet.push_back( client->feed->GetTFT( ) ? 1 : 0 );
+			UTIL_AppendByteArray( Packet, client->feed->GetGameName( ) );
+			CONSOLE_Print( "[RELAY] spectator [" + client->socket->GetIPString( ) + "] is watching game [" + client->feed->GetGameName( ) + "]" );
+		}
+		else
+		{
+			StartRelayPacket( Packet, RELAY_NOTFOUND );
+			client->closing = true;
+		}
+	}
+	else
+		return false;
+
+	FinishRelayPacket( Packet );
+	client->socket->PutBytes( Packet );
+	return true;
+}
+
+SHAREDRELAYFEED CRelay :: FindFeed( uint32_t hostCounter )
+{
+	// zero means the game that started most recently
+
+	if( hostCounter == 0 )
+		return m_Feeds.empty( ) ? SHAREDRELAYFEED( ) : m_Feeds.back( );
+
+	for( vector<SHAREDRELAYFEED> :: iterator i = m_Feeds.begin( ); i != m_Feeds.end( ); ++i )
+	{
+		if( (*i)->GetHostCounter( ) == hostCounter )
+			return *i;
+	}
+
+	return SHAREDRELAYFEED( );
+}
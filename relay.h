@@ -0,0 +1,93 @@
+/*
+
+	ent-ghost
+	Copyright [2011-2013] [Jack Lu]
+
+	This file is part of the ent-ghost source code.
+
+	ent-ghost is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	ent-ghost source code is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with ent-ghost source code. If not, see <http://www.gnu.org/licenses/>.
+
+	ent-ghost is modified from GHost++ (http://ghostplusplus.googlecode.com/)
+	GHost++ is Copyright [2008] [Trevor Hogan]
+
+*/
+
+#ifndef RELAY_H
+#define RELAY_H
+
+#include "relayfeed.h"
+
+#define RELAY_INTERVAL				50			// milliseconds the relay thread waits for socket activity
+#define RELAY_STALLTIMEOUT			30			// seconds a spectator's send buffer can stay full before it's dropped
+#define RELAY_IDLETIMEOUT			10			// seconds a spectator has to subscribe to a game after connecting
+
+class CTCPServer;
+class CTCPSocket;
+class CPacketView;
+
+//
+// CRelay
+//
+
+// the spectator relay lets anyone watch running games without taking a slot (bot_relayport)
+// spectators connect to a separate port, ask for a game and get its replay data delayed by bot_relaydelay seconds
+// everything runs on the relay's own thread with its own select( ) so spectators can't slow down the games
+// each spectator only has a cursor into the game's feed, packets are queued on its socket until bot_relaymaxbuffer bytes are waiting to be sent
+// a spectator whose send buffer stays full for RELAY_STALLTIMEOUT seconds can't keep up and is dropped
+
+struct RelayClient {
+	CTCPSocket *socket;
+	SHAREDRELAYFEED feed;					// the game being watched, NULL until the spectator subscribes
+	uint32_t next;							// the next segment of the feed to send
+	uint32_t connectedTime;					// GetTime when the spectator connected
+	uint32_t stalledTime;					// GetTime when the send buffer filled up, zero if it isn't full
+	bool closing;							// if the spectator is disconnected as soon as everything has been sent
+
+	RelayClient( CTCPSocket *nSocket ) : socket( nSocket ), next( 0 ), connectedTime( GetTime( ) ), stalledTime( 0 ), closing( false ) { }
+};
+
+class CRelay
+{
+private:
+	uint16_t m_Port;
+	uint32_t m_Delay;						// milliseconds
+	uint32_t m_MaxClients;
+	uint32_t m_MaxBuffer;					// the most bytes waiting to be sent to one spectator
+	CTCPServer *m_Socket;
+	vector<RelayClient *> m_Clients;		// only touched by the relay thread
+	vector<SHAREDRELAYFEED> m_Feeds;		// only touched by the relay thread
+	vector<SHAREDRELAYFEED> m_NewFeeds;		// feeds added by game threads that the relay thread hasn't picked up yet
+	boost::mutex m_NewFeedsMutex;			// protects m_NewFeeds and m_Valid
+	bool m_Valid;							// false if listening failed, either at startup or later on the relay thread
+	volatile bool m_Exiting;
+	boost::thread *m_Thread;
+
+public:
+	CRelay( string nBindAddress, uint16_t nPort, uint32_t nDelay, uint32_t nMaxClients, uint32_t nMaxBuffer );
+	~CRelay( );
+
+	bool GetValid( );
+
+	SHAREDRELAYFEED AddFeed( uint32_t hostCounter, string gameName, uint32_t war3Version, uint16_t buildNumber, bool TFT );
+
+	void loop( );
+
+private:
+	void Stop( );
+	bool UpdateClient( RelayClient *client, fd_set *fd, fd_set *send_fd );
+	bool ProcessPacket( RelayClient *client, CPacketView &packet );
+	SHAREDRELAYFEED FindFeed( uint32_t hostCounter );
+};
+
+#endif
@@ -0,0 +1,115 @@
+/*
+
+	ent-ghost
+	Copyright [2011-2013] [Jack Lu]
+
+	This file is part of the ent-ghost source code.
+
+	ent-ghost is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	ent-ghost source code is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with ent-ghost source code. If not, see <http://www.gnu.org/licenses/>.
+
+	ent-ghost is modified from GHost++ (http://ghostplusplus.googlecode.com/)
+	GHost++ is Copyright [2008] [Trevor Hogan]
+
+*/
+
+#include "ghost.h"
+#include "util.h"
+#include "relayfeed.h"
+
+void StartRelayPacket( BYTEARRAY &packet, unsigned char id )
+{
+	packet.push_back( RELAY_HEADER_CONSTANT );
+	packet.push_back( id );
+	packet.push_back( 0 );
+	packet.push_back( 0 );
+}
+
+void FinishRelayPacket( BYTEARRAY &packet )
+{
+	packet[2] = (unsigned char)packet.size( );
+	packet[3] = (unsigned char)( packet.size( ) >> 8 );
+}
+
+//
+// CRelayFeed
+//
+
+CRelayFeed :: CRelayFeed( uint32_t nHostCounter, string nGameName, uint32_t nWar3Version, uint16_t nBuildNumber, bool nTFT ) : m_HostCounter( nHostCounter ), m_GameName( nGameName ), m_War3Version( nWar3Version ), m_BuildNumber( nBuildNumber ), m_TFT( nTFT ), m_StartTime( GetTime( ) ), m_PendingTicks( 0 ), m_Ended( false ), m_NumReleased( 0 ), m_Closed( false )
+{
+
+}
+
+CRelayFeed :: ~CRelayFeed( )
+{
+
+}
+
+void CRelayFeed :: Append( const char *data, uint32_t length )
+{
+	boost::mutex::scoped_lock lock( m_Mutex );
+
+	if( m_Ended || length == 0 )
+		return;
+
+	if( m_Pending.empty( ) )
+		m_PendingTicks = GetTicks( );
+
+	m_Pending.append( data, length );
+}
+
+void CRelayFeed :: End( )
+{
+	boost::mutex::scoped_lock lock( m_Mutex );
+	m_Ended = true;
+}
+
+void CRelayFeed :: Update( uint32_t ticks, uint32_t delay )
+{
+	// turn the pending data into packets once there's enough of it, it's been waiting long enough or the game is over
+	// the lock is only held to take the data so the game thread never waits for us to build the packets
+
+	if( !m_Closed )
+	{
+		string Pending;
+		uint32_t PendingTicks = 0;
+		boost::mutex::scoped_lock lock( m_Mutex );
+
+		if( !m_Pending.empty( ) && ( m_Pending.size( ) >= RELAY_SEGMENTSIZE || ticks - m_PendingTicks >= RELAY_SEGMENTINTERVAL || m_Ended ) )
+		{
+			Pending.swap( m_Pending );
+			PendingTicks = m_PendingTicks;
+		}
+
+		if( m_Ended && m_Pending.empty( ) )
+			m_Closed = true;
+
+		lock.unlock( );
+
+		for( uint32_t i = 0; i < Pending.size( ); i += RELAY_SEGMENTSIZE )
+		{
+			uint32_t Length = Pending.size( ) - i < RELAY_SEGMENTSIZE ? Pending.size( ) - i : RELAY_SEGMENTSIZE;
+			BYTEARRAY Packet;
+			Packet.reserve( 4 + Length );
+			StartRelayPacket( Packet, RELAY_DATA );
+			Packet.insert( Packet.end( ), Pending.begin( ) + i, Pending.begin( ) + i + Length );
+			FinishRelayPacket( Packet );
+			m_Segments.push_back( RelaySegment( PendingTicks, UTIL_CreateSharedByteArray( Packet ) ) );
+		}
+	}
+
+	// release the packets that are old enough
+
+	while( m_NumReleased < m_Segments.size( ) && ticks - m_Segments[m_NumReleased].ticks >= delay )
+		++m_NumReleased;
+}
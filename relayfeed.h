@@ -0,0 +1,124 @@
+/*
+
+	ent-ghost
+	Copyright [2011-2013] [Jack Lu]
+
+	This file is part of the ent-ghost source code.
+
+	ent-ghost is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	ent-ghost source code is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with ent-ghost source code. If not, see <http://www.gnu.org/licenses/>.
+
+	ent-ghost is modified from GHost++ (http://ghostplusplus.googlecode.com/)
+	GHost++ is Copyright [2008] [Trevor Hogan]
+
+*/
+
+#ifndef RELAYFEED_H
+#define RELAYFEED_H
+
+//
+// spectator relay protocol
+//
+
+// every packet starts with RELAY_HEADER_CONSTANT, an ID and the two byte length of the whole packet (like W3GS and GPS packets)
+// spectator -> relay:
+//  RELAY_LIST			(nothing)
+//  RELAY_SUBSCRIBE		4 bytes host counter of the game to watch, zero for the game that started most recently
+// relay -> spectator:
+//  RELAY_GAMELIST		1 byte number of games, then for each game 4 bytes host counter, 4 bytes seconds since it started and the null terminated game name
+//  RELAY_START			4 bytes host counter, 4 bytes delay in seconds, 4 bytes war3 version, 2 bytes build number, 1 byte TFT and the null terminated game name
+//  RELAY_DATA			the next part of the decompressed replay data (starting with the replay's game header and player list)
+//  RELAY_END			(nothing) the game is over and every RELAY_DATA packet has been sent, the relay disconnects afterwards
+//  RELAY_NOTFOUND		(nothing) there's no such game, the relay disconnects afterwards
+
+#define RELAY_HEADER_CONSTANT		250
+
+#define RELAY_SEGMENTSIZE			8192		// the most replay data in one RELAY_DATA packet
+#define RELAY_SEGMENTINTERVAL		500			// milliseconds replay data is collected for before it's turned into a RELAY_DATA packet
+
+enum RelayProtocol {
+	RELAY_LIST				= 1,
+	RELAY_SUBSCRIBE			= 2,
+	RELAY_GAMELIST			= 3,
+	RELAY_START				= 4,
+	RELAY_DATA				= 5,
+	RELAY_END				= 6,
+	RELAY_NOTFOUND			= 7
+};
+
+// start a relay packet, FinishRelayPacket fills in the length
+
+void StartRelayPacket( BYTEARRAY &packet, unsigned char id );
+void FinishRelayPacket( BYTEARRAY &packet );
+
+//
+// CRelayFeed
+//
+
+// the replay data of one game as it's recorded (see CReplay :: Flush)
+// the game thread only appends the data to a pending buffer so spectators never cost the game any time
+// the relay thread turns the pending data into RELAY_DATA packets which are kept for the rest of the game so late spectators can start from the beginning
+// each packet is built once and queued on every spectator's socket as a shared send buffer segment so a packet with 500 spectators is still one packet
+// a packet is only released to spectators once the configured delay (bot_relaydelay) has passed since its data was recorded
+
+struct RelaySegment {
+	uint32_t ticks;							// GetTicks when the first byte of data in the packet was recorded
+	SHAREDBYTEARRAY packet;					// the RELAY_DATA packet
+
+	RelaySegment( uint32_t nTicks, const SHAREDBYTEARRAY &nPacket ) : ticks( nTicks ), packet( nPacket ) { }
+};
+
+class CRelayFeed
+{
+private:
+	uint32_t m_HostCounter;
+	string m_GameName;
+	uint32_t m_War3Version;
+	uint16_t m_BuildNumber;
+	bool m_TFT;
+	uint32_t m_StartTime;					// GetTime when the game started
+	boost::mutex m_Mutex;					// protects m_Pending, m_PendingTicks and m_Ended
+	string m_Pending;						// data appended by the game thread that isn't in a packet yet
+	uint32_t m_PendingTicks;				// GetTicks when the first byte of m_Pending was appended
+	bool m_Ended;							// if the game thread won't append anything else
+	vector<RelaySegment> m_Segments;		// only touched by the relay thread
+	uint32_t m_NumReleased;					// number of segments that can be sent to spectators, only touched by the relay thread
+	bool m_Closed;							// if every byte is in a segment and the game ended, only touched by the relay thread
+
+public:
+	CRelayFeed( uint32_t nHostCounter, string nGameName, uint32_t nWar3Version, uint16_t nBuildNumber, bool nTFT );
+	~CRelayFeed( );
+
+	uint32_t GetHostCounter( )				{ return m_HostCounter; }
+	string GetGameName( )					{ return m_GameName; }
+	uint32_t GetWar3Version( )				{ return m_War3Version; }
+	uint16_t GetBuildNumber( )				{ return m_BuildNumber; }
+	bool GetTFT( )							{ return m_TFT; }
+	uint32_t GetStartTime( )				{ return m_StartTime; }
+	uint32_t GetNumReleased( )				{ return m_NumReleased; }
+	const SHAREDBYTEARRAY &GetPacket( uint32_t segment )	{ return m_Segments[segment].packet; }
+	bool GetFinished( )						{ return m_Closed && m_NumReleased == m_Segments.size( ); }
+
+	// called by the game thread
+
+	void Append( const char *data, uint32_t length );
+	void End( );
+
+	// called by the relay thread
+
+	void Update( uint32_t ticks, uint32_t delay );
+};
+
+typedef boost::shared_ptr<CRelayFeed> SHAREDRELAYFEED;
+
+#endif
@@ -27,20 +27,28 @@
 #include "util.h"
 #include "packed.h"
 #include "replay.h"
+#include "replaywriter.h"
+#include "relayfeed.h"
 #include "gameprotocol.h"
 
 //
 // CReplay
 //
 
-CReplay :: CReplay( ) : CPacked( ), m_HostPID( 0 ), m_PlayerCount( 0 ), m_MapGameType( 0 ), m_RandomSeed( 0 ), m_SelectMode( 0 ), m_StartSpotCount( 0 )
+CReplay :: CReplay( ) : CPacked( ), m_HostPID( 0 ), m_PlayerCount( 0 ), m_MapGameType( 0 ), m_RandomSeed( 0 ), m_SelectMode( 0 ), m_StartSpotCount( 0 ), m_Compressor( NULL ), m_StreamedSize( 0 ), m_RelayedSize( 0 )
 {
-	m_CompiledBlocks.reserve( 262144 );
+	m_CompiledBlocks.reserve( PACKED_BLOCKSIZE * 2 );
 }
 
 CReplay :: ~CReplay( )
 {
+	// a replay that was never saved leaves nothing behind
 
+	if( m_Writer )
+		m_Writer->Abort( );
+
+	if( m_RelayFeed )
+		m_RelayFeed->End( );
 }
 
 void CReplay :: AddLeaveGame( uint32_t reason, unsigned char PID, uint32_t result )
@@ -52,6 +60,7 @@ void CReplay :: AddLeaveGame( uint32_t reason, unsigned char PID, uint32_t resul
 	UTIL_AppendByteArray( Block, result, false );
 	UTIL_AppendByteArray( Block, (uint32_t)1, false );
 	m_CompiledBlocks += string( Block.begin( ), Block.end( ) );
+	Flush( );
 }
 
 void CReplay :: AddLeaveGameDuringLoading( uint32_t reason, unsigned char PID, uint32_t result )
@@ -65,53 +74,36 @@ void CReplay :: AddLeaveGameDuringLoading( uint32_t reason, unsigned char PID, u
 	m_LoadingBlocks.push( Block );
 }
 
-void CReplay :: AddTimeSlot2( queue<CIncomingAction *> actions )
+void CReplay :: AddTimeSlot( const BYTEARRAY &actionPacket )
 {
-	BYTEARRAY Block;
-	Block.push_back( REPLAY_TIMESLOT2 );
-	UTIL_AppendByteArray( Block, (uint16_t)0, false );
-	UTIL_AppendByteArray( Block, (uint16_t)0, false );
+	// add a time slot from the W3GS_INCOMING_ACTION or W3GS_INCOMING_ACTION2 packet that was sent to the players
+	// the replay block holds the same send interval and actions so they're appended as they are instead of being serialized again
+	// W3GS_INCOMING_ACTION2 becomes a REPLAY_TIMESLOT2 block and doesn't advance the replay length
+	// the packet's crc is dropped, it's only there if the packet has any actions
 
-	while( !actions.empty( ) )
-	{
-		CIncomingAction *Action = actions.front( );
-		actions.pop( );
-		Block.push_back( Action->GetPID( ) );
-		UTIL_AppendByteArray( Block, (uint16_t)Action->GetAction( )->size( ), false );
-		UTIL_AppendByteArrayFast( Block, *Action->GetAction( ) );
-	}
+	if( actionPacket.size( ) < 6 )
+		return;
 
-	// assign length
+	bool Overflow = actionPacket[1] == CGameProtocol :: W3GS_INCOMING_ACTION2;
+	uint32_t ActionsStart = actionPacket.size( ) > 6 ? 8 : 6;
+	uint32_t ActionsLength = actionPacket.size( ) - ActionsStart;
+	uint16_t BlockLength = ActionsLength + 2;
 
-	BYTEARRAY LengthBytes = UTIL_CreateByteArray( (uint16_t)( Block.size( ) - 3 ), false );
-	Block[1] = LengthBytes[0];
-	Block[2] = LengthBytes[1];
-	m_CompiledBlocks += string( Block.begin( ), Block.end( ) );
-}
-
-void CReplay :: AddTimeSlot( uint16_t timeIncrement, queue<CIncomingAction *> actions )
-{
-	BYTEARRAY Block;
-	Block.push_back( REPLAY_TIMESLOT );
-	UTIL_AppendByteArray( Block, (uint16_t)0, false );
-	UTIL_AppendByteArray( Block, timeIncrement, false );
+	char Header[5];
+	Header[0] = Overflow ? REPLAY_TIMESLOT2 : REPLAY_TIMESLOT;
+	Header[1] = (char)BlockLength;
+	Header[2] = (char)( BlockLength >> 8 );
+	Header[3] = (char)actionPacket[4];
+	Header[4] = (char)actionPacket[5];
+	m_CompiledBlocks.append( Header, 5 );
 
-	while( !actions.empty( ) )
-	{
-		CIncomingAction *Action = actions.front( );
-		actions.pop( );
-		Block.push_back( Action->GetPID( ) );
-		UTIL_AppendByteArray( Block, (uint16_t)Action->GetAction( )->size( ), false );
-		UTIL_AppendByteArrayFast( Block, *Action->GetAction( ) );
-	}
+	if( ActionsLength > 0 )
+		m_CompiledBlocks.append( (const char *)&actionPacket[ActionsStart], ActionsLength );
 
-	// assign length
+	if( !Overflow )
+		m_ReplayLength += actionPacket[4] | ( actionPacket[5] << 8 );
 
-	BYTEARRAY LengthBytes = UTIL_CreateByteArray( (uint16_t)( Block.size( ) - 3 ), false );
-	Block[1] = LengthBytes[0];
-	Block[2] = LengthBytes[1];
-	m_CompiledBlocks += string( Block.begin( ), Block.end( ) );
-	m_ReplayLength += timeIncrement;
+	Flush( );
 }
 
 void CReplay :: AddChatMessage( unsigned char PID, unsigned char flags, uint32_t chatMode, string message )
@@ -130,6 +122,7 @@ void CReplay :: AddChatMessage( unsigned char PID, unsigned char flags, uint32_t
 	Block[2] = LengthBytes[0];
 	Block[3] = LengthBytes[1];
 	m_CompiledBlocks += string( Block.begin( ), Block.end( ) );
+	Flush( );
 }
 
 void CReplay :: AddLoadingBlock( BYTEARRAY &loadingBlock )
@@ -137,14 +130,91 @@ void CReplay :: AddLoadingBlock( BYTEARRAY &loadingBlock )
 	m_LoadingBlocks.push( loadingBlock );
 }
 
+bool CReplay :: Stream( CReplayCompressor *compressor, string fileName, string gameName, string statString )
+{
+	// start streaming the replay to a temporary file, this is called when the game has finished loading
+	// from now on the replay data is compressed in the background as it's recorded and Save only has to finish the last block and write the header
+	// the host player is part of the data we're handing over so it can't be changed after this (see SetHostPID)
+
+	if( m_Writer || !compressor )
+		return false;
+
+	SHAREDREPLAYWRITER Writer( new CReplayWriter( fileName ) );
+
+	if( Writer->GetError( ) )
+	{
+		Writer->Abort( );
+
+		if( m_RelayFeed )
+		{
+			m_RelayFeed->End( );
+			m_RelayFeed.reset( );
+		}
+
+		return false;
+	}
+
+	CONSOLE_Print( "[REPLAY] streaming replay to file [" + fileName + "]" );
+	m_Compressor = compressor;
+	m_Writer = Writer;
+	m_CompiledBlocks.insert( 0, BuildStart( gameName, statString ) );
+	Flush( );
+	return true;
+}
+
 void CReplay :: BuildReplay( string gameName, string statString, uint32_t war3Version, uint16_t buildNumber )
 {
 	m_War3Version = war3Version;
 	m_BuildNumber = buildNumber;
 	m_Flags = 32768;
 
+	// a streamed replay has already handed over everything but the last block, Save does the rest
+
+	if( m_Writer )
+		return;
+
 	CONSOLE_Print( "[REPLAY] building replay" );
 
+	m_Decompressed = BuildStart( gameName, statString );
+	m_Decompressed += m_CompiledBlocks;
+}
+
+bool CReplay :: Save( bool TFT, string fileName )
+{
+	if( !m_Writer )
+		return CPacked :: Save( TFT, fileName );
+
+	// the relay feed already has everything, the padding isn't replay data
+
+	if( m_RelayFeed )
+	{
+		m_RelayFeed->End( );
+		m_RelayFeed.reset( );
+	}
+
+	// pad the last block with zeros the same way CPacked :: Compress does and hand it over
+
+	uint32_t DecompressedSize = m_StreamedSize + m_CompiledBlocks.size( );
+	m_CompiledBlocks.append( PACKED_BLOCKSIZE - ( m_CompiledBlocks.size( ) % PACKED_BLOCKSIZE ), 0 );
+	Flush( );
+
+	SHAREDREPLAYWRITER Writer = m_Writer;
+	m_Writer.reset( );
+
+	if( !Writer->Wait( ) )
+	{
+		Writer->Abort( );
+		return false;
+	}
+
+	CONSOLE_Print( "[PACKED] saving data to file [" + fileName + "]" );
+	return Writer->Finish( BuildHeader( TFT, Writer->GetBlocksSize( ), Writer->GetNumBlocks( ), DecompressedSize ), fileName );
+}
+
+string CReplay :: BuildStart( string gameName, string statString )
+{
+	// the start of the replay data, everything up to and including the third start block
+
 	uint32_t LanguageID = 0x0012F8B0;
 
 	BYTEARRAY Replay;
@@ -210,10 +280,31 @@ void CReplay :: BuildReplay( string gameName, string statString, uint32_t war3Ve
 	Replay.push_back( REPLAY_THIRDSTARTBLOCK );
 	UTIL_AppendByteArray( Replay, (uint32_t)1, false );
 
-	// done
+	return string( Replay.begin( ), Replay.end( ) );
+}
+
+void CReplay :: Flush( )
+{
+	// publish the new data to the relay feed and hand every complete block to the compressor
 
-	m_Decompressed = string( Replay.begin( ), Replay.end( ) );
-	m_Decompressed += m_CompiledBlocks;
+	if( !m_Writer )
+		return;
+
+	if( m_RelayFeed )
+	{
+		m_RelayFeed->Append( m_CompiledBlocks.data( ) + m_RelayedSize, m_CompiledBlocks.size( ) - m_RelayedSize );
+		m_RelayedSize = m_CompiledBlocks.size( );
+	}
+
+	while( m_CompiledBlocks.size( ) >= PACKED_BLOCKSIZE )
+	{
+		string Chunk = m_CompiledBlocks.substr( 0, PACKED_BLOCKSIZE );
+		m_CompiledBlocks.erase( 0, PACKED_BLOCKSIZE );
+		m_Compressor->Compress( m_Writer, Chunk );
+		m_StreamedSize += PACKED_BLOCKSIZE;
+	}
+
+	m_RelayedSize = m_CompiledBlocks.size( );
 }
 
 #define READB( x, y, z )	(x).read( (char *)(y), (z) )
@@ -509,19 +600,22 @@ void CReplay :: ParseReplay( bool parseBlocks )
 			UTIL_AppendByteArray( Block, GarbageData, 13 );
 			m_Blocks.push( Block );
 		}
-		else if( Garbage1 == CReplay :: REPLAY_TIMESLOT )
+		else if( Garbage1 == CReplay :: REPLAY_TIMESLOT || Garbage1 == CReplay :: REPLAY_TIMESLOT2 )
 		{
+			// a REPLAY_TIMESLOT2 block holds the actions that didn't fit in the next time slot and doesn't advance the replay length (see AddTimeSlot)
+
+			unsigned char BlockID = Garbage1;
 			uint16_t BlockSize;
 			READB( ISS, &BlockSize, 2 );
 			READB( ISS, GarbageData, BlockSize );
 
-			if( BlockSize >= 2 )
+			if( BlockSize >= 2 && BlockID == CReplay :: REPLAY_TIMESLOT )
 				ActualReplayLength += GarbageData[0] | GarbageData[1] << 8;
 
 			// reconstruct the block
 
 			BYTEARRAY Block;
-			Block.push_back( CReplay :: REPLAY_TIMESLOT );
+			Block.push_back( BlockID );
 			UTIL_AppendByteArray( Block, BlockSize, false );
 			UTIL_AppendByteArray( Block, GarbageData, BlockSize );
 			m_Blocks.push( Block );
@@ -32,7 +32,14 @@
 // CReplay
 //
 
+// once the game has loaded the replay can be streamed (see Stream) instead of being built and compressed all at once when the game ends
+// everything up to the end of the loading blocks is final by then so the data is handed to the replay compressor in PACKED_BLOCKSIZE chunks as it's recorded
+// a streamed replay can also be published to the spectator relay as it's recorded (see SetRelayFeed)
+
 class CIncomingAction;
+class CReplayWriter;
+class CReplayCompressor;
+class CRelayFeed;
 
 class CReplay : public CPacked
 {
@@ -64,7 +71,12 @@ private:
 	queue<BYTEARRAY> m_LoadingBlocks;
 	queue<BYTEARRAY> m_Blocks;
 	queue<uint32_t> m_CheckSums;
-	string m_CompiledBlocks;
+	string m_CompiledBlocks;				// when streaming this is only the data that hasn't been handed to the compressor yet
+	CReplayCompressor *m_Compressor;
+	boost::shared_ptr<CReplayWriter> m_Writer;	// the file being streamed to, null if we aren't streaming
+	uint32_t m_StreamedSize;				// bytes of decompressed data handed to the compressor
+	boost::shared_ptr<CRelayFeed> m_RelayFeed;	// the spectator relay's feed for this game, null if it isn't relayed
+	uint32_t m_RelayedSize;					// bytes at the start of m_CompiledBlocks that were already published to the relay feed
 
 public:
 	CReplay( );
@@ -84,6 +96,7 @@ public:
 	queue<BYTEARRAY> *GetLoadingBlocks( )	{ return &m_LoadingBlocks; }
 	queue<BYTEARRAY> *GetBlocks( )			{ return &m_Blocks; }
 	queue<uint32_t> *GetCheckSums( )		{ return &m_CheckSums; }
+	bool GetStreaming( )					{ return m_Writer.get( ) != NULL; }
 
 	void AddPlayer( unsigned char nPID, string nName )		{ m_Players.push_back( PIDPlayer( nPID, nName ) ); }
 	void SetSlots( vector<CGameSlot> nSlots )				{ m_Slots = nSlots; }
@@ -91,18 +104,24 @@ public:
 	void SetSelectMode( unsigned char nSelectMode )			{ m_SelectMode = nSelectMode; }
 	void SetStartSpotCount( unsigned char nStartSpotCount )	{ m_StartSpotCount = nStartSpotCount; }
 	void SetMapGameType( uint32_t nMapGameType )			{ m_MapGameType = nMapGameType; }
-	void SetHostPID( unsigned char nHostPID )				{ m_HostPID = nHostPID; }
-	void SetHostName( string nHostName )					{ m_HostName = nHostName; }
+	void SetHostPID( unsigned char nHostPID )				{ if( !m_Writer ) m_HostPID = nHostPID; }
+	void SetHostName( string nHostName )					{ if( !m_Writer ) m_HostName = nHostName; }
+	void SetRelayFeed( const boost::shared_ptr<CRelayFeed> &nRelayFeed )	{ if( !m_Writer ) m_RelayFeed = nRelayFeed; }
 
 	void AddLeaveGame( uint32_t reason, unsigned char PID, uint32_t result );
 	void AddLeaveGameDuringLoading( uint32_t reason, unsigned char PID, uint32_t result );
-	void AddTimeSlot2( queue<CIncomingAction *> actions );
-	void AddTimeSlot( uint16_t timeIncrement, queue<CIncomingAction *> actions );
+	void AddTimeSlot( const BYTEARRAY &actionPacket );
 	void AddChatMessage( unsigned char PID, unsigned char flags, uint32_t chatMode, string message );
 	void AddLoadingBlock( BYTEARRAY &loadingBlock );
+	bool Stream( CReplayCompressor *compressor, string fileName, string gameName, string statString );
 	void BuildReplay( string gameName, string statString, uint32_t war3Version, uint16_t buildNumber );
+	virtual bool Save( bool TFT, string fileName );
 
 	void ParseReplay( bool parseBlocks );
+
+private:
+	string BuildStart( string gameName, string statString );
+	void Flush( );
 };
 
 #endif
@@ -0,0 +1,402 @@
+/*
+
+	ent-ghost
+	Copyright [2011-2013] [Jack Lu]
+
+	This file is part of the ent-ghost source code.
+
+	ent-ghost is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	ent-ghost source code is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with ent-ghost source code. If not, see <http://www.gnu.org/licenses/>.
+
+	ent-ghost is modified from GHost++ (http://ghostplusplus.googlecode.com/)
+	GHost++ is Copyright [2008] [Trevor Hogan]
+
+*/
+
+#include "ghost.h"
+#include "util.h"
+#include "crc32.h"
+#include "mappedfile.h"
+#include "replayarchive.h"
+
+#ifndef WIN32
+ #include <errno.h>
+ #include <fcntl.h>
+ #include <unistd.h>
+ #include <sys/file.h>
+ #include <sys/stat.h>
+#endif
+
+#ifndef WIN32
+
+// records are applied in the order their replays were written so a game ID that was added again ends up with its newest replay
+
+bool EntryOffsetLess( const pair<uint32_t, ReplayArchiveEntry> &a, const pair<uint32_t, ReplayArchiveEntry> &b )
+{
+	return a.second.offset < b.second.offset;
+}
+
+// pread and pwrite can return early, these keep going until everything was read or written
+
+bool ReadAll( int fd, void *data, size_t size, uint64_t offset )
+{
+	while( size > 0 )
+	{
+		ssize_t Result = pread( fd, data, size, offset );
+
+		if( Result < 0 && errno == EINTR )
+			continue;
+
+		if( Result <= 0 )
+			return false;
+
+		data = (char *)data + Result;
+		size -= Result;
+		offset += Result;
+	}
+
+	return true;
+}
+
+bool WriteAll( int fd, const void *data, size_t size, uint64_t offset )
+{
+	while( size > 0 )
+	{
+		ssize_t Result = pwrite( fd, data, size, offset );
+
+		if( Result < 0 && errno == EINTR )
+			continue;
+
+		if( Result <= 0 )
+			return false;
+
+		data = (const char *)data + Result;
+		size -= Result;
+		offset += Result;
+	}
+
+	return true;
+}
+
+#endif
+
+//
+// CReplayArchive
+//
+
+CReplayArchive :: CReplayArchive( string nFileName, bool nReadOnly ) : m_FileName( nFileName ), m_ReadOnly( nReadOnly ), m_FD( -1 ), m_IndexFD( -1 ), m_Size( 0 ), m_IndexSize( 0 ), m_CRC( new CCRC32( ) ), m_Valid( false )
+{
+	m_CRC->Initialize( );
+	m_Valid = Open( );
+}
+
+CReplayArchive :: ~CReplayArchive( )
+{
+#ifndef WIN32
+	if( m_FD != -1 )
+		close( m_FD );
+
+	if( m_IndexFD != -1 )
+		close( m_IndexFD );
+#endif
+
+	delete m_CRC;
+}
+
+uint32_t CReplayArchive :: GetNumEntries( )
+{
+	boost::mutex::scoped_lock lock( m_Mutex );
+	return m_Entries.size( );
+}
+
+bool CReplayArchive :: Add( uint32_t id, const unsigned char *data, uint32_t size )
+{
+#ifdef WIN32
+	return false;
+#else
+	if( !m_Valid || m_ReadOnly || size == 0 )
+		return false;
+
+	uint32_t Entry[4];
+	Entry[0] = REPLAYARCHIVE_ENTRYMAGIC;
+	Entry[1] = id;
+	Entry[2] = size;
+	Entry[3] = m_CRC->FullCRC( (unsigned char *)data, size );
+
+	boost::mutex::scoped_lock lock( m_Mutex );
+
+	if( !WriteAll( m_FD, Entry, REPLAYARCHIVE_ENTRYSIZE, m_Size ) || !WriteAll( m_FD, data, size, m_Size + REPLAYARCHIVE_ENTRYSIZE ) )
+	{
+		CONSOLE_Print( "[ARCHIVE] error writing replay " + UTIL_ToString( id ) + " to [" + m_FileName + "], error " + UTIL_ToString( errno ) );
+
+		// cut off whatever was written so the next replay doesn't end up behind a broken one
+
+		if( ftruncate( m_FD, m_Size ) == -1 )
+			m_Valid = false;
+
+		return false;
+	}
+
+	ReplayArchiveEntry NewEntry( m_Size + REPLAYARCHIVE_ENTRYSIZE, size );
+	m_Size += REPLAYARCHIVE_ENTRYSIZE + size;
+	m_Entries[id] = NewEntry;
+
+	if( !AddRecord( id, NewEntry ) )
+		CONSOLE_Print( "[ARCHIVE] error writing the index of [" + m_FileName + "], it will be recovered the next time the archive is opened" );
+
+	return true;
+#endif
+}
+
+bool CReplayArchive :: AddFile( uint32_t id, string fileName )
+{
+	CMappedFile File;
+
+	if( !File.Open( fileName, MAPPEDFILE_SEQUENTIAL ) )
+		return false;
+
+	return Add( id, File.GetData( ), File.GetSize( ) );
+}
+
+bool CReplayArchive :: Get( uint32_t id, string &data )
+{
+	// read the entry header and the replay at once and make sure it's the replay the index says it is
+
+	data.clear( );
+
+#ifdef WIN32
+	return false;
+#else
+	boost::mutex::scoped_lock lock( m_Mutex );
+	map<uint32_t, ReplayArchiveEntry> :: iterator i = m_Entries.find( id );
+
+	if( !m_Valid || i == m_Entries.end( ) )
+		return false;
+
+	ReplayArchiveEntry Entry = i->second;
+	lock.unlock( );
+
+	string Buffer( REPLAYARCHIVE_ENTRYSIZE + Entry.size, 0 );
+
+	if( !ReadAll( m_FD, &Buffer[0], Buffer.size( ), Entry.offset - REPLAYARCHIVE_ENTRYSIZE ) )
+	{
+		CONSOLE_Print( "[ARCHIVE] error reading replay " + UTIL_ToString( id ) + " from [" + m_FileName + "], error " + UTIL_ToString( errno ) );
+		return false;
+	}
+
+	uint32_t Header[4];
+	memcpy( Header, Buffer.data( ), REPLAYARCHIVE_ENTRYSIZE );
+
+	if( Header[0] != REPLAYARCHIVE_ENTRYMAGIC || Header[1] != id || Header[2] != Entry.size || Header[3] != m_CRC->FullCRC( (unsigned char *)&Buffer[REPLAYARCHIVE_ENTRYSIZE], Entry.size ) )
+	{
+		CONSOLE_Print( "[ARCHIVE] replay " + UTIL_ToString( id ) + " in [" + m_FileName + "] is corrupt" );
+		return false;
+	}
+
+	data = Buffer.substr( REPLAYARCHIVE_ENTRYSIZE );
+	return true;
+#endif
+}
+
+void CReplayArchive :: GetEntries( map<uint32_t, ReplayArchiveEntry> &entries )
+{
+	boost::mutex::scoped_lock lock( m_Mutex );
+	entries = m_Entries;
+}
+
+bool CReplayArchive :: Open( )
+{
+#ifdef WIN32
+	CONSOLE_Print( "[ARCHIVE] replay archives aren't supported on Windows" );
+	return false;
+#else
+	string IndexFileName = m_FileName + ".idx";
+	int Flags = m_ReadOnly ? O_RDONLY : O_RDWR | O_CREAT;
+	m_FD = open( m_FileName.c_str( ), Flags, 0644 );
+	m_IndexFD = open( IndexFileName.c_str( ), Flags, 0644 );
+	struct stat Stat;
+	struct stat IndexStat;
+
+	if( m_FD == -1 || m_IndexFD == -1 || fstat( m_FD, &Stat ) == -1 || fstat( m_IndexFD, &IndexStat ) == -1 )
+	{
+		CONSOLE_Print( "[ARCHIVE] unable to open [" + m_FileName + "], error " + UTIL_ToString( errno ) );
+		return false;
+	}
+
+	// two writers would append over each other and the recovery below would cut off a replay another process is writing
+
+	if( !m_ReadOnly && flock( m_FD, LOCK_EX | LOCK_NB ) == -1 )
+	{
+		CONSOLE_Print( "[ARCHIVE] unable to open [" + m_FileName + "], it's in use by another process" );
+		return false;
+	}
+
+	// new files start with a header
+
+	uint32_t Header[2];
+	Header[0] = REPLAYARCHIVE_MAGIC;
+	Header[1] = REPLAYARCHIVE_VERSION;
+
+	if( !m_ReadOnly && Stat.st_size == 0 && !WriteAll( m_FD, Header, REPLAYARCHIVE_HEADERSIZE, 0 ) )
+		return false;
+
+	Header[0] = REPLAYARCHIVE_INDEXMAGIC;
+
+	if( !m_ReadOnly && IndexStat.st_size == 0 && !WriteAll( m_IndexFD, Header, REPLAYARCHIVE_HEADERSIZE, 0 ) )
+		return false;
+
+	uint64_t Size = Stat.st_size > 0 ? Stat.st_size : REPLAYARCHIVE_HEADERSIZE;
+	uint64_t IndexSize = IndexStat.st_size > 0 ? IndexStat.st_size : REPLAYARCHIVE_HEADERSIZE;
+
+	if( !ReadAll( m_FD, Header, REPLAYARCHIVE_HEADERSIZE, 0 ) || Header[0] != REPLAYARCHIVE_MAGIC || Header[1] != REPLAYARCHIVE_VERSION )
+	{
+		CONSOLE_Print( "[ARCHIVE] [" + m_FileName + "] isn't a replay archive" );
+		return false;
+	}
+
+	if( !ReadAll( m_IndexFD, Header, REPLAYARCHIVE_HEADERSIZE, 0 ) || Header[0] != REPLAYARCHIVE_INDEXMAGIC || Header[1] != REPLAYARCHIVE_VERSION )
+	{
+		CONSOLE_Print( "[ARCHIVE] [" + IndexFileName + "] isn't a replay archive index" );
+		return false;
+	}
+
+	// read the index, records pointing past the end of the archive are dropped
+
+	uint32_t NumRecords = ( IndexSize - REPLAYARCHIVE_HEADERSIZE ) / REPLAYARCHIVE_RECORDSIZE;
+	m_IndexSize = REPLAYARCHIVE_HEADERSIZE + (uint64_t)NumRecords * REPLAYARCHIVE_RECORDSIZE;
+	vector< pair<uint32_t, ReplayArchiveEntry> > Records;
+
+	if( NumRecords > 0 )
+	{
+		string Data( NumRecords * REPLAYARCHIVE_RECORDSIZE, 0 );
+
+		if( !ReadAll( m_IndexFD, &Data[0], Data.size( ), REPLAYARCHIVE_HEADERSIZE ) )
+		{
+			CONSOLE_Print( "[ARCHIVE] error reading [" + IndexFileName + "], error " + UTIL_ToString( errno ) );
+			return false;
+		}
+
+		for( uint32_t i = 0; i < NumRecords; ++i )
+		{
+			uint32_t ID;
+			ReplayArchiveEntry Entry;
+			memcpy( &ID, Data.data( ) + i * REPLAYARCHIVE_RECORDSIZE, 4 );
+			memcpy( &Entry.size, Data.data( ) + i * REPLAYARCHIVE_RECORDSIZE + 4, 4 );
+			memcpy( &Entry.offset, Data.data( ) + i * REPLAYARCHIVE_RECORDSIZE + 8, 8 );
+
+			if( Entry.offset < REPLAYARCHIVE_HEADERSIZE + REPLAYARCHIVE_ENTRYSIZE || Entry.offset + Entry.size > Size )
+				continue;
+
+			Records.push_back( make_pair( ID, Entry ) );
+		}
+	}
+
+	// the replays are stored back to back so every byte of the archive should be covered by an indexed replay
+	// the replays in a gap between indexed replays or after the last one are missing from the index, they're recovered from their entry headers
+
+	stable_sort( Records.begin( ), Records.end( ), EntryOffsetLess );
+	vector< pair<uint32_t, ReplayArchiveEntry> > Recovered;
+	uint64_t End = REPLAYARCHIVE_HEADERSIZE;
+
+	for( vector< pair<uint32_t, ReplayArchiveEntry> > :: iterator i = Records.begin( ); i != Records.end( ); ++i )
+	{
+		uint64_t Start = i->second.offset - REPLAYARCHIVE_ENTRYSIZE;
+
+		if( Start > End && Recover( End, Start, Recovered ) != Start )
+			CONSOLE_Print( "[ARCHIVE] [" + m_FileName + "] has unreadable data between replays, some replays may be missing" );
+
+		if( Start >= End )
+			End = i->second.offset + i->second.size;
+	}
+
+	m_Size = Recover( End, Size, Recovered );
+
+	for( vector< pair<uint32_t, ReplayArchiveEntry> > :: iterator i = Recovered.begin( ); i != Recovered.end( ); ++i )
+	{
+		if( !m_ReadOnly && !AddRecord( i->first, i->second ) )
+			return false;
+
+		Records.push_back( *i );
+	}
+
+	stable_sort( Records.begin( ), Records.end( ), EntryOffsetLess );
+
+	for( vector< pair<uint32_t, ReplayArchiveEntry> > :: iterator i = Records.begin( ); i != Records.end( ); ++i )
+		m_Entries[i->first] = i->second;
+
+	if( !Recovered.empty( ) )
+		CONSOLE_Print( "[ARCHIVE] recovered " + UTIL_ToString( (uint32_t)Recovered.size( ) ) + " replays missing from the index of [" + m_FileName + "]" );
+
+	// a read only archive may be being written by someone else so the end of it is left alone
+
+	if( m_Size < Size && !m_ReadOnly )
+	{
+		CONSOLE_Print( "[ARCHIVE] discarding " + UTIL_ToString( (uint32_t)( Size - m_Size ) ) + " bytes of partially written data at the end of [" + m_FileName + "]" );
+
+		if( ftruncate( m_FD, m_Size ) == -1 )
+			return false;
+	}
+
+	if( m_IndexSize < (uint64_t)IndexSize && !m_ReadOnly && ftruncate( m_IndexFD, m_IndexSize ) == -1 )
+		return false;
+
+	CONSOLE_Print( "[ARCHIVE] opened [" + m_FileName + "] with " + UTIL_ToString( (uint32_t)m_Entries.size( ) ) + " replays" );
+	return true;
+#endif
+}
+
+uint64_t CReplayArchive :: Recover( uint64_t start, uint64_t end, vector< pair<uint32_t, ReplayArchiveEntry> > &recovered )
+{
+	// walk the entry headers from start to end and add every complete replay to recovered
+	// returns the end of the last complete replay
+
+#ifdef WIN32
+	return start;
+#else
+	while( end - start >= REPLAYARCHIVE_ENTRYSIZE )
+	{
+		uint32_t Entry[4];
+
+		if( !ReadAll( m_FD, Entry, REPLAYARCHIVE_ENTRYSIZE, start ) || Entry[0] != REPLAYARCHIVE_ENTRYMAGIC || Entry[2] > end - start - REPLAYARCHIVE_ENTRYSIZE )
+			break;
+
+		string Data( Entry[2], 0 );
+
+		if( Entry[2] > 0 && ( !ReadAll( m_FD, &Data[0], Data.size( ), start + REPLAYARCHIVE_ENTRYSIZE ) || Entry[3] != m_CRC->FullCRC( (unsigned char *)&Data[0], Data.size( ) ) ) )
+			break;
+
+		recovered.push_back( make_pair( Entry[1], ReplayArchiveEntry( start + REPLAYARCHIVE_ENTRYSIZE, Entry[2] ) ) );
+		start += REPLAYARCHIVE_ENTRYSIZE + Entry[2];
+	}
+
+	return start;
+#endif
+}
+
+bool CReplayArchive :: AddRecord( uint32_t id, const ReplayArchiveEntry &entry )
+{
+#ifdef WIN32
+	return false;
+#else
+	unsigned char Record[REPLAYARCHIVE_RECORDSIZE];
+	memcpy( Record, &id, 4 );
+	memcpy( Record + 4, &entry.size, 4 );
+	memcpy( Record + 8, &entry.offset, 8 );
+
+	if( !WriteAll( m_IndexFD, Record, REPLAYARCHIVE_RECORDSIZE, m_IndexSize ) )
+		return false;
+
+	m_IndexSize += REPLAYARCHIVE_RECORDSIZE;
+	return true;
+#endif
+}
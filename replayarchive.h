@@ -0,0 +1,95 @@
+/*
+
+	ent-ghost
+	Copyright [2011-2013] [Jack Lu]
+
+	This file is part of the ent-ghost source code.
+
+	ent-ghost is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	ent-ghost source code is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with ent-ghost source code. If not, see <http://www.gnu.org/licenses/>.
+
+	ent-ghost is modified from GHost++ (http://ghostplusplus.googlecode.com/)
+	GHost++ is Copyright [2008] [Trevor Hogan]
+
+*/
+
+#ifndef REPLAYARCHIVE_H
+#define REPLAYARCHIVE_H
+
+#define REPLAYARCHIVE_MAGIC			0x41524847	// "GHRA"
+#define REPLAYARCHIVE_INDEXMAGIC	0x58524847	// "GHRX"
+#define REPLAYARCHIVE_ENTRYMAGIC	0x45524847	// "GHRE"
+#define REPLAYARCHIVE_VERSION		1
+#define REPLAYARCHIVE_HEADERSIZE	8			// magic and version at the start of the archive and the index
+#define REPLAYARCHIVE_ENTRYSIZE		16			// magic, game ID, size and CRC in front of each replay
+#define REPLAYARCHIVE_RECORDSIZE	16			// game ID, size and offset of each replay in the index
+
+class CCRC32;
+
+struct ReplayArchiveEntry {
+	uint64_t offset;						// position of the replay data in the archive
+	uint32_t size;
+
+	ReplayArchiveEntry( ) : offset( 0 ), size( 0 ) { }
+	ReplayArchiveEntry( uint64_t nOffset, uint32_t nSize ) : offset( nOffset ), size( nSize ) { }
+};
+
+//
+// CReplayArchive
+//
+
+// an append only file holding many replays so the replay path doesn't fill up with one small file per game
+// each replay is stored exactly as it would be saved to a .w3g file behind a small entry header with the game's database ID and a CRC of the data
+// the index is a second file (the archive's name plus ".idx") with one fixed size record per replay, it's read into memory when the archive is opened
+// so getting a replay back is a single read at a known offset
+// the replay is always written before its index record, if the bot dies in between (or the record can't be written) the missing records are recovered from the entry headers on the next start
+// a partially written replay at the end of the archive is cut off
+// adding a replay with the same game ID again replaces it in the index, the old data stays in the archive
+// the archive is safe to use from every game thread at once (replays are saved by the game that recorded them)
+// only one process can open an archive for writing at a time (it's locked with flock), an archive opened read only is never modified so it can be read while the bot is writing to it
+// it isn't available on Windows
+
+class CReplayArchive
+{
+private:
+	string m_FileName;
+	bool m_ReadOnly;
+	int m_FD;
+	int m_IndexFD;
+	uint64_t m_Size;						// bytes in the archive (up to the end of the last complete replay)
+	uint64_t m_IndexSize;
+	map<uint32_t, ReplayArchiveEntry> m_Entries;	// game ID -> entry
+	CCRC32 *m_CRC;
+	boost::mutex m_Mutex;					// protects everything above except m_CRC which is only read
+	bool m_Valid;
+
+public:
+	CReplayArchive( string nFileName, bool nReadOnly = false );
+	~CReplayArchive( );
+
+	bool GetValid( )						{ return m_Valid; }
+	string GetFileName( )					{ return m_FileName; }
+	uint32_t GetNumEntries( );
+
+	bool Add( uint32_t id, const unsigned char *data, uint32_t size );
+	bool AddFile( uint32_t id, string fileName );
+	bool Get( uint32_t id, string &data );
+	void GetEntries( map<uint32_t, ReplayArchiveEntry> &entries );
+
+private:
+	bool Open( );
+	uint64_t Recover( uint64_t start, uint64_t end, vector< pair<uint32_t, ReplayArchiveEntry> > &recovered );
+	bool AddRecord( uint32_t id, const ReplayArchiveEntry &entry );
+};
+
+#endif
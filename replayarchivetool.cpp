@@ -0,0 +1,172 @@
+/*
+
+	ent-ghost
+	Copyright [2011-2013] [Jack Lu]
+
+	This file is part of the ent-ghost source code.
+
+	ent-ghost is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	ent-ghost source code is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with ent-ghost source code. If not, see <http://www.gnu.org/licenses/>.
+
+	ent-ghost is modified from GHost++ (http://ghostplusplus.googlecode.com/)
+	GHost++ is Copyright [2008] [Trevor Hogan]
+
+*/
+
+#include "ghost.h"
+#include "util.h"
+#include "replayarchive.h"
+
+#include <algorithm>
+
+#include <boost/filesystem.hpp>
+
+using namespace boost :: filesystem;
+
+// replayarchive is a separate program that moves replays in and out of a replay archive (see CReplayArchive)
+// a replay's game ID is its file name, so "1234.w3g" is imported as game 1234 and exported back to "1234.w3g"
+
+boost::mutex PrintMutex;
+
+void CONSOLE_Print( string message )
+{
+	boost::mutex::scoped_lock printLock( PrintMutex );
+	cout << message << endl;
+}
+
+bool Import( CReplayArchive &archive, path file, bool removeFiles, uint32_t &numImported )
+{
+	string Stem = file.stem( ).string( );
+
+	if( Stem.empty( ) || Stem.find_first_not_of( "0123456789" ) != string :: npos )
+	{
+		CONSOLE_Print( "[ARCHIVE] skipping [" + file.string( ) + "], it isn't named after a game ID" );
+		return true;
+	}
+
+	if( !archive.AddFile( UTIL_ToUInt32( Stem ), file.string( ) ) )
+	{
+		CONSOLE_Print( "[ARCHIVE] error importing [" + file.string( ) + "]" );
+		return false;
+	}
+
+	++numImported;
+
+	if( removeFiles )
+	{
+		boost::system::error_code Error;
+		remove( file, Error );
+	}
+
+	return true;
+}
+
+int main( int argc, char **argv )
+{
+	vector<string> Args;
+	bool RemoveFiles = false;
+
+	for( int i = 1; i < argc; ++i )
+	{
+		if( string( argv[i] ) == "-r" )
+			RemoveFiles = true;
+		else
+			Args.push_back( argv[i] );
+	}
+
+	if( Args.size( ) < 2 )
+	{
+		cout << "usage: replayarchive list <archive>" << endl;
+		cout << "       replayarchive import [-r] <archive> <replay file or directory> ... (-r removes the imported files)" << endl;
+		cout << "       replayarchive export <archive> <game ID> [replay file]" << endl;
+		return 1;
+	}
+
+	string Command = Args[0];
+	// only import writes to the archive, listing and exporting also work while the bot has it open
+
+	CReplayArchive Archive( Args[1], Command != "import" );
+
+	if( !Archive.GetValid( ) )
+		return 1;
+
+	if( Command == "list" )
+	{
+		map<uint32_t, ReplayArchiveEntry> Entries;
+		Archive.GetEntries( Entries );
+
+		for( map<uint32_t, ReplayArchiveEntry> :: iterator i = Entries.begin( ); i != Entries.end( ); ++i )
+			cout << i->first << " " << i->second.size << " bytes at " << i->second.offset << endl;
+	}
+	else if( Command == "import" && Args.size( ) >= 3 )
+	{
+		uint32_t NumImported = 0;
+
+		for( vector<string> :: iterator i = Args.begin( ) + 2; i != Args.end( ); ++i )
+		{
+			boost::system::error_code Error;
+
+			if( is_directory( *i, Error ) )
+			{
+				// import in file name order so the archive is in a predictable order
+
+				vector<path> Files;
+				directory_iterator EndIterator;
+
+				for( directory_iterator j( *i, Error ); !Error && j != EndIterator; j.increment( Error ) )
+				{
+					string Extension = j->path( ).extension( ).string( );
+					transform( Extension.begin( ), Extension.end( ), Extension.begin( ), (int(*)(int))tolower );
+
+					if( is_regular_file( j->status( ) ) && Extension == ".w3g" )
+						Files.push_back( j->path( ) );
+				}
+
+				sort( Files.begin( ), Files.end( ) );
+
+				for( vector<path> :: iterator j = Files.begin( ); j != Files.end( ); ++j )
+				{
+					if( !Import( Archive, *j, RemoveFiles, NumImported ) )
+						return 1;
+				}
+			}
+			else if( !Import( Archive, *i, RemoveFiles, NumImported ) )
+				return 1;
+		}
+
+		CONSOLE_Print( "[ARCHIVE] imported " + UTIL_ToString( NumImported ) + " replays, the archive has " + UTIL_ToString( Archive.GetNumEntries( ) ) + " replays" );
+	}
+	else if( Command == "export" && Args.size( ) >= 3 )
+	{
+		string Data;
+		string FileName = Args.size( ) >= 4 ? Args[3] : Args[2] + ".w3g";
+
+		if( !Archive.Get( UTIL_ToUInt32( Args[2] ), Data ) )
+		{
+			CONSOLE_Print( "[ARCHIVE] game " + Args[2] + " isn't in the archive" );
+			return 1;
+		}
+
+		if( !UTIL_FileWrite( FileName, (unsigned char *)Data.data( ), Data.size( ) ) )
+			return 1;
+
+		CONSOLE_Print( "[ARCHIVE] exported game " + Args[2] + " to [" + FileName + "]" );
+	}
+	else
+	{
+		cout << "unknown command or missing argument [" << Command << "]" << endl;
+		return 1;
+	}
+
+	return 0;
+}
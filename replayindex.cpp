@@ -0,0 +1,971 @@
+/*
+
+	ent-ghost
+	Copyright [2011-2013] [Jack Lu]
+
+	This file is part of the ent-ghost source code.
+
+	ent-ghost is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	ent-ghost source code is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with ent-ghost source code. If not, see <http://www.gnu.org/licenses/>.
+
+	ent-ghost is modified from GHost++ (http://ghostplusplus.googlecode.com/)
+	GHost++ is Copyright [2008] [Trevor Hogan]
+
+*/
+
+#include "ghost.h"
+#include "util.h"
+#include "mappedfile.h"
+#include "packed.h"
+#include "replay.h"
+#include "replayindex.h"
+
+#include <algorithm>
+#include <stdio.h>
+#include <time.h>
+
+#ifndef WIN32
+ #include <sys/time.h>
+#endif
+
+#ifdef __APPLE__
+ #include <mach/mach_time.h>
+#endif
+
+#include <boost/filesystem.hpp>
+
+using namespace boost :: filesystem;
+
+bool gVerbose = false;
+boost::mutex PrintMutex;
+
+uint32_t GetTime( )
+{
+	return GetTicks( ) / 1000;
+}
+
+uint32_t GetTicks( )
+{
+#ifdef WIN32
+	return timeGetTime( );
+#elif __APPLE__
+	uint64_t current = mach_absolute_time( );
+	static mach_timebase_info_data_t info = { 0, 0 };
+
+	if( info.denom == 0 )
+		mach_timebase_info( &info );
+
+	uint64_t elapsednano = current * ( info.numer / info.denom );
+	return elapsednano / 1e6;
+#else
+	uint32_t ticks;
+	struct timespec t;
+	clock_gettime( CLOCK_MONOTONIC, &t );
+	ticks = t.tv_sec * 1000;
+	ticks += t.tv_nsec / 1000000;
+	return ticks;
+#endif
+}
+
+void CONSOLE_Print( string message )
+{
+	// CPacked and CReplay print several lines for every replay they load so only show them when asked to
+
+	if( !gVerbose && message.compare( 0, 14, "[REPLAYINDEX] " ) != 0 )
+		return;
+
+	boost::mutex::scoped_lock printLock( PrintMutex );
+	cout << message << endl;
+}
+
+string ToLower( string s )
+{
+	transform( s.begin( ), s.end( ), s.begin( ), (int(*)(int))tolower );
+	return s;
+}
+
+//
+// the queries
+//
+
+void MatchStrings( ReplayIndexSegment *segment, string text, bool exact, vector<bool> &matches )
+{
+	// find every string in the segment that's equal to (or contains) text ignoring case
+	// the tables refer to strings by ID so each query only compares every string once per segment
+
+	matches.assign( segment->numStrings, false );
+
+	for( uint32_t i = 0; i < segment->numStrings; ++i )
+	{
+		string String = ToLower( CReplayIndex :: GetString( segment, i ) );
+		matches[i] = exact ? String == text : String.find( text ) != string :: npos;
+	}
+}
+
+string GameString( ReplayIndexSegment *segment, uint32_t game )
+{
+	uint32_t ID = CReplayIndex :: Get( segment->gameID, game );
+	return ( ID != 0 ? "#" + UTIL_ToString( ID ) : CReplayIndex :: GetString( segment, CReplayIndex :: Get( segment->gameFile, game ) ) ) + " [" + CReplayIndex :: GetString( segment, CReplayIndex :: Get( segment->gameName, game ) ) + "]";
+}
+
+void QuerySummary( CReplayIndex &index )
+{
+	uint32_t NumGames = 0;
+	uint32_t NumPlayers = 0;
+	uint32_t NumChat = 0;
+	uint32_t NumMarkers = 0;
+	uint64_t Duration = 0;
+
+	for( uint32_t i = 0; i < index.GetNumSegments( ); ++i )
+	{
+		ReplayIndexSegment *Segment = index.GetSegment( i );
+		NumGames += Segment->numGames;
+		NumPlayers += Segment->numPlayers;
+		NumChat += Segment->numChat;
+		NumMarkers += Segment->numMarkers;
+
+		for( uint32_t j = 0; j < Segment->numGames; ++j )
+			Duration += CReplayIndex :: Get( Segment->gameDuration, j );
+	}
+
+	cout << NumGames << " games (" << Duration / 3600000 << " hours), " << NumPlayers << " players, " << NumChat << " chat messages, " << NumMarkers << " markers in " << index.GetNumSegments( ) << " segments" << endl;
+}
+
+void QueryGames( CReplayIndex &index, string name )
+{
+	// every game the player was in and when they left
+
+	name = ToLower( name );
+	vector<bool> Matches;
+
+	for( uint32_t i = 0; i < index.GetNumSegments( ); ++i )
+	{
+		ReplayIndexSegment *Segment = index.GetSegment( i );
+		MatchStrings( Segment, name, true, Matches );
+
+		for( uint32_t j = 0; j < Segment->numPlayers; ++j )
+		{
+			if( !Matches[CReplayIndex :: Get( Segment->playerName, j )] )
+				continue;
+
+			uint32_t Game = CReplayIndex :: Get( Segment->playerGame, j );
+			uint32_t Duration = CReplayIndex :: Get( Segment->gameDuration, Game );
+			uint32_t Left = CReplayIndex :: Get( Segment->playerLeft, j );
+			string LeftString = Left == REPLAYINDEX_NOTLEFT ? "stayed" : "left at " + UTIL_MSToString( Left ) + " (" + UTIL_MSToString( Left < Duration ? Duration - Left : 0 ) + " before the end)";
+			cout << GameString( Segment, Game ) << " " << UTIL_MSToString( Duration ) << ", " << LeftString << endl;
+		}
+	}
+}
+
+void QueryLeavers( CReplayIndex &index, uint32_t minutes )
+{
+	// the players who most often left at least minutes before the end of the game
+
+	map<string, pair<uint32_t, uint32_t> > Players;		// lower case name -> ( games left early, games played )
+
+	for( uint32_t i = 0; i < index.GetNumSegments( ); ++i )
+	{
+		ReplayIndexSegment *Segment = index.GetSegment( i );
+		vector<uint32_t> Early( Segment->numStrings, 0 );
+		vector<uint32_t> Played( Segment->numStrings, 0 );
+
+		for( uint32_t j = 0; j < Segment->numPlayers; ++j )
+		{
+			uint32_t Name = CReplayIndex :: Get( Segment->playerName, j );
+			uint32_t Left = CReplayIndex :: Get( Segment->playerLeft, j );
+			uint32_t Duration = CReplayIndex :: Get( Segment->gameDuration, CReplayIndex :: Get( Segment->playerGame, j ) );
+			++Played[Name];
+
+			if( Left != REPLAYINDEX_NOTLEFT && (uint64_t)Left + minutes * 60000 <= Duration )
+				++Early[Name];
+		}
+
+		for( uint32_t j = 0; j < Segment->numStrings; ++j )
+		{
+			if( Played[j] > 0 )
+			{
+				pair<uint32_t, uint32_t> &Player = Players[ToLower( CReplayIndex :: GetString( Segment, j ) )];
+				Player.first += Early[j];
+				Player.second += Played[j];
+			}
+		}
+	}
+
+	vector<pair<uint32_t, string> > Leavers;
+
+	for( map<string, pair<uint32_t, uint32_t> > :: iterator i = Players.begin( ); i != Players.end( ); ++i )
+	{
+		if( i->second.first > 0 )
+			Leavers.push_back( make_pair( i->second.first, i->first ) );
+	}
+
+	sort( Leavers.begin( ), Leavers.end( ) );
+	reverse( Leavers.begin( ), Leavers.end( ) );
+
+	for( uint32_t i = 0; i < Leavers.size( ) && i < 50; ++i )
+		cout << Leavers[i].second << " left " << Leavers[i].first << " of " << Players[Leavers[i].second].second << " games at least " << minutes << " minutes early" << endl;
+}
+
+void QueryChat( CReplayIndex &index, string text )
+{
+	text = ToLower( text );
+	vector<bool> Matches;
+
+	for( uint32_t i = 0; i < index.GetNumSegments( ); ++i )
+	{
+		ReplayIndexSegment *Segment = index.GetSegment( i );
+		MatchStrings( Segment, text, false, Matches );
+
+		for( uint32_t j = 0; j < Segment->numChat; ++j )
+		{
+			uint32_t Message = CReplayIndex :: Get( Segment->chatMessage, j );
+
+			if( !Matches[Message] )
+				continue;
+
+			uint32_t Game = CReplayIndex :: Get( Segment->chatGame, j );
+			cout << GameString( Segment, Game ) << " " << UTIL_MSToString( CReplayIndex :: Get( Segment->chatTime, j ) ) << " " << CReplayIndex :: GetPlayerName( Segment, Game, CReplayIndex :: GetByte( Segment->chatPID, j ) ) << ": " << CReplayIndex :: GetString( Segment, Message ) << endl;
+		}
+	}
+}
+
+void QueryMarkers( CReplayIndex &index, string text )
+{
+	text = ToLower( text );
+	vector<bool> Matches;
+
+	for( uint32_t i = 0; i < index.GetNumSegments( ); ++i )
+	{
+		ReplayIndexSegment *Segment = index.GetSegment( i );
+		MatchStrings( Segment, text, false, Matches );
+
+		for( uint32_t j = 0; j < Segment->numMarkers; ++j )
+		{
+			uint32_t Key = CReplayIndex :: Get( Segment->markerKey, j );
+
+			if( !Matches[Key] )
+				continue;
+
+			uint32_t Game = CReplayIndex :: Get( Segment->markerGame, j );
+			string Type = CReplayIndex :: GetByte( Segment->markerType, j ) == REPLAYINDEX_MARKER_DOTA ? "dota" : "w3mmd";
+			cout << GameString( Segment, Game ) << " " << UTIL_MSToString( CReplayIndex :: Get( Segment->markerTime, j ) ) << " " << CReplayIndex :: GetPlayerName( Segment, Game, CReplayIndex :: GetByte( Segment->markerPID, j ) ) << " " << Type << " [" << CReplayIndex :: GetString( Segment, Key ) << "] = " << CReplayIndex :: Get( Segment->markerValue, j ) << endl;
+		}
+	}
+}
+
+//
+// main
+//
+
+int main( int argc, char **argv )
+{
+	vector<string> Args;
+
+	for( int i = 1; i < argc; ++i )
+	{
+		if( string( argv[i] ) == "-v" )
+			gVerbose = true;
+		else
+			Args.push_back( argv[i] );
+	}
+
+	if( Args.size( ) < 2 )
+	{
+		cout << "usage: replayindex [-v] build <replay path> <index file> [threads]" << endl;
+		cout << "       replayindex summary <index file>" << endl;
+		cout << "       replayindex games <index file> <player name>" << endl;
+		cout << "       replayindex leavers <index file> [minutes before the end, default 5]" << endl;
+		cout << "       replayindex chat <index file> <text>" << endl;
+		cout << "       replayindex markers <index file> <text>" << endl;
+		return 1;
+	}
+
+	string Command = Args[0];
+
+	if( Command == "build" )
+	{
+		if( Args.size( ) < 3 )
+		{
+			cout << "usage: replayindex build <replay path> <index file> [threads]" << endl;
+			return 1;
+		}
+
+		uint32_t NumThreads = Args.size( ) >= 4 ? UTIL_ToUInt32( Args[3] ) : boost::thread::hardware_concurrency( );
+		CReplayIndexBuilder Builder( UTIL_AddPathSeperator( Args[1] ), Args[2], NumThreads );
+		return Builder.Build( ) ? 0 : 1;
+	}
+
+	CReplayIndex Index;
+
+	if( !Index.Open( Args[1] ) )
+		return 1;
+
+	uint32_t StartTicks = GetTicks( );
+
+	if( Command == "summary" )
+		QuerySummary( Index );
+	else if( Command == "games" && Args.size( ) >= 3 )
+		QueryGames( Index, Args[2] );
+	else if( Command == "leavers" )
+		QueryLeavers( Index, Args.size( ) >= 3 ? UTIL_ToUInt32( Args[2] ) : 5 );
+	else if( Command == "chat" && Args.size( ) >= 3 )
+		QueryChat( Index, Args[2] );
+	else if( Command == "markers" && Args.size( ) >= 3 )
+		QueryMarkers( Index, Args[2] );
+	else
+	{
+		cout << "unknown command or missing argument [" << Command << "]" << endl;
+		return 1;
+	}
+
+	if( gVerbose )
+		cout << "query took " << GetTicks( ) - StartTicks << "ms" << endl;
+
+	return 0;
+}
+
+//
+// CReplayIndexBuilder
+//
+
+void AppendUInt32( string &column, uint32_t i )
+{
+	column.append( (const char *)&i, 4 );
+}
+
+void AppendColumn( string &segment, const string &column )
+{
+	// every column starts on a four byte boundary
+
+	segment += column;
+
+	if( segment.size( ) % 4 != 0 )
+		segment.append( 4 - segment.size( ) % 4, 0 );
+}
+
+uint32_t AddString( map<string, uint32_t> &ids, string &offsets, string &data, const string &s )
+{
+	map<string, uint32_t> :: iterator i = ids.find( s );
+
+	if( i != ids.end( ) )
+		return i->second;
+
+	uint32_t ID = ids.size( );
+	ids[s] = ID;
+	data += s;
+	AppendUInt32( offsets, data.size( ) );
+	return ID;
+}
+
+void FindMarkers( const unsigned char *data, uint32_t size, uint32_t time, unsigned char pid, vector<ReplayIndexMarker> &markers )
+{
+	// the length of each action isn't stored so search the action data for the W3MMD and DotA signatures the same way CStatsW3MMD and CStatsDOTA do
+	// both are followed by two null terminated strings and a four byte value
+
+	for( uint32_t i = 0; i + 6 <= size; ++i )
+	{
+		if( data[i] != 0x6b )
+			continue;
+
+		unsigned char Type;
+		uint32_t Position;
+
+		if( size - i >= 9 && memcmp( data + i + 1, "MMD.Dat", 8 ) == 0 )
+		{
+			Type = REPLAYINDEX_MARKER_W3MMD;
+			Position = i + 9;
+		}
+		else if( memcmp( data + i + 1, "dr.x", 5 ) == 0 )
+		{
+			Type = REPLAYINDEX_MARKER_DOTA;
+			Position = i + 6;
+		}
+		else
+			continue;
+
+		const unsigned char *MissionKeyEnd = (const unsigned char *)memchr( data + Position, 0, size - Position );
+
+		if( !MissionKeyEnd )
+			continue;
+
+		uint32_t KeyPosition = MissionKeyEnd - data + 1;
+		const unsigned char *KeyEnd = KeyPosition < size ? (const unsigned char *)memchr( data + KeyPosition, 0, size - KeyPosition ) : NULL;
+
+		if( !KeyEnd || size - ( KeyEnd - data + 1 ) < 4 )
+			continue;
+
+		uint32_t Value;
+		memcpy( &Value, KeyEnd + 1, 4 );
+		string Key = string( (const char *)data + Position, MissionKeyEnd - data - Position ) + " " + string( (const char *)data + KeyPosition, KeyEnd - data - KeyPosition );
+		markers.push_back( ReplayIndexMarker( time, pid, Type, Key, Value ) );
+		i = KeyEnd - data + 4;
+	}
+}
+
+CReplayIndexBuilder :: CReplayIndexBuilder( string nPath, string nFileName, uint32_t nNumThreads ) : m_Path( nPath ), m_FileName( nFileName ), m_NumThreads( nNumThreads ), m_NextFile( 0 )
+{
+	if( m_NumThreads == 0 )
+		m_NumThreads = 1;
+}
+
+CReplayIndexBuilder :: ~CReplayIndexBuilder( )
+{
+
+}
+
+bool CReplayIndexBuilder :: Build( )
+{
+	// the replays are indexed in file name order one segment at a time
+	// the replays of a segment are summarized on m_NumThreads threads, then the segment is written and the summaries are freed
+
+	vector<string> Files;
+	boost::system::error_code Error;
+	directory_iterator EndIterator;
+
+	for( directory_iterator i( m_Path, Error ); !Error && i != EndIterator; i.increment( Error ) )
+	{
+		if( is_regular_file( i->status( ) ) && ToLower( i->path( ).extension( ).string( ) ) == ".w3g" )
+			Files.push_back( i->path( ).filename( ).string( ) );
+	}
+
+	if( Error )
+	{
+		CONSOLE_Print( "[REPLAYINDEX] error reading replay path [" + m_Path + "] - " + Error.message( ) );
+		return false;
+	}
+
+	sort( Files.begin( ), Files.end( ) );
+	CONSOLE_Print( "[REPLAYINDEX] indexing " + UTIL_ToString( Files.size( ) ) + " replays in [" + m_Path + "] on " + UTIL_ToString( m_NumThreads ) + " threads" );
+
+	string TempFileName = m_FileName + ".tmp";
+	FILE *File = fopen( TempFileName.c_str( ), "wb" );
+
+	if( !File )
+	{
+		CONSOLE_Print( "[REPLAYINDEX] error opening file [" + TempFileName + "] for writing" );
+		return false;
+	}
+
+	string Header;
+	AppendUInt32( Header, REPLAYINDEX_MAGIC );
+	AppendUInt32( Header, REPLAYINDEX_VERSION );
+	bool Success = fwrite( Header.data( ), 1, Header.size( ), File ) == Header.size( );
+	uint32_t StartTicks = GetTicks( );
+	uint32_t NumInvalid = 0;
+
+	for( uint32_t i = 0; Success && i < Files.size( ); i += REPLAYINDEX_SEGMENTREPLAYS )
+	{
+		m_Files.assign( Files.begin( ) + i, Files.begin( ) + min( (uint32_t)Files.size( ), i + REPLAYINDEX_SEGMENTREPLAYS ) );
+		m_Summaries.assign( m_Files.size( ), ReplaySummary( ) );
+		m_NextFile = 0;
+
+		vector<boost::thread *> Threads;
+
+		for( uint32_t j = 1; j < m_NumThreads && j < m_Files.size( ); ++j )
+			Threads.push_back( new boost::thread( &CReplayIndexBuilder :: loop, this ) );
+
+		loop( );
+
+		for( vector<boost::thread *> :: iterator j = Threads.begin( ); j != Threads.end( ); ++j )
+		{
+			(*j)->join( );
+			delete *j;
+		}
+
+		for( vector<ReplaySummary> :: iterator j = m_Summaries.begin( ); j != m_Summaries.end( ); ++j )
+		{
+			if( !j->valid )
+			{
+				CONSOLE_Print( "[REPLAYINDEX] skipping invalid replay [" + j->fileName + "]" );
+				++NumInvalid;
+			}
+		}
+
+		string Segment = BuildSegment( );
+		string Size;
+		AppendUInt32( Size, Segment.size( ) );
+		Success = fwrite( Size.data( ), 1, Size.size( ), File ) == Size.size( ) && fwrite( Segment.data( ), 1, Segment.size( ), File ) == Segment.size( );
+		CONSOLE_Print( "[REPLAYINDEX] indexed " + UTIL_ToString( i + m_Files.size( ) ) + "/" + UTIL_ToString( Files.size( ) ) + " replays" );
+	}
+
+	m_Files.clear( );
+	m_Summaries.clear( );
+
+	if( fclose( File ) != 0 )
+		Success = false;
+
+	if( Success )
+	{
+		rename( TempFileName, m_FileName, Error );
+		Success = !Error;
+	}
+
+	if( !Success )
+	{
+		CONSOLE_Print( "[REPLAYINDEX] error writing index file [" + m_FileName + "]" );
+		remove( TempFileName.c_str( ) );
+		return false;
+	}
+
+	CONSOLE_Print( "[REPLAYINDEX] indexed " + UTIL_ToString( Files.size( ) - NumInvalid ) + " replays (" + UTIL_ToString( NumInvalid ) + " invalid) in " + UTIL_ToString( GetTicks( ) - StartTicks ) + "ms" );
+	return true;
+}
+
+void CReplayIndexBuilder :: Summarize( string fileName, ReplaySummary &summary )
+{
+	CReplay Replay;
+	Replay.Load( fileName, true );
+
+	if( !Replay.GetValid( ) )
+		return;
+
+	Replay.ParseReplay( true );
+
+	if( !Replay.GetValid( ) )
+		return;
+
+	summary.gameName = Replay.GetGameName( );
+	summary.duration = Replay.GetReplayLength( );
+
+	vector<PIDPlayer> Players = Replay.GetPlayers( );
+	vector<CGameSlot> Slots = Replay.GetSlots( );
+	map<unsigned char, uint32_t> PIDToPlayer;
+
+	for( vector<PIDPlayer> :: iterator i = Players.begin( ); i != Players.end( ); ++i )
+	{
+		unsigned char Team = 0;
+		unsigned char Colour = 0;
+
+		for( vector<CGameSlot> :: iterator j = Slots.begin( ); j != Slots.end( ); ++j )
+		{
+			if( j->GetPID( ) == i->first )
+			{
+				Team = j->GetTeam( );
+				Colour = j->GetColour( );
+				break;
+			}
+		}
+
+		PIDToPlayer[i->first] = summary.players.size( );
+		summary.players.push_back( ReplayIndexPlayer( i->first, i->second, Team, Colour ) );
+	}
+
+	// players that left during loading left at zero
+
+	queue<BYTEARRAY> *LoadingBlocks = Replay.GetLoadingBlocks( );
+
+	while( !LoadingBlocks->empty( ) )
+	{
+		BYTEARRAY &Block = LoadingBlocks->front( );
+
+		if( Block.size( ) >= 10 && PIDToPlayer.find( Block[5] ) != PIDToPlayer.end( ) )
+		{
+			ReplayIndexPlayer &Player = summary.players[PIDToPlayer[Block[5]]];
+			Player.left = 0;
+			Player.leftResult = UTIL_ByteArrayToUInt32( Block, false, 6 );
+		}
+
+		LoadingBlocks->pop( );
+	}
+
+	// the blocks are in the order they happened so the game time is the sum of the time slots so far
+
+	queue<BYTEARRAY> *Blocks = Replay.GetBlocks( );
+	uint32_t Time = 0;
+
+	while( !Blocks->empty( ) )
+	{
+		BYTEARRAY &Block = Blocks->front( );
+
+		if( Block.empty( ) )
+		{
+			Blocks->pop( );
+			continue;
+		}
+
+		if( Block[0] == CReplay :: REPLAY_LEAVEGAME && Block.size( ) >= 10 )
+		{
+			if( PIDToPlayer.find( Block[5] ) != PIDToPlayer.end( ) )
+			{
+				ReplayIndexPlayer &Player = summary.players[PIDToPlayer[Block[5]]];
+				Player.left = Time;
+				Player.leftResult = UTIL_ByteArrayToUInt32( Block, false, 6 );
+			}
+		}
+		else if( ( Block[0] == CReplay :: REPLAY_TIMESLOT || Block[0] == CReplay :: REPLAY_TIMESLOT2 ) && Block.size( ) >= 5 )
+		{
+			// block ID, block size, send interval, then the actions of each player (PID, action size, actions)
+
+			if( Block[0] == CReplay :: REPLAY_TIMESLOT )
+				Time += Block[3] | ( Block[4] << 8 );
+
+			uint32_t Position = 5;
+
+			while( Block.size( ) - Position >= 3 )
+			{
+				unsigned char PID = Block[Position];
+				uint32_t ActionsSize = Block[Position + 1] | ( Block[Position + 2] << 8 );
+				Position += 3;
+
+				if( Block.size( ) - Position < ActionsSize )
+					break;
+
+				FindMarkers( &Block[Position], ActionsSize, Time, PID, summary.markers );
+				Position += ActionsSize;
+			}
+		}
+		else if( Block[0] == CReplay :: REPLAY_CHATMESSAGE && Block.size( ) >= 6 )
+		{
+			// block ID, PID, block size, flags, chat mode (only if flags is 0x20), message
+
+			uint32_t MessageStart = Block[4] == 0x20 ? 9 : 5;
+
+			if( Block.size( ) > MessageStart )
+			{
+				BYTEARRAY Message = UTIL_ExtractCString( Block, MessageStart );
+				summary.chat.push_back( ReplayIndexChat( Time, Block[1], string( Message.begin( ), Message.end( ) ) ) );
+			}
+		}
+
+		Blocks->pop( );
+	}
+
+	summary.valid = true;
+}
+
+void CReplayIndexBuilder :: loop( )
+{
+	while( true )
+	{
+		boost::mutex::scoped_lock lock( m_NextFileMutex );
+
+		if( m_NextFile >= m_Files.size( ) )
+			break;
+
+		uint32_t File = m_NextFile++;
+		lock.unlock( );
+
+		ReplaySummary &Summary = m_Summaries[File];
+		Summary.fileName = m_Files[File];
+		string Stem = path( m_Files[File] ).stem( ).string( );
+
+		if( !Stem.empty( ) && Stem.find_first_not_of( "0123456789" ) == string :: npos )
+			Summary.id = UTIL_ToUInt32( Stem );
+
+		Summarize( m_Path + m_Files[File], Summary );
+	}
+}
+
+string CReplayIndexBuilder :: BuildSegment( )
+{
+	map<string, uint32_t> StringIDs;
+	string StringOffsets;
+	string StringData;
+	AppendUInt32( StringOffsets, 0 );
+
+	string GameID, GameFile, GameName, GameDuration, GameFirstPlayer;
+	string PlayerGame, PlayerName, PlayerLeft, PlayerLeftResult, PlayerPID, PlayerTeam, PlayerColour;
+	string ChatGame, ChatTime, ChatMessage, ChatPID;
+	string MarkerGame, MarkerTime, MarkerKey, MarkerValue, MarkerPID, MarkerType;
+	uint32_t NumGames = 0;
+	uint32_t NumPlayers = 0;
+
+	for( vector<ReplaySummary> :: iterator i = m_Summaries.begin( ); i != m_Summaries.end( ); ++i )
+	{
+		if( !i->valid )
+			continue;
+
+		AppendUInt32( GameID, i->id );
+		AppendUInt32( GameFile, AddString( StringIDs, StringOffsets, StringData, i->fileName ) );
+		AppendUInt32( GameName, AddString( StringIDs, StringOffsets, StringData, i->gameName ) );
+		AppendUInt32( GameDuration, i->duration );
+		AppendUInt32( GameFirstPlayer, NumPlayers );
+
+		for( vector<ReplayIndexPlayer> :: iterator j = i->players.begin( ); j != i->players.end( ); ++j )
+		{
+			AppendUInt32( PlayerGame, NumGames );
+			AppendUInt32( PlayerName, AddString( StringIDs, StringOffsets, StringData, j->name ) );
+			AppendUInt32( PlayerLeft, j->left );
+			AppendUInt32( PlayerLeftResult, j->leftResult );
+			PlayerPID.push_back( j->pid );
+			PlayerTeam.push_back( j->team );
+			PlayerColour.push_back( j->colour );
+			++NumPlayers;
+		}
+
+		for( vector<ReplayIndexChat> :: iterator j = i->chat.begin( ); j != i->chat.end( ); ++j )
+		{
+			AppendUInt32( ChatGame, NumGames );
+			AppendUInt32( ChatTime, j->time );
+			AppendUInt32( ChatMessage, AddString( StringIDs, StringOffsets, StringData, j->message ) );
+			ChatPID.push_back( j->pid );
+		}
+
+		for( vector<ReplayIndexMarker> :: iterator j = i->markers.begin( ); j != i->markers.end( ); ++j )
+		{
+			AppendUInt32( MarkerGame, NumGames );
+			AppendUInt32( MarkerTime, j->time );
+			AppendUInt32( MarkerKey, AddString( StringIDs, StringOffsets, StringData, j->key ) );
+			AppendUInt32( MarkerValue, j->value );
+			MarkerPID.push_back( j->pid );
+			MarkerType.push_back( j->type );
+		}
+
+		++NumGames;
+	}
+
+	// each table is its row count followed by its columns
+
+	string Segment;
+	AppendUInt32( Segment, StringIDs.size( ) );
+	AppendColumn( Segment, StringOffsets );
+	AppendColumn( Segment, StringData );
+
+	AppendUInt32( Segment, NumGames );
+	AppendColumn( Segment, GameID );
+	AppendColumn( Segment, GameFile );
+	AppendColumn( Segment, GameName );
+	AppendColumn( Segment, GameDuration );
+	AppendColumn( Segment, GameFirstPlayer );
+
+	AppendUInt32( Segment, NumPlayers );
+	AppendColumn( Segment, PlayerGame );
+	AppendColumn( Segment, PlayerName );
+	AppendColumn( Segment, PlayerLeft );
+	AppendColumn( Segment, PlayerLeftResult );
+	AppendColumn( Segment, PlayerPID );
+	AppendColumn( Segment, PlayerTeam );
+	AppendColumn( Segment, PlayerColour );
+
+	AppendUInt32( Segment, ChatPID.size( ) );
+	AppendColumn( Segment, ChatGame );
+	AppendColumn( Segment, ChatTime );
+	AppendColumn( Segment, ChatMessage );
+	AppendColumn( Segment, ChatPID );
+
+	AppendUInt32( Segment, MarkerPID.size( ) );
+	AppendColumn( Segment, MarkerGame );
+	AppendColumn( Segment, MarkerTime );
+	AppendColumn( Segment, MarkerKey );
+	AppendColumn( Segment, MarkerValue );
+	AppendColumn( Segment, MarkerPID );
+	AppendColumn( Segment, MarkerType );
+	return Segment;
+}
+
+//
+// CReplayIndex
+//
+
+// reads the tables of a segment in the order CReplayIndexBuilder :: BuildSegment wrote them
+
+class CSegmentReader
+{
+private:
+	const unsigned char *m_Data;
+	uint32_t m_Size;
+	uint32_t m_Position;
+	bool m_Valid;
+
+public:
+	CSegmentReader( const unsigned char *nData, uint32_t nSize ) : m_Data( nData ), m_Size( nSize ), m_Position( 0 ), m_Valid( true ) { }
+
+	bool GetValid( )			{ return m_Valid; }
+
+	uint32_t ReadUInt32( )
+	{
+		const unsigned char *Data = ReadColumn( 4 );
+		return Data ? CReplayIndex :: Get( Data, 0 ) : 0;
+	}
+
+	const unsigned char *ReadColumn( uint64_t size )
+	{
+		uint64_t Padded = ( size + 3 ) & ~(uint64_t)3;
+
+		if( !m_Valid || m_Size - m_Position < Padded )
+		{
+			m_Valid = false;
+			return NULL;
+		}
+
+		const unsigned char *Column = m_Data + m_Position;
+		m_Position += Padded;
+		return Column;
+	}
+};
+
+// the queries use the string IDs and row numbers stored in the columns as indexes without checking them
+// so every segment is checked once when the index is opened instead
+
+bool CheckColumn( const unsigned char *column, uint32_t rows, uint32_t limit )
+{
+	// every value is less than limit (a string ID or a row number of another table)
+
+	for( uint32_t i = 0; i < rows; ++i )
+	{
+		if( CReplayIndex :: Get( column, i ) >= limit )
+			return false;
+	}
+
+	return true;
+}
+
+bool CheckAscending( const unsigned char *column, uint32_t rows, uint32_t limit )
+{
+	// the values never decrease and none is more than limit (the start of each string or each game's players)
+
+	uint32_t Last = 0;
+
+	for( uint32_t i = 0; i < rows; ++i )
+	{
+		uint32_t Value = CReplayIndex :: Get( column, i );
+
+		if( Value < Last || Value > limit )
+			return false;
+
+		Last = Value;
+	}
+
+	return true;
+}
+
+bool CheckSegment( ReplayIndexSegment &segment )
+{
+	return CheckAscending( segment.stringOffsets, segment.numStrings + 1, CReplayIndex :: Get( segment.stringOffsets, segment.numStrings ) ) &&
+		CheckColumn( segment.gameFile, segment.numGames, segment.numStrings ) &&
+		CheckColumn( segment.gameName, segment.numGames, segment.numStrings ) &&
+		CheckAscending( segment.gameFirstPlayer, segment.numGames, segment.numPlayers ) &&
+		CheckColumn( segment.playerGame, segment.numPlayers, segment.numGames ) &&
+		CheckColumn( segment.playerName, segment.numPlayers, segment.numStrings ) &&
+		CheckColumn( segment.chatGame, segment.numChat, segment.numGames ) &&
+		CheckColumn( segment.chatMessage, segment.numChat, segment.numStrings ) &&
+		CheckColumn( segment.markerGame, segment.numMarkers, segment.numGames ) &&
+		CheckColumn( segment.markerKey, segment.numMarkers, segment.numStrings );
+}
+
+CReplayIndex :: CReplayIndex( ) : m_File( new CMappedFile( ) )
+{
+
+}
+
+CReplayIndex :: ~CReplayIndex( )
+{
+	delete m_File;
+}
+
+bool CReplayIndex :: Open( string fileName )
+{
+	m_Segments.clear( );
+
+	if( !m_File->Open( fileName, MAPPEDFILE_SEQUENTIAL ) || m_File->GetSize( ) < 8 || Get( m_File->GetData( ), 0 ) != REPLAYINDEX_MAGIC || Get( m_File->GetData( ), 1 ) != REPLAYINDEX_VERSION )
+	{
+		CONSOLE_Print( "[REPLAYINDEX] [" + fileName + "] isn't a replay index" );
+		return false;
+	}
+
+	uint32_t Position = 8;
+
+	while( Position < m_File->GetSize( ) )
+	{
+		uint32_t Size = m_File->GetSize( ) - Position >= 4 ? Get( m_File->GetData( ) + Position, 0 ) : 0;
+		Position += 4;
+
+		if( Size == 0 || Size > m_File->GetSize( ) - Position )
+		{
+			CONSOLE_Print( "[REPLAYINDEX] index [" + fileName + "] is truncated" );
+			return false;
+		}
+
+		CSegmentReader Reader( m_File->GetData( ) + Position, Size );
+		ReplayIndexSegment Segment;
+
+		Segment.numStrings = Reader.ReadUInt32( );
+		Segment.stringOffsets = Reader.ReadColumn( ( (uint64_t)Segment.numStrings + 1 ) * 4 );
+		Segment.stringData = (const char *)Reader.ReadColumn( Segment.stringOffsets ? Get( Segment.stringOffsets, Segment.numStrings ) : 0 );
+
+		Segment.numGames = Reader.ReadUInt32( );
+		Segment.gameID = Reader.ReadColumn( (uint64_t)Segment.numGames * 4 );
+		Segment.gameFile = Reader.ReadColumn( (uint64_t)Segment.numGames * 4 );
+		Segment.gameName = Reader.ReadColumn( (uint64_t)Segment.numGames * 4 );
+		Segment.gameDuration = Reader.ReadColumn( (uint64_t)Segment.numGames * 4 );
+		Segment.gameFirstPlayer = Reader.ReadColumn( (uint64_t)Segment.numGames * 4 );
+
+		Segment.numPlayers = Reader.ReadUInt32( );
+		Segment.playerGame = Reader.ReadColumn( (uint64_t)Segment.numPlayers * 4 );
+		Segment.playerName = Reader.ReadColumn( (uint64_t)Segment.numPlayers * 4 );
+		Segment.playerLeft = Reader.ReadColumn( (uint64_t)Segment.numPlayers * 4 );
+		Segment.playerLeftResult = Reader.ReadColumn( (uint64_t)Segment.numPlayers * 4 );
+		Segment.playerPID = Reader.ReadColumn( Segment.numPlayers );
+		Segment.playerTeam = Reader.ReadColumn( Segment.numPlayers );
+		Segment.playerColour = Reader.ReadColumn( Segment.numPlayers );
+
+		Segment.numChat = Reader.ReadUInt32( );
+		Segment.chatGame = Reader.ReadColumn( (uint64_t)Segment.numChat * 4 );
+		Segment.chatTime = Reader.ReadColumn( (uint64_t)Segment.numChat * 4 );
+		Segment.chatMessage = Reader.ReadColumn( (uint64_t)Segment.numChat * 4 );
+		Segment.chatPID = Reader.ReadColumn( Segment.numChat );
+
+		Segment.numMarkers = Reader.ReadUInt32( );
+		Segment.markerGame = Reader.ReadColumn( (uint64_t)Segment.numMarkers * 4 );
+		Segment.markerTime = Reader.ReadColumn( (uint64_t)Segment.numMarkers * 4 );
+		Segment.markerKey = Reader.ReadColumn( (uint64_t)Segment.numMarkers * 4 );
+		Segment.markerValue = Reader.ReadColumn( (uint64_t)Segment.numMarkers * 4 );
+		Segment.markerPID = Reader.ReadColumn( Segment.numMarkers );
+		Segment.markerType = Reader.ReadColumn( Segment.numMarkers );
+
+		if( !Reader.GetValid( ) || !CheckSegment( Segment ) )
+		{
+			CONSOLE_Print( "[REPLAYINDEX] index [" + fileName + "] has an invalid segment" );
+			return false;
+		}
+
+		m_Segments.push_back( Segment );
+		Position += Size;
+	}
+
+	m_File->Advise( MAPPEDFILE_RANDOM );
+	return true;
+}
+
+uint32_t CReplayIndex :: Get( const unsigned char *column, uint32_t row )
+{
+	uint32_t Value;
+	memcpy( &Value, column + row * 4, 4 );
+	return Value;
+}
+
+string CReplayIndex :: GetString( ReplayIndexSegment *segment, uint32_t id )
+{
+	if( id >= segment->numStrings )
+		return string( );
+
+	// Open checked that the offsets are ascending and within stringData
+
+	uint32_t Start = Get( segment->stringOffsets, id );
+	return string( segment->stringData + Start, Get( segment->stringOffsets, id + 1 ) - Start );
+}
+
+string CReplayIndex :: GetPlayerName( ReplayIndexSegment *segment, uint32_t game, unsigned char pid )
+{
+	// the players of each game are stored together starting at gameFirstPlayer
+
+	uint32_t End = game + 1 < segment->numGames ? Get( segment->gameFirstPlayer, game + 1 ) : segment->numPlayers;
+
+	for( uint32_t i = Get( segment->gameFirstPlayer, game ); i < End && i < segment->numPlayers; ++i )
+	{
+		if( GetByte( segment->playerPID, i ) == pid )
+			return GetString( segment, Get( segment->playerName, i ) );
+	}
+
+	return "PID " + UTIL_ToString( pid );
+}
@@ -0,0 +1,180 @@
+/*
+
+	ent-ghost
+	Copyright [2011-2013] [Jack Lu]
+
+	This file is part of the ent-ghost source code.
+
+	ent-ghost is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	ent-ghost source code is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with ent-ghost source code. If not, see <http://www.gnu.org/licenses/>.
+
+	ent-ghost is modified from GHost++ (http://ghostplusplus.googlecode.com/)
+	GHost++ is Copyright [2008] [Trevor Hogan]
+
+*/
+
+#ifndef REPLAYINDEX_H
+#define REPLAYINDEX_H
+
+// replayindex is a separate program that indexes a directory of replays so questions like "which games did player X leave early" can be answered without opening every replay
+// build: replayindex build <replay path> <index file> [threads]
+// the index is split into segments of REPLAYINDEX_SEGMENTREPLAYS replays, each segment has its own string table followed by one column per field of each table
+// so building only keeps one segment in memory and a query only touches the columns it needs
+
+#define REPLAYINDEX_MAGIC			0x49524847	// "GHRI"
+#define REPLAYINDEX_VERSION			1
+#define REPLAYINDEX_SEGMENTREPLAYS	1024		// replays per segment
+#define REPLAYINDEX_NOTLEFT			0xFFFFFFFF	// the leave time of a player that was still in the game when the replay ended
+
+#define REPLAYINDEX_MARKER_W3MMD	0
+#define REPLAYINDEX_MARKER_DOTA		1
+
+class CMappedFile;
+
+struct ReplayIndexPlayer {
+	unsigned char pid;
+	string name;
+	unsigned char team;
+	unsigned char colour;
+	uint32_t left;							// game time in milliseconds, zero if the player left during loading
+	uint32_t leftResult;
+
+	ReplayIndexPlayer( unsigned char nPID, string nName, unsigned char nTeam, unsigned char nColour ) : pid( nPID ), name( nName ), team( nTeam ), colour( nColour ), left( REPLAYINDEX_NOTLEFT ), leftResult( 0 ) { }
+};
+
+struct ReplayIndexChat {
+	uint32_t time;
+	unsigned char pid;
+	string message;
+
+	ReplayIndexChat( uint32_t nTime, unsigned char nPID, string nMessage ) : time( nTime ), pid( nPID ), message( nMessage ) { }
+};
+
+struct ReplayIndexMarker {
+	uint32_t time;
+	unsigned char pid;
+	unsigned char type;						// REPLAYINDEX_MARKER_*
+	string key;								// mission key and key separated by a space
+	uint32_t value;
+
+	ReplayIndexMarker( uint32_t nTime, unsigned char nPID, unsigned char nType, string nKey, uint32_t nValue ) : time( nTime ), pid( nPID ), type( nType ), key( nKey ), value( nValue ) { }
+};
+
+// everything we keep of one replay until its segment is written
+
+struct ReplaySummary {
+	bool valid;
+	string fileName;
+	uint32_t id;							// the database ID the replay is named after, zero if it isn't named after one
+	string gameName;
+	uint32_t duration;						// milliseconds
+	vector<ReplayIndexPlayer> players;
+	vector<ReplayIndexChat> chat;
+	vector<ReplayIndexMarker> markers;
+
+	ReplaySummary( ) : valid( false ), id( 0 ), duration( 0 ) { }
+};
+
+//
+// CReplayIndexBuilder
+//
+
+class CReplayIndexBuilder
+{
+private:
+	string m_Path;
+	string m_FileName;
+	uint32_t m_NumThreads;
+	vector<string> m_Files;					// the replays of the segment being built
+	vector<ReplaySummary> m_Summaries;
+	uint32_t m_NextFile;					// the next replay in m_Files a worker should take
+	boost::mutex m_NextFileMutex;
+
+public:
+	CReplayIndexBuilder( string nPath, string nFileName, uint32_t nNumThreads );
+	~CReplayIndexBuilder( );
+
+	bool Build( );
+
+	static void Summarize( string fileName, ReplaySummary &summary );
+
+	void loop( );
+
+private:
+	string BuildSegment( );
+};
+
+//
+// CReplayIndex
+//
+
+// the columns of one segment point straight into the mapped index file
+
+struct ReplayIndexSegment {
+	uint32_t numStrings;
+	const unsigned char *stringOffsets;
+	const char *stringData;
+
+	uint32_t numGames;
+	const unsigned char *gameID;
+	const unsigned char *gameFile;
+	const unsigned char *gameName;
+	const unsigned char *gameDuration;
+	const unsigned char *gameFirstPlayer;
+
+	uint32_t numPlayers;
+	const unsigned char *playerGame;
+	const unsigned char *playerName;
+	const unsigned char *playerLeft;
+	const unsigned char *playerLeftResult;
+	const unsigned char *playerPID;
+	const unsigned char *playerTeam;
+	const unsigned char *playerColour;
+
+	uint32_t numChat;
+	const unsigned char *chatGame;
+	const unsigned char *chatTime;
+	const unsigned char *chatMessage;
+	const unsigned char *chatPID;
+
+	uint32_t numMarkers;
+	const unsigned char *markerGame;
+	const unsigned char *markerTime;
+	const unsigned char *markerKey;
+	const unsigned char *markerValue;
+	const unsigned char *markerPID;
+	const unsigned char *markerType;
+};
+
+class CReplayIndex
+{
+private:
+	CMappedFile *m_File;
+	vector<ReplayIndexSegment> m_Segments;
+
+public:
+	CReplayIndex( );
+	~CReplayIndex( );
+
+	bool Open( string fileName );
+
+	uint32_t GetNumSegments( )							{ return m_Segments.size( ); }
+	ReplayIndexSegment *GetSegment( uint32_t segment )	{ return &m_Segments[segment]; }
+
+	static uint32_t Get( const unsigned char *column, uint32_t row );
+	static unsigned char GetByte( const unsigned char *column, uint32_t row )	{ return column[row]; }
+	static string GetString( ReplayIndexSegment *segment, uint32_t id );
+	static string GetPlayerName( ReplayIndexSegment *segment, uint32_t game, unsigned char pid );
+};
+
+#endif
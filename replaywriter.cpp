@@ -0,0 +1,234 @@
+/*
+
+	ent-ghost
+	Copyright [2011-2013] [Jack Lu]
+
+	This file is part of the ent-ghost source code.
+
+	ent-ghost is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	ent-ghost source code is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with ent-ghost source code. If not, see <http://www.gnu.org/licenses/>.
+
+	ent-ghost is modified from GHost++ (http://ghostplusplus.googlecode.com/)
+	GHost++ is Copyright [2008] [Trevor Hogan]
+
+*/
+
+#include "ghost.h"
+#include "util.h"
+#include "crc32.h"
+#include "packed.h"
+#include "replaywriter.h"
+
+#include <stdio.h>
+
+#include <boost/filesystem.hpp>
+
+//
+// CReplayWriter
+//
+
+CReplayWriter :: CReplayWriter( string nFileName ) : m_FileName( nFileName ), m_File( NULL ), m_CRC( new CCRC32( ) ), m_BlocksSize( 0 ), m_NumBlocks( 0 ), m_NumPending( 0 ), m_Error( false )
+{
+	m_CRC->Initialize( );
+	m_File = fopen( m_FileName.c_str( ), "wb" );
+
+	// leave room for the header
+
+	char Header[PACKED_HEADERSIZE];
+	memset( Header, 0, PACKED_HEADERSIZE );
+
+	if( !m_File || fwrite( Header, 1, PACKED_HEADERSIZE, m_File ) != PACKED_HEADERSIZE )
+	{
+		CONSOLE_Print( "[REPLAY] error opening file [" + m_FileName + "] for writing" );
+		m_Error = true;
+	}
+}
+
+CReplayWriter :: ~CReplayWriter( )
+{
+	if( m_File )
+		fclose( m_File );
+
+	delete m_CRC;
+}
+
+bool CReplayWriter :: GetError( )
+{
+	boost::mutex::scoped_lock lock( m_Mutex );
+	return m_Error;
+}
+
+uint32_t CReplayWriter :: GetBlocksSize( )
+{
+	boost::mutex::scoped_lock lock( m_Mutex );
+	return m_BlocksSize;
+}
+
+uint32_t CReplayWriter :: GetNumBlocks( )
+{
+	boost::mutex::scoped_lock lock( m_Mutex );
+	return m_NumBlocks;
+}
+
+void CReplayWriter :: AddPending( )
+{
+	boost::mutex::scoped_lock lock( m_Mutex );
+	++m_NumPending;
+}
+
+void CReplayWriter :: CompressChunk( const string &chunk )
+{
+	// called by the compressor thread, the file is only touched here until the writer is idle
+
+	string Block;
+	bool Compressed = CPacked :: CompressBlock( m_CRC, (const unsigned char *)chunk.data( ), Block );
+
+	boost::mutex::scoped_lock lock( m_Mutex );
+
+	if( !m_Error )
+	{
+		if( Compressed && fwrite( Block.data( ), 1, Block.size( ), m_File ) == Block.size( ) )
+		{
+			m_BlocksSize += Block.size( );
+			++m_NumBlocks;
+		}
+		else
+		{
+			CONSOLE_Print( "[REPLAY] error writing to file [" + m_FileName + "]" );
+			m_Error = true;
+		}
+	}
+
+	if( --m_NumPending == 0 )
+		m_Idle.notify_all( );
+}
+
+bool CReplayWriter :: Wait( )
+{
+	// wait for every chunk handed to the compressor so far to be written
+
+	boost::mutex::scoped_lock lock( m_Mutex );
+	WaitIdle( lock );
+	return !m_Error;
+}
+
+bool CReplayWriter :: Finish( const BYTEARRAY &header, string fileName )
+{
+	// overwrite the space we left at the start of the file with the header and move the file to its final name
+	// the header needs the total size of the blocks so the caller has to Wait first
+
+	boost::mutex::scoped_lock lock( m_Mutex );
+	WaitIdle( lock );
+
+	if( m_Error || !m_File || header.size( ) != PACKED_HEADERSIZE || fseek( m_File, 0, SEEK_SET ) != 0 || fwrite( &header[0], 1, header.size( ), m_File ) != header.size( ) )
+		m_Error = true;
+
+	if( m_File && fclose( m_File ) != 0 )
+		m_Error = true;
+
+	m_File = NULL;
+
+	if( !m_Error )
+	{
+		boost::system::error_code Error;
+		boost::filesystem::rename( m_FileName, fileName, Error );
+
+		if( Error )
+		{
+			CONSOLE_Print( "[REPLAY] error renaming file [" + m_FileName + "] to [" + fileName + "] - " + Error.message( ) );
+			m_Error = true;
+		}
+	}
+
+	if( m_Error )
+		remove( m_FileName.c_str( ) );
+
+	return !m_Error;
+}
+
+void CReplayWriter :: Abort( )
+{
+	boost::mutex::scoped_lock lock( m_Mutex );
+	WaitIdle( lock );
+	m_Error = true;
+
+	if( m_File )
+		fclose( m_File );
+
+	m_File = NULL;
+	remove( m_FileName.c_str( ) );
+}
+
+void CReplayWriter :: WaitIdle( boost::mutex::scoped_lock &lock )
+{
+	while( m_NumPending > 0 )
+		m_Idle.wait( lock );
+}
+
+//
+// CReplayCompressor
+//
+
+CReplayCompressor :: CReplayCompressor( ) : m_Exiting( false ), m_Thread( NULL )
+{
+	m_Thread = new boost::thread( &CReplayCompressor :: loop, this );
+}
+
+CReplayCompressor :: ~CReplayCompressor( )
+{
+	// the thread compresses whatever is still queued before it stops so nobody waiting on a writer is stuck
+
+	boost::mutex::scoped_lock lock( m_QueueMutex );
+	m_Exiting = true;
+	m_QueueCond.notify_all( );
+	lock.unlock( );
+
+	m_Thread->join( );
+	delete m_Thread;
+}
+
+void CReplayCompressor :: Compress( const SHAREDREPLAYWRITER &writer, string &chunk )
+{
+	// note: chunk is swapped into the queue so the caller mustn't rely on its contents afterwards
+
+	writer->AddPending( );
+
+	boost::mutex::scoped_lock lock( m_QueueMutex );
+	m_Queue.push_back( make_pair( writer, string( ) ) );
+	m_Queue.back( ).second.swap( chunk );
+	m_QueueCond.notify_one( );
+}
+
+void CReplayCompressor :: loop( )
+{
+	boost::mutex::scoped_lock lock( m_QueueMutex );
+
+	while( true )
+	{
+		while( m_Queue.empty( ) && !m_Exiting )
+			m_QueueCond.wait( lock );
+
+		if( m_Queue.empty( ) )
+			break;
+
+		pair<SHAREDREPLAYWRITER, string> Job;
+		Job.first.swap( m_Queue.front( ).first );
+		Job.second.swap( m_Queue.front( ).second );
+		m_Queue.pop_front( );
+		lock.unlock( );
+
+		Job.first->CompressChunk( Job.second );
+
+		lock.lock( );
+	}
+}
@@ -0,0 +1,99 @@
+/*
+
+	ent-ghost
+	Copyright [2011-2013] [Jack Lu]
+
+	This file is part of the ent-ghost source code.
+
+	ent-ghost is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	ent-ghost source code is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with ent-ghost source code. If not, see <http://www.gnu.org/licenses/>.
+
+	ent-ghost is modified from GHost++ (http://ghostplusplus.googlecode.com/)
+	GHost++ is Copyright [2008] [Trevor Hogan]
+
+*/
+
+#ifndef REPLAYWRITER_H
+#define REPLAYWRITER_H
+
+class CCRC32;
+
+//
+// CReplayWriter
+//
+
+// a replay that's written to a file while the game is still running instead of being compressed all at once at the end
+// CReplay hands over its data in PACKED_BLOCKSIZE chunks as they fill up, the chunks are compressed by the replay compressor thread and appended to the file
+// the file starts with room for the header which is only written when the replay is finished, then it's renamed to the real replay file name (see CReplay :: Save)
+// so a long game only keeps a partial block in memory and finishing it is just compressing the last block and writing the header
+
+class CReplayWriter
+{
+private:
+	string m_FileName;
+	FILE *m_File;
+	CCRC32 *m_CRC;								// only used by the compressor thread
+	uint32_t m_BlocksSize;						// bytes of blocks written to the file (including the block headers)
+	uint32_t m_NumBlocks;
+	uint32_t m_NumPending;						// chunks waiting to be compressed
+	bool m_Error;
+	boost::mutex m_Mutex;						// protects everything above
+	boost::condition_variable m_Idle;			// signalled when m_NumPending drops to zero
+
+public:
+	CReplayWriter( string nFileName );
+	~CReplayWriter( );
+
+	string GetFileName( )						{ return m_FileName; }
+	bool GetError( );
+	uint32_t GetBlocksSize( );
+	uint32_t GetNumBlocks( );
+
+	void AddPending( );
+	void CompressChunk( const string &chunk );
+	bool Wait( );
+	bool Finish( const BYTEARRAY &header, string fileName );
+	void Abort( );
+
+private:
+	void WaitIdle( boost::mutex::scoped_lock &lock );
+};
+
+typedef boost::shared_ptr<CReplayWriter> SHAREDREPLAYWRITER;
+
+//
+// CReplayCompressor
+//
+
+// a single thread that compresses the replay chunks of every game
+// the chunks of one replay have to be written in order so there's no point in having more than one thread, and compressing 8 KB takes well under a millisecond
+
+class CReplayCompressor
+{
+private:
+	deque<pair<SHAREDREPLAYWRITER, string> > m_Queue;
+	boost::mutex m_QueueMutex;
+	boost::condition_variable m_QueueCond;
+	volatile bool m_Exiting;
+	boost::thread *m_Thread;
+
+public:
+	CReplayCompressor( );
+	~CReplayCompressor( );
+
+	void Compress( const SHAREDREPLAYWRITER &writer, string &chunk );
+
+	void loop( );
+};
+
+#endif
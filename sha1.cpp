@@ -19,6 +19,214 @@
 
 #include "sha1.h"
 
+#if defined( __GNUC__ ) && defined( __x86_64__ )
+ #define SHA1_SHANI
+ #include <cpuid.h>
+ #include <immintrin.h>
+#endif
+
+#ifdef SHA1_SHANI
+
+// the SHA-NI instructions need SSSE3 and SSE4.1 as well (for the byte shuffle and the final extract)
+
+static bool SHANIDetect()
+{
+	unsigned int eax = 0, ebx = 0, ecx = 0, edx = 0;
+
+	if(__get_cpuid_max(0, NULL) < 7)
+		return false;
+
+	__cpuid_count(7, 0, eax, ebx, ecx, edx);
+
+	if(!(ebx & (1 << 29)))
+		return false;
+
+	__get_cpuid(1, &eax, &ebx, &ecx, &edx);
+	return (ecx & bit_SSSE3) && (ecx & bit_SSE4_1);
+}
+
+// this is set once during static initialization so there's nothing to synchronize later (DisableSHANI is only for sha1bench)
+static bool g_SHANI = SHANIDetect();
+
+// Transform numBlocks 64 byte blocks with the SHA-NI instructions
+// the round structure follows Intel's "New Instructions Supporting the Secure Hash Algorithm on Intel Architecture Processors" (2013)
+__attribute__((target("sha,ssse3,sse4.1"))) static void SHANITransform(uint32_t state[5], const unsigned char *data, unsigned int numBlocks)
+{
+	__m128i ABCD, ABCD_SAVE, E0, E0_SAVE, E1;
+	__m128i MSG0, MSG1, MSG2, MSG3;
+	const __m128i MASK = _mm_set_epi64x(0x0001020304050607ULL, 0x08090a0b0c0d0e0fULL);
+
+	ABCD = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)state), 0x1B);
+	E0 = _mm_set_epi32(state[4], 0, 0, 0);
+
+	while(numBlocks--)
+	{
+		ABCD_SAVE = ABCD;
+		E0_SAVE = E0;
+
+		// rounds 0-3
+		MSG0 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(data + 0)), MASK);
+		E0 = _mm_add_epi32(E0, MSG0);
+		E1 = ABCD;
+		ABCD = _mm_sha1rnds4_epu32(ABCD, E0, 0);
+
+		// rounds 4-7
+		MSG1 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(data + 16)), MASK);
+		E1 = _mm_sha1nexte_epu32(E1, MSG1);
+		E0 = ABCD;
+		ABCD = _mm_sha1rnds4_epu32(ABCD, E1, 0);
+		MSG0 = _mm_sha1msg1_epu32(MSG0, MSG1);
+
+		// rounds 8-11
+		MSG2 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(data + 32)), MASK);
+		E0 = _mm_sha1nexte_epu32(E0, MSG2);
+		E1 = ABCD;
+		ABCD = _mm_sha1rnds4_epu32(ABCD, E0, 0);
+		MSG1 = _mm_sha1msg1_epu32(MSG1, MSG2);
+		MSG0 = _mm_xor_si128(MSG0, MSG2);
+
+		// rounds 12-15
+		MSG3 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(data + 48)), MASK);
+		E1 = _mm_sha1nexte_epu32(E1, MSG3);
+		E0 = ABCD;
+		MSG0 = _mm_sha1msg2_epu32(MSG0, MSG3);
+		ABCD = _mm_sha1rnds4_epu32(ABCD, E1, 0);
+		MSG2 = _mm_sha1msg1_epu32(MSG2, MSG3);
+		MSG1 = _mm_xor_si128(MSG1, MSG3);
+
+		// rounds 16-19
+		E0 = _mm_sha1nexte_epu32(E0, MSG0);
+		E1 = ABCD;
+		MSG1 = _mm_sha1msg2_epu32(MSG1, MSG0);
+		ABCD = _mm_sha1rnds4_epu32(ABCD, E0, 0);
+		MSG3 = _mm_sha1msg1_epu32(MSG3, MSG0);
+		MSG2 = _mm_xor_si128(MSG2, MSG0);
+
+		// rounds 20-23
+		E1 = _mm_sha1nexte_epu32(E1, MSG1);
+		E0 = ABCD;
+		MSG2 = _mm_sha1msg2_epu32(MSG2, MSG1);
+		ABCD = _mm_sha1rnds4_epu32(ABCD, E1, 1);
+		MSG0 = _mm_sha1msg1_epu32(MSG0, MSG1);
+		MSG3 = _mm_xor_si128(MSG3, MSG1);
+
+		// rounds 24-27
+		E0 = _mm_sha1nexte_epu32(E0, MSG2);
+		E1 = ABCD;
+		MSG3 = _mm_sha1msg2_epu32(MSG3, MSG2);
+		ABCD = _mm_sha1rnds4_epu32(ABCD, E0, 1);
+		MSG1 = _mm_sha1msg1_epu32(MSG1, MSG2);
+		MSG0 = _mm_xor_si128(MSG0, MSG2);
+
+		// rounds 28-31
+		E1 = _mm_sha1nexte_epu32(E1, MSG3);
+		E0 = ABCD;
+		MSG0 = _mm_sha1msg2_epu32(MSG0, MSG3);
+		ABCD = _mm_sha1rnds4_epu32(ABCD, E1, 1);
+		MSG2 = _mm_sha1msg1_epu32(MSG2, MSG3);
+		MSG1 = _mm_xor_si128(MSG1, MSG3);
+
+		// rounds 32-35
+		E0 = _mm_sha1nexte_epu32(E0, MSG0);
+		E1 = ABCD;
+		MSG1 = _mm_sha1msg2_epu32(MSG1, MSG0);
+		ABCD = _mm_sha1rnds4_epu32(ABCD, E0, 1);
+		MSG3 = _mm_sha1msg1_epu32(MSG3, MSG0);
+		MSG2 = _mm_xor_si128(MSG2, MSG0);
+
+		// rounds 36-39
+		E1 = _mm_sha1nexte_epu32(E1, MSG1);
+		E0 = ABCD;
+		MSG2 = _mm_sha1msg2_epu32(MSG2, MSG1);
+		ABCD = _mm_sha1rnds4_epu32(ABCD, E1, 1);
+		MSG0 = _mm_sha1msg1_epu32(MSG0, MSG1);
+		MSG3 = _mm_xor_si128(MSG3, MSG1);
+
+		// rounds 40-43
+		E0 = _mm_sha1nexte_epu32(E0, MSG2);
+		E1 = ABCD;
+		MSG3 = _mm_sha1msg2_epu32(MSG3, MSG2);
+		ABCD = _mm_sha1rnds4_epu32(ABCD, E0, 2);
+		MSG1 = _mm_sha1msg1_epu32(MSG1, MSG2);
+		MSG0 = _mm_xor_si128(MSG0, MSG2);
+
+		// rounds 44-47
+		E1 = _mm_sha1nexte_epu32(E1, MSG3);
+		E0 = ABCD;
+		MSG0 = _mm_sha1msg2_epu32(MSG0, MSG3);
+		ABCD = _mm_sha1rnds4_epu32(ABCD, E1, 2);
+		MSG2 = _mm_sha1msg1_epu32(MSG2, MSG3);
+		MSG1 = _mm_xor_si128(MSG1, MSG3);
+
+		// rounds 48-51
+		E0 = _mm_sha1nexte_epu32(E0, MSG0);
+		E1 = ABCD;
+		MSG1 = _mm_sha1msg2_epu32(MSG1, MSG0);
+		ABCD = _mm_sha1rnds4_epu32(ABCD, E0, 2);
+		MSG3 = _mm_sha1msg1_epu32(MSG3, MSG0);
+		MSG2 = _mm_xor_si128(MSG2, MSG0);
+
+		// rounds 52-55
+		E1 = _mm_sha1nexte_epu32(E1, MSG1);
+		E0 = ABCD;
+		MSG2 = _mm_sha1msg2_epu32(MSG2, MSG1);
+		ABCD = _mm_sha1rnds4_epu32(ABCD, E1, 2);
+		MSG0 = _mm_sha1msg1_epu32(MSG0, MSG1);
+		MSG3 = _mm_xor_si128(MSG3, MSG1);
+
+		// rounds 56-59
+		E0 = _mm_sha1nexte_epu32(E0, MSG2);
+		E1 = ABCD;
+		MSG3 = _mm_sha1msg2_epu32(MSG3, MSG2);
+		ABCD = _mm_sha1rnds4_epu32(ABCD, E0, 2);
+		MSG1 = _mm_sha1msg1_epu32(MSG1, MSG2);
+		MSG0 = _mm_xor_si128(MSG0, MSG2);
+
+		// rounds 60-63
+		E1 = _mm_sha1nexte_epu32(E1, MSG3);
+		E0 = ABCD;
+		MSG0 = _mm_sha1msg2_epu32(MSG0, MSG3);
+		ABCD = _mm_sha1rnds4_epu32(ABCD, E1, 3);
+		MSG2 = _mm_sha1msg1_epu32(MSG2, MSG3);
+		MSG1 = _mm_xor_si128(MSG1, MSG3);
+
+		// rounds 64-67
+		E0 = _mm_sha1nexte_epu32(E0, MSG0);
+		E1 = ABCD;
+		MSG1 = _mm_sha1msg2_epu32(MSG1, MSG0);
+		ABCD = _mm_sha1rnds4_epu32(ABCD, E0, 3);
+		MSG3 = _mm_sha1msg1_epu32(MSG3, MSG0);
+		MSG2 = _mm_xor_si128(MSG2, MSG0);
+
+		// rounds 68-71
+		E1 = _mm_sha1nexte_epu32(E1, MSG1);
+		E0 = ABCD;
+		MSG2 = _mm_sha1msg2_epu32(MSG2, MSG1);
+		ABCD = _mm_sha1rnds4_epu32(ABCD, E1, 3);
+		MSG3 = _mm_xor_si128(MSG3, MSG1);
+
+		// rounds 72-75
+		E0 = _mm_sha1nexte_epu32(E0, MSG2);
+		E1 = ABCD;
+		MSG3 = _mm_sha1msg2_epu32(MSG3, MSG2);
+		ABCD = _mm_sha1rnds4_epu32(ABCD, E0, 3);
+
+		// rounds 76-79
+		E1 = _mm_sha1nexte_epu32(E1, MSG3);
+		E0 = ABCD;
+		ABCD = _mm_sha1rnds4_epu32(ABCD, E1, 3);
+
+		E0 = _mm_sha1nexte_epu32(E0, E0_SAVE);
+		ABCD = _mm_add_epi32(ABCD, ABCD_SAVE);
+		data += 64;
+	}
+
+	_mm_storeu_si128((__m128i *)state, _mm_shuffle_epi32(ABCD, 0x1B));
+	state[4] = _mm_extract_epi32(E0, 3);
+}
+
+#endif
+
 
 CSHA1::CSHA1()
 {
@@ -44,13 +252,43 @@ void CSHA1::Reset()
 	m_count[1] = 0;
 }
 
-void CSHA1::Transform(uint32_t state[5], unsigned char buffer[64])
+bool CSHA1::UsingSHANI()
+{
+#ifdef SHA1_SHANI
+	return g_SHANI;
+#else
+	return false;
+#endif
+}
+
+void CSHA1::DisableSHANI()
+{
+#ifdef SHA1_SHANI
+	g_SHANI = false;
+#endif
+}
+
+void CSHA1::Transform(uint32_t state[5], const unsigned char *buffer, unsigned int numBlocks)
+{
+#ifdef SHA1_SHANI
+	if(g_SHANI)
+	{
+		SHANITransform(state, buffer, numBlocks);
+		return;
+	}
+#endif
+
+	for(; numBlocks > 0; --numBlocks, buffer += 64)
+		TransformBlock(state, buffer);
+}
+
+void CSHA1::TransformBlock(uint32_t state[5], const unsigned char *buffer)
 {
 	uint32_t a = 0, b = 0, c = 0, d = 0, e = 0;
 
-	SHA1_WORKSPACE_BLOCK* block;
-	static unsigned char workspace[64];
-	block = (SHA1_WORKSPACE_BLOCK *)workspace;
+	// the workspace is on the stack (it used to be static) so concurrent hashes don't trample each other
+	SHA1_WORKSPACE_BLOCK workspace;
+	SHA1_WORKSPACE_BLOCK* block = &workspace;
 	memcpy(block, buffer, 64);
 
 	// Copy state[] to working vars
@@ -107,12 +345,12 @@ void CSHA1::Update(unsigned char* data, unsigned int len)
 	if((j + len) > 63)
 	{
 		memcpy(&m_buffer[j], data, (i = 64 - j));
-		Transform(m_state, m_buffer);
+		Transform(m_state, m_buffer, 1);
 
-		for (; i+63 < len; i += 64)
-		{
-			Transform(m_state, &data[i]);
-		}
+		// transform all the whole blocks in one call so the SHA-NI path can keep the state in registers
+		unsigned int numBlocks = (len - i) / 64;
+		Transform(m_state, &data[i], numBlocks);
+		i += numBlocks * 64;
 
 		j = 0;
 	}
@@ -149,7 +387,7 @@ void CSHA1::Final()
 	memset(m_count, 0, 8);
 	memset(finalcount, 0, 8);
 
-	Transform(m_state, m_buffer);
+	Transform(m_state, m_buffer, 1);
 }
 
 // Get the final hash as a pre-formatted string
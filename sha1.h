@@ -33,6 +33,9 @@
 
 #define MAX_FILE_READ_BUFFER 8000
 
+// each CSHA1 object only touches its own state so separate objects can be used from different threads at the same time
+// on x86-64 CPUs with the SHA extensions the blocks are transformed with the SHA-NI instructions, otherwise with the portable code below
+
 class CSHA1
 {
 public:
@@ -83,9 +86,16 @@ public:
 	void ReportHash(char *szReport, unsigned char uReportType = REPORT_HEX);
 	void GetHash(unsigned char *uDest);
 
+	// If the blocks are transformed with the SHA-NI instructions
+	static bool UsingSHANI();
+
+	// Only used to test and time the portable code on CPUs with SHA-NI (see sha1bench), call it before hashing anything
+	static void DisableSHANI();
+
 private:
-	// Private SHA-1 transformation
-	void Transform(uint32_t state[5], unsigned char buffer[64]);
+	// Private SHA-1 transformation of numBlocks consecutive 64 byte blocks
+	void Transform(uint32_t state[5], const unsigned char *buffer, unsigned int numBlocks);
+	static void TransformBlock(uint32_t state[5], const unsigned char *buffer);
 };
 
 #endif // ___SHA1_H___
@@ -0,0 +1,236 @@
+/*
+
+	ent-ghost
+	Copyright [2011-2013] [Jack Lu]
+
+	This file is part of the ent-ghost source code.
+
+	ent-ghost is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	ent-ghost source code is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with ent-ghost source code. If not, see <http://www.gnu.org/licenses/>.
+
+	ent-ghost is modified from GHost++ (http://ghostplusplus.googlecode.com/)
+	GHost++ is Copyright [2008] [Trevor Hogan]
+
+*/
+
+
+#include "ghost.h"
+#include "util.h"
+#include "sha1.h"
+
+#include <time.h>
+
+#ifndef WIN32
+ #include <sys/time.h>
+#endif
+
+#ifdef __APPLE__
+ #include <mach/mach_time.h>
+#endif
+
+// sha1bench is a separate program that checks CSHA1 against the FIPS 180-1 test vectors and times it
+// on CPUs with the SHA extensions it checks and times the SHA-NI path first, then disables it and does the same with the portable code
+// every digest has to be the same on both paths, including for every length around the 64 byte block size at every alignment and for data split over several updates
+
+#define SHA1BENCH_MINTICKS 1000
+
+boost::mutex PrintMutex;
+
+uint32_t GetTime( )
+{
+	return GetTicks( ) / 1000;
+}
+
+uint32_t GetTicks( )
+{
+#ifdef WIN32
+	return timeGetTime( );
+#elif __APPLE__
+	uint64_t current = mach_absolute_time( );
+	static mach_timebase_info_data_t info = { 0, 0 };
+
+	if( info.denom == 0 )
+		mach_timebase_info( &info );
+
+	uint64_t elapsednano = current * ( info.numer / info.denom );
+	return elapsednano / 1e6;
+#else
+	uint32_t ticks;
+	struct timespec t;
+	clock_gettime( CLOCK_MONOTONIC, &t );
+	ticks = t.tv_sec * 1000;
+	ticks += t.tv_nsec / 1000000;
+	return ticks;
+#endif
+}
+
+void CONSOLE_Print( string message )
+{
+	boost::mutex::scoped_lock printLock( PrintMutex );
+	cout << message << endl;
+}
+
+string GenerateData( uint32_t size )
+{
+	string Data( size, 0 );
+	uint32_t Seed = 12345;
+
+	for( uint32_t i = 0; i < size; ++i )
+	{
+		Seed = Seed * 1103515245 + 12345;
+		Data[i] = (char)( Seed >> 24 );
+	}
+
+	return Data;
+}
+
+string Digest( const string &data, uint32_t chunkSize )
+{
+	// hash data with one Update per chunkSize bytes and return the digest in hex
+
+	CSHA1 SHA;
+	uint32_t Position = 0;
+
+	do
+	{
+		uint32_t Length = min( (uint32_t)data.size( ) - Position, chunkSize );
+		SHA.Update( (unsigned char *)data.data( ) + Position, Length );
+		Position += Length;
+	} while( Position < data.size( ) );
+
+	SHA.Final( );
+	unsigned char Hash[20];
+	SHA.GetHash( Hash );
+	string Hex;
+	char Buffer[3];
+
+	for( int i = 0; i < 20; ++i )
+	{
+		snprintf( Buffer, sizeof( Buffer ), "%02x", Hash[i] );
+		Hex += Buffer;
+	}
+
+	return Hex;
+}
+
+bool Check( string path, string name, const string &data, string expected )
+{
+	bool Success = true;
+
+	// the whole buffer in one update, then in uneven pieces
+
+	uint32_t Chunks[] = { 0xFFFFFFFF, 1, 7, 63, 65, MAX_FILE_READ_BUFFER };
+
+	for( uint32_t i = 0; i < sizeof( Chunks ) / sizeof( Chunks[0] ); ++i )
+	{
+		if( i > 0 && Chunks[i] >= data.size( ) )
+			continue;
+
+		if( i > 0 && Chunks[i] < 64 && data.size( ) > 65536 )
+			continue;
+
+		string Hex = Digest( data, Chunks[i] );
+
+		if( Hex != expected )
+		{
+			CONSOLE_Print( "[SHA1BENCH] " + path + " failed on " + name + ( i > 0 ? " in " + UTIL_ToString( Chunks[i] ) + " byte updates" : string( ) ) + ", expected " + expected + ", got " + Hex );
+			Success = false;
+		}
+	}
+
+	return Success;
+}
+
+bool Run( string path, const string &data, vector<string> &digests )
+{
+	// the first path records the digests of the generated data, the second has to match them
+
+	bool Success = true;
+	bool First = digests.empty( );
+
+	Success = Check( path, "\"\"", string( ), "da39a3ee5e6b4b0d3255bfef95601890afd80709" ) && Success;
+	Success = Check( path, "\"abc\"", "abc", "a9993e364706816aba3e25717850c26c9cd0d89d" ) && Success;
+	Success = Check( path, "the two block FIPS vector", "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq", "84983e441c3bd26ebaae4aa1f95129e5e54670f1" ) && Success;
+	Success = Check( path, "a million \"a\"", string( 1000000, 'a' ), "34aa973cd4c4daa4f61eeb2bdbad27316534016f" ) && Success;
+
+	string Bytes( 1048581, 0 );
+
+	for( uint32_t i = 0; i < Bytes.size( ); ++i )
+		Bytes[i] = (char)( i & 0xFF );
+
+	Success = Check( path, "1 MB + 5 of counting bytes", Bytes, "0eaf42839eaec6c562e1412fb56339c7096f6c3a" ) && Success;
+	uint32_t Next = 0;
+
+	for( uint32_t Offset = 0; Offset < 16; ++Offset )
+	{
+		for( uint32_t Length = 0; Length <= 200; ++Length )
+		{
+			string Piece = data.substr( Offset, Length );
+			string Hex = Digest( Piece, 0xFFFFFFFF );
+
+			if( First )
+				digests.push_back( Hex );
+
+			Success = Check( path, UTIL_ToString( Length ) + " bytes at offset " + UTIL_ToString( Offset ), Piece, digests[Next++] ) && Success;
+		}
+	}
+
+	if( First )
+		digests.push_back( Digest( data, 0xFFFFFFFF ) );
+
+	Success = Check( path, "4 MB of generated data", data, digests[Next] ) && Success;
+
+	if( !Success )
+		return false;
+
+	// time it the way map_sha1 is calculated, the map's script files in MAX_FILE_READ_BUFFER byte updates
+
+	uint64_t Hashed = 0;
+	uint32_t StartTicks = GetTicks( );
+
+	do
+	{
+		Digest( data, MAX_FILE_READ_BUFFER );
+		Hashed += data.size( );
+	} while( GetTicks( ) - StartTicks < SHA1BENCH_MINTICKS );
+
+	uint32_t Ticks = GetTicks( ) - StartTicks;
+	CONSOLE_Print( "[SHA1BENCH] " + path + ": " + UTIL_ToString( Hashed / 1048576.0 * 1000 / max( Ticks, (uint32_t)1 ), 1 ) + " MB/s" );
+	return true;
+}
+
+int main( int argc, char **argv )
+{
+	string Data = GenerateData( 4 * 1024 * 1024 );
+	vector<string> Digests;
+	bool Success = true;
+
+	if( CSHA1 :: UsingSHANI( ) )
+	{
+		Success = Run( "SHA-NI", Data, Digests ) && Success;
+		CSHA1 :: DisableSHANI( );
+	}
+	else
+		CONSOLE_Print( "[SHA1BENCH] this CPU doesn't support SHA-NI, only checking the portable code" );
+
+	Success = Run( "portable", Data, Digests ) && Success;
+
+	if( !Success )
+	{
+		CONSOLE_Print( "[SHA1BENCH] FAILED" );
+		return 1;
+	}
+
+	CONSOLE_Print( "[SHA1BENCH] every implementation matches" );
+	return 0;
+}
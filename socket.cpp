@@ -37,12 +37,12 @@
 // CSocket
 //
 
-CSocket :: CSocket( ) :  m_Socket( INVALID_SOCKET ), m_HasError( false ), m_Error( 0 )
+CSocket :: CSocket( ) :  m_Socket( INVALID_SOCKET ), m_HasError( false ), m_Error( 0 ), m_Reactor( NULL ), m_ReactorTag( NULL ), m_Readable( false ), m_Writable( false )
 {
         memset( &m_SIN, 0, sizeof( m_SIN ) );
 }
 
-CSocket :: CSocket( SOCKET nSocket, struct sockaddr_in nSIN ) : m_Socket( nSocket ), m_SIN( nSIN ), m_HasError( false ), m_Error( 0 )
+CSocket :: CSocket( SOCKET nSocket, struct sockaddr_in nSIN ) : m_Socket( nSocket ), m_SIN( nSIN ), m_HasError( false ), m_Error( 0 ), m_Reactor( NULL ), m_ReactorTag( NULL ), m_Readable( false ), m_Writable( false )
 {
 
 }
@@ -130,6 +130,41 @@ void CSocket :: SetFD( fd_set *fd, fd_set *send_fd, int *nfds )
 #endif
 }
 
+void CSocket :: SetReactor( CGameReactor *nReactor, void *nReactorTag )
+{
+	m_Reactor = nReactor;
+	m_ReactorTag = nReactorTag;
+	m_Readable = false;
+	m_Writable = false;
+}
+
+void CSocket :: EventReadiness( bool readable, bool writable )
+{
+	if( readable )
+		m_Readable = true;
+
+	if( writable )
+		m_Writable = true;
+}
+
+bool CSocket :: IsReadable( fd_set *fd )
+{
+	// sockets registered with a reactor use the edge triggered state, everything else uses the fd_set from select
+
+	if( m_Reactor )
+		return m_Readable;
+
+	return fd && FD_ISSET( m_Socket, fd );
+}
+
+bool CSocket :: IsWritable( fd_set *send_fd )
+{
+	if( m_Reactor )
+		return m_Writable;
+
+	return send_fd && FD_ISSET( m_Socket, send_fd );
+}
+
 void CSocket :: Allocate( int type )
 {
 	m_Socket = socket( AF_INET, type, 0 );
@@ -148,10 +183,16 @@ void CSocket :: Reset( )
 	if( m_Socket != INVALID_SOCKET )
 		closesocket( m_Socket );
 
+	// closing the socket also removes it from any epoll set so we just forget about the reactor
+
 	m_Socket = INVALID_SOCKET;
 	memset( &m_SIN, 0, sizeof( m_SIN ) );
 	m_HasError = false;
 	m_Error = 0;
+	m_Reactor = NULL;
+	m_ReactorTag = NULL;
+	m_Readable = false;
+	m_Writable = false;
 }
 
 string CSocket :: GetHostName( )
@@ -173,6 +214,208 @@ string CSocket :: GetHostName( )
                return m_CachedHostName;
 }
 
+//
+// CRecvBuffer
+//
+
+CRecvBuffer :: CRecvBuffer( ) : m_Data( NULL ), m_Capacity( 0 ), m_Start( 0 ), m_End( 0 )
+{
+
+}
+
+CRecvBuffer :: ~CRecvBuffer( )
+{
+	delete [] m_Data;
+}
+
+void CRecvBuffer :: Consume( uint32_t length )
+{
+	if( length >= m_End - m_Start )
+	{
+		// everything has been consumed so we can start over at the front of the buffer for free
+
+		m_Start = 0;
+		m_End = 0;
+	}
+	else
+		m_Start += length;
+}
+
+char *CRecvBuffer :: Reserve( uint32_t length )
+{
+	// return a pointer to at least length bytes of free space at the end of the buffer
+
+	if( m_Capacity - m_End >= length )
+		return m_Data + m_End;
+
+	uint32_t Size = m_End - m_Start;
+
+	if( m_Capacity - Size >= length )
+	{
+		// there's enough room if we move the unconsumed data back to the front
+
+		memmove( m_Data, m_Data + m_Start, Size );
+	}
+	else
+	{
+		uint32_t Capacity = m_Capacity ? m_Capacity : TCPSOCKET_RECV_SIZE;
+
+		while( Capacity - Size < length )
+			Capacity *= 2;
+
+		char *Data = new char[Capacity];
+
+		if( Size > 0 )
+			memcpy( Data, m_Data + m_Start, Size );
+
+		delete [] m_Data;
+		m_Data = Data;
+		m_Capacity = Capacity;
+	}
+
+	m_Start = 0;
+	m_End = Size;
+	return m_Data + m_End;
+}
+
+void CRecvBuffer :: Commit( uint32_t length )
+{
+	// length bytes were written to the space returned by Reserve
+
+	m_End += length;
+}
+
+//
+// CSendBuffer
+//
+
+void CSendBuffer :: clear( )
+{
+	m_Segments.clear( );
+	m_Offset = 0;
+	m_Size = 0;
+}
+
+void CSendBuffer :: Append( string &bytes )
+{
+	// note: bytes is swapped into the buffer if it gets a segment of its own so the caller mustn't rely on its contents afterwards
+
+	if( bytes.empty( ) )
+		return;
+
+	m_Size += bytes.size( );
+
+	if( !m_Segments.empty( ) && !m_Segments.back( ).shared && m_Segments.back( ).bytes.size( ) + bytes.size( ) <= TCPSOCKET_SEGMENT_SIZE )
+		m_Segments.back( ).bytes += bytes;
+	else
+	{
+		m_Segments.push_back( SendSegment( ) );
+		m_Segments.back( ).bytes.swap( bytes );
+	}
+}
+
+void CSendBuffer :: Append( const char *bytes, uint32_t length )
+{
+	if( length == 0 )
+		return;
+
+	m_Size += length;
+
+	if( !m_Segments.empty( ) && !m_Segments.back( ).shared && m_Segments.back( ).bytes.size( ) + length <= TCPSOCKET_SEGMENT_SIZE )
+		m_Segments.back( ).bytes.append( bytes, length );
+	else
+	{
+		m_Segments.push_back( SendSegment( ) );
+		m_Segments.back( ).bytes.assign( bytes, length );
+	}
+}
+
+void CSendBuffer :: Append( const SHAREDBYTEARRAY &bytes )
+{
+	// shared packets always get a segment of their own so every send buffer references the same bytes instead of copying them
+
+	if( !bytes || bytes->empty( ) )
+		return;
+
+	m_Size += bytes->size( );
+	m_Segments.push_back( SendSegment( ) );
+	m_Segments.back( ).shared = bytes;
+}
+
+void CSendBuffer :: Consume( uint32_t length )
+{
+	if( length >= m_Size )
+	{
+		clear( );
+		return;
+	}
+
+	m_Size -= length;
+
+	while( length > 0 )
+	{
+		uint32_t Remaining = m_Segments.front( ).size( ) - m_Offset;
+
+		if( length < Remaining )
+		{
+			m_Offset += length;
+			return;
+		}
+
+		length -= Remaining;
+		m_Segments.pop_front( );
+		m_Offset = 0;
+	}
+}
+
+string CSendBuffer :: GetFront( uint32_t length )
+{
+	// return a copy of the first length bytes waiting to be sent (only used for logging)
+
+	string Bytes;
+	uint32_t Offset = m_Offset;
+
+	for( deque<SendSegment> :: iterator i = m_Segments.begin( ); i != m_Segments.end( ) && Bytes.size( ) < length; ++i )
+	{
+		Bytes.append( i->data( ) + Offset, min( i->size( ) - Offset, length - (uint32_t)Bytes.size( ) ) );
+		Offset = 0;
+	}
+
+	return Bytes;
+}
+
+#ifndef WIN32
+uint32_t CSendBuffer :: GetIOVecs( struct iovec *iov, uint32_t count )
+{
+	// fill in up to count iovecs describing the data waiting to be sent and return how many were used
+
+	uint32_t Used = 0;
+	uint32_t Offset = m_Offset;
+
+	for( deque<SendSegment> :: iterator i = m_Segments.begin( ); i != m_Segments.end( ) && Used < count; ++i )
+	{
+		iov[Used].iov_base = (void *)( i->data( ) + Offset );
+		iov[Used].iov_len = i->size( ) - Offset;
+		Offset = 0;
+		++Used;
+	}
+
+	return Used;
+}
+#else
+const char *CSendBuffer :: GetFirstSegment( uint32_t *length )
+{
+	if( m_Segments.empty( ) )
+	{
+		*length = 0;
+		return NULL;
+	}
+
+	*length = m_Segments.front( ).size( ) - m_Offset;
+	return m_Segments.front( ).data( ) + m_Offset;
+}
+#endif
+
 //
 // CTCPSocket
 //
@@ -220,6 +463,7 @@ void CTCPSocket :: Reset( )
 	m_Connected = false;
 	m_RecvBuffer.clear( );
 	m_SendBuffer.clear( );
+	m_BulkSendBuffer.clear( );
 	m_LastRecv = GetTime( );
 	m_LastSend = GetTime( );
 
@@ -247,12 +491,26 @@ void CTCPSocket :: Reset( )
 
 void CTCPSocket :: PutBytes( string bytes )
 {
-	m_SendBuffer += bytes;
+	m_SendBuffer.Append( bytes );
 }
 
 void CTCPSocket :: PutBytes( BYTEARRAY bytes )
 {
-	m_SendBuffer += string( bytes.begin( ), bytes.end( ) );
+	if( !bytes.empty( ) )
+		m_SendBuffer.Append( (const char *)&bytes[0], bytes.size( ) );
+}
+
+void CTCPSocket :: PutBytes( const SHAREDBYTEARRAY &bytes )
+{
+	m_SendBuffer.Append( bytes );
+}
+
+void CTCPSocket :: PutBulkBytes( BYTEARRAY bytes )
+{
+	// bulk packets are only sent when there's nothing else waiting (see DoSend)
+	// they always get a segment of their own so we know where one ends and other data can be slipped in
+
+	m_BulkSendBuffer.Append( UTIL_CreateSharedByteArray( bytes ) );
 }
 
 void CTCPSocket :: DoRecv( fd_set *fd )
@@ -260,12 +518,18 @@ void CTCPSocket :: DoRecv( fd_set *fd )
 	if( m_Socket == INVALID_SOCKET || m_HasError || !m_Connected )
 		return;
 
-	if( FD_ISSET( m_Socket, fd ) )
+	// keep receiving until recv would block, we receive straight into the end of the receive buffer
+	// when the socket is registered with a reactor we only hear about new data once (edge triggered) so we have to drain the socket completely
+	// otherwise we stop after TCPSOCKET_RECV_MAX bytes so a fast sender can't keep us here forever, select will tell us about the rest
+
+	uint32_t Received = 0;
+
+	while( IsReadable( fd ) && ( m_Reactor || Received < TCPSOCKET_RECV_MAX ) )
 	{
 		// data is waiting, receive it
 
-		char buffer[1024];
-		int c = recv( m_Socket, buffer, 1024, 0 );
+		char *Buffer = m_RecvBuffer.Reserve( TCPSOCKET_RECV_SIZE );
+		int c = recv( m_Socket, Buffer, TCPSOCKET_RECV_SIZE, 0 );
 		
 		if( c > 0 )
 		{
@@ -278,13 +542,14 @@ void CTCPSocket :: DoRecv( fd_set *fd )
 
 				if( !Log.fail( ) )
 				{
-					Log << "					RECEIVE <<< " << UTIL_ByteArrayToHexString( UTIL_CreateByteArray( (unsigned char *)buffer, c ) ) << endl;
+					Log << "					RECEIVE <<< " << UTIL_ByteArrayToHexString( UTIL_CreateByteArray( (unsigned char *)Buffer, c ) ) << endl;
 					Log.close( );
 				}
 			}
 
-			m_RecvBuffer += string( buffer, c );
+			m_RecvBuffer.Commit( c );
 			m_LastRecv = GetTime( );
+			Received += c;
 		}
 		else if( c == SOCKET_ERROR && GetLastError( ) != EWOULDBLOCK )
 		{
@@ -301,20 +566,48 @@ void CTCPSocket :: DoRecv( fd_set *fd )
 
 			CONSOLE_Print( "[TCPSOCKET] closed by remote host" );
 			m_Connected = false;
+			return;
+		}
+		else
+		{
+			// nothing left to receive
+
+			m_Readable = false;
+			return;
 		}
 	}
 }
 
 void CTCPSocket :: DoSend( fd_set *send_fd )
 {
-	if( m_Socket == INVALID_SOCKET || m_HasError || !m_Connected || m_SendBuffer.empty( ) )
+	if( m_Socket == INVALID_SOCKET || m_HasError || !m_Connected || ( m_SendBuffer.empty( ) && m_BulkSendBuffer.empty( ) ) )
 		return;
 
-	if( FD_ISSET( m_Socket, send_fd ) )
+	while( ( !m_SendBuffer.empty( ) || !m_BulkSendBuffer.empty( ) ) && IsWritable( send_fd ) )
 	{
-		// socket is ready, send it
+		// pick the buffer to send from, the normal buffer always goes first so lobby traffic is never stuck behind map data
+		// the bulk buffer is only sent when the normal buffer is empty, or when a bulk packet was partly sent and has to be finished before anything else
+
+		CSendBuffer *Buffer = &m_SendBuffer;
 
-		int s = send( m_Socket, m_SendBuffer.c_str( ), (int)m_SendBuffer.size( ), MSG_NOSIGNAL );
+		if( m_BulkSendBuffer.GetPartial( ) || m_SendBuffer.empty( ) )
+			Buffer = &m_BulkSendBuffer;
+
+		// socket is ready, send as much of the buffer as the kernel will take
+		// on Linux all the segments go out in a single call, sendmsg is used rather than writev because writev doesn't take MSG_NOSIGNAL
+
+#ifndef WIN32
+		struct iovec IOVecs[TCPSOCKET_MAX_IOVECS];
+		struct msghdr Message;
+		memset( &Message, 0, sizeof( Message ) );
+		Message.msg_iov = IOVecs;
+		Message.msg_iovlen = Buffer->GetIOVecs( IOVecs, Buffer == &m_BulkSendBuffer && m_BulkSendBuffer.GetPartial( ) ? 1 : TCPSOCKET_MAX_IOVECS );
+		int s = sendmsg( m_Socket, &Message, MSG_NOSIGNAL );
+#else
+		uint32_t Length = 0;
+		const char *Segment = Buffer->GetFirstSegment( &Length );
+		int s = send( m_Socket, Segment, (int)Length, MSG_NOSIGNAL );
+#endif
 		
 		if( s > 0 )
 		{
@@ -327,13 +620,20 @@ void CTCPSocket :: DoSend( fd_set *send_fd )
 
 				if( !Log.fail( ) )
 				{
-					Log << "SEND >>> " << UTIL_ByteArrayToHexString( BYTEARRAY( m_SendBuffer.begin( ), m_SendBuffer.begin( ) + s ) ) << endl;
+					string Sent = Buffer->GetFront( s );
+					Log << "SEND >>> " << UTIL_ByteArrayToHexString( BYTEARRAY( Sent.begin( ), Sent.end( ) ) ) << endl;
 					Log.close( );
 				}
 			}
 
-			m_SendBuffer = m_SendBuffer.substr( s );
+			Buffer->Consume( s );
 			m_LastSend = GetTime( );
+
+			// when polled with select we only send once per call so a fast receiver can't keep us here forever
+			// but if that just emptied the normal buffer go on with the bulk buffer, it was held back for it
+
+			if( !m_Reactor && ( Buffer == &m_BulkSendBuffer || !m_SendBuffer.empty( ) ) )
+				return;
 		}
 		else if( s == SOCKET_ERROR && GetLastError( ) != EWOULDBLOCK )
 		{
@@ -344,6 +644,13 @@ void CTCPSocket :: DoSend( fd_set *send_fd )
 			CONSOLE_Print( "[TCPSOCKET] error (send) - " + GetErrorString( ) );
 			return;
 		}
+		else
+		{
+			// the kernel buffer is full, the reactor will tell us when there's room again
+
+			m_Writable = false;
+			return;
+		}
 	}
 }
 
@@ -555,7 +862,7 @@ CTCPSocket *CTCPServer :: Accept( fd_set *fd )
 	if( m_Socket == INVALID_SOCKET || m_HasError )
 		return NULL;
 
-	if( FD_ISSET( m_Socket, fd ) )
+	if( IsReadable( fd ) )
 	{
 		// a connection is waiting, accept it
 
@@ -570,6 +877,9 @@ CTCPSocket *CTCPServer :: Accept( fd_set *fd )
 #endif
 		{
 			// accept error, ignore it
+			// when using a reactor this also means there are no more connections waiting so stop trying until we're told otherwise
+
+			m_Readable = false;
 		}
 		else
 		{
@@ -76,6 +76,7 @@
  #include <sys/ioctl.h>
  #include <sys/socket.h>
  #include <sys/types.h>
+ #include <sys/uio.h>
  #include <unistd.h>
 
  typedef int SOCKET;
@@ -100,10 +101,17 @@
  #define SHUT_RDWR 2
 #endif
 
+#define TCPSOCKET_RECV_SIZE			16384		// number of bytes we try to receive with each recv call
+#define TCPSOCKET_RECV_MAX			262144		// maximum number of bytes received per DoRecv call when polled with select
+#define TCPSOCKET_SEGMENT_SIZE		16384		// small writes are merged into send buffer segments up to this size
+#define TCPSOCKET_MAX_IOVECS		64			// maximum number of send buffer segments passed to one sendmsg call
+
 //
 // CSocket
 //
 
+class CGameReactor;
+
 class CSocket
 {
 protected:
@@ -112,6 +120,10 @@ protected:
 	bool m_HasError;
 	int m_Error;
 	string m_CachedHostName;
+	CGameReactor *m_Reactor;		// the reactor this socket is registered with, NULL if it's polled with select
+	void *m_ReactorTag;				// owner of the socket as far as the reactor is concerned
+	bool m_Readable;				// edge triggered readiness reported by the reactor (cleared when recv/accept would block)
+	bool m_Writable;				// edge triggered readiness reported by the reactor (cleared when send would block)
 
 public:
 	CSocket( );
@@ -125,11 +137,98 @@ public:
 	virtual int GetError( )							{ return m_Error; }
 	virtual string GetErrorString( );
 	virtual void SetFD( fd_set *fd, fd_set *send_fd, int *nfds );
+	virtual SOCKET GetFD( )							{ return m_Socket; }
+	virtual CGameReactor *GetReactor( )				{ return m_Reactor; }
+	virtual void *GetReactorTag( )					{ return m_ReactorTag; }
+	virtual void SetReactor( CGameReactor *nReactor, void *nReactorTag );
+	virtual void EventReadiness( bool readable, bool writable );
+	virtual bool IsReadable( fd_set *fd );
+	virtual bool IsWritable( fd_set *send_fd );
 	virtual void Allocate( int type );
 	virtual void Reset( );
 	virtual string GetHostName( );
 };
 
+//
+// CRecvBuffer
+//
+
+// a receive buffer that's consumed in place
+// data is received straight into the free space at the end of the buffer and consuming data only advances the start offset
+// the unconsumed data is moved back to the front of the buffer only when we run out of room at the end (usually it's a partial packet or nothing at all)
+// so receiving and extracting packets is linear in the amount of data instead of copying the rest of the buffer for every packet
+
+class CRecvBuffer
+{
+private:
+	char *m_Data;
+	uint32_t m_Capacity;
+	uint32_t m_Start;								// offset of the first unconsumed byte
+	uint32_t m_End;									// offset just past the last received byte
+
+	CRecvBuffer( const CRecvBuffer & );
+	CRecvBuffer &operator=( const CRecvBuffer & );
+
+public:
+	CRecvBuffer( );
+	~CRecvBuffer( );
+
+	const char *GetData( )							{ return m_Data + m_Start; }
+	uint32_t GetSize( )								{ return m_End - m_Start; }
+	bool empty( )									{ return m_Start == m_End; }
+	void clear( )									{ m_Start = 0; m_End = 0; }
+
+	void Consume( uint32_t length );
+	char *Reserve( uint32_t length );
+	void Commit( uint32_t length );
+};
+
+//
+// CSendBuffer
+//
+
+// a send buffer made of a chain of segments
+// small writes are appended to the last segment, large ones get a segment of their own (strings are swapped in without copying)
+// sent data is consumed in place by advancing the offset into the first segment and dropping segments once they're fully sent
+// so a partial send never moves the rest of the buffer around and all the segments can be handed to the kernel in a single sendmsg call
+
+struct SendSegment {
+	string bytes;									// small writes are coalesced here
+	SHAREDBYTEARRAY shared;							// or the segment is a packet shared with other send buffers (see CBaseGame :: SendAll)
+
+	const char *data( )								{ return shared ? (const char *)&(*shared)[0] : bytes.data( ); }
+	uint32_t size( )								{ return shared ? shared->size( ) : bytes.size( ); }
+};
+
+class CSendBuffer
+{
+private:
+	deque<SendSegment> m_Segments;
+	uint32_t m_Offset;								// bytes of the first segment that have already been sent
+	uint32_t m_Size;								// bytes waiting to be sent
+
+public:
+	CSendBuffer( ) : m_Offset( 0 ), m_Size( 0 ) { }
+	~CSendBuffer( ) { }
+
+	uint32_t GetSize( )								{ return m_Size; }
+	bool empty( )									{ return m_Size == 0; }
+	bool GetPartial( )								{ return m_Offset != 0; }
+	void clear( );
+
+	void Append( string &bytes );
+	void Append( const char *bytes, uint32_t length );
+	void Append( const SHAREDBYTEARRAY &bytes );
+	void Consume( uint32_t length );
+	string GetFront( uint32_t length );
+
+#ifndef WIN32
+	uint32_t GetIOVecs( struct iovec *iov, uint32_t count );
+#else
+	const char *GetFirstSegment( uint32_t *length );
+#endif
+};
+
 //
 // CTCPSocket
 //
@@ -141,8 +240,9 @@ protected:
 	string m_LogFile;
 
 private:
-	string m_RecvBuffer;
-	string m_SendBuffer;
+	CRecvBuffer m_RecvBuffer;
+	CSendBuffer m_SendBuffer;
+	CSendBuffer m_BulkSendBuffer;				// low priority packets (map parts), each one is a segment of its own
 	uint32_t m_LastRecv;
 	uint32_t m_LastSend;
 
@@ -153,11 +253,14 @@ public:
 
 	virtual void Reset( );
 	virtual bool GetConnected( )				{ return m_Connected; }
-	virtual string *GetBytes( )					{ return &m_RecvBuffer; }
+	virtual CRecvBuffer *GetBytes( )			{ return &m_RecvBuffer; }
+	virtual uint32_t GetSendSize( )				{ return m_SendBuffer.GetSize( ) + m_BulkSendBuffer.GetSize( ); }
 	virtual void PutBytes( string bytes );
 	virtual void PutBytes( BYTEARRAY bytes );
+	virtual void PutBytes( const SHAREDBYTEARRAY &bytes );
+	virtual void PutBulkBytes( BYTEARRAY bytes );
 	virtual void ClearRecvBuffer( )				{ m_RecvBuffer.clear( ); }
-	virtual void ClearSendBuffer( )				{ m_SendBuffer.clear( ); }
+	virtual void ClearSendBuffer( )				{ m_SendBuffer.clear( ); m_BulkSendBuffer.clear( ); }
 	virtual uint32_t GetLastRecv( )				{ return m_LastRecv; }
 	virtual uint32_t GetLastSend( )				{ return m_LastSend; }
 	virtual void DoRecv( fd_set *fd );
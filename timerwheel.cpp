@@ -0,0 +1,254 @@
+/*
+
+	ent-ghost
+	Copyright [2011-2013] [Jack Lu]
+
+	This file is part of the ent-ghost source code.
+
+	ent-ghost is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	ent-ghost source code is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with ent-ghost source code. If not, see <http://www.gnu.org/licenses/>.
+
+	ent-ghost is modified from GHost++ (http://ghostplusplus.googlecode.com/)
+	GHost++ is Copyright [2008] [Trevor Hogan]
+
+*/
+
+#include "ghost.h"
+#include "timerwheel.h"
+
+// the number of ticks covered by one slot of the given level
+
+#define TIMERWHEEL_SPAN( level )	( (uint32_t)1 << ( TIMERWHEEL_SLOTBITS * ( level ) ) )
+
+//
+// CTimerWheel
+//
+
+CTimerWheel :: CTimerWheel( uint32_t nTicks ) : m_CurrentTicks( nTicks )
+{
+	for( uint32_t i = 0; i < TIMERWHEEL_LEVELS; ++i )
+	{
+		m_LevelCount[i] = 0;
+
+		for( uint32_t j = 0; j < TIMERWHEEL_SLOTS; ++j )
+			m_Slots[i][j] = NULL;
+	}
+}
+
+CTimerWheel :: ~CTimerWheel( )
+{
+	// the entries belong to someone else, just make sure nobody thinks they're still scheduled
+
+	for( uint32_t i = 0; i < TIMERWHEEL_LEVELS; ++i )
+	{
+		for( uint32_t j = 0; j < TIMERWHEEL_SLOTS; ++j )
+		{
+			for( TimerEntry *Timer = m_Slots[i][j]; Timer; Timer = Timer->next )
+				Timer->active = false;
+		}
+	}
+}
+
+uint32_t CTimerWheel :: GetNumTimers( )
+{
+	uint32_t NumTimers = 0;
+
+	for( uint32_t i = 0; i < TIMERWHEEL_LEVELS; ++i )
+		NumTimers += m_LevelCount[i];
+
+	return NumTimers;
+}
+
+void CTimerWheel :: Add( TimerEntry *timer, uint32_t ticks )
+{
+	if( timer->active )
+		Cancel( timer );
+
+	timer->expires = ticks;
+	Link( timer );
+}
+
+void CTimerWheel :: Cancel( TimerEntry *timer )
+{
+	if( !timer->active )
+		return;
+
+	if( timer->prev )
+		timer->prev->next = timer->next;
+	else
+		m_Slots[timer->level][timer->slot] = timer->next;
+
+	if( timer->next )
+		timer->next->prev = timer->prev;
+
+	timer->prev = NULL;
+	timer->next = NULL;
+	timer->active = false;
+	--m_LevelCount[timer->level];
+}
+
+void CTimerWheel :: Advance( uint32_t ticks, vector<TimerEntry *> &expired )
+{
+	// process every tick up to and including ticks
+	// expired timers are removed from the wheel and appended to expired in the order they fired
+
+	while( (int32_t)( ticks - m_CurrentTicks ) >= 0 )
+	{
+		// nothing can fire before the next cascade of the lowest level that has any timers in it so skip straight to it
+
+		uint32_t Level = 0;
+
+		while( Level < TIMERWHEEL_LEVELS && m_LevelCount[Level] == 0 )
+			++Level;
+
+		if( Level == TIMERWHEEL_LEVELS )
+		{
+			m_CurrentTicks = ticks + 1;
+			break;
+		}
+
+		if( Level > 0 )
+		{
+			uint32_t Span = TIMERWHEEL_SPAN( Level );
+			uint32_t Boundary = ( m_CurrentTicks + Span - 1 ) & ~( Span - 1 );
+
+			if( (int32_t)( Boundary - ticks ) > 0 )
+			{
+				m_CurrentTicks = ticks + 1;
+				break;
+			}
+
+			m_CurrentTicks = Boundary;
+		}
+
+		// move the timers of the slots that just came up to the lower levels, highest level first
+
+		for( uint32_t i = TIMERWHEEL_LEVELS - 1; i > 0; --i )
+		{
+			if( ( m_CurrentTicks & ( TIMERWHEEL_SPAN( i ) - 1 ) ) == 0 )
+				Cascade( i );
+		}
+
+		// fire everything in the current level 0 slot
+
+		uint32_t Slot = m_CurrentTicks & TIMERWHEEL_SLOTMASK;
+
+		while( m_Slots[0][Slot] )
+		{
+			TimerEntry *Timer = m_Slots[0][Slot];
+			Cancel( Timer );
+			expired.push_back( Timer );
+		}
+
+		++m_CurrentTicks;
+	}
+}
+
+uint32_t CTimerWheel :: GetTicksUntilNext( uint32_t ticks, uint32_t maximum )
+{
+	// return the number of ticks from ticks until Advance has something to do (a timer fires or a slot has to be cascaded)
+	// this is never more than maximum, which is also returned when the wheel is empty
+
+	bool Found = false;
+	uint32_t Next = 0;
+
+	for( uint32_t i = 0; i < TIMERWHEEL_LEVELS; ++i )
+	{
+		if( m_LevelCount[i] == 0 )
+			continue;
+
+		// find the first slot of this level that comes up and isn't empty
+
+		uint32_t Span = TIMERWHEEL_SPAN( i );
+		uint32_t Boundary = ( m_CurrentTicks + Span - 1 ) & ~( Span - 1 );
+
+		for( uint32_t j = 0; j < TIMERWHEEL_SLOTS; ++j )
+		{
+			uint32_t SlotTicks = Boundary + j * Span;
+
+			if( m_Slots[i][( SlotTicks >> ( TIMERWHEEL_SLOTBITS * i ) ) & TIMERWHEEL_SLOTMASK] )
+			{
+				if( !Found || (int32_t)( SlotTicks - Next ) < 0 )
+					Next = SlotTicks;
+
+				Found = true;
+				break;
+			}
+		}
+	}
+
+	if( !Found )
+		return maximum;
+
+	if( (int32_t)( Next - ticks ) <= 0 )
+		return 0;
+
+	if( Next - ticks < maximum )
+		return Next - ticks;
+
+	return maximum;
+}
+
+void CTimerWheel :: Link( TimerEntry *timer )
+{
+	// overdue timers go in the slot that's processed next
+	// timers beyond the range of the wheel are pulled in to the furthest slot
+
+	uint32_t Delta = timer->expires - m_CurrentTicks;
+
+	if( (int32_t)Delta < 0 )
+	{
+		Delta = 0;
+		timer->expires = m_CurrentTicks;
+	}
+	else if( Delta >= TIMERWHEEL_SPAN( TIMERWHEEL_LEVELS ) )
+	{
+		Delta = TIMERWHEEL_SPAN( TIMERWHEEL_LEVELS ) - 1;
+		timer->expires = m_CurrentTicks + Delta;
+	}
+
+	uint32_t Level = 0;
+
+	while( Level < TIMERWHEEL_LEVELS - 1 && Delta >= TIMERWHEEL_SPAN( Level + 1 ) )
+		++Level;
+
+	timer->level = Level;
+	timer->slot = ( timer->expires >> ( TIMERWHEEL_SLOTBITS * Level ) ) & TIMERWHEEL_SLOTMASK;
+	timer->prev = NULL;
+	timer->next = m_Slots[Level][timer->slot];
+
+	if( timer->next )
+		timer->next->prev = timer;
+
+	m_Slots[Level][timer->slot] = timer;
+	timer->active = true;
+	++m_LevelCount[Level];
+}
+
+void CTimerWheel :: Cascade( uint32_t level )
+{
+	// relink every timer in the slot of this level that just came up
+	// they're all due within the span of one slot so they end up in one of the lower levels
+
+	uint32_t Slot = ( m_CurrentTicks >> ( TIMERWHEEL_SLOTBITS * level ) ) & TIMERWHEEL_SLOTMASK;
+	TimerEntry *Timer = m_Slots[level][Slot];
+	m_Slots[level][Slot] = NULL;
+
+	while( Timer )
+	{
+		TimerEntry *Next = Timer->next;
+		--m_LevelCount[level];
+		Link( Timer );
+		Timer = Next;
+	}
+}
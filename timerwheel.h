@@ -0,0 +1,82 @@
+/*
+
+	ent-ghost
+	Copyright [2011-2013] [Jack Lu]
+
+	This file is part of the ent-ghost source code.
+
+	ent-ghost is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	ent-ghost source code is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with ent-ghost source code. If not, see <http://www.gnu.org/licenses/>.
+
+	ent-ghost is modified from GHost++ (http://ghostplusplus.googlecode.com/)
+	GHost++ is Copyright [2008] [Trevor Hogan]
+
+*/
+
+#ifndef TIMERWHEEL_H
+#define TIMERWHEEL_H
+
+#define TIMERWHEEL_LEVELS		4
+#define TIMERWHEEL_SLOTBITS		6
+#define TIMERWHEEL_SLOTS		( 1 << TIMERWHEEL_SLOTBITS )
+#define TIMERWHEEL_SLOTMASK		( TIMERWHEEL_SLOTS - 1 )
+
+//
+// CTimerWheel
+//
+
+// a hierarchical timer wheel with millisecond resolution (times are GetTicks values)
+// level 0 holds timers due within 64ms with one slot per tick, each higher level covers 64 times the range of the level below it
+// timers in the higher levels are moved down ("cascaded") when their slot comes up, so adding, cancelling and expiring a timer are all O(1)
+// timers further away than the wheel can hold (~4.6 hours) are clamped to the last slot and simply fire early
+// the wheel doesn't allocate anything, the owner of a timer embeds a TimerEntry and keeps it alive while it's scheduled
+// warning: the wheel isn't synchronized, it must only be touched by the thread that owns it
+
+struct TimerEntry;
+
+class CTimerWheel
+{
+private:
+	TimerEntry *m_Slots[TIMERWHEEL_LEVELS][TIMERWHEEL_SLOTS];
+	uint32_t m_LevelCount[TIMERWHEEL_LEVELS];	// number of timers in each level
+	uint32_t m_CurrentTicks;					// the next tick to be processed, every timer due before this has already fired
+
+public:
+	CTimerWheel( uint32_t nTicks );
+	~CTimerWheel( );
+
+	uint32_t GetNumTimers( );
+
+	void Add( TimerEntry *timer, uint32_t ticks );
+	void Cancel( TimerEntry *timer );
+	void Advance( uint32_t ticks, vector<TimerEntry *> &expired );
+	uint32_t GetTicksUntilNext( uint32_t ticks, uint32_t maximum );
+
+private:
+	void Link( TimerEntry *timer );
+	void Cascade( uint32_t level );
+};
+
+struct TimerEntry {
+	TimerEntry *prev;
+	TimerEntry *next;
+	void *data;									// owner data, not used by the wheel
+	uint32_t expires;							// GetTicks when the timer fires
+	unsigned char level;
+	unsigned char slot;
+	bool active;								// if the timer is currently in the wheel
+
+	TimerEntry( void *nData = NULL ) : prev( NULL ), next( NULL ), data( nData ), expires( 0 ), level( 0 ), slot( 0 ), active( false ) { }
+};
+
+#endif
@@ -69,6 +69,15 @@ BYTEARRAY UTIL_CreateByteArray( uint32_t i, bool reverse )
 		return result;
 }
 
+SHAREDBYTEARRAY UTIL_CreateSharedByteArray( BYTEARRAY &b )
+{
+	// note: the contents of b are swapped into the shared byte array rather than copied so b is empty afterwards
+
+	BYTEARRAY *Shared = new BYTEARRAY( );
+	Shared->swap( b );
+	return SHAREDBYTEARRAY( Shared );
+}
+
 uint16_t UTIL_ByteArrayToUInt16( BYTEARRAY b, bool reverse, unsigned int start )
 {
 	if( b.size( ) < start + 2 )